@@ -1 +1 @@
-gcc -g -Wall -Wextra -Werror src/tokenizer.c src/string_util.c src/parser.c src/ast.c src/main.c src/processor.c src/output/fasm_linux_x86_64.c src/file_util.c src/ast_walk.c src/ast_clone.c src/output/x86_64_util.c src/output/util.c src/output/qbe.c -o barely $@
+gcc -g -Wall -Wextra -Werror src/tokenizer.c src/string_util.c src/parser.c src/ast.c src/main.c src/processor.c src/inliner.c src/reachability.c src/layout.c src/ir.c src/symbol_table.c src/arena.c src/interner.c src/keywords.c src/thread_pool.c src/stats.c src/output/fasm_linux_x86_64.c src/file_util.c src/ast_serialize.c src/module_cache.c src/ast_walk.c src/ast_clone.c src/output/x86_64_util.c src/output/register_allocation.c src/output/x86_64_instruction.c src/output/peephole.c src/output/writer.c src/output/x86_64_encoder.c src/output/elf_linux_x86_64.c src/output/qbe.c -pthread -o barely $@
@@ -0,0 +1,115 @@
+# every word the compiler recognizes by name, regenerate src/keywords.{h,c} with `python generate_keywords.py` after changing it
+words = [
+    ("Keyword_Proc", "proc"),
+    ("Keyword_Macro", "macro"),
+    ("Keyword_Type", "type"),
+    ("Keyword_Struct", "struct"),
+    ("Keyword_Union", "union"),
+    ("Keyword_Enum", "enum"),
+    ("Keyword_Mod", "mod"),
+    ("Keyword_Global", "global"),
+    ("Keyword_Const", "const"),
+    ("Keyword_Var", "var"),
+    ("Keyword_If", "if"),
+    ("Keyword_Else", "else"),
+    ("Keyword_While", "while"),
+    ("Keyword_Break", "break"),
+    ("Keyword_Return", "return"),
+
+    ("Literal_True", "true"),
+    ("Literal_False", "false"),
+    ("Literal_Null", "null"),
+
+    ("Intrinsic_TypeOf", "@typeof"),
+    ("Intrinsic_SizeOf", "@sizeof"),
+    ("Intrinsic_LengthOf", "@lengthof"),
+    ("Intrinsic_IsType", "@istype"),
+    ("Intrinsic_Cast", "@cast"),
+    ("Intrinsic_Init", "@init"),
+    ("Intrinsic_Build", "@build"),
+    ("Intrinsic_File", "@file"),
+    ("Intrinsic_Line", "@line"),
+    ("Intrinsic_Os", "@os"),
+    ("Intrinsic_Linux", "@linux"),
+    ("Intrinsic_Syscall0", "@syscall0"),
+    ("Intrinsic_Syscall1", "@syscall1"),
+    ("Intrinsic_Syscall2", "@syscall2"),
+    ("Intrinsic_Syscall3", "@syscall3"),
+    ("Intrinsic_Syscall4", "@syscall4"),
+    ("Intrinsic_Syscall5", "@syscall5"),
+    ("Intrinsic_Syscall6", "@syscall6"),
+    ("Intrinsic_Copy", "@copy"),
+    ("Intrinsic_Set", "@set"),
+
+    ("Builtin_UInt", "uint"),
+    ("Builtin_UInt64", "uint64"),
+    ("Builtin_UInt32", "uint32"),
+    ("Builtin_UInt16", "uint16"),
+    ("Builtin_UInt8", "uint8"),
+    ("Builtin_Float64", "float64"),
+    ("Builtin_Byte", "byte"),
+    ("Builtin_Ptr", "ptr"),
+    ("Builtin_Bool", "bool"),
+]
+
+# every word is at least two characters long
+def word_hash(word, multipliers, size):
+    return (len(word) + ord(word[0]) * multipliers[0] + ord(word[1]) * multipliers[1] + ord(word[-1]) * multipliers[2]) & (size - 1)
+
+def find_parameters():
+    size = 64
+    while True:
+        for first in range(1, 64):
+            for second in range(1, 64):
+                for last in range(1, 64):
+                    multipliers = (first, second, last)
+                    slots = set(word_hash(word, multipliers, size) for _, word in words)
+                    if len(slots) == len(words):
+                        return multipliers, size
+        size *= 2
+
+def main():
+    multipliers, size = find_parameters()
+
+    table = [None] * size
+    for id, word in words:
+        table[word_hash(word, multipliers, size)] = (id, word)
+
+    header = open("src/keywords.h", "w")
+    header.write("// generated by generate_keywords.py, do not edit\n\n")
+    header.write("#ifndef KEYWORDS__\n#define KEYWORDS__\n\n#include <stddef.h>\n\n")
+    header.write("typedef enum {\n    Word_None,\n")
+    for id, _ in words:
+        header.write(f"    {id},\n")
+    header.write("} Word_Id;\n\n")
+    header.write("Word_Id lookup_word(char* string, size_t length);\n")
+    header.write("char* get_word_string(Word_Id id);\n\n#endif\n")
+    header.close()
+
+    source = open("src/keywords.c", "w")
+    source.write("// generated by generate_keywords.py, do not edit\n\n")
+    source.write("#include <string.h>\n\n#include \"keywords.h\"\n\n")
+    source.write("typedef struct {\n    char* string;\n    size_t length;\n    Word_Id id;\n} Word_Entry;\n\n")
+    source.write("// perfect hash over length, first, second and last character\n")
+    source.write(f"static Word_Entry word_table[{size}] = {{\n")
+    for entry in table:
+        if entry is None:
+            source.write("    { NULL, 0, Word_None },\n")
+        else:
+            id, word = entry
+            source.write(f"    {{ \"{word}\", {len(word)}, {id} }},\n")
+    source.write("};\n\n")
+    source.write("Word_Id lookup_word(char* string, size_t length) {\n")
+    source.write("    if (length < 2) {\n        return Word_None;\n    }\n\n")
+    source.write(f"    size_t hash = (length + (unsigned char) string[0] * {multipliers[0]} + (unsigned char) string[1] * {multipliers[1]} + (unsigned char) string[length - 1] * {multipliers[2]}) & {size - 1};\n")
+    source.write("    Word_Entry* entry = &word_table[hash];\n")
+    source.write("    if (entry->length == length && memcmp(entry->string, string, length) == 0) {\n        return entry->id;\n    }\n")
+    source.write("    return Word_None;\n}\n\n")
+    source.write("char* get_word_string(Word_Id id) {\n")
+    source.write("    switch (id) {\n")
+    for id, word in words:
+        source.write(f"        case {id}: return \"{word}\";\n")
+    source.write("        default: return NULL;\n    }\n}\n")
+    source.close()
+
+main()
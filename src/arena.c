@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 8
+
+Arena arena_new(char* name) {
+    return (Arena) {
+        .name = name,
+        .current = NULL,
+        .used = 0,
+        .high_water = 0,
+    };
+}
+
+static Arena_Chunk* arena_chunk_new(Arena_Chunk* previous, size_t size) {
+    Arena_Chunk* chunk = malloc(sizeof(Arena_Chunk) + size);
+    if (chunk == NULL) {
+        printf("Error: Out of memory\n");
+        exit(1);
+    }
+
+    chunk->previous = previous;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+void* arena_allocate(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+
+    Arena_Chunk* chunk = arena->current;
+    if (chunk == NULL || chunk->used + size > chunk->size) {
+        size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = arena_chunk_new(chunk, chunk_size);
+        arena->current = chunk;
+    }
+
+    void* result = chunk->data + chunk->used;
+    chunk->used += size;
+
+    arena->used += size;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+
+    memset(result, 0, size);
+    return result;
+}
+
+char* arena_copy_string_length(Arena* arena, char* string, size_t length) {
+    char* result = arena_allocate(arena, length + 1);
+    memcpy(result, string, length);
+    result[length] = 0;
+    return result;
+}
+
+// keeps the most recent chunk around so the arena can be refilled without going back to malloc
+void arena_reset(Arena* arena) {
+    Arena_Chunk* chunk = arena->current;
+    if (chunk == NULL) {
+        return;
+    }
+
+    Arena_Chunk* previous = chunk->previous;
+    while (previous != NULL) {
+        Arena_Chunk* next = previous->previous;
+        free(previous);
+        previous = next;
+    }
+
+    chunk->previous = NULL;
+    chunk->used = 0;
+    arena->used = 0;
+}
+
+// takes over the chunks of other, which is left empty
+// the high water marks are added, since the arenas were filled independently
+void arena_merge(Arena* arena, Arena* other) {
+    if (other->current != NULL) {
+        Arena_Chunk* oldest = other->current;
+        while (oldest->previous != NULL) {
+            oldest = oldest->previous;
+        }
+
+        if (arena->current == NULL) {
+            arena->current = other->current;
+        } else {
+            oldest->previous = arena->current->previous;
+            arena->current->previous = other->current;
+        }
+    }
+
+    arena->used += other->used;
+    arena->high_water += other->high_water;
+
+    other->current = NULL;
+    other->used = 0;
+    other->high_water = 0;
+}
+
+void arena_free(Arena* arena) {
+    Arena_Chunk* chunk = arena->current;
+    while (chunk != NULL) {
+        Arena_Chunk* previous = chunk->previous;
+        free(chunk);
+        chunk = previous;
+    }
+
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+void arena_print_usage(Arena* arena) {
+    printf("%s arena: %zu bytes high water\n", arena->name, arena->high_water);
+}
@@ -0,0 +1,33 @@
+#ifndef ARENA__
+#define ARENA__
+
+#include <stddef.h>
+
+typedef struct Arena_Chunk Arena_Chunk;
+
+struct Arena_Chunk {
+    Arena_Chunk* previous;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+// bump allocator, everything allocated from it is released together
+typedef struct {
+    char* name;
+    Arena_Chunk* current;
+    size_t used;
+    size_t high_water;
+} Arena;
+
+Arena arena_new(char* name);
+void* arena_allocate(Arena* arena, size_t size);
+char* arena_copy_string_length(Arena* arena, char* string, size_t length);
+void arena_reset(Arena* arena);
+void arena_merge(Arena* arena, Arena* other);
+void arena_free(Arena* arena);
+void arena_print_usage(Arena* arena);
+
+#define arena_new_value(arena, Type) ((Type*) arena_allocate(arena, sizeof(Type)))
+
+#endif
@@ -24,6 +24,11 @@ typedef struct {
 typedef enum {
     Directive_If,
     Directive_Entry,
+    // called by the startup code once the entry procedure returns
+    Directive_Exit,
+    Directive_Packed,
+    Directive_Inline,
+    Directive_NoInline,
 } Directive_Kind;
 
 typedef struct {
@@ -40,6 +45,8 @@ typedef struct Ast_Item Ast_Item;
 
 typedef struct {
     char* name;
+    // set when the name is an intrinsic like @syscall3
+    Word_Id id;
 } Ast_Identifier;
 
 typedef enum {
@@ -439,6 +446,7 @@ typedef struct {
     Array_Ast_Type returns;
     Ast_Expression* body;
     bool has_implicit_return;
+    bool computed_address_taken;
     Location end_location;
 } Ast_Item_Procedure;
 
@@ -449,9 +457,19 @@ typedef struct {
     Array_Ast_Macro_Variant variants;
 } Ast_Item_Macro;
 
+// sizes and field offsets of a named type, computed the first time layout.c is asked for them
+typedef struct {
+    size_t size;
+    size_t alignment;
+    size_t* offsets;
+    size_t* sizes;
+    size_t count;
+} Type_Layout;
+
 typedef struct {
     char* name;
     Ast_Type type;
+    Type_Layout* computed_layout;
 } Ast_Item_Type;
 
 typedef struct {
@@ -466,6 +484,7 @@ typedef struct {
 
 struct Ast_Item {
     Array_Ast_Directive directives;
+    Location location;
     enum {
         Item_Procedure,
         Item_Macro,
@@ -480,6 +499,8 @@ struct Ast_Item {
         Ast_Item_Global global;
         Ast_Item_Constant constant;
     } data;
+    // not reached from the entry procedure, so nothing is output for it
+    bool computed_unreachable;
 };
 
 typedef struct {
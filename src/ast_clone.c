@@ -2,7 +2,7 @@
 
 #include "ast_clone.h"
 
-Array_Ast_Directive clone_directives(Array_Ast_Directive directives) {
+Array_Ast_Directive clone_directives(Array_Ast_Directive directives, Arena* arena) {
     Array_Ast_Directive result = array_ast_directive_new(directives.count);
     for (size_t i = 0; i < directives.count; i++) {
         Ast_Directive directive = directives.elements[i];
@@ -10,13 +10,19 @@ Array_Ast_Directive clone_directives(Array_Ast_Directive directives) {
         switch (directive.kind) {
             case Directive_If: {
                 Ast_Directive_If* if_in = &directive.data.if_;
-                Ast_Directive_If if_out = { .expression = malloc(sizeof(Ast_Expression)) };
+                Ast_Directive_If if_out = { .expression = arena_allocate(arena, sizeof(Ast_Expression)) };
 
-                *if_out.expression = clone_expression(*if_in->expression);
+                *if_out.expression = clone_expression(*if_in->expression, arena);
 
                 directive_result.data.if_ = if_out;
                 break;
             }
+            case Directive_Entry:
+            case Directive_Exit:
+            case Directive_Packed:
+            case Directive_Inline:
+            case Directive_NoInline:
+                break;
             default:
                 assert(false);
         }
@@ -25,9 +31,9 @@ Array_Ast_Directive clone_directives(Array_Ast_Directive directives) {
     return result;
 }
 
-Ast_Item clone_item(Ast_Item item) {
+Ast_Item clone_item(Ast_Item item, Arena* arena) {
     Ast_Item result = {};
-    result.directives = clone_directives(item.directives);
+    result.directives = clone_directives(item.directives, arena);
     result.kind = item.kind;
 
     switch (item.kind) {
@@ -38,18 +44,18 @@ Ast_Item clone_item(Ast_Item item) {
             for (size_t i = 0; i < procedure_in->arguments.count; i++) {
                 Ast_Declaration* declaration_in = &procedure_in->arguments.elements[i];
                 Ast_Declaration declaration_out = { .name = declaration_in->name, .location = declaration_in->location };
-                declaration_out.type = clone_type(declaration_in->type);
+                declaration_out.type = clone_type(declaration_in->type, arena);
                 array_ast_declaration_append(&procedure_out.arguments, declaration_out);
             }
 
             for (size_t i = 0; i < procedure_in->returns.count; i++) {
-                Ast_Type* result_type = malloc(sizeof(Ast_Type));
-                *result_type = clone_type(*procedure_in->returns.elements[i]);
+                Ast_Type* result_type = arena_allocate(arena, sizeof(Ast_Type));
+                *result_type = clone_type(*procedure_in->returns.elements[i], arena);
                 array_ast_type_append(&procedure_out.returns, result_type);
             }
 
-            procedure_out.body = malloc(sizeof(Ast_Expression));
-            *procedure_out.body = clone_expression(*procedure_in->body);
+            procedure_out.body = arena_allocate(arena, sizeof(Ast_Expression));
+            *procedure_out.body = clone_expression(*procedure_in->body, arena);
 
             result.data.procedure = procedure_out;
             break;
@@ -58,7 +64,7 @@ Ast_Item clone_item(Ast_Item item) {
             Ast_Item_Type* type_in = &item.data.type;
             Ast_Item_Type type_out = { .name = type_in->name };
 
-            type_out.type = clone_type(type_in->type);
+            type_out.type = clone_type(type_in->type, arena);
 
             result.data.type = type_out;
             break;
@@ -70,9 +76,9 @@ Ast_Item clone_item(Ast_Item item) {
     return result;
 }
 
-Ast_Statement clone_statement(Ast_Statement statement) {
+Ast_Statement clone_statement(Ast_Statement statement, Arena* arena) {
     Ast_Statement result = {};
-    result.directives = clone_directives(statement.directives);
+    result.directives = clone_directives(statement.directives, arena);
     result.kind = statement.kind;
     result.statement_end_location = statement.statement_end_location;
 
@@ -84,19 +90,19 @@ Ast_Statement clone_statement(Ast_Statement statement) {
             for (size_t i = 0; i < declare_in->declarations.count; i++) {
                 Ast_Declaration* declaration_in = &declare_in->declarations.elements[i];
                 Ast_Declaration declaration_out = { .name = declaration_in->name, .location = declaration_in->location };
-                declaration_out.type = clone_type(declaration_in->type);
+                declaration_out.type = clone_type(declaration_in->type, arena);
                 array_ast_declaration_append(&declare_out.declarations, declaration_out);
             }
 
-            declare_out.expression = malloc(sizeof(Ast_Expression));
-            *declare_out.expression = clone_expression(*declare_in->expression);
+            declare_out.expression = arena_allocate(arena, sizeof(Ast_Expression));
+            *declare_out.expression = clone_expression(*declare_in->expression, arena);
 
             result.data.declare = declare_out;
             break;
         }
         case Statement_Assign: {
             Ast_Statement_Assign* assign_in = &statement.data.assign;
-            Ast_Statement_Assign assign_out = { .parts = array_statement_assign_part_new(assign_in->parts.count), .expression = malloc(sizeof(Ast_Expression)) };
+            Ast_Statement_Assign assign_out = { .parts = array_statement_assign_part_new(assign_in->parts.count), .expression = arena_allocate(arena, sizeof(Ast_Expression)) };
 
             for (size_t i = 0; i < assign_in->parts.count; i++) {
                 Statement_Assign_Part* assign_part_in = &assign_in->parts.elements[i];
@@ -110,17 +116,17 @@ Ast_Statement clone_statement(Ast_Statement statement) {
                         break;
                     }
                     case Retrieve_Assign_Parent: {
-                        assign_part_out.data.parent.expression = malloc(sizeof(Ast_Expression));
-                        *assign_part_out.data.parent.expression = clone_expression(*assign_part_in->data.parent.expression);
+                        assign_part_out.data.parent.expression = arena_allocate(arena, sizeof(Ast_Expression));
+                        *assign_part_out.data.parent.expression = clone_expression(*assign_part_in->data.parent.expression, arena);
                         assign_part_out.data.parent.name = assign_part_in->data.parent.name;
                         assign_part_out.data.parent.needs_reference = assign_part_in->data.parent.needs_reference;
                         break;
                     }
                     case Retrieve_Assign_Array: {
-                        assign_part_out.data.array.expression_inner = malloc(sizeof(Ast_Expression));
-                        *assign_part_out.data.array.expression_inner = clone_expression(*assign_part_in->data.array.expression_inner);
-                        assign_part_out.data.array.expression_outer = malloc(sizeof(Ast_Expression));
-                        *assign_part_out.data.array.expression_outer = clone_expression(*assign_part_in->data.array.expression_outer);
+                        assign_part_out.data.array.expression_inner = arena_allocate(arena, sizeof(Ast_Expression));
+                        *assign_part_out.data.array.expression_inner = clone_expression(*assign_part_in->data.array.expression_inner, arena);
+                        assign_part_out.data.array.expression_outer = arena_allocate(arena, sizeof(Ast_Expression));
+                        *assign_part_out.data.array.expression_outer = clone_expression(*assign_part_in->data.array.expression_outer, arena);
                         break;
                     }
                     default:
@@ -130,16 +136,16 @@ Ast_Statement clone_statement(Ast_Statement statement) {
                 array_statement_assign_part_append(&assign_out.parts, assign_part_out);
             }
 
-            *assign_out.expression = clone_expression(*assign_in->expression);
+            *assign_out.expression = clone_expression(*assign_in->expression, arena);
 
             result.data.assign = assign_out;
             break;
         }
         case Statement_Expression: {
             Ast_Statement_Expression* expression_in = &statement.data.expression;
-            Ast_Statement_Expression expression_out = { .expression = malloc(sizeof(Ast_Expression)) };
+            Ast_Statement_Expression expression_out = { .expression = arena_allocate(arena, sizeof(Ast_Expression)) };
 
-            *expression_out.expression = clone_expression(*expression_in->expression);
+            *expression_out.expression = clone_expression(*expression_in->expression, arena);
             expression_out.skip_stack_check = expression_in->skip_stack_check;
 
             result.data.expression = expression_out;
@@ -147,9 +153,9 @@ Ast_Statement clone_statement(Ast_Statement statement) {
         }
         case Statement_While: {
             Ast_Statement_While* while_in = &statement.data.while_;
-            Ast_Statement_While while_out = { .condition = malloc(sizeof(Ast_Expression)), .inside = malloc(sizeof(Ast_Expression)) };
-            *while_out.condition = clone_expression(*while_in->condition);
-            *while_out.inside = clone_expression(*while_in->inside);
+            Ast_Statement_While while_out = { .condition = arena_allocate(arena, sizeof(Ast_Expression)), .inside = arena_allocate(arena, sizeof(Ast_Expression)) };
+            *while_out.condition = clone_expression(*while_in->condition, arena);
+            *while_out.inside = clone_expression(*while_in->inside, arena);
 
             result.data.while_ = while_out;
             break;
@@ -161,7 +167,7 @@ Ast_Statement clone_statement(Ast_Statement statement) {
     return result;
 }
 
-Ast_Type clone_type(Ast_Type type) {
+Ast_Type clone_type(Ast_Type type, Arena* arena) {
     Ast_Type result;
     result.kind = type.kind;
 
@@ -175,22 +181,22 @@ Ast_Type clone_type(Ast_Type type) {
         }
         case Type_Pointer: {
             Ast_Type_Pointer* pointer_in = &type.data.pointer;
-            Ast_Type_Pointer pointer_out = { .child = malloc(sizeof(Ast_Type)) };
+            Ast_Type_Pointer pointer_out = { .child = arena_allocate(arena, sizeof(Ast_Type)) };
 
-            *pointer_out.child = clone_type(*pointer_in->child);
+            *pointer_out.child = clone_type(*pointer_in->child, arena);
 
             result.data.pointer = pointer_out;
             break;
         }
         case Type_Array: {
             Ast_Type_Array* array_in = &type.data.array;
-            Ast_Type_Array array_out = { .element_type = malloc(sizeof(Ast_Type)) };
+            Ast_Type_Array array_out = { .element_type = arena_allocate(arena, sizeof(Ast_Type)) };
 
-            *array_out.element_type = clone_type(*array_in->element_type);
+            *array_out.element_type = clone_type(*array_in->element_type, arena);
 
             if (array_in->has_size) {
-                array_out.size_type = malloc(sizeof(Ast_Type));
-                *array_out.size_type = clone_type(*array_in->size_type);
+                array_out.size_type = arena_allocate(arena, sizeof(Ast_Type));
+                *array_out.size_type = clone_type(*array_in->size_type, arena);
                 array_out.has_size = true;
             }
 
@@ -202,9 +208,9 @@ Ast_Type clone_type(Ast_Type type) {
             Ast_Type_Struct struct_out = { .items = array_ast_declaration_pointer_new(struct_in->items.count) };
 
             for (size_t i = 0; i < struct_in->items.count; i++) {
-                Ast_Declaration* declaration = malloc(sizeof(Ast_Declaration));
+                Ast_Declaration* declaration = arena_allocate(arena, sizeof(Ast_Declaration));
                 declaration->name = struct_in->items.elements[i]->name;
-                declaration->type = clone_type(struct_in->items.elements[i]->type);
+                declaration->type = clone_type(struct_in->items.elements[i]->type, arena);
                 array_ast_declaration_pointer_append(&struct_out.items, declaration);
             }
 
@@ -221,9 +227,9 @@ Ast_Type clone_type(Ast_Type type) {
         }
         case Type_TypeOf: {
             Ast_Type_TypeOf* type_of_in = &type.data.type_of;
-            Ast_Type_TypeOf type_of_out = { .expression = malloc(sizeof(Ast_Expression)) };
+            Ast_Type_TypeOf type_of_out = { .expression = arena_allocate(arena, sizeof(Ast_Expression)) };
 
-            *type_of_out.expression = clone_expression(*type_of_in->expression);
+            *type_of_out.expression = clone_expression(*type_of_in->expression, arena);
 
             result.data.type_of = type_of_out;
             break;
@@ -233,8 +239,8 @@ Ast_Type clone_type(Ast_Type type) {
             Ast_RunMacro run_macro_out = { .identifier = run_macro_in->identifier, .arguments = array_ast_macro_syntax_data_new(run_macro_in->arguments.count), .location = run_macro_in->location };
 
             for (size_t i = 0; i < run_macro_in->arguments.count; i++) {
-                Ast_Macro_Syntax_Data* syntax_data = malloc(sizeof(Ast_Macro_Syntax_Data));
-                *syntax_data = clone_syntax_data(*run_macro_in->arguments.elements[i]);
+                Ast_Macro_Syntax_Data* syntax_data = arena_allocate(arena, sizeof(Ast_Macro_Syntax_Data));
+                *syntax_data = clone_syntax_data(*run_macro_in->arguments.elements[i], arena);
                 array_ast_macro_syntax_data_append(&run_macro_out.arguments, syntax_data);
             }
 
@@ -248,7 +254,7 @@ Ast_Type clone_type(Ast_Type type) {
     return result;
 }
 
-Ast_Expression clone_expression(Ast_Expression expression) {
+Ast_Expression clone_expression(Ast_Expression expression, Arena* arena) {
     Ast_Expression result;
     result.kind = expression.kind;
 
@@ -258,8 +264,8 @@ Ast_Expression clone_expression(Ast_Expression expression) {
             Ast_Expression_Block block_out = { .statements = array_ast_statement_new(block_in->statements.count) };
 
             for (size_t i = 0; i < block_in->statements.count; i++) {
-                Ast_Statement* statement = malloc(sizeof(Ast_Statement));
-                *statement = clone_statement(*block_in->statements.elements[i]);
+                Ast_Statement* statement = arena_allocate(arena, sizeof(Ast_Statement));
+                *statement = clone_statement(*block_in->statements.elements[i], arena);
                 array_ast_statement_append(&block_out.statements, statement);
             }
 
@@ -271,15 +277,15 @@ Ast_Expression clone_expression(Ast_Expression expression) {
             Ast_Expression_Invoke invoke_out = { .kind = invoke_in->kind, .arguments = array_ast_expression_new(invoke_in->arguments.count), .location = invoke_in->location };
 
             for (size_t i = 0; i < invoke_in->arguments.count; i++) {
-                Ast_Expression* expression = malloc(sizeof(Ast_Expression));
-                *expression = clone_expression(*invoke_in->arguments.elements[i]);
+                Ast_Expression* expression = arena_allocate(arena, sizeof(Ast_Expression));
+                *expression = clone_expression(*invoke_in->arguments.elements[i], arena);
                 array_ast_expression_append(&invoke_out.arguments, expression);
             }
 
             switch (invoke_in->kind) {
                 case Invoke_Standard: {
-                    Ast_Expression* expression = malloc(sizeof(Ast_Expression));
-                    *expression = clone_expression(*invoke_in->data.procedure.procedure);
+                    Ast_Expression* expression = arena_allocate(arena, sizeof(Ast_Expression));
+                    *expression = clone_expression(*invoke_in->data.procedure.procedure, arena);
                     invoke_out.data.procedure.procedure = expression;
                     break;
                 }
@@ -296,8 +302,8 @@ Ast_Expression clone_expression(Ast_Expression expression) {
             Ast_RunMacro run_macro_out = { .identifier = run_macro_in->identifier, .arguments = array_ast_macro_syntax_data_new(run_macro_in->arguments.count), .location = run_macro_in->location };
 
             for (size_t i = 0; i < run_macro_in->arguments.count; i++) {
-                Ast_Macro_Syntax_Data* syntax_data = malloc(sizeof(Ast_Macro_Syntax_Data));
-                *syntax_data = clone_syntax_data(*run_macro_in->arguments.elements[i]);
+                Ast_Macro_Syntax_Data* syntax_data = arena_allocate(arena, sizeof(Ast_Macro_Syntax_Data));
+                *syntax_data = clone_syntax_data(*run_macro_in->arguments.elements[i], arena);
 
                 array_ast_macro_syntax_data_append(&run_macro_out.arguments, syntax_data);
             }
@@ -318,15 +324,15 @@ Ast_Expression clone_expression(Ast_Expression expression) {
                     break;
                 }
                 case Retrieve_Assign_Array: {
-                    retrieve_out.data.array.expression_inner = malloc(sizeof(Ast_Expression));
-                    *retrieve_out.data.array.expression_inner = clone_expression(*retrieve_in->data.array.expression_inner);
-                    retrieve_out.data.array.expression_outer = malloc(sizeof(Ast_Expression));
-                    *retrieve_out.data.array.expression_outer = clone_expression(*retrieve_in->data.array.expression_outer);
+                    retrieve_out.data.array.expression_inner = arena_allocate(arena, sizeof(Ast_Expression));
+                    *retrieve_out.data.array.expression_inner = clone_expression(*retrieve_in->data.array.expression_inner, arena);
+                    retrieve_out.data.array.expression_outer = arena_allocate(arena, sizeof(Ast_Expression));
+                    *retrieve_out.data.array.expression_outer = clone_expression(*retrieve_in->data.array.expression_outer, arena);
                     break;
                 }
                 case Retrieve_Assign_Parent: {
-                    retrieve_out.data.parent.expression = malloc(sizeof(Ast_Expression));
-                    *retrieve_out.data.parent.expression = clone_expression(*retrieve_in->data.parent.expression);
+                    retrieve_out.data.parent.expression = arena_allocate(arena, sizeof(Ast_Expression));
+                    *retrieve_out.data.parent.expression = clone_expression(*retrieve_in->data.parent.expression, arena);
                     retrieve_out.data.parent.name = retrieve_in->data.parent.name;
                     break;
                 }
@@ -339,21 +345,21 @@ Ast_Expression clone_expression(Ast_Expression expression) {
         }
         case Expression_Reference: {
             Ast_Expression_Reference* reference_in = &expression.data.reference;
-            Ast_Expression_Reference reference_out = { .inner = malloc(sizeof(Ast_Expression)) };
-            *reference_out.inner = clone_expression(*reference_in->inner);
+            Ast_Expression_Reference reference_out = { .inner = arena_allocate(arena, sizeof(Ast_Expression)) };
+            *reference_out.inner = clone_expression(*reference_in->inner, arena);
 
             result.data.reference = reference_out;
             break;
         }
         case Expression_If: {
             Ast_Expression_If* if_in = &expression.data.if_;
-            Ast_Expression_If if_out = { .condition = malloc(sizeof(Ast_Expression)), .if_expression = malloc(sizeof(Ast_Expression)), .location = if_in->location };
-            *if_out.condition = clone_expression(*if_in->condition);
-            *if_out.if_expression = clone_expression(*if_in->if_expression);
+            Ast_Expression_If if_out = { .condition = arena_allocate(arena, sizeof(Ast_Expression)), .if_expression = arena_allocate(arena, sizeof(Ast_Expression)), .location = if_in->location };
+            *if_out.condition = clone_expression(*if_in->condition, arena);
+            *if_out.if_expression = clone_expression(*if_in->if_expression, arena);
 
             if (if_in->else_expression != NULL) {
-                if_out.else_expression = malloc(sizeof(Ast_Expression));
-                *if_out.else_expression = clone_expression(*if_in->else_expression);
+                if_out.else_expression = arena_allocate(arena, sizeof(Ast_Expression));
+                *if_out.else_expression = clone_expression(*if_in->else_expression, arena);
             }
 
             result.data.if_ = if_out;
@@ -362,8 +368,8 @@ Ast_Expression clone_expression(Ast_Expression expression) {
         case Expression_IsType: {
             Ast_Expression_IsType* is_type_in = &expression.data.is_type;
             Ast_Expression_IsType is_type_out = {};
-            is_type_out.given = clone_type(is_type_in->given);
-            is_type_out.wanted = clone_type(is_type_in->wanted);
+            is_type_out.given = clone_type(is_type_in->given, arena);
+            is_type_out.wanted = clone_type(is_type_in->wanted, arena);
 
             result.data.is_type = is_type_out;
             break;
@@ -371,16 +377,16 @@ Ast_Expression clone_expression(Ast_Expression expression) {
         case Expression_SizeOf: {
             Ast_Expression_SizeOf* size_of_in = &expression.data.size_of;
             Ast_Expression_SizeOf size_of_out = {};
-            size_of_out.type = clone_type(size_of_in->type);
+            size_of_out.type = clone_type(size_of_in->type, arena);
 
             result.data.size_of = size_of_out;
             break;
         }
         case Expression_Cast: {
             Ast_Expression_Cast* cast_in = &expression.data.cast;
-            Ast_Expression_Cast cast_out = { .expression = malloc(sizeof(Ast_Expression)) };
-            *cast_out.expression = clone_expression(*cast_in->expression);
-            cast_out.type = clone_type(cast_in->type);
+            Ast_Expression_Cast cast_out = { .expression = arena_allocate(arena, sizeof(Ast_Expression)) };
+            *cast_out.expression = clone_expression(*cast_in->expression, arena);
+            cast_out.type = clone_type(cast_in->type, arena);
 
             result.data.cast = cast_out;
             break;
@@ -388,7 +394,7 @@ Ast_Expression clone_expression(Ast_Expression expression) {
         case Expression_Build: {
             Ast_Expression_Build* build_in = &expression.data.build;
             Ast_Expression_Build build_out = { .arguments = array_ast_expression_new(build_in->arguments.count) };
-            build_out.type = clone_type(build_in->type);
+            build_out.type = clone_type(build_in->type, arena);
 
             for (size_t i = 0; i < build_in->arguments.count; i++) {
                 array_ast_expression_append(&build_out.arguments, build_in->arguments.elements[i]);
@@ -400,7 +406,7 @@ Ast_Expression clone_expression(Ast_Expression expression) {
         case Expression_Init: {
             Ast_Expression_Init* init_in = &expression.data.init;
             Ast_Expression_Init init_out = {};
-            init_out.type = clone_type(init_in->type);
+            init_out.type = clone_type(init_in->type, arena);
             result.data.init = init_out;
             break;
         }
@@ -428,8 +434,8 @@ Ast_Expression clone_expression(Ast_Expression expression) {
             Ast_Expression_Multiple multiple_out = { .expressions = array_ast_expression_new(multiple_in->expressions.count) };
 
             for (size_t i = 0; i < multiple_in->expressions.count; i++) {
-                Ast_Expression* cloned = malloc(sizeof(Ast_Expression));
-                *cloned = clone_expression(*multiple_in->expressions.elements[i]);
+                Ast_Expression* cloned = arena_allocate(arena, sizeof(Ast_Expression));
+                *cloned = clone_expression(*multiple_in->expressions.elements[i], arena);
                 array_ast_expression_append(&multiple_out.expressions, cloned);
             }
             result.data.multiple = multiple_out;
@@ -442,19 +448,19 @@ Ast_Expression clone_expression(Ast_Expression expression) {
     return result;
 }
 
-Ast_Macro_Syntax_Data clone_syntax_data(Ast_Macro_Syntax_Data data) {
+Ast_Macro_Syntax_Data clone_syntax_data(Ast_Macro_Syntax_Data data, Arena* arena) {
     Ast_Macro_Syntax_Data result;
     result.kind = data.kind;
 
     switch (data.kind) {
         case Macro_Expression: {
-            result.data.expression = malloc(sizeof(Ast_Expression));
-            *result.data.expression = clone_expression(*data.data.expression);
+            result.data.expression = arena_allocate(arena, sizeof(Ast_Expression));
+            *result.data.expression = clone_expression(*data.data.expression, arena);
             break;
         }
         case Macro_Type: {
-            result.data.type = malloc(sizeof(Ast_Type));
-            *result.data.type = clone_type(*data.data.type);
+            result.data.type = arena_allocate(arena, sizeof(Ast_Type));
+            *result.data.type = clone_type(*data.data.type, arena);
             break;
         }
         default:
@@ -1,6 +1,7 @@
+#include "arena.h"
 #include "ast.h"
 
-Ast_Item clone_item(Ast_Item item);
-Ast_Expression clone_expression(Ast_Expression expression);
-Ast_Type clone_type(Ast_Type type);
-Ast_Macro_Syntax_Data clone_syntax_data(Ast_Macro_Syntax_Data data);
+Ast_Item clone_item(Ast_Item item, Arena* arena);
+Ast_Expression clone_expression(Ast_Expression expression, Arena* arena);
+Ast_Type clone_type(Ast_Type type, Arena* arena);
+Ast_Macro_Syntax_Data clone_syntax_data(Ast_Macro_Syntax_Data data, Arena* arena);
@@ -0,0 +1,1007 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_serialize.h"
+
+void serialize_bytes(String_Buffer* buffer, void* bytes, size_t length) {
+    if (buffer->count + length > buffer->capacity) {
+        size_t capacity_new = buffer->capacity * 2;
+        while (capacity_new < buffer->count + length) {
+            capacity_new *= 2;
+        }
+
+        char* elements_new = malloc(capacity_new);
+        memcpy(elements_new, buffer->elements, buffer->count);
+        free(buffer->elements);
+        buffer->elements = elements_new;
+        buffer->capacity = capacity_new;
+    }
+
+    memcpy(buffer->elements + buffer->count, bytes, length);
+    buffer->count += length;
+}
+
+void serialize_u8(String_Buffer* buffer, unsigned char value) {
+    serialize_bytes(buffer, &value, 1);
+}
+
+// LEB128, most sizes fit in a single byte
+void serialize_size(String_Buffer* buffer, size_t value) {
+    unsigned char bytes[10];
+    size_t count = 0;
+    do {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        if (value != 0) {
+            byte |= 0x80;
+        }
+        bytes[count] = byte;
+        count++;
+    } while (value != 0);
+    serialize_bytes(buffer, bytes, count);
+}
+
+// NULL is stored as length 0, everything else as length + 1
+void serialize_string(String_Buffer* buffer, char* string) {
+    if (string == NULL) {
+        serialize_size(buffer, 0);
+        return;
+    }
+
+    size_t length = strlen(string);
+    serialize_size(buffer, length + 1);
+    serialize_bytes(buffer, string, length);
+}
+
+void serialize_location(String_Buffer* buffer, Location location) {
+    serialize_size(buffer, location.row);
+    serialize_size(buffer, location.col);
+}
+
+void serialize_identifier(String_Buffer* buffer, Ast_Identifier identifier) {
+    serialize_string(buffer, identifier.name);
+    serialize_size(buffer, identifier.id);
+}
+
+void serialize_expression(String_Buffer* buffer, Ast_Expression* expression);
+void serialize_type(String_Buffer* buffer, Ast_Type* type);
+void serialize_statement(String_Buffer* buffer, Ast_Statement* statement);
+
+void serialize_optional_expression(String_Buffer* buffer, Ast_Expression* expression) {
+    serialize_u8(buffer, expression != NULL);
+    if (expression != NULL) {
+        serialize_expression(buffer, expression);
+    }
+}
+
+void serialize_directives(String_Buffer* buffer, Array_Ast_Directive* directives) {
+    serialize_size(buffer, directives->count);
+    for (size_t i = 0; i < directives->count; i++) {
+        Ast_Directive* directive = &directives->elements[i];
+        serialize_u8(buffer, directive->kind);
+        if (directive->kind == Directive_If) {
+            serialize_expression(buffer, directive->data.if_.expression);
+        }
+    }
+}
+
+void serialize_declaration(String_Buffer* buffer, Ast_Declaration* declaration) {
+    serialize_string(buffer, declaration->name);
+    serialize_location(buffer, declaration->location);
+    serialize_type(buffer, &declaration->type);
+}
+
+void serialize_syntax_data(String_Buffer* buffer, Ast_Macro_Syntax_Data* data) {
+    serialize_u8(buffer, data->kind);
+    switch (data->kind) {
+        case Macro_Expression:
+            serialize_expression(buffer, data->data.expression);
+            break;
+        case Macro_Type:
+            serialize_type(buffer, data->data.type);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void serialize_run_macro(String_Buffer* buffer, Ast_RunMacro* run_macro) {
+    serialize_identifier(buffer, run_macro->identifier);
+    serialize_location(buffer, run_macro->location);
+    serialize_size(buffer, run_macro->arguments.count);
+    for (size_t i = 0; i < run_macro->arguments.count; i++) {
+        serialize_syntax_data(buffer, run_macro->arguments.elements[i]);
+    }
+}
+
+void serialize_number(String_Buffer* buffer, Ast_Expression_Number* number) {
+    serialize_u8(buffer, number->kind);
+    switch (number->kind) {
+        case Number_Integer:
+            serialize_size(buffer, number->value.integer);
+            break;
+        case Number_Decimal:
+            serialize_bytes(buffer, &number->value.decimal, sizeof(double));
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void serialize_retrieve(String_Buffer* buffer, Retrieve_Assign_Node* retrieve) {
+    serialize_u8(buffer, retrieve->kind);
+    serialize_location(buffer, retrieve->location);
+    switch (retrieve->kind) {
+        case Retrieve_Assign_Identifier:
+            serialize_identifier(buffer, retrieve->data.identifier);
+            break;
+        case Retrieve_Assign_Parent:
+            serialize_expression(buffer, retrieve->data.parent.expression);
+            serialize_string(buffer, retrieve->data.parent.name);
+            break;
+        case Retrieve_Assign_Array:
+            serialize_expression(buffer, retrieve->data.array.expression_outer);
+            serialize_expression(buffer, retrieve->data.array.expression_inner);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void serialize_type(String_Buffer* buffer, Ast_Type* type) {
+    serialize_directives(buffer, &type->directives);
+    serialize_u8(buffer, type->kind);
+
+    switch (type->kind) {
+        case Type_Basic:
+            serialize_identifier(buffer, type->data.basic.identifier);
+            break;
+        case Type_Pointer:
+            serialize_type(buffer, type->data.pointer.child);
+            break;
+        case Type_Procedure: {
+            Ast_Type_Procedure* procedure = &type->data.procedure;
+            serialize_size(buffer, procedure->arguments.count);
+            for (size_t i = 0; i < procedure->arguments.count; i++) {
+                serialize_type(buffer, procedure->arguments.elements[i]);
+            }
+            serialize_size(buffer, procedure->returns.count);
+            for (size_t i = 0; i < procedure->returns.count; i++) {
+                serialize_type(buffer, procedure->returns.elements[i]);
+            }
+            break;
+        }
+        case Type_Array: {
+            Ast_Type_Array* array = &type->data.array;
+            serialize_u8(buffer, array->has_size);
+            if (array->has_size) {
+                serialize_type(buffer, array->size_type);
+            }
+            serialize_type(buffer, array->element_type);
+            break;
+        }
+        case Type_Internal:
+            serialize_u8(buffer, type->data.internal);
+            break;
+        case Type_Struct:
+        case Type_Union: {
+            Array_Ast_Declaration_Pointer* items = type->kind == Type_Struct ? &type->data.struct_.items : &type->data.union_.items;
+            serialize_size(buffer, items->count);
+            for (size_t i = 0; i < items->count; i++) {
+                serialize_declaration(buffer, items->elements[i]);
+            }
+            break;
+        }
+        case Type_Enum: {
+            Array_String* items = &type->data.enum_.items;
+            serialize_size(buffer, items->count);
+            for (size_t i = 0; i < items->count; i++) {
+                serialize_string(buffer, items->elements[i]);
+            }
+            break;
+        }
+        case Type_Number:
+            serialize_size(buffer, type->data.number.value);
+            break;
+        case Type_TypeOf:
+            serialize_expression(buffer, type->data.type_of.expression);
+            break;
+        case Type_RunMacro:
+            serialize_run_macro(buffer, &type->data.run_macro);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void serialize_expression(String_Buffer* buffer, Ast_Expression* expression) {
+    serialize_directives(buffer, &expression->directives);
+    serialize_u8(buffer, expression->kind);
+
+    switch (expression->kind) {
+        case Expression_Block: {
+            Ast_Expression_Block* block = &expression->data.block;
+            serialize_size(buffer, block->statements.count);
+            for (size_t i = 0; i < block->statements.count; i++) {
+                serialize_statement(buffer, block->statements.elements[i]);
+            }
+            break;
+        }
+        case Expression_Number:
+            serialize_number(buffer, &expression->data.number);
+            break;
+        case Expression_String:
+            serialize_string(buffer, expression->data.string.value);
+            break;
+        case Expression_Char:
+            serialize_u8(buffer, expression->data.char_.value);
+            break;
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            serialize_u8(buffer, invoke->kind);
+            serialize_location(buffer, invoke->location);
+            serialize_size(buffer, invoke->arguments.count);
+            for (size_t i = 0; i < invoke->arguments.count; i++) {
+                serialize_expression(buffer, invoke->arguments.elements[i]);
+            }
+
+            switch (invoke->kind) {
+                case Invoke_Standard:
+                    serialize_expression(buffer, invoke->data.procedure.procedure);
+                    break;
+                case Invoke_Operator:
+                    serialize_u8(buffer, invoke->data.operator_.operator_);
+                    break;
+                default:
+                    assert(false);
+            }
+            break;
+        }
+        case Expression_RunMacro:
+            serialize_run_macro(buffer, &expression->data.run_macro);
+            break;
+        case Expression_Retrieve:
+            serialize_retrieve(buffer, &expression->data.retrieve);
+            break;
+        case Expression_If: {
+            Ast_Expression_If* if_ = &expression->data.if_;
+            serialize_location(buffer, if_->location);
+            serialize_expression(buffer, if_->condition);
+            serialize_expression(buffer, if_->if_expression);
+            serialize_optional_expression(buffer, if_->else_expression);
+            break;
+        }
+        case Expression_Multiple: {
+            Ast_Expression_Multiple* multiple = &expression->data.multiple;
+            serialize_size(buffer, multiple->expressions.count);
+            for (size_t i = 0; i < multiple->expressions.count; i++) {
+                serialize_expression(buffer, multiple->expressions.elements[i]);
+            }
+            break;
+        }
+        case Expression_Reference:
+            serialize_expression(buffer, expression->data.reference.inner);
+            break;
+        case Expression_Boolean:
+            serialize_u8(buffer, expression->data.boolean.value);
+            break;
+        case Expression_Null:
+            break;
+        case Expression_Cast: {
+            Ast_Expression_Cast* cast = &expression->data.cast;
+            serialize_location(buffer, cast->location);
+            serialize_type(buffer, &cast->type);
+            serialize_expression(buffer, cast->expression);
+            break;
+        }
+        case Expression_Init: {
+            Ast_Expression_Init* init = &expression->data.init;
+            serialize_location(buffer, init->location);
+            serialize_type(buffer, &init->type);
+            break;
+        }
+        case Expression_Build: {
+            Ast_Expression_Build* build = &expression->data.build;
+            serialize_location(buffer, build->location);
+            serialize_type(buffer, &build->type);
+            serialize_size(buffer, build->arguments.count);
+            for (size_t i = 0; i < build->arguments.count; i++) {
+                serialize_expression(buffer, build->arguments.elements[i]);
+            }
+            break;
+        }
+        case Expression_SizeOf: {
+            Ast_Expression_SizeOf* size_of = &expression->data.size_of;
+            serialize_location(buffer, size_of->location);
+            serialize_type(buffer, &size_of->type);
+            break;
+        }
+        case Expression_LengthOf: {
+            Ast_Expression_LengthOf* length_of = &expression->data.length_of;
+            serialize_location(buffer, length_of->location);
+            serialize_type(buffer, &length_of->type);
+            break;
+        }
+        case Expression_IsType: {
+            Ast_Expression_IsType* is_type = &expression->data.is_type;
+            serialize_type(buffer, &is_type->wanted);
+            serialize_type(buffer, &is_type->given);
+            break;
+        }
+        default:
+            assert(false);
+    }
+}
+
+void serialize_statement(String_Buffer* buffer, Ast_Statement* statement) {
+    serialize_directives(buffer, &statement->directives);
+    serialize_u8(buffer, statement->kind);
+    serialize_location(buffer, statement->statement_end_location);
+
+    switch (statement->kind) {
+        case Statement_Expression: {
+            Ast_Statement_Expression* expression = &statement->data.expression;
+            serialize_expression(buffer, expression->expression);
+            serialize_u8(buffer, expression->skip_stack_check);
+            break;
+        }
+        case Statement_Declare: {
+            Ast_Statement_Declare* declare = &statement->data.declare;
+            serialize_size(buffer, declare->declarations.count);
+            for (size_t i = 0; i < declare->declarations.count; i++) {
+                serialize_declaration(buffer, &declare->declarations.elements[i]);
+            }
+            serialize_optional_expression(buffer, declare->expression);
+            break;
+        }
+        case Statement_Assign: {
+            Ast_Statement_Assign* assign = &statement->data.assign;
+            serialize_size(buffer, assign->parts.count);
+            for (size_t i = 0; i < assign->parts.count; i++) {
+                serialize_retrieve(buffer, &assign->parts.elements[i]);
+            }
+            serialize_expression(buffer, assign->expression);
+            break;
+        }
+        case Statement_Return: {
+            Ast_Statement_Return* return_ = &statement->data.return_;
+            serialize_location(buffer, return_->location);
+            serialize_optional_expression(buffer, return_->expression);
+            break;
+        }
+        case Statement_While: {
+            Ast_Statement_While* while_ = &statement->data.while_;
+            serialize_location(buffer, while_->location);
+            serialize_expression(buffer, while_->condition);
+            serialize_expression(buffer, while_->inside);
+            break;
+        }
+        case Statement_Break:
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void serialize_macro_argument(String_Buffer* buffer, Ast_Macro_Argument argument) {
+    serialize_u8(buffer, argument.kind);
+    serialize_u8(buffer, argument.multiple);
+}
+
+void serialize_item(String_Buffer* buffer, Ast_Item* item) {
+    serialize_directives(buffer, &item->directives);
+    serialize_location(buffer, item->location);
+    serialize_u8(buffer, item->kind);
+
+    switch (item->kind) {
+        case Item_Procedure: {
+            Ast_Item_Procedure* procedure = &item->data.procedure;
+            serialize_string(buffer, procedure->name);
+            serialize_size(buffer, procedure->arguments.count);
+            for (size_t i = 0; i < procedure->arguments.count; i++) {
+                serialize_declaration(buffer, &procedure->arguments.elements[i]);
+            }
+            serialize_size(buffer, procedure->returns.count);
+            for (size_t i = 0; i < procedure->returns.count; i++) {
+                serialize_type(buffer, procedure->returns.elements[i]);
+            }
+            serialize_expression(buffer, procedure->body);
+            serialize_location(buffer, procedure->end_location);
+            break;
+        }
+        case Item_Macro: {
+            Ast_Item_Macro* macro = &item->data.macro;
+            serialize_string(buffer, macro->name);
+            serialize_size(buffer, macro->arguments.count);
+            for (size_t i = 0; i < macro->arguments.count; i++) {
+                serialize_macro_argument(buffer, macro->arguments.elements[i]);
+            }
+            serialize_macro_argument(buffer, macro->return_);
+            serialize_size(buffer, macro->variants.count);
+            for (size_t i = 0; i < macro->variants.count; i++) {
+                Ast_Macro_Variant* variant = &macro->variants.elements[i];
+                serialize_size(buffer, variant->bindings.count);
+                for (size_t j = 0; j < variant->bindings.count; j++) {
+                    serialize_string(buffer, variant->bindings.elements[j]);
+                }
+                serialize_u8(buffer, variant->varargs);
+                serialize_syntax_data(buffer, &variant->data);
+            }
+            break;
+        }
+        case Item_Type:
+            serialize_string(buffer, item->data.type.name);
+            serialize_type(buffer, &item->data.type.type);
+            break;
+        case Item_Global:
+            serialize_string(buffer, item->data.global.name);
+            serialize_type(buffer, &item->data.global.type);
+            break;
+        case Item_Constant:
+            serialize_string(buffer, item->data.constant.name);
+            serialize_number(buffer, &item->data.constant.expression);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void serialize_file(Ast_File* file, String_Buffer* buffer) {
+    serialize_size(buffer, file->items.count);
+    for (size_t i = 0; i < file->items.count; i++) {
+        serialize_item(buffer, &file->items.elements[i]);
+    }
+}
+
+// on malformed input the state is marked failed and zeroes are returned from then on
+unsigned char deserialize_u8(Deserialize_State* state) {
+    if (state->failed || state->index >= state->length) {
+        state->failed = true;
+        return 0;
+    }
+
+    unsigned char value = state->data[state->index];
+    state->index++;
+    return value;
+}
+
+size_t deserialize_size(Deserialize_State* state) {
+    size_t value = 0;
+    size_t shift = 0;
+    while (true) {
+        unsigned char byte = deserialize_u8(state);
+        if (shift < 64) {
+            value |= (size_t) (byte & 0x7f) << shift;
+        }
+        shift += 7;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+// a count can never exceed the bytes left, this keeps corrupt input from asking for huge arrays
+size_t deserialize_count(Deserialize_State* state) {
+    size_t count = deserialize_size(state);
+    if (count > state->length - state->index) {
+        state->failed = true;
+        return 0;
+    }
+    return count;
+}
+
+char* deserialize_string(Deserialize_State* state) {
+    size_t length = deserialize_size(state);
+    if (length == 0) {
+        return NULL;
+    }
+    length--;
+
+    if (state->failed || length > state->length - state->index) {
+        state->failed = true;
+        return "";
+    }
+
+    char* result = interner_intern(state->names, state->data + state->index, length);
+    state->index += length;
+    return result;
+}
+
+Location deserialize_location(Deserialize_State* state) {
+    Location location = { .file = state->file };
+    location.row = deserialize_size(state);
+    location.col = deserialize_size(state);
+    return location;
+}
+
+Ast_Identifier deserialize_identifier(Deserialize_State* state) {
+    Ast_Identifier identifier = {};
+    identifier.name = deserialize_string(state);
+    identifier.id = deserialize_size(state);
+    return identifier;
+}
+
+Ast_Expression deserialize_expression(Deserialize_State* state);
+Ast_Type deserialize_type(Deserialize_State* state);
+Ast_Statement deserialize_statement(Deserialize_State* state);
+
+Ast_Expression* deserialize_expression_allocated(Deserialize_State* state) {
+    Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
+    *expression = deserialize_expression(state);
+    return expression;
+}
+
+Ast_Type* deserialize_type_allocated(Deserialize_State* state) {
+    Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
+    *type = deserialize_type(state);
+    return type;
+}
+
+Ast_Expression* deserialize_optional_expression(Deserialize_State* state) {
+    if (deserialize_u8(state)) {
+        return deserialize_expression_allocated(state);
+    }
+    return NULL;
+}
+
+Array_Ast_Directive deserialize_directives(Deserialize_State* state) {
+    size_t count = deserialize_count(state);
+    Array_Ast_Directive directives = array_ast_directive_new(count > 0 ? count : 1);
+    for (size_t i = 0; i < count && !state->failed; i++) {
+        Ast_Directive directive = {};
+        directive.kind = deserialize_u8(state);
+        if (directive.kind == Directive_If) {
+            directive.data.if_.expression = deserialize_expression_allocated(state);
+        }
+        array_ast_directive_append(&directives, directive);
+    }
+    return directives;
+}
+
+Ast_Declaration deserialize_declaration(Deserialize_State* state) {
+    Ast_Declaration declaration = {};
+    declaration.name = deserialize_string(state);
+    declaration.location = deserialize_location(state);
+    declaration.type = deserialize_type(state);
+    return declaration;
+}
+
+Ast_Macro_Syntax_Data deserialize_syntax_data(Deserialize_State* state) {
+    Ast_Macro_Syntax_Data data = {};
+    data.kind = deserialize_u8(state);
+    switch (data.kind) {
+        case Macro_Expression:
+            data.data.expression = deserialize_expression_allocated(state);
+            break;
+        case Macro_Type:
+            data.data.type = deserialize_type_allocated(state);
+            break;
+        default:
+            state->failed = true;
+            break;
+    }
+    return data;
+}
+
+Ast_RunMacro deserialize_run_macro(Deserialize_State* state) {
+    Ast_RunMacro run_macro = {};
+    run_macro.identifier = deserialize_identifier(state);
+    run_macro.location = deserialize_location(state);
+
+    size_t count = deserialize_count(state);
+    run_macro.arguments = array_ast_macro_syntax_data_new(count > 0 ? count : 1);
+    for (size_t i = 0; i < count && !state->failed; i++) {
+        Ast_Macro_Syntax_Data* data = arena_allocate(state->arena, sizeof(*data));
+        *data = deserialize_syntax_data(state);
+        array_ast_macro_syntax_data_append(&run_macro.arguments, data);
+    }
+    return run_macro;
+}
+
+Ast_Expression_Number deserialize_number(Deserialize_State* state) {
+    Ast_Expression_Number number = {};
+    number.kind = deserialize_u8(state);
+    switch (number.kind) {
+        case Number_Integer:
+            number.value.integer = deserialize_size(state);
+            break;
+        case Number_Decimal:
+            if (state->failed || sizeof(double) > state->length - state->index) {
+                state->failed = true;
+                break;
+            }
+            memcpy(&number.value.decimal, state->data + state->index, sizeof(double));
+            state->index += sizeof(double);
+            break;
+        default:
+            state->failed = true;
+            break;
+    }
+    return number;
+}
+
+Array_Ast_Expression deserialize_expressions(Deserialize_State* state) {
+    size_t count = deserialize_count(state);
+    Array_Ast_Expression expressions = array_ast_expression_new(count > 0 ? count : 1);
+    for (size_t i = 0; i < count && !state->failed; i++) {
+        array_ast_expression_append(&expressions, deserialize_expression_allocated(state));
+    }
+    return expressions;
+}
+
+Array_Ast_Type deserialize_types(Deserialize_State* state) {
+    size_t count = deserialize_count(state);
+    Array_Ast_Type types = array_ast_type_new(count > 0 ? count : 1);
+    for (size_t i = 0; i < count && !state->failed; i++) {
+        array_ast_type_append(&types, deserialize_type_allocated(state));
+    }
+    return types;
+}
+
+Retrieve_Assign_Node deserialize_retrieve(Deserialize_State* state) {
+    Retrieve_Assign_Node retrieve = {};
+    retrieve.kind = deserialize_u8(state);
+    retrieve.location = deserialize_location(state);
+    switch (retrieve.kind) {
+        case Retrieve_Assign_Identifier:
+            retrieve.data.identifier = deserialize_identifier(state);
+            break;
+        case Retrieve_Assign_Parent:
+            retrieve.data.parent.expression = deserialize_expression_allocated(state);
+            retrieve.data.parent.name = deserialize_string(state);
+            break;
+        case Retrieve_Assign_Array:
+            retrieve.data.array.expression_outer = deserialize_expression_allocated(state);
+            retrieve.data.array.expression_inner = deserialize_expression_allocated(state);
+            break;
+        default:
+            state->failed = true;
+            break;
+    }
+    return retrieve;
+}
+
+Ast_Type deserialize_type(Deserialize_State* state) {
+    Ast_Type type = {};
+    type.directives = deserialize_directives(state);
+    type.kind = deserialize_u8(state);
+    if (state->failed) {
+        return type;
+    }
+
+    switch (type.kind) {
+        case Type_Basic:
+            type.data.basic.identifier = deserialize_identifier(state);
+            break;
+        case Type_Pointer:
+            type.data.pointer.child = deserialize_type_allocated(state);
+            break;
+        case Type_Procedure:
+            type.data.procedure.arguments = deserialize_types(state);
+            type.data.procedure.returns = deserialize_types(state);
+            break;
+        case Type_Array: {
+            Ast_Type_Array* array = &type.data.array;
+            array->has_size = deserialize_u8(state);
+            if (array->has_size) {
+                array->size_type = deserialize_type_allocated(state);
+            }
+            array->element_type = deserialize_type_allocated(state);
+            break;
+        }
+        case Type_Internal:
+            type.data.internal = deserialize_u8(state);
+            break;
+        case Type_Struct:
+        case Type_Union: {
+            size_t count = deserialize_count(state);
+            Array_Ast_Declaration_Pointer items = array_ast_declaration_pointer_new(count > 0 ? count : 1);
+            for (size_t i = 0; i < count && !state->failed; i++) {
+                Ast_Declaration* declaration = arena_allocate(state->arena, sizeof(*declaration));
+                *declaration = deserialize_declaration(state);
+                array_ast_declaration_pointer_append(&items, declaration);
+            }
+
+            if (type.kind == Type_Struct) {
+                type.data.struct_.items = items;
+            } else {
+                type.data.union_.items = items;
+            }
+            break;
+        }
+        case Type_Enum: {
+            size_t count = deserialize_count(state);
+            Array_String items = array_string_new(count > 0 ? count : 1);
+            for (size_t i = 0; i < count && !state->failed; i++) {
+                array_string_append(&items, deserialize_string(state));
+            }
+            type.data.enum_.items = items;
+            break;
+        }
+        case Type_Number:
+            type.data.number.value = deserialize_size(state);
+            break;
+        case Type_TypeOf:
+            type.data.type_of.expression = deserialize_expression_allocated(state);
+            break;
+        case Type_RunMacro:
+            type.data.run_macro = deserialize_run_macro(state);
+            break;
+        default:
+            state->failed = true;
+            break;
+    }
+
+    return type;
+}
+
+Ast_Expression deserialize_expression(Deserialize_State* state) {
+    Ast_Expression expression = {};
+    expression.directives = deserialize_directives(state);
+    expression.kind = deserialize_u8(state);
+    if (state->failed) {
+        return expression;
+    }
+
+    switch (expression.kind) {
+        case Expression_Block: {
+            size_t count = deserialize_count(state);
+            Array_Ast_Statement statements = array_ast_statement_new(count > 0 ? count : 1);
+            for (size_t i = 0; i < count && !state->failed; i++) {
+                Ast_Statement* statement = arena_allocate(state->arena, sizeof(*statement));
+                *statement = deserialize_statement(state);
+                array_ast_statement_append(&statements, statement);
+            }
+            expression.data.block.statements = statements;
+            break;
+        }
+        case Expression_Number:
+            expression.data.number = deserialize_number(state);
+            break;
+        case Expression_String:
+            expression.data.string.value = deserialize_string(state);
+            break;
+        case Expression_Char:
+            expression.data.char_.value = deserialize_u8(state);
+            break;
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression.data.invoke;
+            invoke->kind = deserialize_u8(state);
+            invoke->location = deserialize_location(state);
+            invoke->arguments = deserialize_expressions(state);
+
+            switch (invoke->kind) {
+                case Invoke_Standard:
+                    invoke->data.procedure.procedure = deserialize_expression_allocated(state);
+                    break;
+                case Invoke_Operator:
+                    invoke->data.operator_.operator_ = deserialize_u8(state);
+                    break;
+                default:
+                    state->failed = true;
+                    break;
+            }
+            break;
+        }
+        case Expression_RunMacro:
+            expression.data.run_macro = deserialize_run_macro(state);
+            break;
+        case Expression_Retrieve:
+            expression.data.retrieve = deserialize_retrieve(state);
+            break;
+        case Expression_If: {
+            Ast_Expression_If* if_ = &expression.data.if_;
+            if_->location = deserialize_location(state);
+            if_->condition = deserialize_expression_allocated(state);
+            if_->if_expression = deserialize_expression_allocated(state);
+            if_->else_expression = deserialize_optional_expression(state);
+            break;
+        }
+        case Expression_Multiple:
+            expression.data.multiple.expressions = deserialize_expressions(state);
+            break;
+        case Expression_Reference:
+            expression.data.reference.inner = deserialize_expression_allocated(state);
+            break;
+        case Expression_Boolean:
+            expression.data.boolean.value = deserialize_u8(state);
+            break;
+        case Expression_Null:
+            break;
+        case Expression_Cast: {
+            Ast_Expression_Cast* cast = &expression.data.cast;
+            cast->location = deserialize_location(state);
+            cast->type = deserialize_type(state);
+            cast->expression = deserialize_expression_allocated(state);
+            break;
+        }
+        case Expression_Init: {
+            Ast_Expression_Init* init = &expression.data.init;
+            init->location = deserialize_location(state);
+            init->type = deserialize_type(state);
+            break;
+        }
+        case Expression_Build: {
+            Ast_Expression_Build* build = &expression.data.build;
+            build->location = deserialize_location(state);
+            build->type = deserialize_type(state);
+            build->arguments = deserialize_expressions(state);
+            break;
+        }
+        case Expression_SizeOf: {
+            Ast_Expression_SizeOf* size_of = &expression.data.size_of;
+            size_of->location = deserialize_location(state);
+            size_of->type = deserialize_type(state);
+            break;
+        }
+        case Expression_LengthOf: {
+            Ast_Expression_LengthOf* length_of = &expression.data.length_of;
+            length_of->location = deserialize_location(state);
+            length_of->type = deserialize_type(state);
+            break;
+        }
+        case Expression_IsType: {
+            Ast_Expression_IsType* is_type = &expression.data.is_type;
+            is_type->wanted = deserialize_type(state);
+            is_type->given = deserialize_type(state);
+            break;
+        }
+        default:
+            state->failed = true;
+            break;
+    }
+
+    return expression;
+}
+
+Ast_Statement deserialize_statement(Deserialize_State* state) {
+    Ast_Statement statement = {};
+    statement.directives = deserialize_directives(state);
+    statement.kind = deserialize_u8(state);
+    statement.statement_end_location = deserialize_location(state);
+    if (state->failed) {
+        return statement;
+    }
+
+    switch (statement.kind) {
+        case Statement_Expression: {
+            Ast_Statement_Expression* expression = &statement.data.expression;
+            expression->expression = deserialize_expression_allocated(state);
+            expression->skip_stack_check = deserialize_u8(state);
+            break;
+        }
+        case Statement_Declare: {
+            Ast_Statement_Declare* declare = &statement.data.declare;
+            size_t count = deserialize_count(state);
+            declare->declarations = array_ast_declaration_new(count > 0 ? count : 1);
+            for (size_t i = 0; i < count && !state->failed; i++) {
+                array_ast_declaration_append(&declare->declarations, deserialize_declaration(state));
+            }
+            declare->expression = deserialize_optional_expression(state);
+            break;
+        }
+        case Statement_Assign: {
+            Ast_Statement_Assign* assign = &statement.data.assign;
+            size_t count = deserialize_count(state);
+            assign->parts = array_statement_assign_part_new(count > 0 ? count : 1);
+            for (size_t i = 0; i < count && !state->failed; i++) {
+                array_statement_assign_part_append(&assign->parts, deserialize_retrieve(state));
+            }
+            assign->expression = deserialize_expression_allocated(state);
+            break;
+        }
+        case Statement_Return: {
+            Ast_Statement_Return* return_ = &statement.data.return_;
+            return_->location = deserialize_location(state);
+            return_->expression = deserialize_optional_expression(state);
+            break;
+        }
+        case Statement_While: {
+            Ast_Statement_While* while_ = &statement.data.while_;
+            while_->location = deserialize_location(state);
+            while_->condition = deserialize_expression_allocated(state);
+            while_->inside = deserialize_expression_allocated(state);
+            break;
+        }
+        case Statement_Break:
+            break;
+        default:
+            state->failed = true;
+            break;
+    }
+
+    return statement;
+}
+
+Ast_Macro_Argument deserialize_macro_argument(Deserialize_State* state) {
+    Ast_Macro_Argument argument = {};
+    argument.kind = deserialize_u8(state);
+    argument.multiple = deserialize_u8(state);
+    return argument;
+}
+
+Ast_Item deserialize_item(Deserialize_State* state) {
+    Ast_Item item = {};
+    item.directives = deserialize_directives(state);
+    item.location = deserialize_location(state);
+    item.kind = deserialize_u8(state);
+    if (state->failed) {
+        return item;
+    }
+
+    switch (item.kind) {
+        case Item_Procedure: {
+            Ast_Item_Procedure* procedure = &item.data.procedure;
+            procedure->name = deserialize_string(state);
+
+            size_t count = deserialize_count(state);
+            procedure->arguments = array_ast_declaration_new(count > 0 ? count : 1);
+            for (size_t i = 0; i < count && !state->failed; i++) {
+                array_ast_declaration_append(&procedure->arguments, deserialize_declaration(state));
+            }
+
+            procedure->returns = deserialize_types(state);
+            procedure->body = deserialize_expression_allocated(state);
+            procedure->end_location = deserialize_location(state);
+            break;
+        }
+        case Item_Macro: {
+            Ast_Item_Macro* macro = &item.data.macro;
+            macro->name = deserialize_string(state);
+
+            size_t count = deserialize_count(state);
+            macro->arguments = array_ast_macro_syntax_kind_new(count > 0 ? count : 1);
+            for (size_t i = 0; i < count && !state->failed; i++) {
+                array_ast_macro_syntax_kind_append(&macro->arguments, deserialize_macro_argument(state));
+            }
+            macro->return_ = deserialize_macro_argument(state);
+
+            size_t variant_count = deserialize_count(state);
+            macro->variants = array_ast_macro_variant_new(variant_count > 0 ? variant_count : 1);
+            for (size_t i = 0; i < variant_count && !state->failed; i++) {
+                Ast_Macro_Variant variant = {};
+
+                size_t binding_count = deserialize_count(state);
+                variant.bindings = array_string_new(binding_count > 0 ? binding_count : 1);
+                for (size_t j = 0; j < binding_count && !state->failed; j++) {
+                    array_string_append(&variant.bindings, deserialize_string(state));
+                }
+                variant.varargs = deserialize_u8(state);
+                variant.data = deserialize_syntax_data(state);
+
+                array_ast_macro_variant_append(&macro->variants, variant);
+            }
+            break;
+        }
+        case Item_Type:
+            item.data.type.name = deserialize_string(state);
+            item.data.type.type = deserialize_type(state);
+            break;
+        case Item_Global:
+            item.data.global.name = deserialize_string(state);
+            item.data.global.type = deserialize_type(state);
+            break;
+        case Item_Constant:
+            item.data.constant.name = deserialize_string(state);
+            item.data.constant.expression = deserialize_number(state);
+            break;
+        default:
+            state->failed = true;
+            break;
+    }
+
+    return item;
+}
+
+bool deserialize_file(Deserialize_State* state, Ast_File* result) {
+    size_t count = deserialize_count(state);
+    Array_Ast_Item items = array_ast_item_new(count > 0 ? count : 1);
+    for (size_t i = 0; i < count && !state->failed; i++) {
+        array_ast_item_append(&items, deserialize_item(state));
+    }
+
+    result->items = items;
+    return !state->failed && state->index == state->length;
+}
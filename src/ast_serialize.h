@@ -0,0 +1,31 @@
+#ifndef AST_SERIALIZE__
+#define AST_SERIALIZE__
+
+#include "arena.h"
+#include "ast.h"
+#include "interner.h"
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t index;
+    bool failed;
+
+    char* file;
+    Arena* arena;
+    Interner* names;
+} Deserialize_State;
+
+// has to be bumped with every change to what serialize_file writes or to the ast it is read back into
+#define AST_SERIALIZE_VERSION 1
+
+// binary form of a freshly parsed file, computed fields are not stored
+void serialize_file(Ast_File* file, String_Buffer* buffer);
+bool deserialize_file(Deserialize_State* state, Ast_File* result);
+
+void serialize_size(String_Buffer* buffer, size_t value);
+void serialize_string(String_Buffer* buffer, char* string);
+size_t deserialize_size(Deserialize_State* state);
+char* deserialize_string(Deserialize_State* state);
+
+#endif
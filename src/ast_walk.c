@@ -210,6 +210,10 @@ void walk_statement(Ast_Statement* statement, Ast_Walk_State* state) {
                 break;
             }
             case Directive_Entry:
+            case Directive_Exit:
+            case Directive_Packed:
+            case Directive_Inline:
+            case Directive_NoInline:
                 break;
         }
     }
@@ -1,21 +1,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
-char* read_file_to_string(char* path) {
-    FILE* file = fopen(path, "r");
-    if (file == NULL) return 0;
+// maps the file read-only, the result is not NUL-terminated
+char* map_file(char* path, size_t* length) {
+    int file = open(path, O_RDONLY);
+    if (file < 0) return NULL;
 
-    fseek(file, 0, SEEK_END);
-    size_t file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    struct stat file_stat;
+    if (fstat(file, &file_stat) < 0) {
+        close(file);
+        return NULL;
+    }
+
+    *length = file_stat.st_size;
+    if (*length == 0) {
+        close(file);
+        return "";
+    }
 
-    char* buffer = malloc(file_size + 1);
-    buffer[file_size] = 0;
-    fread(buffer, 1, file_size, file);
+    char* contents = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (contents == MAP_FAILED) return NULL;
 
-    return buffer;
+    return contents;
+}
+
+void unmap_file(char* contents, size_t length) {
+    if (length > 0) {
+        munmap(contents, length);
+    }
 }
 
 char* concatenate_folder_file_path(char* folder_path, char* file_path) {
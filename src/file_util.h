@@ -1,2 +1,5 @@
-char* read_file_to_string(char* path);
+#include <stddef.h>
+
+char* map_file(char* path, size_t* length);
+void unmap_file(char* contents, size_t length);
 char* concatenate_folder_file_path(char* folder_path, char* file_path);
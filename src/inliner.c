@@ -0,0 +1,432 @@
+#include <assert.h>
+#include <string.h>
+
+#include "ast_walk.h"
+#include "inliner.h"
+#include "processor.h"
+
+// procedures with more statements and expressions than this are only inlined when marked #inline
+#define INLINE_NODE_LIMIT 16
+
+typedef struct {
+    Generic_State generic;
+    Arena* arena;
+    Ast_Item_Procedure* caller;
+    Array_String caller_names;
+    Array_Ast_Expression call_sites;
+} Inline_State;
+
+bool contains_name(Array_String* names, char* name) {
+    for (size_t i = 0; i < names->count; i++) {
+        if (strcmp(names->elements[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// copies keep the computed fields, types and directives are shared since nothing changes them anymore
+Ast_Expression* copy_expression(Ast_Expression* expression, Arena* arena);
+
+Ast_Statement* copy_statement(Ast_Statement* statement, Arena* arena) {
+    Ast_Statement* result = arena_allocate(arena, sizeof(Ast_Statement));
+    *result = *statement;
+
+    switch (statement->kind) {
+        case Statement_Expression:
+            result->data.expression.expression = copy_expression(statement->data.expression.expression, arena);
+            break;
+        case Statement_Declare: {
+            Ast_Statement_Declare* declare = &result->data.declare;
+            declare->declarations = array_ast_declaration_new(statement->data.declare.declarations.count + 1);
+            for (size_t i = 0; i < statement->data.declare.declarations.count; i++) {
+                array_ast_declaration_append(&declare->declarations, statement->data.declare.declarations.elements[i]);
+            }
+
+            if (declare->expression != NULL) {
+                declare->expression = copy_expression(declare->expression, arena);
+            }
+            break;
+        }
+        case Statement_Assign: {
+            Ast_Statement_Assign* assign = &result->data.assign;
+            assign->parts = array_statement_assign_part_new(statement->data.assign.parts.count + 1);
+            for (size_t i = 0; i < statement->data.assign.parts.count; i++) {
+                Statement_Assign_Part part = statement->data.assign.parts.elements[i];
+                if (part.kind == Retrieve_Assign_Parent) {
+                    part.data.parent.expression = copy_expression(part.data.parent.expression, arena);
+                } else if (part.kind == Retrieve_Assign_Array) {
+                    part.data.array.expression_outer = copy_expression(part.data.array.expression_outer, arena);
+                    part.data.array.expression_inner = copy_expression(part.data.array.expression_inner, arena);
+                }
+                array_statement_assign_part_append(&assign->parts, part);
+            }
+
+            assign->expression = copy_expression(assign->expression, arena);
+            break;
+        }
+        case Statement_Return:
+            if (result->data.return_.expression != NULL) {
+                result->data.return_.expression = copy_expression(result->data.return_.expression, arena);
+            }
+            break;
+        case Statement_While:
+            result->data.while_.condition = copy_expression(statement->data.while_.condition, arena);
+            result->data.while_.inside = copy_expression(statement->data.while_.inside, arena);
+            break;
+        case Statement_Break:
+            break;
+        default:
+            assert(false);
+    }
+
+    return result;
+}
+
+Array_Ast_Expression copy_expressions(Array_Ast_Expression* expressions, Arena* arena) {
+    Array_Ast_Expression result = array_ast_expression_new(expressions->count + 1);
+    for (size_t i = 0; i < expressions->count; i++) {
+        array_ast_expression_append(&result, copy_expression(expressions->elements[i], arena));
+    }
+    return result;
+}
+
+Ast_Expression* copy_expression(Ast_Expression* expression, Arena* arena) {
+    Ast_Expression* result = arena_allocate(arena, sizeof(Ast_Expression));
+    *result = *expression;
+
+    switch (expression->kind) {
+        case Expression_Block: {
+            Ast_Expression_Block* block = &result->data.block;
+            block->statements = array_ast_statement_new(expression->data.block.statements.count + 1);
+            for (size_t i = 0; i < expression->data.block.statements.count; i++) {
+                array_ast_statement_append(&block->statements, copy_statement(expression->data.block.statements.elements[i], arena));
+            }
+            break;
+        }
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &result->data.invoke;
+            invoke->arguments = copy_expressions(&expression->data.invoke.arguments, arena);
+            if (invoke->kind == Invoke_Standard) {
+                invoke->data.procedure.procedure = copy_expression(invoke->data.procedure.procedure, arena);
+            }
+            break;
+        }
+        case Expression_RunMacro: {
+            // the arguments are never output, only the expansion is
+            Ast_RunMacro* run_macro = &result->data.run_macro;
+            if (run_macro->result.kind == Macro_Expression) {
+                run_macro->result.data.expression = copy_expression(run_macro->result.data.expression, arena);
+            }
+            break;
+        }
+        case Expression_Retrieve: {
+            Ast_Expression_Retrieve* retrieve = &result->data.retrieve;
+            if (retrieve->kind == Retrieve_Assign_Parent) {
+                retrieve->data.parent.expression = copy_expression(retrieve->data.parent.expression, arena);
+            } else if (retrieve->kind == Retrieve_Assign_Array) {
+                retrieve->data.array.expression_outer = copy_expression(retrieve->data.array.expression_outer, arena);
+                retrieve->data.array.expression_inner = copy_expression(retrieve->data.array.expression_inner, arena);
+            }
+            break;
+        }
+        case Expression_If: {
+            Ast_Expression_If* if_ = &result->data.if_;
+            if_->condition = copy_expression(if_->condition, arena);
+            if_->if_expression = copy_expression(if_->if_expression, arena);
+            if (if_->else_expression != NULL) {
+                if_->else_expression = copy_expression(if_->else_expression, arena);
+            }
+            break;
+        }
+        case Expression_Multiple:
+            result->data.multiple.expressions = copy_expressions(&expression->data.multiple.expressions, arena);
+            break;
+        case Expression_Reference:
+            result->data.reference.inner = copy_expression(expression->data.reference.inner, arena);
+            break;
+        case Expression_Cast:
+            result->data.cast.expression = copy_expression(expression->data.cast.expression, arena);
+            break;
+        case Expression_Build:
+            result->data.build.arguments = copy_expressions(&expression->data.build.arguments, arena);
+            break;
+        case Expression_Number:
+        case Expression_String:
+        case Expression_Char:
+        case Expression_Boolean:
+        case Expression_Null:
+        case Expression_Init:
+        case Expression_SizeOf:
+        case Expression_LengthOf:
+        case Expression_IsType:
+            break;
+        default:
+            assert(false);
+    }
+
+    return result;
+}
+
+typedef struct {
+    Ast_Item_Procedure* procedure;
+    size_t nodes;
+    size_t returns;
+    bool recursive;
+} Inline_Candidate_State;
+
+void count_candidate_expression(Ast_Expression* expression, void* internal_state) {
+    Inline_Candidate_State* state = internal_state;
+    state->nodes++;
+
+    if (expression->kind == Expression_Retrieve && expression->data.retrieve.kind == Retrieve_Assign_Identifier) {
+        if (strcmp(expression->data.retrieve.data.identifier.name, state->procedure->name) == 0) {
+            state->recursive = true;
+        }
+    }
+}
+
+void count_candidate_statement(Ast_Statement* statement, void* internal_state) {
+    Inline_Candidate_State* state = internal_state;
+    state->nodes++;
+
+    if (statement->kind == Statement_Return) {
+        state->returns++;
+    }
+}
+
+bool should_inline(Ast_Item* item) {
+    Ast_Item_Procedure* procedure = &item->data.procedure;
+    if (has_directive(&item->directives, Directive_NoInline) || has_directive(&item->directives, Directive_Entry) || has_directive(&item->directives, Directive_Exit)) {
+        return false;
+    }
+
+    if (has_directive(&item->directives, Directive_If) && !get_directive(&item->directives, Directive_If)->data.if_.result) {
+        return false;
+    }
+
+    if (procedure->returns.count > 1 || procedure->body->kind != Expression_Block) {
+        return false;
+    }
+
+    Inline_Candidate_State state = { .procedure = procedure };
+    Ast_Walk_State walk_state = {
+        .expression_func = count_candidate_expression,
+        .statement_func = count_candidate_statement,
+        .internal_state = &state,
+    };
+    walk_expression(procedure->body, &walk_state);
+
+    // the body becomes a block, so the only return it can have is the one at its very end
+    Array_Ast_Statement* statements = &procedure->body->data.block.statements;
+    bool ends_in_return = statements->count > 0 && statements->elements[statements->count - 1]->kind == Statement_Return;
+    if (state.recursive || state.returns != (ends_in_return ? 1 : 0)) {
+        return false;
+    }
+
+    return state.nodes <= INLINE_NODE_LIMIT || has_directive(&item->directives, Directive_Inline);
+}
+
+typedef struct {
+    Ast_Item_Procedure* callee;
+    Array_String* caller_names;
+    bool visible;
+} Name_Check_State;
+
+bool is_argument_name(Ast_Item_Procedure* procedure, char* name) {
+    for (size_t i = 0; i < procedure->arguments.count; i++) {
+        if (strcmp(procedure->arguments.elements[i].name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void check_expression_names(Ast_Expression* expression, void* internal_state) {
+    Name_Check_State* state = internal_state;
+    if (expression->kind == Expression_Retrieve && expression->data.retrieve.kind == Retrieve_Assign_Identifier) {
+        char* name = expression->data.retrieve.data.identifier.name;
+        if (!is_argument_name(state->callee, name) && contains_name(state->caller_names, name)) {
+            state->visible = false;
+        }
+    }
+}
+
+void check_statement_names(Ast_Statement* statement, void* internal_state) {
+    Name_Check_State* state = internal_state;
+    if (statement->kind == Statement_Assign) {
+        for (size_t i = 0; i < statement->data.assign.parts.count; i++) {
+            Statement_Assign_Part* part = &statement->data.assign.parts.elements[i];
+            if (part->kind == Retrieve_Assign_Identifier && !is_argument_name(state->callee, part->data.identifier.name) && contains_name(state->caller_names, part->data.identifier.name)) {
+                state->visible = false;
+            }
+        }
+    }
+}
+
+// names the callee uses must not be shadowed by a local of the caller once the body is moved there,
+// and its parameters must not shadow a local of the caller that is still read once the body is done
+bool callee_names_visible(Ast_Item_Procedure* callee, Inline_State* state) {
+    for (size_t i = 0; i < callee->arguments.count; i++) {
+        if (contains_name(&state->caller_names, callee->arguments.elements[i].name)) {
+            return false;
+        }
+    }
+
+    Name_Check_State check_state = { .callee = callee, .caller_names = &state->caller_names, .visible = true };
+    Ast_Walk_State walk_state = {
+        .expression_func = check_expression_names,
+        .statement_func = check_statement_names,
+        .internal_state = &check_state,
+    };
+    walk_expression(callee->body, &walk_state);
+    return check_state.visible;
+}
+
+Ast_Expression create_inlined_body(Ast_Expression_Invoke* invoke, Ast_Item_Procedure* callee, Inline_State* state) {
+    Array_Ast_Statement* body = &callee->body->data.block.statements;
+    Ast_Expression_Block block = { .statements = array_ast_statement_new(body->count + 1) };
+
+    // all arguments are evaluated before any of the parameters come into scope
+    if (callee->arguments.count > 0) {
+        Ast_Statement* declare = arena_allocate(state->arena, sizeof(Ast_Statement));
+        *declare = (Ast_Statement) { .directives = array_ast_directive_new(1), .kind = Statement_Declare, .statement_end_location = invoke->location };
+        declare->data.declare.declarations = array_ast_declaration_new(callee->arguments.count);
+        for (size_t i = 0; i < callee->arguments.count; i++) {
+            array_ast_declaration_append(&declare->data.declare.declarations, callee->arguments.elements[i]);
+        }
+
+        if (invoke->arguments.count == 1) {
+            declare->data.declare.expression = invoke->arguments.elements[0];
+        } else {
+            Ast_Expression* multiple = arena_allocate(state->arena, sizeof(Ast_Expression));
+            *multiple = (Ast_Expression) { .directives = array_ast_directive_new(1), .kind = Expression_Multiple };
+            multiple->data.multiple.expressions = invoke->arguments;
+            declare->data.declare.expression = multiple;
+        }
+        array_ast_statement_append(&block.statements, declare);
+    }
+
+    for (size_t i = 0; i < body->count; i++) {
+        Ast_Statement* statement = body->elements[i];
+        if (statement->kind == Statement_Return) {
+            if (statement->data.return_.expression == NULL) {
+                continue;
+            }
+
+            // the returned values are left behind as the value of the block
+            Ast_Statement* value = arena_allocate(state->arena, sizeof(Ast_Statement));
+            *value = (Ast_Statement) { .directives = statement->directives, .kind = Statement_Expression, .statement_end_location = statement->statement_end_location };
+            value->data.expression.expression = copy_expression(statement->data.return_.expression, state->arena);
+            value->data.expression.skip_stack_check = true;
+            array_ast_statement_append(&block.statements, value);
+        } else {
+            array_ast_statement_append(&block.statements, copy_statement(statement, state->arena));
+        }
+    }
+
+    return (Ast_Expression) { .directives = array_ast_directive_new(1), .kind = Expression_Block, .data = { .block = block } };
+}
+
+void collect_call_site(Ast_Expression* expression, void* internal_state) {
+    Inline_State* state = internal_state;
+    if (expression->kind != Expression_Invoke || expression->data.invoke.kind != Invoke_Standard) {
+        return;
+    }
+
+    // unexpanded macro arguments were never processed and are not output
+    Ast_Expression_Invoke* invoke = &expression->data.invoke;
+    if (invoke->data.procedure.computed_procedure_type.kind != Type_Procedure) {
+        return;
+    }
+
+    Ast_Expression* procedure = invoke->data.procedure.procedure;
+    if (procedure->kind == Expression_Retrieve && procedure->data.retrieve.kind == Retrieve_Assign_Identifier) {
+        array_ast_expression_append(&state->call_sites, expression);
+    }
+}
+
+void collect_declared_name(Ast_Statement* statement, void* internal_state) {
+    Inline_State* state = internal_state;
+    if (statement->kind == Statement_Declare) {
+        for (size_t i = 0; i < statement->data.declare.declarations.count; i++) {
+            array_string_append(&state->caller_names, statement->data.declare.declarations.elements[i].name);
+        }
+    }
+}
+
+void inline_call_site(Ast_Expression* expression, Inline_State* state) {
+    // macro expansions can share nodes, so the site may have been seen and replaced already
+    if (expression->kind != Expression_Invoke) {
+        return;
+    }
+
+    Ast_Expression_Invoke* invoke = &expression->data.invoke;
+    Ast_Identifier identifier = invoke->data.procedure.procedure->data.retrieve.data.identifier;
+    if (contains_name(&state->caller_names, identifier.name)) {
+        return;
+    }
+
+    Resolved resolved = resolve(&state->generic, identifier);
+    if (resolved.kind != Resolved_Item || resolved.data.item->kind != Item_Procedure) {
+        return;
+    }
+
+    Ast_Item_Procedure* callee = &resolved.data.item->data.procedure;
+    if (callee == state->caller || !should_inline(resolved.data.item) || !callee_names_visible(callee, state)) {
+        return;
+    }
+
+    *expression = create_inlined_body(invoke, callee, state);
+}
+
+void inline_procedures(Program* program, Symbol_Table* symbols, Arena* arena) {
+    Inline_State state = {
+        .generic = (Generic_State) {
+            .program = program,
+            .symbols = symbols,
+        },
+        .arena = arena,
+        .caller_names = array_string_new(16),
+        .call_sites = array_ast_expression_new(64),
+    };
+
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file = &program->elements[j];
+        state.generic.current_file = file;
+
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (item->kind != Item_Procedure) {
+                continue;
+            }
+
+            if (has_directive(&item->directives, Directive_If) && !get_directive(&item->directives, Directive_If)->data.if_.result) {
+                continue;
+            }
+
+            Ast_Item_Procedure* procedure = &item->data.procedure;
+            state.caller = procedure;
+            state.caller_names.count = 0;
+            state.call_sites.count = 0;
+            for (size_t k = 0; k < procedure->arguments.count; k++) {
+                array_string_append(&state.caller_names, procedure->arguments.elements[k].name);
+            }
+
+            Ast_Walk_State walk_state = {
+                .expression_func = collect_call_site,
+                .statement_func = collect_declared_name,
+                .internal_state = &state,
+            };
+            walk_expression(procedure->body, &walk_state);
+
+            // call sites are replaced in place, code that was just inlined is not looked at again
+            for (size_t k = 0; k < state.call_sites.count; k++) {
+                inline_call_site(state.call_sites.elements[k], &state);
+            }
+        }
+    }
+
+    array_string_free(&state.caller_names);
+    array_ast_expression_free(&state.call_sites);
+}
@@ -0,0 +1,11 @@
+#ifndef INLINER__
+#define INLINER__
+
+#include "arena.h"
+#include "ast.h"
+#include "symbol_table.h"
+
+// replaces direct calls to small procedures with a block holding their body, runs on the processed program
+void inline_procedures(Program* program, Symbol_Table* symbols, Arena* arena);
+
+#endif
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interner.h"
+#include "string_util.h"
+
+Interner interner_new(size_t capacity) {
+    size_t capacity_rounded = 16;
+    while (capacity_rounded * INTERNER_SHARD_COUNT < capacity) {
+        capacity_rounded *= 2;
+    }
+
+    Interner interner;
+    for (size_t i = 0; i < INTERNER_SHARD_COUNT; i++) {
+        interner.shards[i] = (Interner_Shard) {
+            .strings = calloc(capacity_rounded, sizeof(Interned_String)),
+            .count = 0,
+            .capacity = capacity_rounded,
+            .arena = arena_new("name"),
+        };
+        pthread_mutex_init(&interner.shards[i].mutex, NULL);
+    }
+    return interner;
+}
+
+static Interned_String* interner_find_slot(Interned_String* strings, size_t capacity, char* string, size_t length, size_t hash) {
+    size_t mask = capacity - 1;
+    size_t index = hash & mask;
+    while (strings[index].string != NULL) {
+        Interned_String* interned = &strings[index];
+        if (interned->hash == hash && interned->length == length && memcmp(interned->string, string, length) == 0) {
+            return interned;
+        }
+        index = (index + 1) & mask;
+    }
+    return &strings[index];
+}
+
+static void interner_grow(Interner_Shard* shard) {
+    size_t capacity_new = shard->capacity * 2;
+    Interned_String* strings_new = calloc(capacity_new, sizeof(Interned_String));
+
+    for (size_t i = 0; i < shard->capacity; i++) {
+        Interned_String* interned = &shard->strings[i];
+        if (interned->string != NULL) {
+            *interner_find_slot(strings_new, capacity_new, interned->string, interned->length, interned->hash) = *interned;
+        }
+    }
+
+    free(shard->strings);
+    shard->strings = strings_new;
+    shard->capacity = capacity_new;
+}
+
+char* interner_intern(Interner* interner, char* string, size_t length) {
+    size_t hash = string_hash_length(string, length);
+    // the low bits index the slots inside a shard, so the shard is chosen by the high ones
+    Interner_Shard* shard = &interner->shards[hash >> (sizeof(size_t) * 8 - INTERNER_SHARD_BITS)];
+
+    pthread_mutex_lock(&shard->mutex);
+    Interned_String* interned = interner_find_slot(shard->strings, shard->capacity, string, length, hash);
+    char* result = interned->string;
+    if (result == NULL) {
+        // keep the load factor at or below one half
+        if ((shard->count + 1) * 2 > shard->capacity) {
+            interner_grow(shard);
+            interned = interner_find_slot(shard->strings, shard->capacity, string, length, hash);
+        }
+
+        result = arena_copy_string_length(&shard->arena, string, length);
+        *interned = (Interned_String) { result, length, hash };
+        shard->count++;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return result;
+}
+
+void interner_print_usage(Interner* interner) {
+    size_t high_water = 0;
+    for (size_t i = 0; i < INTERNER_SHARD_COUNT; i++) {
+        high_water += interner->shards[i].arena.high_water;
+    }
+    printf("name arena: %zu bytes high water\n", high_water);
+}
+
+void interner_free(Interner* interner) {
+    for (size_t i = 0; i < INTERNER_SHARD_COUNT; i++) {
+        Interner_Shard* shard = &interner->shards[i];
+        pthread_mutex_destroy(&shard->mutex);
+        free(shard->strings);
+        arena_free(&shard->arena);
+    }
+}
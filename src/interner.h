@@ -0,0 +1,38 @@
+#ifndef INTERNER__
+#define INTERNER__
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+typedef struct {
+    char* string;
+    size_t length;
+    size_t hash;
+} Interned_String;
+
+#define INTERNER_SHARD_BITS 4
+#define INTERNER_SHARD_COUNT (1 << INTERNER_SHARD_BITS)
+
+// one part of the table, the top bits of a hash pick the shard and only its mutex is taken
+typedef struct {
+    Interned_String* strings;
+    size_t count;
+    size_t capacity;
+    Arena arena;
+    pthread_mutex_t mutex;
+} Interner_Shard;
+
+// deduplicates names taken from source views, every distinct string is stored once
+// shared by every parser thread, split into shards so threads interning different names rarely wait on each other
+typedef struct {
+    Interner_Shard shards[INTERNER_SHARD_COUNT];
+} Interner;
+
+Interner interner_new(size_t capacity);
+char* interner_intern(Interner* interner, char* string, size_t length);
+void interner_print_usage(Interner* interner);
+void interner_free(Interner* interner);
+
+#endif
@@ -0,0 +1,1140 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ir.h"
+#include "keywords.h"
+#include "layout.h"
+
+Dynamic_Array_Impl(Ir_Transfer, Array_Ir_Transfer, array_ir_transfer_)
+Dynamic_Array_Impl(Ir_Incoming, Array_Ir_Incoming, array_ir_incoming_)
+Dynamic_Array_Impl(Ir_Instruction, Array_Ir_Instruction, array_ir_instruction_)
+Dynamic_Array_Impl(Ir_Block, Array_Ir_Block, array_ir_block_)
+Dynamic_Array_Impl(Ir_Procedure, Ir_Program, ir_program_)
+
+typedef struct {
+    char* name;
+    Ast_Type* type;
+    Ir_Value address;
+} Ir_Local;
+
+Dynamic_Array_Def(Ir_Local, Array_Ir_Local, array_ir_local_)
+Dynamic_Array_Impl(Ir_Local, Array_Ir_Local, array_ir_local_)
+
+typedef struct {
+    Generic_State generic;
+    Ir_Procedure* procedure;
+    size_t block;
+    size_t alloca_count;
+    Array_Ir_Local locals;
+    Array_Size scopes;
+    Array_Size break_blocks;
+} Ir_Build_State;
+
+bool ir_has_value(Ir_Instruction* instruction) {
+    switch (instruction->kind) {
+        case Ir_Store:
+        case Ir_Copy:
+        case Ir_Zero:
+        case Ir_Copy_Bytes:
+        case Ir_Set_Bytes:
+        case Ir_Jump:
+        case Ir_Branch:
+        case Ir_Return:
+        case Ir_Unreachable:
+            return false;
+        case Ir_Call:
+            return instruction->data.call.has_value;
+        default:
+            return true;
+    }
+}
+
+size_t ir_type_size(Ir_Type type) {
+    switch (type) {
+        case Ir_I8: return 1;
+        case Ir_I16: return 2;
+        case Ir_I32: return 4;
+        case Ir_I64: return 8;
+        case Ir_F64: return 8;
+        default:
+            assert(false);
+    }
+}
+
+// false for structs, unions and arrays, which only ever live in memory
+bool get_ir_type(Ast_Type* type_in, Ir_Type* result, Generic_State* state) {
+    Ast_Type type = evaluate_type_complete(type_in, state);
+    switch (type.kind) {
+        case Type_Internal:
+            switch (type.data.internal) {
+                case Type_UInt:
+                case Type_UInt64:
+                case Type_Ptr:
+                    *result = Ir_I64;
+                    return true;
+                case Type_UInt32:
+                    *result = Ir_I32;
+                    return true;
+                case Type_UInt16:
+                    *result = Ir_I16;
+                    return true;
+                case Type_UInt8:
+                case Type_Byte:
+                case Type_Bool:
+                    *result = Ir_I8;
+                    return true;
+                case Type_Float64:
+                    *result = Ir_F64;
+                    return true;
+            }
+            break;
+        case Type_Pointer:
+        case Type_Enum:
+        case Type_RegisterSize:
+            *result = Ir_I64;
+            return true;
+        default:
+            return false;
+    }
+    assert(false);
+}
+
+size_t ir_new_block(Ir_Build_State* state) {
+    array_ir_block_append(&state->procedure->blocks, (Ir_Block) { .instructions = array_size_new(8) });
+    return state->procedure->blocks.count - 1;
+}
+
+Ir_Value ir_append(Ir_Instruction instruction, Ir_Build_State* state) {
+    Ir_Value value = state->procedure->instructions.count;
+    array_ir_instruction_append(&state->procedure->instructions, instruction);
+    array_size_append(&state->procedure->blocks.elements[state->block].instructions, value);
+    return value;
+}
+
+// allocas all go to the start of the entry block so they dominate every use
+Ir_Value ir_alloca(size_t size, size_t alignment, Ir_Build_State* state) {
+    Ir_Value value = state->procedure->instructions.count;
+    array_ir_instruction_append(&state->procedure->instructions, (Ir_Instruction) { .kind = Ir_Alloca, .type = Ir_I64, .data = { .alloca = { size, alignment } } });
+
+    Array_Size* entry = &state->procedure->blocks.elements[0].instructions;
+    array_size_append(entry, 0);
+    for (size_t i = entry->count - 1; i > state->alloca_count; i--) {
+        entry->elements[i] = entry->elements[i - 1];
+    }
+    entry->elements[state->alloca_count] = value;
+    state->alloca_count++;
+    return value;
+}
+
+Ir_Value ir_constant(Ir_Type type, size_t constant, Ir_Build_State* state) {
+    return ir_append((Ir_Instruction) { .kind = Ir_Constant, .type = type, .data = { .constant = constant } }, state);
+}
+
+Ir_Value ir_binary(Ir_Binary_Operator operator_, Ir_Type type, Ir_Value left, Ir_Value right, Ir_Build_State* state) {
+    return ir_append((Ir_Instruction) { .kind = Ir_Binary, .type = type, .data = { .binary = { operator_, left, right } } }, state);
+}
+
+Ir_Value ir_offset(Ir_Value address, size_t offset, Ir_Build_State* state) {
+    if (offset == 0) {
+        return address;
+    }
+    return ir_binary(Ir_Add, Ir_I64, address, ir_constant(Ir_I64, offset, state), state);
+}
+
+Ir_Value ir_load(Ir_Type type, Ir_Value address, Ir_Build_State* state) {
+    return ir_append((Ir_Instruction) { .kind = Ir_Load, .type = type, .data = { .memory = { address, IR_NO_VALUE } } }, state);
+}
+
+void ir_copy(Ir_Value destination, Ir_Value source, size_t size, Ir_Build_State* state) {
+    ir_append((Ir_Instruction) { .kind = Ir_Copy, .data = { .copy = { destination, source, size } } }, state);
+}
+
+void ir_terminate(Ir_Instruction instruction, Ir_Build_State* state) {
+    ir_append(instruction, state);
+}
+
+void ir_jump(size_t block, Ir_Build_State* state) {
+    ir_terminate((Ir_Instruction) { .kind = Ir_Jump, .data = { .jump = block } }, state);
+}
+
+Ir_Transfer ir_scalar(Ir_Value value, Ir_Type type) {
+    return (Ir_Transfer) { .value = value, .type = type, .size = ir_type_size(type), .aggregate = false };
+}
+
+void ir_store_transfer(Ir_Value address, Ir_Transfer transfer, Ir_Build_State* state) {
+    if (transfer.aggregate) {
+        ir_copy(address, transfer.value, transfer.size, state);
+    } else {
+        ir_append((Ir_Instruction) { .kind = Ir_Store, .type = transfer.type, .data = { .memory = { address, transfer.value } } }, state);
+    }
+}
+
+// aggregates are copied out so later stores to the memory they came from cannot change them
+Ir_Transfer ir_read(Ir_Value address, Ast_Type* type, Ir_Build_State* state) {
+    Ir_Type ir_type;
+    if (get_ir_type(type, &ir_type, &state->generic)) {
+        return ir_scalar(ir_load(ir_type, address, state), ir_type);
+    }
+
+    size_t size = get_size(type, &state->generic);
+    Ir_Value copy = ir_alloca(size, get_alignment(type, &state->generic), state);
+    ir_copy(copy, address, size, state);
+    return (Ir_Transfer) { .value = copy, .type = Ir_I64, .size = size, .aggregate = true };
+}
+
+Ir_Local* get_ir_local(char* name, Ir_Build_State* state) {
+    for (int i = state->locals.count - 1; i >= 0; i--) {
+        if (strcmp(state->locals.elements[i].name, name) == 0) {
+            return &state->locals.elements[i];
+        }
+    }
+    return NULL;
+}
+
+Ast_Declaration* get_ir_argument(char* name, size_t* index, Ir_Build_State* state) {
+    Array_Ast_Declaration* arguments = &state->procedure->source->arguments;
+    for (int i = arguments->count - 1; i >= 0; i--) {
+        if (strcmp(arguments->elements[i].name, name) == 0) {
+            *index = i;
+            return &arguments->elements[i];
+        }
+    }
+    return NULL;
+}
+
+void build_ir_expression(Ast_Expression* expression, Array_Ir_Transfer* results, Ir_Build_State* state);
+
+Ir_Transfer build_ir_single(Ast_Expression* expression, Ir_Build_State* state) {
+    Array_Ir_Transfer results = array_ir_transfer_new(1);
+    build_ir_expression(expression, &results, state);
+    assert(results.count == 1);
+
+    Ir_Transfer result = results.elements[0];
+    array_ir_transfer_free(&results);
+    return result;
+}
+
+Ir_Value build_ir_address(Ast_Expression* expression, Ir_Build_State* state);
+
+// address of the memory a retrieve or assign part names, with the type stored there
+bool build_ir_retrieve_address(Retrieve_Assign_Node* node, Ir_Value* address, Ast_Type* type, Ir_Build_State* state) {
+    switch (node->kind) {
+        case Retrieve_Assign_Array: {
+            Ast_Type array_type = node->data.array.computed_array_type;
+
+            Ir_Value base;
+            Ast_Type array_raw;
+            if (array_type.kind == Type_Pointer) {
+                base = build_ir_single(node->data.array.expression_outer, state).value;
+                array_raw = evaluate_type_complete(array_type.data.pointer.child, &state->generic);
+            } else {
+                base = build_ir_address(node->data.array.expression_outer, state);
+                array_raw = evaluate_type_complete(&array_type, &state->generic);
+            }
+
+            Ir_Value index = build_ir_single(node->data.array.expression_inner, state).value;
+            size_t element_size = get_size(array_raw.data.array.element_type, &state->generic);
+
+            Ir_Value offset = ir_binary(Ir_Multiply, Ir_I64, index, ir_constant(Ir_I64, element_size, state), state);
+            *address = ir_binary(Ir_Add, Ir_I64, base, offset, state);
+            *type = *array_raw.data.array.element_type;
+            return true;
+        }
+        case Retrieve_Assign_Parent: {
+            Ast_Type parent_type = node->data.parent.computed_parent_type;
+
+            Ir_Value base;
+            if (node->data.parent.needs_reference) {
+                base = build_ir_address(node->data.parent.expression, state);
+            } else {
+                base = build_ir_single(node->data.parent.expression, state).value;
+            }
+
+            Location_Size_Data location_size = get_parent_item_location_size(&parent_type, node->data.parent.name, &state->generic);
+            *address = ir_offset(base, location_size.location, state);
+            *type = get_parent_item_type(&parent_type, node->data.parent.name, &state->generic);
+            return true;
+        }
+        case Retrieve_Assign_Identifier: {
+            char* name = node->data.identifier.name;
+
+            Ir_Local* local = get_ir_local(name, state);
+            if (local != NULL) {
+                *address = local->address;
+                *type = *local->type;
+                return true;
+            }
+
+            size_t index;
+            Ast_Declaration* argument = get_ir_argument(name, &index, state);
+            if (argument != NULL) {
+                *address = ir_append((Ir_Instruction) { .kind = Ir_Argument, .type = Ir_I64, .data = { .argument = index } }, state);
+                *type = argument->type;
+                return true;
+            }
+
+            Resolved resolved = resolve(&state->generic, node->data.identifier);
+            if (resolved.kind == Resolved_Item && resolved.data.item->kind == Item_Global) {
+                Ast_Item_Global* global = &resolved.data.item->data.global;
+                *address = ir_append((Ir_Instruction) { .kind = Ir_Global, .type = Ir_I64, .data = { .name = global->name } }, state);
+                *type = global->type;
+                return true;
+            }
+            return false;
+        }
+        default:
+            assert(false);
+    }
+}
+
+bool is_enum_variant(Ast_Expression_Retrieve* retrieve) {
+    return retrieve->kind == Retrieve_Assign_Identifier && retrieve->computed_result_type != NULL && retrieve->computed_result_type->kind == Type_Enum;
+}
+
+Ir_Value build_ir_address(Ast_Expression* expression, Ir_Build_State* state) {
+    if (expression->kind == Expression_RunMacro) {
+        return build_ir_address(expression->data.run_macro.result.data.expression, state);
+    }
+
+    Ast_Expression_Retrieve* retrieve = &expression->data.retrieve;
+    if (expression->kind == Expression_Retrieve && (retrieve->kind != Retrieve_Assign_Identifier || (retrieve->data.identifier.id == Word_None && !is_enum_variant(retrieve)))) {
+        Ir_Value address;
+        Ast_Type type;
+        if (build_ir_retrieve_address(retrieve, &address, &type, state)) {
+            return address;
+        }
+
+        // procedures are already addresses, taking a reference to one changes nothing
+        Resolved resolved = resolve(&state->generic, retrieve->data.identifier);
+        if (resolved.kind == Resolved_Item && resolved.data.item->kind == Item_Procedure) {
+            return ir_append((Ir_Instruction) { .kind = Ir_Procedure_Address, .type = Ir_I64, .data = { .name = resolved.data.item->data.procedure.name } }, state);
+        }
+    }
+
+    // anything else is a temporary that gets a place in memory
+    Ir_Transfer transfer = build_ir_single(expression, state);
+    if (transfer.aggregate) {
+        return transfer.value;
+    }
+
+    Ir_Value address = ir_alloca(transfer.size, transfer.size, state);
+    ir_store_transfer(address, transfer, state);
+    return address;
+}
+
+Ir_Value build_ir_aggregate(Ast_Type* type, Ir_Build_State* state) {
+    return ir_alloca(get_size(type, &state->generic), get_alignment(type, &state->generic), state);
+}
+
+// fields are evaluated last to first, the order the stack machine pushes them in
+void build_ir_build(Ast_Expression_Build* build, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    size_t size = get_size(&build->type, &state->generic);
+    Ir_Value address = build_ir_aggregate(&build->type, state);
+
+    Ast_Type type = evaluate_type_complete(&build->type, &state->generic);
+    switch (type.kind) {
+        case Type_Struct: {
+            Type_Layout layout = get_layout(&build->type, &state->generic);
+            for (int i = build->arguments.count - 1; i >= 0; i--) {
+                Ir_Transfer field = build_ir_single(build->arguments.elements[i], state);
+                ir_store_transfer(ir_offset(address, layout.offsets[i], state), field, state);
+            }
+            layout_free_unnamed(&layout, &build->type, &state->generic);
+            break;
+        }
+        case Type_Array: {
+            size_t element_size = get_size(type.data.array.element_type, &state->generic);
+            for (int i = build->arguments.count - 1; i >= 0; i--) {
+                Ir_Transfer element = build_ir_single(build->arguments.elements[i], state);
+                ir_store_transfer(ir_offset(address, i * element_size, state), element, state);
+            }
+            break;
+        }
+        default:
+            assert(false);
+    }
+
+    array_ir_transfer_append(results, (Ir_Transfer) { .value = address, .type = Ir_I64, .size = size, .aggregate = true });
+}
+
+Ir_Binary_Operator get_ir_binary_operator(Operator operator_) {
+    switch (operator_) {
+        case Operator_Add: return Ir_Add;
+        case Operator_Subtract: return Ir_Subtract;
+        case Operator_Multiply: return Ir_Multiply;
+        case Operator_Divide: return Ir_Divide;
+        case Operator_Modulus: return Ir_Modulus;
+        case Operator_And: return Ir_And;
+        case Operator_Or: return Ir_Or;
+        default:
+            assert(false);
+    }
+}
+
+Ir_Condition get_ir_condition(Operator operator_) {
+    switch (operator_) {
+        case Operator_Equal: return Ir_Equal;
+        case Operator_NotEqual: return Ir_NotEqual;
+        case Operator_Less: return Ir_Less;
+        case Operator_LessEqual: return Ir_LessEqual;
+        case Operator_Greater: return Ir_Greater;
+        case Operator_GreaterEqual: return Ir_GreaterEqual;
+        default:
+            assert(false);
+    }
+}
+
+void build_ir_operator(Ast_Expression_Invoke* invoke, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    Operator operator_ = invoke->data.operator_.operator_;
+
+    Array_Ir_Transfer arguments = array_ir_transfer_new(2);
+    for (size_t i = 0; i < invoke->arguments.count; i++) {
+        build_ir_expression(invoke->arguments.elements[i], &arguments, state);
+    }
+
+    switch (operator_) {
+        case Operator_Add:
+        case Operator_Subtract:
+        case Operator_Multiply:
+        case Operator_Divide:
+        case Operator_Modulus: {
+            Ir_Type type;
+            bool scalar = get_ir_type(&invoke->data.operator_.computed_operand_type, &type, &state->generic);
+            assert(scalar);
+
+            Ir_Value value = ir_binary(get_ir_binary_operator(operator_), type, arguments.elements[0].value, arguments.elements[1].value, state);
+            array_ir_transfer_append(results, ir_scalar(value, type));
+            break;
+        }
+        case Operator_Equal:
+        case Operator_NotEqual:
+        case Operator_Greater:
+        case Operator_GreaterEqual:
+        case Operator_Less:
+        case Operator_LessEqual: {
+            Ir_Type type;
+            bool scalar = get_ir_type(&invoke->data.operator_.computed_operand_type, &type, &state->generic);
+            assert(scalar);
+
+            Ir_Instruction compare = { .kind = Ir_Compare, .type = Ir_I8 };
+            compare.data.compare.condition = get_ir_condition(operator_);
+            compare.data.compare.operand_type = type;
+            compare.data.compare.left = arguments.elements[0].value;
+            compare.data.compare.right = arguments.elements[1].value;
+            array_ir_transfer_append(results, ir_scalar(ir_append(compare, state), Ir_I8));
+            break;
+        }
+        case Operator_And:
+        case Operator_Or: {
+            Ir_Value value = ir_binary(get_ir_binary_operator(operator_), Ir_I8, arguments.elements[0].value, arguments.elements[1].value, state);
+            array_ir_transfer_append(results, ir_scalar(value, Ir_I8));
+            break;
+        }
+        case Operator_Not: {
+            Ir_Instruction compare = { .kind = Ir_Compare, .type = Ir_I8 };
+            compare.data.compare.condition = Ir_Equal;
+            compare.data.compare.operand_type = Ir_I8;
+            compare.data.compare.left = arguments.elements[0].value;
+            compare.data.compare.right = ir_constant(Ir_I8, 0, state);
+            array_ir_transfer_append(results, ir_scalar(ir_append(compare, state), Ir_I8));
+            break;
+        }
+        default:
+            assert(false);
+    }
+
+    array_ir_transfer_free(&arguments);
+}
+
+// the procedure a call names directly, unless a local or argument shadows it
+Ast_Item_Procedure* get_ir_direct_callee(Ast_Expression* procedure, Ir_Build_State* state) {
+    if (procedure->kind != Expression_Retrieve || procedure->data.retrieve.kind != Retrieve_Assign_Identifier) {
+        return NULL;
+    }
+
+    char* name = procedure->data.retrieve.data.identifier.name;
+    size_t index;
+    if (get_ir_local(name, state) != NULL || get_ir_argument(name, &index, state) != NULL) {
+        return NULL;
+    }
+
+    Resolved resolved = resolve(&state->generic, procedure->data.retrieve.data.identifier);
+    if (resolved.kind != Resolved_Item || resolved.data.item->kind != Item_Procedure) {
+        return NULL;
+    }
+    return &resolved.data.item->data.procedure;
+}
+
+void build_ir_call(Ast_Expression_Invoke* invoke, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    Array_Ir_Transfer arguments = array_ir_transfer_new(invoke->arguments.count + 1);
+    for (size_t i = 0; i < invoke->arguments.count; i++) {
+        build_ir_expression(invoke->arguments.elements[i], &arguments, state);
+    }
+
+    Ast_Expression* procedure = invoke->data.procedure.procedure;
+    Word_Id id = procedure->kind == Expression_Retrieve && procedure->data.retrieve.kind == Retrieve_Assign_Identifier ? procedure->data.retrieve.data.identifier.id : Word_None;
+    if (id >= Intrinsic_Syscall0 && id <= Intrinsic_Syscall6) {
+        Ir_Value value = ir_append((Ir_Instruction) { .kind = Ir_Syscall, .type = Ir_I64, .data = { .syscall = arguments } }, state);
+        array_ir_transfer_append(results, ir_scalar(value, Ir_I64));
+        return;
+    }
+
+    if (id == Intrinsic_Copy || id == Intrinsic_Set) {
+        Ir_Instruction bytes = { .kind = id == Intrinsic_Copy ? Ir_Copy_Bytes : Ir_Set_Bytes, .type = Ir_I64 };
+        if (id == Intrinsic_Copy) {
+            bytes.data.bytes.source = arguments.elements[0].value;
+            bytes.data.bytes.destination = arguments.elements[1].value;
+        } else {
+            bytes.data.bytes.destination = arguments.elements[0].value;
+            bytes.data.bytes.source = arguments.elements[1].value;
+        }
+        bytes.data.bytes.length = arguments.elements[2].value;
+        ir_append(bytes, state);
+        array_ir_transfer_free(&arguments);
+        return;
+    }
+
+    Ir_Instruction call = { .kind = Ir_Call, .type = Ir_I64 };
+    call.data.call.arguments = arguments;
+    call.data.call.destination = IR_NO_VALUE;
+    call.data.call.callee = IR_NO_VALUE;
+
+    Ast_Item_Procedure* direct = get_ir_direct_callee(procedure, state);
+    if (direct != NULL) {
+        call.data.call.direct = direct;
+    } else {
+        call.data.call.callee = build_ir_single(procedure, state).value;
+    }
+
+    Array_Ast_Type* returns = &invoke->data.procedure.computed_procedure_type.data.procedure.returns;
+    for (size_t i = 0; i < returns->count; i++) {
+        call.data.call.returns_size += get_size(returns->elements[i], &state->generic);
+    }
+
+    Ir_Type type;
+    if (returns->count == 1 && get_ir_type(returns->elements[0], &type, &state->generic)) {
+        call.type = type;
+        call.data.call.has_value = true;
+        array_ir_transfer_append(results, ir_scalar(ir_append(call, state), type));
+        return;
+    }
+
+    if (call.data.call.returns_size == 0) {
+        ir_append(call, state);
+        return;
+    }
+
+    // returned values are laid out like the stack they come back on, the last one lowest
+    Ir_Value destination = ir_alloca(call.data.call.returns_size, 8, state);
+    call.data.call.destination = destination;
+    ir_append(call, state);
+
+    size_t offset = call.data.call.returns_size;
+    for (size_t i = 0; i < returns->count; i++) {
+        offset -= get_size(returns->elements[i], &state->generic);
+        array_ir_transfer_append(results, ir_read(ir_offset(destination, offset, state), returns->elements[i], state));
+    }
+}
+
+void build_ir_cast(Ast_Expression_Cast* cast, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    Ir_Transfer input = build_ir_single(cast->expression, state);
+
+    Ir_Type output_type;
+    bool scalar = get_ir_type(&cast->type, &output_type, &state->generic);
+    assert(scalar && !input.aggregate);
+
+    if (output_type == input.type) {
+        array_ir_transfer_append(results, ir_scalar(input.value, output_type));
+        return;
+    }
+
+    Ir_Instruction convert = { .kind = Ir_Convert, .type = output_type, .data = { .convert = { input.type, input.value } } };
+    array_ir_transfer_append(results, ir_scalar(ir_append(convert, state), output_type));
+}
+
+void build_ir_statement(Ast_Statement* statement, Array_Ir_Transfer* results, Ir_Build_State* state);
+
+// both sides of an if leave their values in the same place, a phi for scalars and shared memory for aggregates
+void merge_ir_results(Array_Ir_Transfer* if_results, size_t if_end, Array_Ir_Transfer* else_results, size_t else_end, size_t merge, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    size_t count = if_results->count > else_results->count ? if_results->count : else_results->count;
+
+    Array_Ir_Transfer* sides[2] = { if_results, else_results };
+    size_t ends[2] = { if_end, else_end };
+
+    for (size_t i = 0; i < count; i++) {
+        Ir_Transfer first = i < if_results->count ? if_results->elements[i] : else_results->elements[i];
+        if (first.aggregate) {
+            Ir_Value shared = ir_alloca(first.size, 8, state);
+            for (size_t j = 0; j < 2; j++) {
+                if (i < sides[j]->count) {
+                    // the copy has to happen before the jump that ends the side
+                    Array_Size* instructions = &state->procedure->blocks.elements[ends[j]].instructions;
+                    size_t jump = array_size_pop(instructions);
+
+                    size_t block = state->block;
+                    state->block = ends[j];
+                    ir_copy(shared, sides[j]->elements[i].value, first.size, state);
+                    state->block = block;
+
+                    array_size_append(instructions, jump);
+                }
+            }
+            array_ir_transfer_append(results, (Ir_Transfer) { .value = shared, .type = Ir_I64, .size = first.size, .aggregate = true });
+        } else {
+            Ir_Instruction phi = { .kind = Ir_Phi, .type = first.type, .data = { .phi = array_ir_incoming_new(2) } };
+            for (size_t j = 0; j < 2; j++) {
+                if (i < sides[j]->count) {
+                    array_ir_incoming_append(&phi.data.phi, (Ir_Incoming) { ends[j], sides[j]->elements[i].value });
+                }
+            }
+            array_ir_transfer_append(results, ir_scalar(ir_append(phi, state), first.type));
+        }
+    }
+
+    (void) merge;
+}
+
+void build_ir_if(Ast_Expression_If* node, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    Ir_Value condition = build_ir_single(node->condition, state).value;
+
+    size_t if_block = ir_new_block(state);
+    size_t else_block = ir_new_block(state);
+    size_t merge_block = ir_new_block(state);
+
+    ir_terminate((Ir_Instruction) { .kind = Ir_Branch, .data = { .branch = { condition, if_block, else_block } } }, state);
+
+    Array_Ir_Transfer if_results = array_ir_transfer_new(1);
+    state->block = if_block;
+    build_ir_expression(node->if_expression, &if_results, state);
+    size_t if_end = state->block;
+    ir_jump(merge_block, state);
+
+    Array_Ir_Transfer else_results = array_ir_transfer_new(1);
+    state->block = else_block;
+    if (node->else_expression != NULL) {
+        build_ir_expression(node->else_expression, &else_results, state);
+    }
+    size_t else_end = state->block;
+    ir_jump(merge_block, state);
+
+    state->block = merge_block;
+    merge_ir_results(&if_results, if_end, &else_results, else_end, merge_block, results, state);
+
+    array_ir_transfer_free(&if_results);
+    array_ir_transfer_free(&else_results);
+}
+
+void build_ir_retrieve(Ast_Expression_Retrieve* retrieve, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    if (retrieve->kind == Retrieve_Assign_Identifier) {
+        if (retrieve->data.identifier.id == Intrinsic_File) {
+            Ir_Value value = ir_append((Ir_Instruction) { .kind = Ir_String, .type = Ir_I64, .data = { .string = retrieve->location.file } }, state);
+            array_ir_transfer_append(results, ir_scalar(value, Ir_I64));
+            return;
+        } else if (retrieve->data.identifier.id == Intrinsic_Line) {
+            array_ir_transfer_append(results, ir_scalar(ir_constant(Ir_I64, retrieve->location.row, state), Ir_I64));
+            return;
+        }
+    }
+
+    bool variable = retrieve->kind != Retrieve_Assign_Identifier || get_ir_local(retrieve->data.identifier.name, state) != NULL;
+    if (!variable) {
+        size_t index;
+        variable = get_ir_argument(retrieve->data.identifier.name, &index, state) != NULL;
+    }
+
+    if (variable) {
+        Ir_Value address;
+        Ast_Type type;
+        bool found = build_ir_retrieve_address(retrieve, &address, &type, state);
+        assert(found);
+        array_ir_transfer_append(results, ir_read(address, &type, state));
+        return;
+    }
+
+    if (is_enum_variant(retrieve)) {
+        Ast_Type_Enum* enum_ = &retrieve->computed_result_type->data.enum_;
+        size_t index = 0;
+        while (strcmp(enum_->items.elements[index], retrieve->data.identifier.name) != 0) {
+            index++;
+        }
+        array_ir_transfer_append(results, ir_scalar(ir_constant(Ir_I64, index, state), Ir_I64));
+        return;
+    }
+
+    Resolved resolved = resolve(&state->generic, retrieve->data.identifier);
+    assert(resolved.kind == Resolved_Item);
+    Ast_Item* item = resolved.data.item;
+    switch (item->kind) {
+        case Item_Procedure: {
+            Ir_Value value = ir_append((Ir_Instruction) { .kind = Ir_Procedure_Address, .type = Ir_I64, .data = { .name = item->data.procedure.name } }, state);
+            array_ir_transfer_append(results, ir_scalar(value, Ir_I64));
+            break;
+        }
+        case Item_Global: {
+            Ast_Item_Global* global = &item->data.global;
+            Ir_Value address = ir_append((Ir_Instruction) { .kind = Ir_Global, .type = Ir_I64, .data = { .name = global->name } }, state);
+            array_ir_transfer_append(results, ir_read(address, &global->type, state));
+            break;
+        }
+        case Item_Constant: {
+            Ir_Type type;
+            bool scalar = get_ir_type(retrieve->computed_result_type, &type, &state->generic);
+            assert(scalar);
+
+            Ast_Expression_Number* number = &item->data.constant.expression;
+            size_t value = number->kind == Number_Integer ? number->value.integer : (size_t) number->value.decimal;
+            if (type == Ir_F64) {
+                union { double d; size_t s; } bits = { .d = number->kind == Number_Integer ? (double) number->value.integer : number->value.decimal };
+                value = bits.s;
+            }
+            array_ir_transfer_append(results, ir_scalar(ir_constant(type, value, state), type));
+            break;
+        }
+        default:
+            assert(false);
+    }
+}
+
+size_t truncate_ir_constant(Ir_Type type, size_t value) {
+    size_t size = ir_type_size(type);
+    if (size == 8) {
+        return value;
+    }
+    return value & ((1ul << (size * 8)) - 1);
+}
+
+void build_ir_expression(Ast_Expression* expression, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    switch (expression->kind) {
+        case Expression_Block: {
+            Ast_Expression_Block* block = &expression->data.block;
+            array_size_append(&state->scopes, state->locals.count);
+            for (size_t i = 0; i < block->statements.count; i++) {
+                build_ir_statement(block->statements.elements[i], results, state);
+            }
+            state->locals.count = array_size_pop(&state->scopes);
+            break;
+        }
+        case Expression_Multiple: {
+            Ast_Expression_Multiple* multiple = &expression->data.multiple;
+            for (size_t i = 0; i < multiple->expressions.count; i++) {
+                build_ir_expression(multiple->expressions.elements[i], results, state);
+            }
+            break;
+        }
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            if (invoke->kind == Invoke_Operator) {
+                build_ir_operator(invoke, results, state);
+            } else {
+                build_ir_call(invoke, results, state);
+            }
+            break;
+        }
+        case Expression_RunMacro:
+            build_ir_expression(expression->data.run_macro.result.data.expression, results, state);
+            break;
+        case Expression_Retrieve:
+            build_ir_retrieve(&expression->data.retrieve, results, state);
+            break;
+        case Expression_If:
+            build_ir_if(&expression->data.if_, results, state);
+            break;
+        case Expression_Number: {
+            Ast_Expression_Number* number = &expression->data.number;
+            assert(number->type != NULL);
+
+            Ir_Type type;
+            bool scalar = get_ir_type(number->type, &type, &state->generic);
+            assert(scalar);
+
+            size_t value;
+            if (type == Ir_F64) {
+                union { double d; size_t s; } bits = { .d = number->kind == Number_Integer ? (double) number->value.integer : number->value.decimal };
+                value = bits.s;
+            } else {
+                value = truncate_ir_constant(type, number->kind == Number_Integer ? number->value.integer : (size_t) number->value.decimal);
+            }
+            array_ir_transfer_append(results, ir_scalar(ir_constant(type, value, state), type));
+            break;
+        }
+        case Expression_Boolean:
+            array_ir_transfer_append(results, ir_scalar(ir_constant(Ir_I8, expression->data.boolean.value, state), Ir_I8));
+            break;
+        case Expression_Char:
+            array_ir_transfer_append(results, ir_scalar(ir_constant(Ir_I8, (unsigned char) expression->data.char_.value, state), Ir_I8));
+            break;
+        case Expression_Null:
+            array_ir_transfer_append(results, ir_scalar(ir_constant(Ir_I64, 0, state), Ir_I64));
+            break;
+        case Expression_String: {
+            Ir_Value value = ir_append((Ir_Instruction) { .kind = Ir_String, .type = Ir_I64, .data = { .string = expression->data.string.value } }, state);
+            array_ir_transfer_append(results, ir_scalar(value, Ir_I64));
+            break;
+        }
+        case Expression_Reference:
+            array_ir_transfer_append(results, ir_scalar(build_ir_address(expression->data.reference.inner, state), Ir_I64));
+            break;
+        case Expression_Cast:
+            build_ir_cast(&expression->data.cast, results, state);
+            break;
+        case Expression_Init: {
+            Ast_Type* type = &expression->data.init.type;
+            Ir_Type ir_type;
+            if (get_ir_type(type, &ir_type, &state->generic)) {
+                array_ir_transfer_append(results, ir_scalar(ir_constant(ir_type, 0, state), ir_type));
+            } else {
+                size_t size = get_size(type, &state->generic);
+                Ir_Value address = build_ir_aggregate(type, state);
+                ir_append((Ir_Instruction) { .kind = Ir_Zero, .data = { .copy = { address, IR_NO_VALUE, size } } }, state);
+                array_ir_transfer_append(results, (Ir_Transfer) { .value = address, .type = Ir_I64, .size = size, .aggregate = true });
+            }
+            break;
+        }
+        case Expression_Build:
+            build_ir_build(&expression->data.build, results, state);
+            break;
+        case Expression_SizeOf: {
+            Ast_Expression_SizeOf* size_of = &expression->data.size_of;
+            Ir_Type type;
+            get_ir_type(&size_of->computed_result_type, &type, &state->generic);
+            size_t value = truncate_ir_constant(type, get_size(&size_of->type, &state->generic));
+            array_ir_transfer_append(results, ir_scalar(ir_constant(type, value, state), type));
+            break;
+        }
+        case Expression_LengthOf: {
+            Ast_Expression_LengthOf* length_of = &expression->data.length_of;
+            Ir_Type type;
+            get_ir_type(&length_of->computed_result_type, &type, &state->generic);
+            size_t value = truncate_ir_constant(type, get_length(&length_of->type));
+            array_ir_transfer_append(results, ir_scalar(ir_constant(type, value, state), type));
+            break;
+        }
+        default:
+            assert(false);
+    }
+}
+
+void build_ir_statement(Ast_Statement* statement, Array_Ir_Transfer* results, Ir_Build_State* state) {
+    if (has_directive(&statement->directives, Directive_If)) {
+        Ast_Directive_If* if_node = &get_directive(&statement->directives, Directive_If)->data.if_;
+        if (!if_node->result) {
+            return;
+        }
+    }
+
+    switch (statement->kind) {
+        case Statement_Expression:
+            build_ir_expression(statement->data.expression.expression, results, state);
+            break;
+        case Statement_Declare: {
+            Ast_Statement_Declare* declare = &statement->data.declare;
+
+            Array_Ir_Transfer values = array_ir_transfer_new(declare->declarations.count + 1);
+            if (declare->expression != NULL) {
+                build_ir_expression(declare->expression, &values, state);
+                assert(values.count == declare->declarations.count);
+            }
+
+            for (size_t i = 0; i < declare->declarations.count; i++) {
+                Ast_Declaration* declaration = &declare->declarations.elements[i];
+                Ir_Value address = build_ir_aggregate(&declaration->type, state);
+                if (declare->expression != NULL) {
+                    ir_store_transfer(address, values.elements[i], state);
+                }
+                array_ir_local_append(&state->locals, (Ir_Local) { declaration->name, &declaration->type, address });
+            }
+            array_ir_transfer_free(&values);
+            break;
+        }
+        case Statement_Assign: {
+            Ast_Statement_Assign* assign = &statement->data.assign;
+
+            Array_Ir_Transfer values = array_ir_transfer_new(assign->parts.count + 1);
+            build_ir_expression(assign->expression, &values, state);
+            assert(values.count == assign->parts.count);
+
+            // parts take their values last to first, like the stack they came from
+            for (int i = assign->parts.count - 1; i >= 0; i--) {
+                Ir_Value address;
+                Ast_Type type;
+                if (build_ir_retrieve_address(&assign->parts.elements[i], &address, &type, state)) {
+                    ir_store_transfer(address, values.elements[i], state);
+                }
+            }
+            array_ir_transfer_free(&values);
+            break;
+        }
+        case Statement_Return: {
+            Array_Ir_Transfer values = array_ir_transfer_new(2);
+            if (statement->data.return_.expression != NULL) {
+                build_ir_expression(statement->data.return_.expression, &values, state);
+            }
+
+            ir_terminate((Ir_Instruction) { .kind = Ir_Return, .data = { .return_ = values } }, state);
+            state->block = ir_new_block(state);
+            break;
+        }
+        case Statement_While: {
+            Ast_Statement_While* node = &statement->data.while_;
+            size_t condition_block = ir_new_block(state);
+            size_t inside_block = ir_new_block(state);
+            size_t end_block = ir_new_block(state);
+
+            ir_jump(condition_block, state);
+            state->block = condition_block;
+            Ir_Value condition = build_ir_single(node->condition, state).value;
+            ir_terminate((Ir_Instruction) { .kind = Ir_Branch, .data = { .branch = { condition, inside_block, end_block } } }, state);
+
+            array_size_append(&state->break_blocks, end_block);
+            state->block = inside_block;
+
+            Array_Ir_Transfer ignored = array_ir_transfer_new(1);
+            build_ir_expression(node->inside, &ignored, state);
+            array_ir_transfer_free(&ignored);
+
+            ir_jump(condition_block, state);
+            state->break_blocks.count--;
+
+            state->block = end_block;
+            break;
+        }
+        case Statement_Break:
+            ir_jump(state->break_blocks.elements[state->break_blocks.count - 1], state);
+            state->block = ir_new_block(state);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+Ir_Procedure build_ir_procedure(Ast_Item_Procedure* procedure, Ir_Build_State* state) {
+    Ir_Procedure result = {
+        .source = procedure,
+        .instructions = array_ir_instruction_new(64),
+        .blocks = array_ir_block_new(8),
+    };
+
+    state->procedure = &result;
+    state->alloca_count = 0;
+    state->locals.count = 0;
+    state->scopes.count = 0;
+    state->block = ir_new_block(state);
+
+    Array_Ir_Transfer values = array_ir_transfer_new(2);
+    build_ir_expression(procedure->body, &values, state);
+
+    if (procedure->has_implicit_return) {
+        ir_terminate((Ir_Instruction) { .kind = Ir_Return, .data = { .return_ = values } }, state);
+    } else {
+        array_ir_transfer_free(&values);
+        ir_terminate((Ir_Instruction) { .kind = Ir_Unreachable }, state);
+    }
+
+    state->procedure = NULL;
+    return result;
+}
+
+Ir_Program ir_build(Program* program, Symbol_Table* symbols) {
+    Ir_Build_State state = {
+        .generic = (Generic_State) {
+            .program = program,
+            .symbols = symbols,
+        },
+        .locals = array_ir_local_new(16),
+        .scopes = array_size_new(8),
+        .break_blocks = array_size_new(4),
+    };
+    Ir_Program result = ir_program_new(64);
+
+    compute_type_layouts(&state.generic);
+
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file = &program->elements[j];
+        state.generic.current_file = file;
+
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (item->kind != Item_Procedure) {
+                continue;
+            }
+
+            if (!is_item_output(item)) {
+                continue;
+            }
+
+            ir_program_append(&result, build_ir_procedure(&item->data.procedure, &state));
+        }
+    }
+
+    array_ir_local_free(&state.locals);
+    array_size_free(&state.scopes);
+    array_size_free(&state.break_blocks);
+    return result;
+}
+
+char* ir_type_names[] = { "i8", "i16", "i32", "i64", "f64" };
+char* ir_binary_names[] = { "add", "sub", "mul", "div", "mod", "and", "or" };
+char* ir_condition_names[] = { "eq", "ne", "lt", "le", "gt", "ge" };
+
+void dump_ir_transfers(Array_Ir_Transfer* transfers) {
+    for (size_t i = 0; i < transfers->count; i++) {
+        Ir_Transfer* transfer = &transfers->elements[i];
+        if (transfer->aggregate) {
+            printf("%s[%zu] %%%zu", i > 0 ? ", " : "", transfer->size, transfer->value);
+        } else {
+            printf("%s%s %%%zu", i > 0 ? ", " : "", ir_type_names[transfer->type], transfer->value);
+        }
+    }
+}
+
+void dump_ir_instruction(Ir_Value value, Ir_Instruction* instruction) {
+    printf("    ");
+    if (ir_has_value(instruction)) {
+        printf("%%%zu = ", value);
+    }
+
+    switch (instruction->kind) {
+        case Ir_Constant:
+            printf("const %s %zu", ir_type_names[instruction->type], instruction->data.constant);
+            break;
+        case Ir_Argument:
+            printf("argument %zu", instruction->data.argument);
+            break;
+        case Ir_Alloca:
+            printf("alloca %zu, align %zu", instruction->data.alloca.size, instruction->data.alloca.alignment);
+            break;
+        case Ir_Global:
+            printf("global %s", instruction->data.name);
+            break;
+        case Ir_Procedure_Address:
+            printf("procedure %s", instruction->data.name);
+            break;
+        case Ir_String:
+            printf("string \"");
+            for (char* c = instruction->data.string; *c != '\0'; c++) {
+                if (*c == '\n') printf("\\n");
+                else if (*c == '"' || *c == '\\') printf("\\%c", *c);
+                else printf("%c", *c);
+            }
+            printf("\"");
+            break;
+        case Ir_Load:
+            printf("load %s %%%zu", ir_type_names[instruction->type], instruction->data.memory.address);
+            break;
+        case Ir_Store:
+            printf("store %s %%%zu, %%%zu", ir_type_names[instruction->type], instruction->data.memory.address, instruction->data.memory.value);
+            break;
+        case Ir_Copy:
+            printf("copy %%%zu, %%%zu, %zu", instruction->data.copy.destination, instruction->data.copy.source, instruction->data.copy.size);
+            break;
+        case Ir_Zero:
+            printf("zero %%%zu, %zu", instruction->data.copy.destination, instruction->data.copy.size);
+            break;
+        case Ir_Binary:
+            printf("%s %s %%%zu, %%%zu", ir_binary_names[instruction->data.binary.operator_], ir_type_names[instruction->type], instruction->data.binary.left, instruction->data.binary.right);
+            break;
+        case Ir_Compare:
+            printf("cmp %s %s %%%zu, %%%zu", ir_condition_names[instruction->data.compare.condition], ir_type_names[instruction->data.compare.operand_type], instruction->data.compare.left, instruction->data.compare.right);
+            break;
+        case Ir_Convert:
+            printf("convert %s %%%zu to %s", ir_type_names[instruction->data.convert.from], instruction->data.convert.value, ir_type_names[instruction->type]);
+            break;
+        case Ir_Call:
+            if (instruction->data.call.direct != NULL) {
+                printf("call %s(", instruction->data.call.direct->name);
+            } else {
+                printf("call %%%zu(", instruction->data.call.callee);
+            }
+            dump_ir_transfers(&instruction->data.call.arguments);
+            printf(")");
+            if (instruction->data.call.has_value) {
+                printf(" -> %s", ir_type_names[instruction->type]);
+            } else if (instruction->data.call.destination != IR_NO_VALUE) {
+                printf(" -> [%zu] %%%zu", instruction->data.call.returns_size, instruction->data.call.destination);
+            }
+            break;
+        case Ir_Syscall:
+            printf("syscall(");
+            dump_ir_transfers(&instruction->data.syscall);
+            printf(")");
+            break;
+        case Ir_Copy_Bytes:
+            printf("copy_bytes %%%zu, %%%zu, %%%zu", instruction->data.bytes.destination, instruction->data.bytes.source, instruction->data.bytes.length);
+            break;
+        case Ir_Set_Bytes:
+            printf("set_bytes %%%zu, %%%zu, %%%zu", instruction->data.bytes.destination, instruction->data.bytes.source, instruction->data.bytes.length);
+            break;
+        case Ir_Phi:
+            printf("phi %s", ir_type_names[instruction->type]);
+            for (size_t i = 0; i < instruction->data.phi.count; i++) {
+                Ir_Incoming* incoming = &instruction->data.phi.elements[i];
+                printf("%s [@%zu %%%zu]", i > 0 ? "," : "", incoming->block, incoming->value);
+            }
+            break;
+        case Ir_Jump:
+            printf("jmp @%zu", instruction->data.jump);
+            break;
+        case Ir_Branch:
+            printf("br %%%zu, @%zu, @%zu", instruction->data.branch.condition, instruction->data.branch.if_true, instruction->data.branch.if_false);
+            break;
+        case Ir_Return:
+            printf("ret ");
+            dump_ir_transfers(&instruction->data.return_);
+            break;
+        case Ir_Unreachable:
+            printf("unreachable");
+            break;
+        default:
+            assert(false);
+    }
+    printf("\n");
+}
+
+void ir_dump(Ir_Program* program) {
+    for (size_t i = 0; i < program->count; i++) {
+        Ir_Procedure* procedure = &program->elements[i];
+        printf("proc %s {\n", procedure->source->name);
+        for (size_t j = 0; j < procedure->blocks.count; j++) {
+            Ir_Block* block = &procedure->blocks.elements[j];
+            printf("  @%zu:\n", j);
+            for (size_t k = 0; k < block->instructions.count; k++) {
+                Ir_Value value = block->instructions.elements[k];
+                dump_ir_instruction(value, &procedure->instructions.elements[value]);
+            }
+        }
+        printf("}\n");
+    }
+}
+
+void ir_free(Ir_Program* program) {
+    for (size_t i = 0; i < program->count; i++) {
+        Ir_Procedure* procedure = &program->elements[i];
+        for (size_t j = 0; j < procedure->instructions.count; j++) {
+            Ir_Instruction* instruction = &procedure->instructions.elements[j];
+            switch (instruction->kind) {
+                case Ir_Call:
+                    array_ir_transfer_free(&instruction->data.call.arguments);
+                    break;
+                case Ir_Syscall:
+                    array_ir_transfer_free(&instruction->data.syscall);
+                    break;
+                case Ir_Phi:
+                    array_ir_incoming_free(&instruction->data.phi);
+                    break;
+                case Ir_Return:
+                    array_ir_transfer_free(&instruction->data.return_);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        for (size_t j = 0; j < procedure->blocks.count; j++) {
+            array_size_free(&procedure->blocks.elements[j].instructions);
+        }
+        array_ir_instruction_free(&procedure->instructions);
+        array_ir_block_free(&procedure->blocks);
+    }
+    ir_program_free(program);
+}
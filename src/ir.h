@@ -0,0 +1,173 @@
+#ifndef IR__
+#define IR__
+
+#include "ast.h"
+#include "processor.h"
+#include "symbol_table.h"
+
+// instructions are numbered per procedure and every one that produces something defines the value with its index
+typedef size_t Ir_Value;
+
+#define IR_NO_VALUE ((Ir_Value) -1)
+
+// values are always held zero extended, aggregates never become values and are passed around by address
+typedef enum {
+    Ir_I8,
+    Ir_I16,
+    Ir_I32,
+    Ir_I64,
+    Ir_F64,
+} Ir_Type;
+
+typedef enum {
+    Ir_Constant,
+    Ir_Argument,
+    Ir_Alloca,
+    Ir_Global,
+    Ir_Procedure_Address,
+    Ir_String,
+    Ir_Load,
+    Ir_Store,
+    Ir_Copy,
+    Ir_Zero,
+    Ir_Binary,
+    Ir_Compare,
+    Ir_Convert,
+    Ir_Call,
+    Ir_Syscall,
+    // copy and set with a length only known at runtime, for @copy and @set
+    Ir_Copy_Bytes,
+    Ir_Set_Bytes,
+    Ir_Phi,
+    Ir_Jump,
+    Ir_Branch,
+    Ir_Return,
+    Ir_Unreachable,
+} Ir_Instruction_Kind;
+
+typedef enum {
+    Ir_Add,
+    Ir_Subtract,
+    Ir_Multiply,
+    Ir_Divide,
+    Ir_Modulus,
+    Ir_And,
+    Ir_Or,
+} Ir_Binary_Operator;
+
+// comparisons are unsigned, there are no signed types
+typedef enum {
+    Ir_Equal,
+    Ir_NotEqual,
+    Ir_Less,
+    Ir_LessEqual,
+    Ir_Greater,
+    Ir_GreaterEqual,
+} Ir_Condition;
+
+// a value crossing a call or a return, aggregates travel as the address of their memory
+typedef struct {
+    Ir_Value value;
+    Ir_Type type;
+    size_t size;
+    bool aggregate;
+} Ir_Transfer;
+
+Dynamic_Array_Def(Ir_Transfer, Array_Ir_Transfer, array_ir_transfer_)
+
+typedef struct {
+    size_t block;
+    Ir_Value value;
+} Ir_Incoming;
+
+Dynamic_Array_Def(Ir_Incoming, Array_Ir_Incoming, array_ir_incoming_)
+
+typedef struct {
+    Ir_Instruction_Kind kind;
+    Ir_Type type;
+    union {
+        size_t constant;
+        size_t argument;
+        struct {
+            size_t size;
+            size_t alignment;
+        } alloca;
+        char* name;
+        char* string;
+        struct {
+            Ir_Value address;
+            Ir_Value value;
+        } memory;
+        struct {
+            Ir_Value destination;
+            Ir_Value source;
+            size_t size;
+        } copy;
+        struct {
+            Ir_Binary_Operator operator_;
+            Ir_Value left;
+            Ir_Value right;
+        } binary;
+        struct {
+            Ir_Condition condition;
+            Ir_Type operand_type;
+            Ir_Value left;
+            Ir_Value right;
+        } compare;
+        struct {
+            Ir_Type from;
+            Ir_Value value;
+        } convert;
+        struct {
+            // set for calls to a named procedure, callee is only used when it is NULL
+            Ast_Item_Procedure* direct;
+            Ir_Value callee;
+            Array_Ir_Transfer arguments;
+            size_t returns_size;
+            // a single scalar return becomes the value of the call, anything else is copied to destination
+            bool has_value;
+            Ir_Value destination;
+        } call;
+        Array_Ir_Transfer syscall;
+        // source holds the byte value for Ir_Set_Bytes
+        struct {
+            Ir_Value destination;
+            Ir_Value source;
+            Ir_Value length;
+        } bytes;
+        Array_Ir_Incoming phi;
+        size_t jump;
+        struct {
+            Ir_Value condition;
+            size_t if_true;
+            size_t if_false;
+        } branch;
+        Array_Ir_Transfer return_;
+    } data;
+} Ir_Instruction;
+
+Dynamic_Array_Def(Ir_Instruction, Array_Ir_Instruction, array_ir_instruction_)
+
+// indices into the instructions of the procedure, the last one is always a jump, branch, return or unreachable
+typedef struct {
+    Array_Size instructions;
+} Ir_Block;
+
+Dynamic_Array_Def(Ir_Block, Array_Ir_Block, array_ir_block_)
+
+typedef struct {
+    Ast_Item_Procedure* source;
+    Array_Ir_Instruction instructions;
+    Array_Ir_Block blocks;
+} Ir_Procedure;
+
+// one procedure for every procedure item that is output, in program order
+Dynamic_Array_Def(Ir_Procedure, Ir_Program, ir_program_)
+
+bool ir_has_value(Ir_Instruction* instruction);
+size_t ir_type_size(Ir_Type type);
+Ir_Program ir_build(Program* program, Symbol_Table* symbols);
+void ir_dump(Ir_Program* program);
+void ir_free(Ir_Program* program);
+
+#endif
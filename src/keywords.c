@@ -0,0 +1,209 @@
+// generated by generate_keywords.py, do not edit
+
+#include <string.h>
+
+#include "keywords.h"
+
+typedef struct {
+    char* string;
+    size_t length;
+    Word_Id id;
+} Word_Entry;
+
+// perfect hash over length, first, second and last character
+static Word_Entry word_table[128] = {
+    { "uint64", 6, Builtin_UInt64 },
+    { "@istype", 7, Intrinsic_IsType },
+    { "uint16", 6, Builtin_UInt16 },
+    { "uint8", 5, Builtin_UInt8 },
+    { "@sizeof", 7, Intrinsic_SizeOf },
+    { "false", 5, Literal_False },
+    { "else", 4, Keyword_Else },
+    { NULL, 0, Word_None },
+    { "byte", 4, Builtin_Byte },
+    { "ptr", 3, Builtin_Ptr },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "bool", 4, Builtin_Bool },
+    { "@init", 5, Intrinsic_Init },
+    { "@set", 4, Intrinsic_Set },
+    { NULL, 0, Word_None },
+    { "@typeof", 7, Intrinsic_TypeOf },
+    { NULL, 0, Word_None },
+    { "mod", 3, Keyword_Mod },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "true", 4, Literal_True },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "const", 5, Keyword_Const },
+    { "@build", 6, Intrinsic_Build },
+    { NULL, 0, Word_None },
+    { "@line", 5, Intrinsic_Line },
+    { NULL, 0, Word_None },
+    { "enum", 4, Keyword_Enum },
+    { "global", 6, Keyword_Global },
+    { NULL, 0, Word_None },
+    { "@lengthof", 9, Intrinsic_LengthOf },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "break", 5, Keyword_Break },
+    { "struct", 6, Keyword_Struct },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "@linux", 6, Intrinsic_Linux },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "while", 5, Keyword_While },
+    { "uint", 4, Builtin_UInt },
+    { NULL, 0, Word_None },
+    { "@cast", 5, Intrinsic_Cast },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "@copy", 5, Intrinsic_Copy },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "@syscall0", 9, Intrinsic_Syscall0 },
+    { "@syscall1", 9, Intrinsic_Syscall1 },
+    { "@syscall2", 9, Intrinsic_Syscall2 },
+    { "@syscall3", 9, Intrinsic_Syscall3 },
+    { "@syscall4", 9, Intrinsic_Syscall4 },
+    { "@syscall5", 9, Intrinsic_Syscall5 },
+    { "@syscall6", 9, Intrinsic_Syscall6 },
+    { NULL, 0, Word_None },
+    { "@file", 5, Intrinsic_File },
+    { "@os", 3, Intrinsic_Os },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "return", 6, Keyword_Return },
+    { "var", 3, Keyword_Var },
+    { "proc", 4, Keyword_Proc },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "float64", 7, Builtin_Float64 },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "macro", 5, Keyword_Macro },
+    { "if", 2, Keyword_If },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "type", 4, Keyword_Type },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "null", 4, Literal_Null },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "union", 5, Keyword_Union },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { NULL, 0, Word_None },
+    { "uint32", 6, Builtin_UInt32 },
+    { NULL, 0, Word_None },
+};
+
+Word_Id lookup_word(char* string, size_t length) {
+    if (length < 2) {
+        return Word_None;
+    }
+
+    size_t hash = (length + (unsigned char) string[0] * 13 + (unsigned char) string[1] * 13 + (unsigned char) string[length - 1] * 1) & 127;
+    Word_Entry* entry = &word_table[hash];
+    if (entry->length == length && memcmp(entry->string, string, length) == 0) {
+        return entry->id;
+    }
+    return Word_None;
+}
+
+char* get_word_string(Word_Id id) {
+    switch (id) {
+        case Keyword_Proc: return "proc";
+        case Keyword_Macro: return "macro";
+        case Keyword_Type: return "type";
+        case Keyword_Struct: return "struct";
+        case Keyword_Union: return "union";
+        case Keyword_Enum: return "enum";
+        case Keyword_Mod: return "mod";
+        case Keyword_Global: return "global";
+        case Keyword_Const: return "const";
+        case Keyword_Var: return "var";
+        case Keyword_If: return "if";
+        case Keyword_Else: return "else";
+        case Keyword_While: return "while";
+        case Keyword_Break: return "break";
+        case Keyword_Return: return "return";
+        case Literal_True: return "true";
+        case Literal_False: return "false";
+        case Literal_Null: return "null";
+        case Intrinsic_TypeOf: return "@typeof";
+        case Intrinsic_SizeOf: return "@sizeof";
+        case Intrinsic_LengthOf: return "@lengthof";
+        case Intrinsic_IsType: return "@istype";
+        case Intrinsic_Cast: return "@cast";
+        case Intrinsic_Init: return "@init";
+        case Intrinsic_Build: return "@build";
+        case Intrinsic_File: return "@file";
+        case Intrinsic_Line: return "@line";
+        case Intrinsic_Os: return "@os";
+        case Intrinsic_Linux: return "@linux";
+        case Intrinsic_Syscall0: return "@syscall0";
+        case Intrinsic_Syscall1: return "@syscall1";
+        case Intrinsic_Syscall2: return "@syscall2";
+        case Intrinsic_Syscall3: return "@syscall3";
+        case Intrinsic_Syscall4: return "@syscall4";
+        case Intrinsic_Syscall5: return "@syscall5";
+        case Intrinsic_Syscall6: return "@syscall6";
+        case Intrinsic_Copy: return "@copy";
+        case Intrinsic_Set: return "@set";
+        case Builtin_UInt: return "uint";
+        case Builtin_UInt64: return "uint64";
+        case Builtin_UInt32: return "uint32";
+        case Builtin_UInt16: return "uint16";
+        case Builtin_UInt8: return "uint8";
+        case Builtin_Float64: return "float64";
+        case Builtin_Byte: return "byte";
+        case Builtin_Ptr: return "ptr";
+        case Builtin_Bool: return "bool";
+        default: return NULL;
+    }
+}
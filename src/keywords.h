@@ -0,0 +1,62 @@
+// generated by generate_keywords.py, do not edit
+
+#ifndef KEYWORDS__
+#define KEYWORDS__
+
+#include <stddef.h>
+
+typedef enum {
+    Word_None,
+    Keyword_Proc,
+    Keyword_Macro,
+    Keyword_Type,
+    Keyword_Struct,
+    Keyword_Union,
+    Keyword_Enum,
+    Keyword_Mod,
+    Keyword_Global,
+    Keyword_Const,
+    Keyword_Var,
+    Keyword_If,
+    Keyword_Else,
+    Keyword_While,
+    Keyword_Break,
+    Keyword_Return,
+    Literal_True,
+    Literal_False,
+    Literal_Null,
+    Intrinsic_TypeOf,
+    Intrinsic_SizeOf,
+    Intrinsic_LengthOf,
+    Intrinsic_IsType,
+    Intrinsic_Cast,
+    Intrinsic_Init,
+    Intrinsic_Build,
+    Intrinsic_File,
+    Intrinsic_Line,
+    Intrinsic_Os,
+    Intrinsic_Linux,
+    Intrinsic_Syscall0,
+    Intrinsic_Syscall1,
+    Intrinsic_Syscall2,
+    Intrinsic_Syscall3,
+    Intrinsic_Syscall4,
+    Intrinsic_Syscall5,
+    Intrinsic_Syscall6,
+    Intrinsic_Copy,
+    Intrinsic_Set,
+    Builtin_UInt,
+    Builtin_UInt64,
+    Builtin_UInt32,
+    Builtin_UInt16,
+    Builtin_UInt8,
+    Builtin_Float64,
+    Builtin_Byte,
+    Builtin_Ptr,
+    Builtin_Bool,
+} Word_Id;
+
+Word_Id lookup_word(char* string, size_t length);
+char* get_word_string(Word_Id id);
+
+#endif
@@ -0,0 +1,284 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "layout.h"
+#include "processor.h"
+
+Ast_Item_Type* get_named_type(Ast_Type* type, Generic_State* state) {
+    if (type->kind != Type_Basic) {
+        return NULL;
+    }
+
+    Resolved resolved = resolve(state, type->data.basic.identifier);
+    if (resolved.kind != Resolved_Item) {
+        return NULL;
+    }
+
+    Ast_Item* item = resolved.data.item;
+    assert(item->kind == Item_Type);
+    return &item->data.type;
+}
+
+size_t get_alignment(Ast_Type* type_in, Generic_State* state);
+Type_Layout compute_type_layout(Ast_Type* type_in, Generic_State* state);
+
+size_t get_unnamed_size(Ast_Type* type, Generic_State* state) {
+    switch (type->kind) {
+        case Type_Array: {
+            Ast_Type_Array* array = &type->data.array;
+
+            if (array->has_size) {
+                assert(array->size_type->kind == Type_Number);
+                size_t size = array->size_type->data.number.value;
+                return size * get_size(array->element_type, state);
+            }
+            break;
+        }
+        case Type_Internal: {
+            Ast_Type_Internal* internal = &type->data.internal;
+
+            switch (*internal) {
+                case Type_UInt:
+                case Type_UInt64:
+                case Type_Float64:
+                case Type_Ptr:
+                    return 8;
+                case Type_UInt32:
+                    return 4;
+                case Type_UInt16:
+                    return 2;
+                case Type_UInt8:
+                case Type_Byte:
+                    return 1;
+                case Type_Bool:
+                    return 1;
+            }
+            break;
+        }
+        case Type_Pointer: {
+            return 8;
+        }
+        case Type_Struct:
+        case Type_Union: {
+            Type_Layout layout = compute_type_layout(type, state);
+            free(layout.offsets);
+            free(layout.sizes);
+            return layout.size;
+        }
+        case Type_Enum: {
+            return 8;
+        }
+        default:
+            assert(false);
+    }
+    assert(false);
+}
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// fields are placed at their natural alignment unless the struct or union is marked #packed
+Type_Layout compute_type_layout(Ast_Type* type_in, Generic_State* state) {
+    Type_Layout layout = {};
+
+    Ast_Type type = evaluate_type(type_in);
+    Ast_Item_Type* named = get_named_type(&type, state);
+    if (named != NULL) {
+        // an alias shares the layout of the type it names
+        return *get_type_layout(named, state);
+    }
+
+    Array_Ast_Declaration_Pointer* items = NULL;
+    if (type.kind == Type_Struct) items = &type.data.struct_.items;
+    if (type.kind == Type_Union) items = &type.data.union_.items;
+
+    if (items == NULL) {
+        layout.size = get_unnamed_size(&type, state);
+        layout.alignment = get_alignment(&type, state);
+        return layout;
+    }
+
+    bool packed = has_directive(&type.directives, Directive_Packed);
+    layout.alignment = 1;
+    layout.count = items->count;
+    layout.offsets = malloc(sizeof(size_t) * (items->count > 0 ? items->count : 1));
+    layout.sizes = malloc(sizeof(size_t) * (items->count > 0 ? items->count : 1));
+
+    for (size_t i = 0; i < items->count; i++) {
+        Ast_Type* item_type = &items->elements[i]->type;
+        size_t item_size = get_size(item_type, state);
+        size_t item_alignment = packed ? 1 : get_alignment(item_type, state);
+        if (item_alignment > layout.alignment) {
+            layout.alignment = item_alignment;
+        }
+        layout.sizes[i] = item_size;
+
+        if (type.kind == Type_Struct) {
+            layout.offsets[i] = align_up(layout.size, item_alignment);
+            layout.size = layout.offsets[i] + item_size;
+        } else {
+            layout.offsets[i] = 0;
+            if (item_size > layout.size) {
+                layout.size = item_size;
+            }
+        }
+    }
+
+    // arrays of the type keep every element aligned
+    layout.size = align_up(layout.size, layout.alignment);
+    return layout;
+}
+
+Type_Layout get_layout(Ast_Type* type_in, Generic_State* state) {
+    Ast_Type type = evaluate_type(type_in);
+    Ast_Item_Type* named = get_named_type(&type, state);
+    if (named != NULL) {
+        return *get_type_layout(named, state);
+    }
+    return compute_type_layout(&type, state);
+}
+
+void layout_free_unnamed(Type_Layout* layout, Ast_Type* type_in, Generic_State* state) {
+    Ast_Type type = evaluate_type(type_in);
+    if (get_named_type(&type, state) == NULL) {
+        free(layout->offsets);
+        free(layout->sizes);
+    }
+}
+
+Type_Layout* get_type_layout(Ast_Item_Type* type, Generic_State* state) {
+    if (type->computed_layout == NULL) {
+        Type_Layout* layout = malloc(sizeof(Type_Layout));
+        *layout = compute_type_layout(&type->type, state);
+        type->computed_layout = layout;
+    }
+    return type->computed_layout;
+}
+
+void compute_type_layouts(Generic_State* state) {
+    for (size_t j = 0; j < state->program->count; j++) {
+        Ast_File* file = &state->program->elements[j];
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (has_directive(&item->directives, Directive_If) && !get_directive(&item->directives, Directive_If)->data.if_.result) {
+                continue;
+            }
+
+            if (item->kind == Item_Type) {
+                get_type_layout(&item->data.type, state);
+            }
+        }
+    }
+}
+
+size_t get_size(Ast_Type* type_in, Generic_State* state) {
+    Ast_Type type = evaluate_type(type_in);
+    Ast_Item_Type* named = get_named_type(&type, state);
+    if (named != NULL) {
+        return get_type_layout(named, state)->size;
+    }
+    return get_unnamed_size(&type, state);
+}
+
+size_t get_alignment(Ast_Type* type_in, Generic_State* state) {
+    Ast_Type type = evaluate_type(type_in);
+    Ast_Item_Type* named = get_named_type(&type, state);
+    if (named != NULL) {
+        return get_type_layout(named, state)->alignment;
+    }
+
+    switch (type.kind) {
+        case Type_Array:
+            return get_alignment(type.data.array.element_type, state);
+        case Type_Struct:
+        case Type_Union: {
+            if (has_directive(&type.directives, Directive_Packed)) {
+                return 1;
+            }
+
+            Array_Ast_Declaration_Pointer* items = type.kind == Type_Struct ? &type.data.struct_.items : &type.data.union_.items;
+            size_t alignment = 1;
+            for (size_t i = 0; i < items->count; i++) {
+                size_t item_alignment = get_alignment(&items->elements[i]->type, state);
+                if (item_alignment > alignment) {
+                    alignment = item_alignment;
+                }
+            }
+            return alignment;
+        }
+        default:
+            return get_unnamed_size(&type, state);
+    }
+}
+
+Location_Size_Data get_layout_item_location_size(Type_Layout* layout, Ast_Type* type, char* item_name) {
+    Location_Size_Data result = {};
+
+    Array_Ast_Declaration_Pointer* items = type->kind == Type_Struct ? &type->data.struct_.items : &type->data.union_.items;
+    for (size_t i = 0; i < items->count; i++) {
+        if (strcmp(items->elements[i]->name, item_name) == 0) {
+            result.size = layout->sizes[i];
+            result.location = layout->offsets[i];
+            break;
+        }
+    }
+
+    return result;
+}
+
+Location_Size_Data get_parent_item_location_size(Ast_Type* parent_type, char* item_name, Generic_State* state) {
+    Location_Size_Data result = {};
+
+    if (strcmp(item_name, "*") == 0) {
+        result.size = get_size(parent_type, state);
+    } else {
+        switch (parent_type->kind) {
+            case Type_Basic: {
+                Ast_Item_Type* named = get_named_type(parent_type, state);
+                assert(named != NULL);
+
+                Ast_Type type = evaluate_type(&named->type);
+                if (type.kind != Type_Struct && type.kind != Type_Union) {
+                    return get_parent_item_location_size(&type, item_name, state);
+                }
+
+                return get_layout_item_location_size(get_type_layout(named, state), &type, item_name);
+            }
+            case Type_Struct:
+            case Type_Union: {
+                Type_Layout layout = compute_type_layout(parent_type, state);
+                result = get_layout_item_location_size(&layout, parent_type, item_name);
+                free(layout.offsets);
+                free(layout.sizes);
+                break;
+            }
+            case Type_RunMacro: {
+                return get_parent_item_location_size(parent_type->data.run_macro.result.data.type, item_name, state);
+            }
+            default:
+                assert(false);
+        }
+    }
+
+    return result;
+}
+
+size_t get_length(Ast_Type* type) {
+    switch (type->kind) {
+        case Type_Array: {
+            Ast_Type_Array* array_type = &type->data.array;
+            assert(array_type->has_size);
+            return array_type->size_type->data.number.value;
+        }
+        case Type_Pointer: {
+            return get_length(type->data.pointer.child);
+        }
+        case Type_TypeOf: {
+            return get_length(type->data.type_of.computed_result_type);
+        }
+        default:
+            assert(false);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef LAYOUT__
+#define LAYOUT__
+
+#include "processor.h"
+
+typedef struct {
+    size_t size;
+    size_t location;
+} Location_Size_Data;
+
+// sizes, alignments and field offsets of types, shared by the processor and every backend
+size_t get_size(Ast_Type* type_in, Generic_State* state);
+size_t get_alignment(Ast_Type* type_in, Generic_State* state);
+size_t get_length(Ast_Type* type);
+size_t align_up(size_t value, size_t alignment);
+Type_Layout* get_type_layout(Ast_Item_Type* type, Generic_State* state);
+Type_Layout get_layout(Ast_Type* type_in, Generic_State* state);
+void layout_free_unnamed(Type_Layout* layout, Ast_Type* type_in, Generic_State* state);
+void compute_type_layouts(Generic_State* state);
+Location_Size_Data get_parent_item_location_size(Ast_Type* parent_type, char* item_name, Generic_State* state);
+
+#endif
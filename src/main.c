@@ -4,15 +4,141 @@
 #include "tokenizer.h"
 #include "parser.h"
 #include "processor.h"
+#include "inliner.h"
+#include "reachability.h"
+#include "ir.h"
 #include "file_util.h"
+#include "module_cache.h"
+#include "stats.h"
+#include "thread_pool.h"
+#include "ast_walk.h"
 
 #include "output/fasm_linux_x86_64.h"
 #include "output/qbe.h"
 
+typedef struct {
+    char* path;
+    Interner* names;
+    Module_Cache* cache;
+    Arena token_arena;
+    Arena ast_arena;
+    char* real_path;
+    char* contents;
+    size_t length;
+    Tokens tokens;
+    Ast_File result;
+    // time of the read, tokenize and parse phases spent on this file
+    long phase_nanoseconds[3];
+    Stats_File stats;
+} Parse_Job;
+
+void count_expression(Ast_Expression* expression, void* internal_state) {
+    (void) expression;
+    (*(size_t*) internal_state)++;
+}
+
+void count_statement(Ast_Statement* statement, void* internal_state) {
+    (void) statement;
+    (*(size_t*) internal_state)++;
+}
+
+void count_type(Ast_Type* type, void* internal_state) {
+    (void) type;
+    (*(size_t*) internal_state)++;
+}
+
+// items and every expression, statement and type in them
+size_t count_nodes(Ast_File* file) {
+    size_t count = file->items.count;
+    Ast_Walk_State walk_state = {
+        .expression_func = count_expression,
+        .statement_func = count_statement,
+        .type_func = count_type,
+        .internal_state = &count,
+    };
+    for (size_t i = 0; i < file->items.count; i++) {
+        walk_item(&file->items.elements[i], &walk_state);
+    }
+    return count;
+}
+
+// reads, tokenizes and parses one file, files found in the module cache are loaded instead
+void run_parse_job(void* data) {
+    Parse_Job* job = data;
+    job->stats.path = job->path;
+
+    long start = stats_now();
+    job->real_path = realpath(job->path, NULL);
+
+    job->contents = map_file(job->real_path, &job->length);
+    if (job->contents == NULL) {
+        printf("Invalid file %s\n", job->path);
+        exit(1);
+    }
+    job->phase_nanoseconds[Phase_Read] = stats_now() - start;
+
+    start = stats_now();
+    if (job->cache != NULL && module_cache_load(job->cache, job->path, job->contents, job->length, &job->ast_arena, job->names, &job->result)) {
+        job->phase_nanoseconds[Phase_Parse] = stats_now() - start;
+        job->stats.cached = true;
+        if (compiler_stats.enabled) {
+            job->stats.nodes = count_nodes(&job->result);
+        }
+
+        unmap_file(job->contents, job->length);
+        free(job->real_path);
+        return;
+    }
+
+    start = stats_now();
+    job->tokens = tokenize(job->path, job->contents, job->length, &job->token_arena);
+    job->phase_nanoseconds[Phase_Tokenize] = stats_now() - start;
+    job->stats.tokens = job->tokens.count;
+
+    start = stats_now();
+    job->result = parse(&job->tokens, &job->ast_arena, job->names);
+    job->phase_nanoseconds[Phase_Parse] = stats_now() - start;
+    if (compiler_stats.enabled) {
+        job->stats.nodes = count_nodes(&job->result);
+    }
+
+    if (job->cache != NULL) {
+        module_cache_store(job->cache, job->contents, job->length, &job->result);
+    }
+
+    // the parser interns everything it keeps, so the tokens and the mapping can go
+    tokens_free(&job->tokens);
+    arena_reset(&job->token_arena);
+    unmap_file(job->contents, job->length);
+    free(job->real_path);
+}
+
 int main(int argc, char** argv) {
     Program program = program_new(4);
 
     char* backend = "none";
+    bool print_arenas = false;
+    Module_Cache cache;
+    bool use_cache = false;
+    Fasm_Options fasm_options = {};
+    bool inline_enabled = true;
+    bool eliminate_enabled = true;
+    bool print_dropped = false;
+    bool use_ir = false;
+    bool dump_ir = false;
+    Peephole_Stats peephole_stats = {};
+    bool peephole_enabled = true;
+    bool print_peephole = false;
+    size_t threads = thread_pool_default_size();
+    bool print_stats = false;
+    bool stats_json = false;
+    long compile_start = stats_now();
+
+    Arena token_arena = arena_new("token");
+    Arena ast_arena = arena_new("ast");
+    Arena process_arena = arena_new("process");
+    Interner names = interner_new(1024);
+    Array_String paths = array_string_new(32);
 
     int i = 1;
     while (i < argc) {
@@ -22,32 +148,175 @@ int main(int argc, char** argv) {
             if (strcmp(arg, "-backend") == 0) {
                 backend = argv[i + 1];
                 i += 2;
+            } else if (strcmp(arg, "-arenas") == 0) {
+                print_arenas = true;
+                i++;
+            } else if (strcmp(arg, "-cache") == 0) {
+                cache = module_cache_new(argv[i + 1]);
+                use_cache = true;
+                i += 2;
+            } else if (strcmp(arg, "-registers") == 0) {
+                fasm_options.registers = true;
+                i++;
+            } else if (strcmp(arg, "-register-calls") == 0) {
+                fasm_options.register_calls = true;
+                i++;
+            } else if (strcmp(arg, "-no-inline") == 0) {
+                inline_enabled = false;
+                i++;
+            } else if (strcmp(arg, "-keep-unreachable") == 0) {
+                eliminate_enabled = false;
+                i++;
+            } else if (strcmp(arg, "-print-dropped") == 0) {
+                print_dropped = true;
+                i++;
+            } else if (strcmp(arg, "-ir") == 0) {
+                use_ir = true;
+                i++;
+            } else if (strcmp(arg, "-dump-ir") == 0) {
+                dump_ir = true;
+                i++;
+            } else if (strcmp(arg, "-no-peephole") == 0) {
+                peephole_enabled = false;
+                i++;
+            } else if (strcmp(arg, "-peephole-stats") == 0) {
+                print_peephole = true;
+                i++;
+            } else if (strcmp(arg, "-stats") == 0 || strcmp(arg, "-stats-json") == 0) {
+                print_stats = true;
+                stats_json = strcmp(arg, "-stats-json") == 0;
+                stats_enable();
+                i++;
+            } else if (strcmp(arg, "-threads") == 0) {
+                threads = strtoul(argv[i + 1], NULL, 10);
+                if (threads == 0) {
+                    threads = 1;
+                }
+                i += 2;
             } else {
                 assert(false);
             }
         } else {
-            char* path = argv[i];
-            char* real_path = realpath(path, NULL);
+            array_string_append(&paths, argv[i]);
+            i++;
+        }
+    }
 
-            char* contents = read_file_to_string(real_path);
-            if (contents == NULL) {
-                printf("Invalid file %s\n", path);
-                exit(1);
-            }
-            Tokens tokens = tokenize(path, contents);
+    Parse_Job* jobs = malloc(sizeof(Parse_Job) * paths.count);
+    size_t thread_count = threads;
+    if (thread_count > paths.count) {
+        thread_count = paths.count;
+    }
 
-            program_append(&program, parse(&tokens));
-            i++;
+    if (thread_count > 0) {
+        Thread_Pool* pool = thread_pool_new(thread_count);
+        for (size_t j = 0; j < paths.count; j++) {
+            jobs[j] = (Parse_Job) {
+                .path = paths.elements[j],
+                .names = &names,
+                .cache = use_cache ? &cache : NULL,
+                .token_arena = arena_new("token"),
+                .ast_arena = arena_new("ast"),
+            };
+        }
+
+        long start = stats_now();
+        for (size_t j = 0; j < paths.count; j++) {
+            thread_pool_submit(pool, run_parse_job, &jobs[j]);
+        }
+        thread_pool_wait(pool);
+        compiler_stats.files_nanoseconds += stats_now() - start;
+        thread_pool_free(pool);
+    }
+
+    // files are added in command line order regardless of which finished first
+    for (size_t j = 0; j < paths.count; j++) {
+        program_append(&program, jobs[j].result);
+        for (size_t k = Phase_Read; k <= Phase_Parse; k++) {
+            compiler_stats.phase_nanoseconds[k] += jobs[j].phase_nanoseconds[k];
+        }
+        if (compiler_stats.enabled) {
+            array_stats_file_append(&compiler_stats.files, jobs[j].stats);
+        }
+        arena_merge(&token_arena, &jobs[j].token_arena);
+        arena_merge(&ast_arena, &jobs[j].ast_arena);
+    }
+    free(jobs);
+
+    long start = stats_now();
+    Symbol_Table symbols = symbol_table_build(&program);
+    process(&program, &symbols, &process_arena);
+    stats_add_phase(Phase_Process, start);
+
+    start = stats_now();
+    if (inline_enabled) {
+        inline_procedures(&program, &symbols, &process_arena);
+    }
+    stats_add_phase(Phase_Inline, start);
+
+    // after inlining, procedures that were inlined everywhere are left without callers
+    start = stats_now();
+    if (eliminate_enabled) {
+        mark_unreachable_items(&program, &symbols, print_dropped);
+    }
+    stats_add_phase(Phase_Reachability, start);
+
+    start = stats_now();
+    Ir_Program ir = {};
+    if (use_ir || dump_ir) {
+        ir = ir_build(&program, &symbols);
+        if (dump_ir) {
+            ir_dump(&ir);
         }
     }
+    stats_add_phase(Phase_Ir, start);
+
+    if (use_ir) {
+        fasm_options.ir = &ir;
+    }
 
-    process(&program);
+    if (peephole_enabled) {
+        fasm_options.peephole = &peephole_stats;
+    }
+    fasm_options.threads = threads;
 
+    start = stats_now();
     if (strcmp(backend, "fasm") == 0) {
-        output_fasm_linux_x86_64(&program, "output.fasm");
+        output_fasm_linux_x86_64(&program, &symbols, fasm_options, "output.fasm");
+    } else if (strcmp(backend, "elf") == 0) {
+        output_elf_linux_x86_64(&program, &symbols, fasm_options, "output");
     } else if (strcmp(backend, "qbe") == 0) {
-        output_qbe(&program, "output.qbe");
+        output_qbe(&program, &symbols, threads, "output.qbe");
     } else {
         assert(false);
     }
+    // the backends stream their output, the time spent writing it is counted separately
+    stats_add_phase(Phase_Codegen, start);
+    compiler_stats.phase_nanoseconds[Phase_Codegen] -= compiler_stats.phase_nanoseconds[Phase_Write];
+
+    if (print_peephole) {
+        peephole_print_stats(&peephole_stats);
+    }
+
+    if (print_arenas) {
+        arena_print_usage(&token_arena);
+        arena_print_usage(&ast_arena);
+        arena_print_usage(&process_arena);
+        interner_print_usage(&names);
+    }
+
+    if (print_stats) {
+        compiler_stats.total_nanoseconds = stats_now() - compile_start;
+        stats_print(stats_json);
+    }
+
+    if (use_ir || dump_ir) {
+        ir_free(&ir);
+    }
+
+    symbol_table_free(&symbols);
+    arena_free(&token_arena);
+    arena_free(&ast_arena);
+    arena_free(&process_arena);
+    interner_free(&names);
 }
@@ -0,0 +1,92 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ast_serialize.h"
+#include "file_util.h"
+#include "module_cache.h"
+
+#define MODULE_CACHE_MAGIC "BAST"
+
+Module_Cache module_cache_new(char* directory) {
+    if (mkdir(directory, 0755) < 0 && errno != EEXIST) {
+        printf("Unable to create cache directory %s\n", directory);
+        exit(1);
+    }
+
+    return (Module_Cache) { .directory = directory };
+}
+
+char* module_cache_path(Module_Cache* cache, size_t hash, char* suffix) {
+    size_t length = strlen(cache->directory) + strlen(suffix) + 32;
+    char* path = malloc(length);
+    // the format version is part of the name, so compilers writing different formats keep separate entries
+    snprintf(path, length, "%s/%016zx.v%d.ast%s", cache->directory, hash, AST_SERIALIZE_VERSION, suffix);
+    return path;
+}
+
+bool module_cache_load(Module_Cache* cache, char* file, char* contents, size_t length, Arena* arena, Interner* names, Ast_File* result) {
+    size_t hash = string_hash_length(contents, length);
+    char* path = module_cache_path(cache, hash, "");
+
+    size_t entry_length;
+    char* entry = map_file(path, &entry_length);
+    free(path);
+    if (entry == NULL) {
+        return false;
+    }
+
+    Deserialize_State state = {
+        .data = entry,
+        .length = entry_length,
+        .file = file,
+        .arena = arena,
+        .names = names,
+    };
+
+    size_t magic_length = strlen(MODULE_CACHE_MAGIC);
+    bool matches = entry_length >= magic_length && memcmp(entry, MODULE_CACHE_MAGIC, magic_length) == 0;
+    if (matches) {
+        state.index = magic_length;
+        // the version check guards against a renamed entry, the hash and length against hash collisions
+        matches = deserialize_size(&state) == AST_SERIALIZE_VERSION && deserialize_size(&state) == hash && deserialize_size(&state) == length && !state.failed;
+    }
+
+    bool loaded = matches && deserialize_file(&state, result);
+    unmap_file(entry, entry_length);
+    return loaded;
+}
+
+void module_cache_store(Module_Cache* cache, char* contents, size_t length, Ast_File* file) {
+    size_t hash = string_hash_length(contents, length);
+
+    String_Buffer buffer = stringbuffer_new(4096);
+    stringbuffer_appendstring(&buffer, MODULE_CACHE_MAGIC);
+    serialize_size(&buffer, AST_SERIALIZE_VERSION);
+    serialize_size(&buffer, hash);
+    serialize_size(&buffer, length);
+    serialize_file(file, &buffer);
+
+    // written aside and renamed so a concurrent compile never sees half an entry
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%d.%lx.tmp", getpid(), (unsigned long) pthread_self());
+    char* temporary_path = module_cache_path(cache, hash, suffix);
+    char* path = module_cache_path(cache, hash, "");
+
+    FILE* output = fopen(temporary_path, "wb");
+    if (output != NULL) {
+        bool written = fwrite(buffer.elements, 1, buffer.count, output) == buffer.count;
+        if (fclose(output) == 0 && written) {
+            rename(temporary_path, path);
+        } else {
+            remove(temporary_path);
+        }
+    }
+
+    free(temporary_path);
+    free(path);
+    free(buffer.elements);
+}
@@ -0,0 +1,19 @@
+#ifndef MODULE_CACHE__
+#define MODULE_CACHE__
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "interner.h"
+
+// parsed files keyed by a hash of their contents and the version of the serialized format
+typedef struct {
+    char* directory;
+} Module_Cache;
+
+Module_Cache module_cache_new(char* directory);
+bool module_cache_load(Module_Cache* cache, char* file, char* contents, size_t length, Arena* arena, Interner* names, Ast_File* result);
+void module_cache_store(Module_Cache* cache, char* contents, size_t length, Ast_File* file);
+
+#endif
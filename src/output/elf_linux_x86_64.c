@@ -0,0 +1,157 @@
+#include <assert.h>
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "elf_linux_x86_64.h"
+
+#define ELF_BASE_ADDRESS 0x400000
+#define ELF_PAGE_SIZE 0x1000
+
+typedef struct {
+    char* name;
+    size_t hash;
+    size_t address;
+} Elf_Label;
+
+// open addressing table of label addresses, keyed by label name
+typedef struct {
+    Elf_Label* labels;
+    size_t capacity;
+} Elf_Label_Table;
+
+static Elf_Label* elf_label_find_slot(Elf_Label_Table* table, char* name, size_t hash) {
+    size_t mask = table->capacity - 1;
+    size_t index = hash & mask;
+    while (table->labels[index].name != NULL) {
+        Elf_Label* label = &table->labels[index];
+        if (label->hash == hash && strcmp(label->name, name) == 0) {
+            return label;
+        }
+        index = (index + 1) & mask;
+    }
+    return &table->labels[index];
+}
+
+size_t align_page(size_t value) {
+    return (value + ELF_PAGE_SIZE - 1) & ~(size_t) (ELF_PAGE_SIZE - 1);
+}
+
+void elf_write_executable(X86_64_Image* image, char* output_file) {
+    size_t headers_size = sizeof(Elf64_Ehdr) + sizeof(Elf64_Phdr) * Section_Count;
+
+    // every section gets its own page aligned segment, the bss takes no space in the file
+    size_t file_offsets[Section_Count];
+    size_t addresses[Section_Count];
+    file_offsets[Section_Text] = headers_size;
+    file_offsets[Section_Data] = align_page(headers_size + image->text.count);
+    file_offsets[Section_Bss] = align_page(file_offsets[Section_Data] + image->data.count);
+    for (size_t i = 0; i < Section_Count; i++) {
+        addresses[i] = ELF_BASE_ADDRESS + file_offsets[i];
+    }
+
+    // keep the load factor at or below one half
+    size_t capacity = 16;
+    while (capacity < image->labels.count * 2) {
+        capacity *= 2;
+    }
+
+    Elf_Label_Table table = {
+        .labels = calloc(capacity, sizeof(Elf_Label)),
+        .capacity = capacity,
+    };
+
+    for (size_t i = 0; i < image->labels.count; i++) {
+        X86_64_Label* label = &image->labels.elements[i];
+        size_t hash = string_hash(label->name);
+
+        Elf_Label* slot = elf_label_find_slot(&table, label->name, hash);
+        if (slot->name != NULL) {
+            printf("Error: Label '%s' is defined more than once\n", label->name);
+            exit(1);
+        }
+        *slot = (Elf_Label) { label->name, hash, addresses[label->section] + label->offset };
+    }
+
+    for (size_t i = 0; i < image->fixups.count; i++) {
+        X86_64_Fixup* fixup = &image->fixups.elements[i];
+        Elf_Label* label = elf_label_find_slot(&table, fixup->label, string_hash(fixup->label));
+        if (label->name == NULL) {
+            printf("Error: Label '%s' is not defined\n", fixup->label);
+            exit(1);
+        }
+
+        long value = (long) label->address + fixup->addend;
+        if (fixup->relative) {
+            value -= (long) (addresses[Section_Text] + fixup->end);
+        }
+        assert(value >= -2147483648l && value <= 2147483647l);
+
+        for (size_t j = 0; j < 4; j++) {
+            image->text.elements[fixup->offset + j] = (char) (value >> (j * 8));
+        }
+    }
+    free(table.labels);
+
+    Elf64_Ehdr header = {
+        .e_ident = { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64, ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV },
+        .e_type = ET_EXEC,
+        .e_machine = EM_X86_64,
+        .e_version = EV_CURRENT,
+        .e_entry = addresses[Section_Text],
+        .e_phoff = sizeof(Elf64_Ehdr),
+        .e_ehsize = sizeof(Elf64_Ehdr),
+        .e_phentsize = sizeof(Elf64_Phdr),
+        .e_phnum = Section_Count,
+    };
+
+    // the first segment also maps the headers, so the text starts right after them
+    Elf64_Phdr segments[Section_Count] = {
+        [Section_Text] = {
+            .p_type = PT_LOAD,
+            .p_flags = PF_R | PF_X,
+            .p_offset = 0,
+            .p_vaddr = ELF_BASE_ADDRESS,
+            .p_paddr = ELF_BASE_ADDRESS,
+            .p_filesz = headers_size + image->text.count,
+            .p_memsz = headers_size + image->text.count,
+            .p_align = ELF_PAGE_SIZE,
+        },
+        [Section_Data] = {
+            .p_type = PT_LOAD,
+            .p_flags = PF_R,
+            .p_offset = file_offsets[Section_Data],
+            .p_vaddr = addresses[Section_Data],
+            .p_paddr = addresses[Section_Data],
+            .p_filesz = image->data.count,
+            .p_memsz = image->data.count,
+            .p_align = ELF_PAGE_SIZE,
+        },
+        [Section_Bss] = {
+            .p_type = PT_LOAD,
+            .p_flags = PF_R | PF_W,
+            .p_offset = file_offsets[Section_Bss],
+            .p_vaddr = addresses[Section_Bss],
+            .p_paddr = addresses[Section_Bss],
+            .p_filesz = 0,
+            .p_memsz = image->bss_size,
+            .p_align = ELF_PAGE_SIZE,
+        },
+    };
+
+    FILE* file = fopen(output_file, "wb");
+    if (file == NULL) {
+        printf("Error: Cannot open '%s' for writing\n", output_file);
+        exit(1);
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(segments, sizeof(segments), 1, file);
+    fwrite(image->text.elements, 1, image->text.count, file);
+    fseek(file, file_offsets[Section_Data], SEEK_SET);
+    fwrite(image->data.elements, 1, image->data.count, file);
+    fclose(file);
+
+    chmod(output_file, 0755);
+}
@@ -0,0 +1,9 @@
+#ifndef ELF_LINUX_X86_64__
+#define ELF_LINUX_X86_64__
+
+#include "x86_64_encoder.h"
+
+// lays the image out as a static executable starting at the beginning of the text, resolves its fixups and writes it
+void elf_write_executable(X86_64_Image* image, char* output_file);
+
+#endif
@@ -1,79 +1,351 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include "fasm_linux_x86_64.h"
-#include "util.h"
+#include "elf_linux_x86_64.h"
+#include "peephole.h"
+#include "register_allocation.h"
+#include "writer.h"
 #include "x86_64_util.h"
 #include "../ast_walk.h"
+#include "../stats.h"
+#include "../thread_pool.h"
+
+typedef enum {
+    Register_Constant,
+    Register_Load,
+    Register_Leaf,
+    Register_Binary,
+    Register_Compare,
+    Register_Not,
+} Register_Instruction_Kind;
+
+// every instruction defines the virtual register with its own index
+typedef struct {
+    Register_Instruction_Kind kind;
+    size_t size;
+    union {
+        size_t constant;
+        long load_offset;
+        Ast_Expression* leaf;
+        struct {
+            Operator operator_;
+            size_t left;
+            size_t right;
+            bool right_immediate;
+        } operator_;
+    } data;
+} Register_Instruction;
+
+Dynamic_Array_Def(Register_Instruction, Array_Register_Instruction, array_register_instruction_)
+Dynamic_Array_Impl(Register_Instruction, Array_Register_Instruction, array_register_instruction_)
 
 typedef struct {
     Generic_State generic;
-    String_Buffer instructions;
-    String_Buffer data;
-    String_Buffer bss;
+    Fasm_Options options;
+    bool in_register_expression;
+    Array_Register_Instruction register_instructions;
+    Frame_Layout frame;
+    bool register_call;
+    // instructions of the procedure being output, printed or encoded once it is finished
+    Array_X86_64_Instruction code;
+    // names of the private labels in code
+    Arena code_arena;
+    Writer label_name;
+    Writer instructions;
+    Writer data;
+    Writer bss;
     size_t string_index;
     size_t flow_index;
     Array_Size while_index;
+    // bytes between rbp and rsp where code is being emitted, calls are padded with it so rsp is 16 byte aligned at them
+    size_t stack_depth;
+    // false after a jmp or ret, until the next flow label
+    bool stack_depth_known;
+    // stack depth at every flow label, taken from the first jump to it
+    Array_Size label_depths;
+    size_t ir_index;
+    // set by the elf backend, finished procedures are encoded into it instead of being printed
+    X86_64_Image* image;
 } Output_State;
 
 void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_State* state);
 
-void output_copy_fasm_linux_x86_64(Output_State* state, char* input_register, bool input_inverted, int input_offset, char* output_register, bool output_inverted, int output_offset, size_t size, char* intermediate_register_8, char* intermediate_register_1) {
+#define STACK_DEPTH_UNSET ((size_t) -1)
+
+void track_stack_depth_fasm_linux_x86_64(X86_64_Instruction* instruction, Output_State* state) {
+    X86_64_Operand* first = &instruction->operands[0];
+    bool on_rsp = instruction->operand_count > 0 && x86_64_is_general_register(first, 8) && first->data.register_.number == REGISTER_RSP;
+
+    switch (instruction->opcode) {
+        case Opcode_Push:
+            state->stack_depth += 8;
+            break;
+        case Opcode_Pop:
+            state->stack_depth -= 8;
+            break;
+        case Opcode_Sub:
+            if (on_rsp) {
+                assert(instruction->operands[1].kind == Operand_Immediate);
+                state->stack_depth += instruction->operands[1].data.immediate;
+            }
+            break;
+        case Opcode_Add:
+            if (on_rsp) {
+                assert(instruction->operands[1].kind == Operand_Immediate);
+                state->stack_depth -= instruction->operands[1].data.immediate;
+            }
+            break;
+        case Opcode_Mov:
+            // rsp is only ever reset to rbp
+            if (on_rsp) {
+                state->stack_depth = 0;
+            }
+            break;
+        case Opcode_Jmp:
+        case Opcode_Ret:
+            state->stack_depth_known = false;
+            break;
+        default:
+            break;
+    }
+}
+
+void emit_instruction(Output_State* state, X86_64_Instruction instruction) {
+    array_x86_64_instruction_append(&state->code, instruction);
+    track_stack_depth_fasm_linux_x86_64(&instruction, state);
+}
+
+void emit0(Output_State* state, X86_64_Opcode opcode) {
+    emit_instruction(state, x86_64_operation(opcode, 0, (X86_64_Operand) {}, (X86_64_Operand) {}));
+}
+
+void emit1(Output_State* state, X86_64_Opcode opcode, X86_64_Operand operand) {
+    emit_instruction(state, x86_64_operation(opcode, 1, operand, (X86_64_Operand) {}));
+}
+
+void emit2(Output_State* state, X86_64_Opcode opcode, X86_64_Operand first, X86_64_Operand second) {
+    emit_instruction(state, x86_64_operation(opcode, 2, first, second));
+}
+
+// .fN for flow labels and .sN for strings, numbered per procedure until they are put together
+char* local_label_fasm_linux_x86_64(char kind, size_t index, Output_State* state) {
+    state->label_name.count = 0;
+    writer_format(&state->label_name, ".%c%zu", kind, index);
+    return arena_copy_string_length(&state->code_arena, state->label_name.elements, state->label_name.count);
+}
+
+bool has_label_depth(Output_State* state, size_t index) {
+    return index < state->label_depths.count && state->label_depths.elements[index] != STACK_DEPTH_UNSET;
+}
+
+void emit_flow_label(Output_State* state, size_t index) {
+    array_x86_64_instruction_append(&state->code, x86_64_label_instruction(local_label_fasm_linux_x86_64('f', index, state)));
+
+    // labels nothing jumps to yet are reached by falling through
+    if (has_label_depth(state, index)) {
+        state->stack_depth = state->label_depths.elements[index];
+    }
+    state->stack_depth_known = true;
+}
+
+void emit_jump(Output_State* state, X86_64_Opcode opcode, size_t index) {
+    if (state->stack_depth_known && !has_label_depth(state, index)) {
+        while (state->label_depths.count <= index) {
+            array_size_append(&state->label_depths, STACK_DEPTH_UNSET);
+        }
+        state->label_depths.elements[index] = state->stack_depth;
+    }
+
+    emit1(state, opcode, x86_64_label(local_label_fasm_linux_x86_64('f', index, state)));
+}
+
+X86_64_Operand stack_top(long displacement) {
+    return x86_64_memory(REGISTER_RSP, displacement, 0);
+}
+
+void emit_stack_adjust(Output_State* state, X86_64_Opcode opcode, size_t amount) {
+    emit2(state, opcode, x86_64_register(REGISTER_RSP, 8), x86_64_immediate(amount));
+}
+
+// bytes to reserve so rsp is 16 byte aligned once pushed more bytes are on the stack, which keeps the rbp of callees aligned
+size_t get_call_padding(size_t pushed, Output_State* state) {
+    return (16 - (state->stack_depth + pushed) % 16) % 16;
+}
+
+// calls whatever is already on the stack or in the registers, keeping rsp aligned around it
+void emit_aligned_call(Output_State* state, X86_64_Operand callee) {
+    size_t padding = get_call_padding(0, state);
+    if (padding > 0) {
+        emit_stack_adjust(state, Opcode_Sub, padding);
+    }
+    emit1(state, Opcode_Call, callee);
+    if (padding > 0) {
+        emit_stack_adjust(state, Opcode_Add, padding);
+    }
+}
+
+// copies size bytes between two memory operands, intermediate is the register the bytes go through
+void output_copy_fasm_linux_x86_64(Output_State* state, X86_64_Operand input, X86_64_Operand output, size_t size, size_t intermediate) {
     size_t i = 0;
     while (i < size) {
-        if (size - i >= 8) {
-            i += 8;
+        size_t chunk = size - i >= 8 ? 8 : 1;
+        i += chunk;
+
+        X86_64_Operand from = input;
+        from.data.memory.displacement += size - i;
+        X86_64_Operand to = output;
+        to.data.memory.displacement += size - i;
+
+        emit2(state, Opcode_Mov, x86_64_register(intermediate, chunk), from);
+        emit2(state, Opcode_Mov, to, x86_64_register(intermediate, chunk));
+    }
+}
+
+// in the order arguments are assigned to them
+size_t argument_registers[] = { REGISTER_RDI, REGISTER_RSI, REGISTER_RDX, REGISTER_RCX, REGISTER_R8, REGISTER_R9 };
 
-            char buffer[128] = {};
-            sprintf(buffer, "  mov %s, [%s%s%zu]\n", intermediate_register_8, input_register, input_inverted ? "-" : "+", input_offset + (size - i) * (input_inverted ? -1 : 1));
-            stringbuffer_appendstring(&state->instructions, buffer);
+#define ARGUMENT_REGISTER_COUNT (sizeof(argument_registers) / sizeof(argument_registers[0]))
 
-            memset(buffer, 0, 128);
+// registers always hold values zero extended to 64 bits, so every operation can work on the full register
+void output_register_load_fasm_linux_x86_64(size_t destination, size_t base, long offset, size_t size, Output_State* state) {
+    switch (size) {
+        case 8:
+            emit2(state, Opcode_Mov, x86_64_register(destination, 8), x86_64_memory(base, offset, 0));
+            break;
+        case 4:
+            emit2(state, Opcode_Mov, x86_64_register(destination, 4), x86_64_memory(base, offset, 4));
+            break;
+        case 2:
+            emit2(state, Opcode_Movzx, x86_64_register(destination, 4), x86_64_memory(base, offset, 2));
+            break;
+        case 1:
+            emit2(state, Opcode_Movzx, x86_64_register(destination, 4), x86_64_memory(base, offset, 1));
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void output_register_push_fasm_linux_x86_64(size_t number, size_t size, Output_State* state) {
+    if (size == 8) {
+        emit1(state, Opcode_Push, x86_64_register(number, 8));
+    } else {
+        emit_stack_adjust(state, Opcode_Sub, size);
+        emit2(state, Opcode_Mov, stack_top(0), x86_64_register(number, size));
+    }
+}
+
+bool fits_register(size_t size) {
+    return size == 1 || size == 2 || size == 4 || size == 8;
+}
+
+// first register of every argument, 16 byte aggregates take two in a row
+bool assign_argument_registers(Ast_Item_Procedure* procedure, size_t* registers, Output_State* state) {
+    size_t next = 0;
+    for (size_t i = 0; i < procedure->arguments.count; i++) {
+        size_t size = get_size(&procedure->arguments.elements[i].type, &state->generic);
+        size_t needed = size == 16 ? 2 : 1;
+        if ((!fits_register(size) && size != 16) || next + needed > ARGUMENT_REGISTER_COUNT) {
+            return false;
+        }
+
+        registers[i] = next;
+        next += needed;
+    }
+    return true;
+}
+
+// procedures that are only ever called directly take their arguments in registers and return in rax
+bool uses_register_call(Ast_Item_Procedure* procedure, Output_State* state) {
+    if (!state->options.register_calls || procedure->computed_address_taken) {
+        return false;
+    }
+
+    size_t registers[ARGUMENT_REGISTER_COUNT];
+    if (procedure->arguments.count > ARGUMENT_REGISTER_COUNT || !assign_argument_registers(procedure, registers, state)) {
+        return false;
+    }
+
+    return procedure->returns.count == 0 || (procedure->returns.count == 1 && fits_register(get_size(procedure->returns.elements[0], &state->generic)));
+}
+
+void output_argument_load_fasm_linux_x86_64(size_t register_index, size_t base, long offset, size_t size, Output_State* state) {
+    for (size_t i = 0; i < size; i += 8) {
+        output_register_load_fasm_linux_x86_64(argument_registers[register_index + i / 8], base, offset + (long) i, size < 8 ? size : 8, state);
+    }
+}
+
+// rbp relative address of an argument, register passed ones are stored below the locals on entry
+long get_argument_offset_fasm_linux_x86_64(char* name, size_t* size, Output_State* state) {
+    Location_Size_Data location_size = get_argument_location_size(name, &state->generic);
+    *size = location_size.size;
 
-            sprintf(buffer, "  mov [%s%s%zu], %s\n", output_register, output_inverted ? "-" : "+", output_offset + (size - i) * (output_inverted ? -1 : 1), intermediate_register_8);
-            stringbuffer_appendstring(&state->instructions, buffer);
-        } else if (size - i >= 1) {
-            i += 1;
+    if (state->register_call) {
+        return (long) (location_size.location - 8) - (long) (state->frame.size + get_arguments_size(&state->generic));
+    }
+    return location_size.location + 8;
+}
 
-            char buffer[128] = {};
-            sprintf(buffer, "  mov %s, [%s%s%zu]\n", intermediate_register_1, input_register, input_inverted ? "-" : "+", input_offset + (size - i) * (input_inverted ? -1 : 1));
-            stringbuffer_appendstring(&state->instructions, buffer);
+// stores the arguments of a register call below the locals, so they can be addressed like any other
+void output_home_arguments_fasm_linux_x86_64(Ast_Item_Procedure* procedure, Output_State* state) {
+    size_t registers[ARGUMENT_REGISTER_COUNT];
+    assign_argument_registers(procedure, registers, state);
 
-            memset(buffer, 0, 128);
+    for (size_t i = 0; i < procedure->arguments.count; i++) {
+        size_t size;
+        long offset = get_argument_offset_fasm_linux_x86_64(procedure->arguments.elements[i].name, &size, state);
 
-            sprintf(buffer, "  mov [%s%s%zu], %s\n", output_register, output_inverted ? "-" : "+", output_offset + (size - i) * (output_inverted ? -1 : 1), intermediate_register_1);
-            stringbuffer_appendstring(&state->instructions, buffer);
+        for (size_t j = 0; j < size; j += 8) {
+            X86_64_Operand argument = x86_64_register(argument_registers[registers[i] + j / 8], size < 8 ? size : 8);
+            emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RBP, offset + (long) j, 0), argument);
         }
     }
 }
 
 void output_actual_return_fasm_linux_x86_64(Output_State* state) {
+    if (state->register_call) {
+        size_t returns_size = get_returns_size(&state->generic);
+        if (returns_size > 0) {
+            output_register_load_fasm_linux_x86_64(REGISTER_RAX, REGISTER_RSP, 0, returns_size, state);
+        }
+
+        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RSP, 8), x86_64_register(REGISTER_RBP, 8));
+        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RBP, 8));
+        emit0(state, Opcode_Ret);
+        return;
+    }
+
     size_t arguments_size = get_arguments_size(&state->generic);
     size_t returns_size = get_returns_size(&state->generic);
-    size_t locals_size = get_locals_size(state->generic.current_procedure, &state->generic);
+    size_t locals_size = state->frame.size;
 
     // rdx = old rip
-    char buffer[128] = {};
-    sprintf(buffer, "  mov rcx, [rsp+%zu]\n", returns_size + locals_size);
-    stringbuffer_appendstring(&state->instructions, buffer);
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RCX, 8), stack_top(returns_size + locals_size));
 
     // rdx = old rbp
-    memset(buffer, 0, 128);
-    sprintf(buffer, "  mov rdx, [rsp+%zu]\n", returns_size + locals_size + 8);
-    stringbuffer_appendstring(&state->instructions, buffer);
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RDX, 8), stack_top(returns_size + locals_size + 8));
+
+    output_copy_fasm_linux_x86_64(state, stack_top(0), stack_top(16 + arguments_size + locals_size), returns_size, REGISTER_RAX);
 
-    output_copy_fasm_linux_x86_64(state, "rsp", false, 0, "rsp", false, 16 + arguments_size + locals_size, returns_size, "rax", "al");
+    emit_stack_adjust(state, Opcode_Add, 16 + arguments_size + locals_size);
 
-    memset(buffer, 0, 128);
-    sprintf(buffer, "  add rsp, %zu\n", 16 + arguments_size + locals_size);
-    stringbuffer_appendstring(&state->instructions, buffer);
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RBP, 8), x86_64_register(REGISTER_RCX, 8));
+    emit1(state, Opcode_Push, x86_64_register(REGISTER_RDX, 8));
+    emit0(state, Opcode_Ret);
+}
 
-    stringbuffer_appendstring(&state->instructions, "  mov rbp, rcx\n");
-    stringbuffer_appendstring(&state->instructions, "  push rdx\n");
-    stringbuffer_appendstring(&state->instructions, "  ret\n");
+// pops a bool and compares it with true
+void output_condition_fasm_linux_x86_64(Output_State* state) {
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RBX, 8), x86_64_immediate(1));
+    emit2(state, Opcode_Xor, x86_64_register(REGISTER_RAX, 8), x86_64_register(REGISTER_RAX, 8));
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 1), stack_top(0));
+    emit_stack_adjust(state, Opcode_Add, 1);
+    emit2(state, Opcode_Cmp, x86_64_register(REGISTER_RAX, 8), x86_64_register(REGISTER_RBX, 8));
 }
 
 void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State* state) {
@@ -96,25 +368,17 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
                 output_expression_fasm_linux_x86_64(declare->expression, state);
 
                 for (int i = declare->declarations.count - 1; i >= 0; i--) {
-                    Ast_Declaration declaration = declare->declarations.elements[i];
-                    size_t location = 8;
-                    for (size_t j = 0; j < state->generic.current_declares.count; j++) {
-                        location += get_size(&state->generic.current_declares.elements[j].type, &state->generic);
-                    }
-                    size_t size = get_size(&declaration.type, &state->generic);
+                    Ast_Declaration* declaration = &declare->declarations.elements[i];
+                    size_t location = frame_layout_declare(&state->frame, declaration, &state->generic);
+                    size_t size = get_size(&declaration->type, &state->generic);
 
-                    output_copy_fasm_linux_x86_64(state, "rsp", false, 0, "rbp", true, location + size, size, "rax", "al");
+                    output_copy_fasm_linux_x86_64(state, stack_top(0), x86_64_memory(REGISTER_RBP, -(long) (location + size), 0), size, REGISTER_RAX);
 
-                    char buffer[128] = {};
-                    sprintf(buffer, "  add rsp, %zu\n", size);
-                    stringbuffer_appendstring(&state->instructions, buffer);
-
-                    array_ast_declaration_append(&state->generic.current_declares, declaration);
+                    emit_stack_adjust(state, Opcode_Add, size);
                 }
             } else {
                 for (int i = declare->declarations.count - 1; i >= 0; i--) {
-                    Ast_Declaration declaration = declare->declarations.elements[i];
-                    array_ast_declaration_append(&state->generic.current_declares, declaration);
+                    frame_layout_declare(&state->frame, &declare->declarations.elements[i], &state->generic);
                 }
             }
             break;
@@ -145,20 +409,16 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
 
                     size_t size = get_size(array_ast_type_raw->data.array.element_type, &state->generic);
 
-                    stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                    stringbuffer_appendstring(&state->instructions, "  pop rcx\n");
+                    emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
+                    emit1(state, Opcode_Pop, x86_64_register(REGISTER_RCX, 8));
 
-                    char buffer[128] = {};
-                    sprintf(buffer, "  mov rdx, %zu\n", size);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RDX, 8), x86_64_immediate(size));
 
-                    stringbuffer_appendstring(&state->instructions, "  mul rdx\n");
+                    emit1(state, Opcode_Mul, x86_64_register(REGISTER_RDX, 8));
                         
-                    output_copy_fasm_linux_x86_64(state, "rsp", false, 0, "rax+rcx", false, 0, size, "rbx", "bl");
+                    output_copy_fasm_linux_x86_64(state, stack_top(0), x86_64_memory_index(REGISTER_RAX, REGISTER_RCX), size, REGISTER_RBX);
 
-                    memset(buffer, 0, 128);
-                    sprintf(buffer, "  add rsp, %zu\n", size);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    emit_stack_adjust(state, Opcode_Add, size);
                 }
 
                 if (!found && assign_part->kind == Retrieve_Assign_Parent) {
@@ -172,14 +432,12 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
 
                     output_expression_fasm_linux_x86_64(assign_part->data.parent.expression, state);
 
-                    stringbuffer_appendstring(&state->instructions, "  pop rax\n");
+                    emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
 
                     Location_Size_Data location_size = get_parent_item_location_size(&parent_type, assign_part->data.parent.name, &state->generic);
-                    output_copy_fasm_linux_x86_64(state, "rsp", false, 0, "rax", false, location_size.location, location_size.size, "rbx", "bl");
+                    output_copy_fasm_linux_x86_64(state, stack_top(0), x86_64_memory(REGISTER_RAX, location_size.location, 0), location_size.size, REGISTER_RBX);
 
-                    char buffer[128] = {};
-                    sprintf(buffer, "  add rsp, %zu\n", location_size.size);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    emit_stack_adjust(state, Opcode_Add, location_size.size);
                 }
 
                 if (!found && assign_part->kind == Retrieve_Assign_Identifier) {
@@ -188,12 +446,10 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
                     if (has_local_variable(name, &state->generic)) {
                         found = true;
 
-                        Location_Size_Data location_size = get_local_variable_location_size(name, &state->generic);
-                        output_copy_fasm_linux_x86_64(state, "rsp", false, 0, "rbp", true, location_size.location + location_size.size, location_size.size, "rax", "al");
+                        Location_Size_Data location_size = get_local_variable_location_size(name, &state->frame, &state->generic);
+                        output_copy_fasm_linux_x86_64(state, stack_top(0), x86_64_memory(REGISTER_RBP, -(long) (location_size.location + location_size.size), 0), location_size.size, REGISTER_RAX);
 
-                        char buffer[128] = {};
-                        sprintf(buffer, "  add rsp, %zu\n", location_size.size);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        emit_stack_adjust(state, Opcode_Add, location_size.size);
                     }
                 }
 
@@ -207,11 +463,9 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
                                     Ast_Item_Global* global = &item->data.global;
                                     size_t size = get_size(&global->type, &state->generic);
 
-                                    output_copy_fasm_linux_x86_64(state, "rsp", false, 0, global->name, false, 0, size, "rax", "al");
+                                    output_copy_fasm_linux_x86_64(state, stack_top(0), x86_64_memory_label(global->name), size, REGISTER_RAX);
 
-                                    char buffer[128] = {};
-                                    sprintf(buffer, "  add rsp, %zu\n", size);
-                                    stringbuffer_appendstring(&state->instructions, buffer);
+                                    emit_stack_adjust(state, Opcode_Add, size);
 
                                     found = true;
                                     break;
@@ -248,21 +502,13 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
             state->flow_index++;
 
             Ast_Statement_While* node = &statement->data.while_;
-            char buffer[128] = {};
-            sprintf(buffer, "  __%zu:\n", start);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_flow_label(state, start);
 
             output_expression_fasm_linux_x86_64(node->condition, state);
 
-            stringbuffer_appendstring(&state->instructions, "  mov rbx, 1\n");
-            stringbuffer_appendstring(&state->instructions, "  xor rax, rax\n");
-            stringbuffer_appendstring(&state->instructions, "  mov al, [rsp]\n");
-            stringbuffer_appendstring(&state->instructions, "  add rsp, 1\n");
-            stringbuffer_appendstring(&state->instructions, "  cmp rax, rbx\n");
+            output_condition_fasm_linux_x86_64(state);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  jne __%zu\n", end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_jump(state, Opcode_Jne, end);
 
             array_size_append(&state->while_index, end);
 
@@ -270,19 +516,13 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
 
             state->while_index.count--;
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  jmp __%zu\n", start);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_jump(state, Opcode_Jmp, start);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  __%zu:\n", end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_flow_label(state, end);
             break;
         }
         case Statement_Break: {
-            char buffer[128] = {};
-            sprintf(buffer, "  jmp __%zu\n", state->while_index.elements[state->while_index.count - 1]);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_jump(state, Opcode_Jmp, state->while_index.elements[state->while_index.count - 1]);
             break;
         }
         default:
@@ -292,80 +532,69 @@ void output_statement_fasm_linux_x86_64(Ast_Statement* statement, Output_State*
 
 void output_raw_value_fasm_linux_x86_64(Ast_Type_Internal type, size_t value, Output_State* state) {
     if (type == Type_UInt64 || type == Type_UInt) {
-        stringbuffer_appendstring(&state->instructions, "  sub rsp, 8\n");
-        char buffer[128] = {};
-        sprintf(buffer, "  mov rax, %zu\n", value);
-        stringbuffer_appendstring(&state->instructions, buffer);
-        stringbuffer_appendstring(&state->instructions, "  mov [rsp], rax\n");
+        emit_stack_adjust(state, Opcode_Sub, 8);
+        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 8), x86_64_immediate(value));
+        emit2(state, Opcode_Mov, stack_top(0), x86_64_register(REGISTER_RAX, 8));
     } else if (type == Type_UInt32) {
-        stringbuffer_appendstring(&state->instructions, "  sub rsp, 4\n");
-        char buffer[128] = {};
-        sprintf(buffer, "  mov dword [rsp], %zu\n", value);
-        stringbuffer_appendstring(&state->instructions, buffer);
+        emit_stack_adjust(state, Opcode_Sub, 4);
+        emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RSP, 0, 4), x86_64_immediate(value));
     } else if (type == Type_UInt16) {
-        stringbuffer_appendstring(&state->instructions, "  sub rsp, 2\n");
-        char buffer[128] = {};
-        sprintf(buffer, "  mov word [rsp], %zu\n", value);
-        stringbuffer_appendstring(&state->instructions, buffer);
+        emit_stack_adjust(state, Opcode_Sub, 2);
+        emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RSP, 0, 2), x86_64_immediate(value));
     } else if (type == Type_UInt8 || type == Type_Byte) {
-        stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-        char buffer[128] = {};
-        sprintf(buffer, "  mov byte [rsp], %zu\n", value);
-        stringbuffer_appendstring(&state->instructions, buffer);
+        emit_stack_adjust(state, Opcode_Sub, 1);
+        emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RSP, 0, 1), x86_64_immediate(value));
     } else {
         assert(false);
     }
 }
 
 void output_string_fasm_linux_x86_64(char* value, Output_State* state) {
-    char buffer[128] = {};
-    sprintf(buffer, "  push _%zu\n", state->string_index);
-    stringbuffer_appendstring(&state->instructions, buffer);
+    char* label = local_label_fasm_linux_x86_64('s', state->string_index, state);
+    emit1(state, Opcode_Push, x86_64_label(label));
+
+    if (state->image != NULL) {
+        x86_64_image_add_label(state->image, label, Section_Data, state->image->data.count);
 
-    memset(buffer, 0, 128);
-    sprintf(buffer, "  _%zu: db ", state->string_index);
-    stringbuffer_appendstring(&state->data, buffer);
+        size_t length = strlen(value);
+        for (size_t i = 0; i <= length; i++) {
+            stringbuffer_append(&state->image->data, value[i]);
+        }
+
+        state->string_index++;
+        return;
+    }
+
+    writer_format(&state->data, "  .s%zu: db ", state->string_index);
 
     size_t str_len = strlen(value);
     for (size_t i = 0; i < str_len; i++) {
-        char buffer[128] = {};
-        sprintf(buffer, "%i, ", (int) value[i]);
-        stringbuffer_appendstring(&state->data, buffer);
+        writer_format(&state->data, "%i, ", (int) value[i]);
     }
 
-    memset(buffer, 0, 128);
-    sprintf(buffer, "0\n");
-    stringbuffer_appendstring(&state->data, buffer);
+    writer_format(&state->data, "0\n");
 
     state->string_index++;
 }
 
 void output_boolean_fasm_linux_x86_64(bool value, Output_State* state) {
-    char buffer[128] = {};
-    sprintf(buffer, "  mov rax, %i\n", value);
-    stringbuffer_appendstring(&state->instructions, buffer);
-    stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-    stringbuffer_appendstring(&state->instructions, "  mov [rsp], al\n");
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 8), x86_64_immediate(value));
+    emit_stack_adjust(state, Opcode_Sub, 1);
+    emit2(state, Opcode_Mov, stack_top(0), x86_64_register(REGISTER_RAX, 1));
 }
 
 void output_zeroes_fasm_linux_x86_64(size_t count, Output_State* state) {
-    char buffer[128] = {};
-    sprintf(buffer, "  sub rsp, %zu\n", count);
-    stringbuffer_appendstring(&state->instructions, buffer);
+    emit_stack_adjust(state, Opcode_Sub, count);
 
-    stringbuffer_appendstring(&state->instructions, "  mov rax, 0\n");
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 8), x86_64_immediate(0));
 
     size_t i = 0;
     while (i < count) {
         if (i + 8 < count) {
-            char buffer[128] = {};
-            sprintf(buffer, "  mov [rsp+%zu], rax\n", i);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit2(state, Opcode_Mov, stack_top(i), x86_64_register(REGISTER_RAX, 8));
             i += 8;
         } else {
-            char buffer[128] = {};
-            sprintf(buffer, "  mov [rsp+%zu], al\n", i);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit2(state, Opcode_Mov, stack_top(i), x86_64_register(REGISTER_RAX, 1));
             i++;
         }
     }
@@ -377,9 +606,21 @@ void output_build_type_fasm_linux_x86_64(Ast_Expression_Build* build, Ast_Type*
         case Type_Struct: {
             Ast_Type_Struct* struct_ = &type.data.struct_;
             if (build->arguments.count == struct_->items.count) {
+                Type_Layout layout = get_layout(type_in, &state->generic);
+
+                // fields are pushed last to first, each preceded by the padding that follows it
+                size_t end = layout.size;
                 for (int i = build->arguments.count - 1; i >= 0; i--) {
+                    size_t padding = end - (layout.offsets[i] + layout.sizes[i]);
+                    if (padding > 0) {
+                        emit_stack_adjust(state, Opcode_Sub, padding);
+                    }
+
                     output_expression_fasm_linux_x86_64(build->arguments.elements[i], state);
+                    end = layout.offsets[i];
                 }
+
+                layout_free_unnamed(&layout, type_in, &state->generic);
             }
             break;
         }
@@ -399,13 +640,629 @@ void output_build_type_fasm_linux_x86_64(Ast_Expression_Build* build, Ast_Type*
     }
 }
 
+// only registers the stack machine never touches, so leaves can still be output through it
+size_t allocatable_registers[] = { REGISTER_RSI, REGISTER_RDI, REGISTER_R8, REGISTER_R9, REGISTER_R10, REGISTER_R11, REGISTER_R12, REGISTER_R13, REGISTER_R14, REGISTER_R15 };
+
+#define ALLOCATABLE_REGISTER_COUNT (sizeof(allocatable_registers) / sizeof(allocatable_registers[0]))
+
+// size of a value that fits a general purpose register, 0 for everything else
+size_t get_scalar_size(Ast_Type* type_in, Generic_State* state) {
+    if (type_in == NULL) {
+        return 0;
+    }
+
+    Ast_Type type = evaluate_type_complete(type_in, state);
+    switch (type.kind) {
+        case Type_Internal:
+            if (type.data.internal == Type_Float64) {
+                return 0;
+            }
+            return get_size(&type, state);
+        case Type_Pointer:
+        case Type_Enum:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+bool is_call_free(Ast_Expression* expression) {
+    switch (expression->kind) {
+        case Expression_Number:
+        case Expression_Boolean:
+        case Expression_Char:
+        case Expression_Null:
+        case Expression_String:
+        case Expression_SizeOf:
+        case Expression_LengthOf:
+            return true;
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            if (invoke->kind != Invoke_Operator) {
+                return false;
+            }
+            for (size_t i = 0; i < invoke->arguments.count; i++) {
+                if (!is_call_free(invoke->arguments.elements[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case Expression_Retrieve: {
+            Ast_Expression_Retrieve* retrieve = &expression->data.retrieve;
+            switch (retrieve->kind) {
+                case Retrieve_Assign_Identifier:
+                    return true;
+                case Retrieve_Assign_Parent:
+                    return is_call_free(retrieve->data.parent.expression);
+                case Retrieve_Assign_Array:
+                    return is_call_free(retrieve->data.array.expression_outer) && is_call_free(retrieve->data.array.expression_inner);
+                default:
+                    return false;
+            }
+        }
+        case Expression_Reference:
+            return is_call_free(expression->data.reference.inner);
+        case Expression_Cast:
+            return is_call_free(expression->data.cast.expression);
+        case Expression_RunMacro:
+            return expression->data.run_macro.result.kind == Macro_Expression && is_call_free(expression->data.run_macro.result.data.expression);
+        default:
+            return false;
+    }
+}
+
+// value of a literal truncated to size bytes, floats are left to the stack machine
+bool get_constant_value(Ast_Expression* expression, size_t size, size_t* value) {
+    switch (expression->kind) {
+        case Expression_Number: {
+            Ast_Expression_Number* number = &expression->data.number;
+            if (number->type == NULL || number->type->kind != Type_Internal || number->type->data.internal == Type_Float64 || number->kind != Number_Integer) {
+                return false;
+            }
+            *value = number->value.integer;
+            break;
+        }
+        case Expression_Boolean:
+            *value = expression->data.boolean.value;
+            break;
+        case Expression_Char:
+            *value = (unsigned char) expression->data.char_.value;
+            break;
+        case Expression_Null:
+            *value = 0;
+            break;
+        default:
+            return false;
+    }
+
+    if (size < 8) {
+        *value &= ((size_t) 1 << (size * 8)) - 1;
+    }
+    return true;
+}
+
+size_t append_register_instruction(Register_Instruction instruction, Output_State* state) {
+    array_register_instruction_append(&state->register_instructions, instruction);
+    return state->register_instructions.count - 1;
+}
+
+size_t get_operator_operand_size(Ast_Expression_Invoke* invoke, Generic_State* state) {
+    Ast_Type* operand_type = &invoke->data.operator_.computed_operand_type;
+    switch (invoke->data.operator_.operator_) {
+        case Operator_Add:
+        case Operator_Subtract:
+        case Operator_Multiply:
+        case Operator_Divide:
+        case Operator_Modulus: {
+            Ast_Type type = evaluate_type_complete(operand_type, state);
+            if (type.kind != Type_Internal || type.data.internal == Type_Bool) {
+                return 0;
+            }
+            return get_scalar_size(&type, state);
+        }
+        case Operator_Equal:
+        case Operator_NotEqual:
+        case Operator_Greater:
+        case Operator_GreaterEqual:
+        case Operator_Less:
+        case Operator_LessEqual: {
+            Ast_Type type = evaluate_type_complete(operand_type, state);
+            bool ordered = type.kind == Type_Internal && type.data.internal != Type_Ptr && type.data.internal != Type_Bool;
+            bool equality = invoke->data.operator_.operator_ == Operator_Equal || invoke->data.operator_.operator_ == Operator_NotEqual;
+            if (!ordered && !(equality && (is_internal_type(Type_Ptr, &type) || type.kind == Type_Pointer || type.kind == Type_Enum))) {
+                return 0;
+            }
+            return get_scalar_size(&type, state);
+        }
+        case Operator_And:
+        case Operator_Or:
+        case Operator_Not:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// returns the virtual register holding the value, or REGISTER_SPILLED when the tree has to stay on the stack
+// size is what the parent operator expects, retrieves do not carry their own type
+size_t lower_register_expression(Ast_Expression* expression, size_t size, Output_State* state) {
+    Register_Instruction instruction = { .size = size };
+    switch (expression->kind) {
+        case Expression_Number:
+        case Expression_Boolean:
+        case Expression_Char:
+        case Expression_Null:
+            if (!get_constant_value(expression, size, &instruction.data.constant)) {
+                return REGISTER_SPILLED;
+            }
+            instruction.kind = Register_Constant;
+            return append_register_instruction(instruction, state);
+        case Expression_RunMacro: {
+            Ast_RunMacro* run_macro = &expression->data.run_macro;
+            if (run_macro->result.kind != Macro_Expression) {
+                return REGISTER_SPILLED;
+            }
+            return lower_register_expression(run_macro->result.data.expression, size, state);
+        }
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            if (invoke->kind != Invoke_Operator) {
+                return REGISTER_SPILLED;
+            }
+
+            size_t operand_size = get_operator_operand_size(invoke, &state->generic);
+            if (operand_size == 0) {
+                return REGISTER_SPILLED;
+            }
+
+            size_t left = lower_register_expression(invoke->arguments.elements[0], operand_size, state);
+            if (left == REGISTER_SPILLED) {
+                return REGISTER_SPILLED;
+            }
+
+            Operator operator_ = invoke->data.operator_.operator_;
+            instruction.size = operand_size;
+            instruction.data.operator_.operator_ = operator_;
+            instruction.data.operator_.left = left;
+
+            if (operator_ == Operator_Not) {
+                instruction.kind = Register_Not;
+                return append_register_instruction(instruction, state);
+            }
+
+            size_t right = lower_register_expression(invoke->arguments.elements[1], operand_size, state);
+            if (right == REGISTER_SPILLED) {
+                return REGISTER_SPILLED;
+            }
+            instruction.data.operator_.right = right;
+
+            // small constants are folded into the instruction instead of taking a register
+            Register_Instruction* right_instruction = &state->register_instructions.elements[right];
+            if (right_instruction->kind == Register_Constant && right_instruction->data.constant <= 0x7fffffff && operator_ != Operator_Divide && operator_ != Operator_Modulus) {
+                instruction.data.operator_.right = right_instruction->data.constant;
+                instruction.data.operator_.right_immediate = true;
+                state->register_instructions.count--;
+            }
+
+            switch (operator_) {
+                case Operator_Equal:
+                case Operator_NotEqual:
+                case Operator_Greater:
+                case Operator_GreaterEqual:
+                case Operator_Less:
+                case Operator_LessEqual:
+                    // operands are compared zero extended, only the result size matters from here on
+                    instruction.kind = Register_Compare;
+                    instruction.size = 1;
+                    break;
+                default:
+                    instruction.kind = Register_Binary;
+                    break;
+            }
+            return append_register_instruction(instruction, state);
+        }
+        case Expression_Retrieve:
+        case Expression_Cast:
+        case Expression_SizeOf:
+        case Expression_LengthOf:
+        case Expression_Reference: {
+            if (!is_call_free(expression)) {
+                return REGISTER_SPILLED;
+            }
+
+            instruction.kind = Register_Leaf;
+            instruction.data.leaf = expression;
+
+            // locals and arguments are read straight from the frame
+            if (expression->kind == Expression_Retrieve && expression->data.retrieve.kind == Retrieve_Assign_Identifier) {
+                char* name = expression->data.retrieve.data.identifier.name;
+                if (has_local_variable(name, &state->generic)) {
+                    Location_Size_Data location_size = get_local_variable_location_size(name, &state->frame, &state->generic);
+                    assert(location_size.size == size);
+                    instruction.kind = Register_Load;
+                    instruction.data.load_offset = -(long) (location_size.location + location_size.size);
+                } else if (has_argument(name, &state->generic)) {
+                    size_t argument_size;
+                    instruction.kind = Register_Load;
+                    instruction.data.load_offset = get_argument_offset_fasm_linux_x86_64(name, &argument_size, state);
+                    assert(argument_size == size);
+                }
+            }
+            return append_register_instruction(instruction, state);
+        }
+        default:
+            return REGISTER_SPILLED;
+    }
+}
+
+X86_64_Operand get_register_operand_fasm_linux_x86_64(Live_Interval* interval) {
+    if (interval->location == REGISTER_SPILLED) {
+        return x86_64_memory(REGISTER_RSP, interval->spill_slot * 8, 8);
+    }
+    return x86_64_register(allocatable_registers[interval->location], 8);
+}
+
+X86_64_Operand get_right_operand_fasm_linux_x86_64(Register_Instruction* instruction, Live_Interval* right) {
+    if (instruction->data.operator_.right_immediate) {
+        return x86_64_immediate(instruction->data.operator_.right);
+    }
+    return get_register_operand_fasm_linux_x86_64(right);
+}
+
+X86_64_Opcode get_set_opcode(Operator operator_) {
+    switch (operator_) {
+        case Operator_Equal: return Opcode_Sete;
+        case Operator_NotEqual: return Opcode_Setne;
+        case Operator_Less: return Opcode_Setb;
+        case Operator_LessEqual: return Opcode_Setbe;
+        case Operator_Greater: return Opcode_Seta;
+        case Operator_GreaterEqual: return Opcode_Setae;
+        default:
+            assert(false);
+    }
+}
+
+void output_register_instruction_fasm_linux_x86_64(size_t index, Array_Live_Interval* intervals, Output_State* state) {
+    Register_Instruction* instruction = &state->register_instructions.elements[index];
+    Live_Interval* result = &intervals->elements[index];
+    bool spilled = result->location == REGISTER_SPILLED;
+
+    // spilled results are computed in rax and stored afterwards
+    size_t result_register = spilled ? REGISTER_RAX : allocatable_registers[result->location];
+    X86_64_Operand result_8 = x86_64_register(result_register, 8);
+    X86_64_Operand result_4 = x86_64_register(result_register, 4);
+    X86_64_Operand rax = x86_64_register(REGISTER_RAX, 8);
+
+    switch (instruction->kind) {
+        case Register_Constant:
+            emit2(state, Opcode_Mov, result_8, x86_64_immediate(instruction->data.constant));
+            break;
+        case Register_Load:
+            output_register_load_fasm_linux_x86_64(result_register, REGISTER_RBP, instruction->data.load_offset, instruction->size, state);
+            break;
+        case Register_Leaf: {
+            state->in_register_expression = true;
+            output_expression_fasm_linux_x86_64(instruction->data.leaf, state);
+            state->in_register_expression = false;
+
+            output_register_load_fasm_linux_x86_64(result_register, REGISTER_RSP, 0, instruction->size, state);
+            emit_stack_adjust(state, Opcode_Add, instruction->size);
+            break;
+        }
+        case Register_Binary: {
+            Live_Interval* left = &intervals->elements[instruction->data.operator_.left];
+            Live_Interval* right = instruction->data.operator_.right_immediate ? NULL : &intervals->elements[instruction->data.operator_.right];
+
+            Operator operator_ = instruction->data.operator_.operator_;
+            if (operator_ == Operator_Divide || operator_ == Operator_Modulus) {
+                emit2(state, Opcode_Mov, rax, get_register_operand_fasm_linux_x86_64(left));
+                emit2(state, Opcode_Xor, x86_64_register(REGISTER_RDX, 4), x86_64_register(REGISTER_RDX, 4));
+                emit1(state, Opcode_Div, get_right_operand_fasm_linux_x86_64(instruction, right));
+                emit2(state, Opcode_Mov, result_8, x86_64_register(operator_ == Operator_Divide ? REGISTER_RAX : REGISTER_RDX, 8));
+                break;
+            }
+
+            X86_64_Opcode opcode;
+            switch (operator_) {
+                case Operator_Add: opcode = Opcode_Add; break;
+                case Operator_Subtract: opcode = Opcode_Sub; break;
+                case Operator_Multiply: opcode = Opcode_Imul; break;
+                case Operator_And: opcode = Opcode_And; break;
+                case Operator_Or: opcode = Opcode_Or; break;
+                default:
+                    assert(false);
+            }
+
+            bool commutative = operator_ != Operator_Subtract;
+            if (!spilled && left->location == result->location) {
+                emit2(state, opcode, result_8, get_right_operand_fasm_linux_x86_64(instruction, right));
+            } else if (!spilled && commutative && right != NULL && right->location == result->location) {
+                emit2(state, opcode, result_8, get_register_operand_fasm_linux_x86_64(left));
+            } else if (!spilled && (right == NULL || right->location != result->location)) {
+                emit2(state, Opcode_Mov, result_8, get_register_operand_fasm_linux_x86_64(left));
+                emit2(state, opcode, result_8, get_right_operand_fasm_linux_x86_64(instruction, right));
+            } else {
+                emit2(state, Opcode_Mov, rax, get_register_operand_fasm_linux_x86_64(left));
+                emit2(state, opcode, rax, get_right_operand_fasm_linux_x86_64(instruction, right));
+                if (!spilled) {
+                    emit2(state, Opcode_Mov, result_8, rax);
+                }
+            }
+
+            // wrap around at the width of the operands
+            switch (instruction->size) {
+                case 4:
+                    emit2(state, Opcode_Mov, result_4, result_4);
+                    break;
+                case 2:
+                    emit2(state, Opcode_Movzx, result_4, x86_64_register(result_register, 2));
+                    break;
+                case 1:
+                    if (operator_ != Operator_And && operator_ != Operator_Or) {
+                        emit2(state, Opcode_Movzx, result_4, x86_64_register(result_register, 1));
+                    }
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        case Register_Compare:
+        case Register_Not: {
+            Live_Interval* left = &intervals->elements[instruction->data.operator_.left];
+
+            X86_64_Opcode set = Opcode_Sete;
+            if (instruction->kind == Register_Not) {
+                emit2(state, Opcode_Cmp, get_register_operand_fasm_linux_x86_64(left), x86_64_immediate(0));
+            } else {
+                Live_Interval* right = instruction->data.operator_.right_immediate ? NULL : &intervals->elements[instruction->data.operator_.right];
+
+                if (left->location == REGISTER_SPILLED && (right == NULL || right->location == REGISTER_SPILLED)) {
+                    emit2(state, Opcode_Mov, rax, get_register_operand_fasm_linux_x86_64(left));
+                    emit2(state, Opcode_Cmp, rax, get_right_operand_fasm_linux_x86_64(instruction, right));
+                } else {
+                    emit2(state, Opcode_Cmp, get_register_operand_fasm_linux_x86_64(left), get_right_operand_fasm_linux_x86_64(instruction, right));
+                }
+                set = get_set_opcode(instruction->data.operator_.operator_);
+            }
+
+            emit1(state, set, x86_64_register(REGISTER_RAX, 1));
+            emit2(state, Opcode_Movzx, result_4, x86_64_register(REGISTER_RAX, 1));
+            break;
+        }
+        default:
+            assert(false);
+    }
+
+    if (spilled) {
+        emit2(state, Opcode_Mov, stack_top(result->spill_slot * 8), rax);
+    }
+}
+
+// lowers a call free operator tree into virtual registers and leaves its value on the stack like the stack machine would
+bool output_register_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_State* state) {
+    state->register_instructions.count = 0;
+    size_t root = lower_register_expression(expression, 0, state);
+    if (root == REGISTER_SPILLED || !is_call_free(expression)) {
+        return false;
+    }
+
+    Array_Live_Interval intervals = array_live_interval_new(state->register_instructions.count);
+    for (size_t i = 0; i < state->register_instructions.count; i++) {
+        Live_Interval interval = { .start = i, .end = i, .hint = REGISTER_NO_HINT };
+        array_live_interval_append(&intervals, interval);
+
+        Register_Instruction* instruction = &state->register_instructions.elements[i];
+        if (instruction->kind == Register_Binary || instruction->kind == Register_Compare || instruction->kind == Register_Not) {
+            intervals.elements[instruction->data.operator_.left].end = i;
+            if (instruction->kind != Register_Not && !instruction->data.operator_.right_immediate) {
+                intervals.elements[instruction->data.operator_.right].end = i;
+            }
+            if (instruction->kind == Register_Binary) {
+                intervals.elements[i].hint = instruction->data.operator_.left;
+            }
+        }
+    }
+    // the result is read once everything else is done
+    intervals.elements[root].end = intervals.count;
+
+    size_t spill_count = allocate_registers(&intervals, ALLOCATABLE_REGISTER_COUNT);
+
+    if (spill_count > 0) {
+        emit_stack_adjust(state, Opcode_Sub, spill_count * 8);
+    }
+
+    for (size_t i = 0; i < state->register_instructions.count; i++) {
+        output_register_instruction_fasm_linux_x86_64(i, &intervals, state);
+    }
+
+    Live_Interval* result = &intervals.elements[root];
+    size_t size = state->register_instructions.elements[root].size;
+    if (result->location == REGISTER_SPILLED) {
+        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 8), stack_top(result->spill_slot * 8));
+    }
+
+    if (spill_count > 0) {
+        emit_stack_adjust(state, Opcode_Add, spill_count * 8);
+    }
+
+    output_register_push_fasm_linux_x86_64(result->location == REGISTER_SPILLED ? REGISTER_RAX : allocatable_registers[result->location], size, state);
+
+    array_live_interval_free(&intervals);
+    return true;
+}
+
+// intrinsics that are output inline instead of being called
+bool is_intrinsic_call(Ast_Expression_Invoke* invoke) {
+    Ast_Expression* procedure = invoke->data.procedure.procedure;
+    if (procedure->kind != Expression_Retrieve || procedure->data.retrieve.kind != Retrieve_Assign_Identifier) {
+        return false;
+    }
+
+    Word_Id id = procedure->data.retrieve.data.identifier.id;
+    return (id >= Intrinsic_Syscall0 && id <= Intrinsic_Syscall6) || id == Intrinsic_Copy || id == Intrinsic_Set;
+}
+
+Ast_Item_Procedure* get_direct_callee(Ast_Expression_Invoke* invoke, Output_State* state) {
+    Ast_Expression* procedure = invoke->data.procedure.procedure;
+    if (procedure->kind != Expression_Retrieve || procedure->data.retrieve.kind != Retrieve_Assign_Identifier) {
+        return NULL;
+    }
+
+    char* name = procedure->data.retrieve.data.identifier.name;
+    if (has_local_variable(name, &state->generic) || has_argument(name, &state->generic)) {
+        return NULL;
+    }
+
+    Resolved resolved = resolve(&state->generic, procedure->data.retrieve.data.identifier);
+    if (resolved.kind != Resolved_Item || resolved.data.item->kind != Item_Procedure) {
+        return NULL;
+    }
+    return &resolved.data.item->data.procedure;
+}
+
+void output_register_call_fasm_linux_x86_64(Ast_Expression_Invoke* invoke, Ast_Item_Procedure* procedure, Output_State* state) {
+    size_t registers[ARGUMENT_REGISTER_COUNT];
+    assign_argument_registers(procedure, registers, state);
+
+    bool call_free = true;
+    for (size_t i = 0; i < invoke->arguments.count; i++) {
+        call_free = call_free && is_call_free(invoke->arguments.elements[i]);
+    }
+
+    // constants, and variables when nothing can change them in between, skip the stack entirely
+    bool direct[ARGUMENT_REGISTER_COUNT] = {};
+    for (size_t i = 0; i < invoke->arguments.count; i++) {
+        Ast_Expression* argument = invoke->arguments.elements[i];
+        size_t constant;
+        if (get_constant_value(argument, 8, &constant)) {
+            direct[i] = true;
+        } else if (call_free && argument->kind == Expression_Retrieve && argument->data.retrieve.kind == Retrieve_Assign_Identifier) {
+            char* name = argument->data.retrieve.data.identifier.name;
+            direct[i] = has_local_variable(name, &state->generic) || has_argument(name, &state->generic);
+        }
+
+        if (!direct[i]) {
+            output_expression_fasm_linux_x86_64(argument, state);
+        }
+    }
+
+    size_t popped = 0;
+    for (int i = invoke->arguments.count - 1; i >= 0; i--) {
+        if (direct[i]) {
+            continue;
+        }
+
+        size_t size = get_size(&procedure->arguments.elements[i].type, &state->generic);
+        output_argument_load_fasm_linux_x86_64(registers[i], REGISTER_RSP, popped, size, state);
+        popped += size;
+    }
+
+    if (popped > 0) {
+        emit_stack_adjust(state, Opcode_Add, popped);
+    }
+
+    for (size_t i = 0; i < invoke->arguments.count; i++) {
+        if (!direct[i]) {
+            continue;
+        }
+
+        Ast_Expression* argument = invoke->arguments.elements[i];
+        size_t size = get_size(&procedure->arguments.elements[i].type, &state->generic);
+        size_t constant;
+        if (get_constant_value(argument, size, &constant)) {
+            emit2(state, Opcode_Mov, x86_64_register(argument_registers[registers[i]], 8), x86_64_immediate(constant));
+            continue;
+        }
+
+        char* name = argument->data.retrieve.data.identifier.name;
+        long offset;
+        if (has_local_variable(name, &state->generic)) {
+            Location_Size_Data location_size = get_local_variable_location_size(name, &state->frame, &state->generic);
+            offset = -(long) (location_size.location + location_size.size);
+        } else {
+            size_t argument_size;
+            offset = get_argument_offset_fasm_linux_x86_64(name, &argument_size, state);
+        }
+        output_argument_load_fasm_linux_x86_64(registers[i], REGISTER_RBP, offset, size, state);
+    }
+
+    emit_aligned_call(state, x86_64_label(procedure->name));
+
+    if (procedure->returns.count > 0) {
+        output_register_push_fasm_linux_x86_64(REGISTER_RAX, get_size(procedure->returns.elements[0], &state->generic), state);
+    }
+}
+
+// syscall arguments by position, rax takes the number
+size_t syscall_registers[] = { REGISTER_RAX, REGISTER_RDI, REGISTER_RSI, REGISTER_RDX, REGISTER_R10, REGISTER_R8, REGISTER_R9 };
+
+X86_64_Opcode get_cmov_opcode(Operator operator_) {
+    switch (operator_) {
+        case Operator_Equal: return Opcode_Cmove;
+        case Operator_NotEqual: return Opcode_Cmovne;
+        case Operator_Less: return Opcode_Cmovb;
+        case Operator_LessEqual: return Opcode_Cmovbe;
+        case Operator_Greater: return Opcode_Cmova;
+        case Operator_GreaterEqual: return Opcode_Cmovae;
+        default:
+            assert(false);
+    }
+}
+
+// pops the right operand into rbx and the left one into rax
+void output_pop_operands_fasm_linux_x86_64(size_t size, Output_State* state) {
+    if (size == 8) {
+        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RBX, 8));
+        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
+    } else {
+        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RBX, size), stack_top(0));
+        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, size), stack_top(size));
+        emit_stack_adjust(state, Opcode_Add, size * 2);
+    }
+}
+
+void output_arithmetic_fasm_linux_x86_64(Operator operator_, size_t size, Output_State* state) {
+    X86_64_Operand rax = x86_64_register(REGISTER_RAX, size);
+    X86_64_Operand rbx = x86_64_register(REGISTER_RBX, size);
+    X86_64_Operand rdx = x86_64_register(REGISTER_RDX, size);
+
+    output_pop_operands_fasm_linux_x86_64(size, state);
+    switch (operator_) {
+        case Operator_Add:
+            emit2(state, Opcode_Add, rax, rbx);
+            break;
+        case Operator_Subtract:
+            emit2(state, Opcode_Sub, rax, rbx);
+            break;
+        case Operator_Multiply:
+            emit1(state, Opcode_Mul, rbx);
+            break;
+        case Operator_Divide:
+            emit2(state, Opcode_Xor, rdx, rdx);
+            emit1(state, Opcode_Div, rbx);
+            break;
+        case Operator_Modulus:
+            emit2(state, Opcode_Xor, rdx, rdx);
+            emit1(state, Opcode_Div, rbx);
+            emit2(state, Opcode_Mov, rax, rdx);
+            break;
+        default:
+            assert(false);
+    }
+    output_register_push_fasm_linux_x86_64(REGISTER_RAX, size, state);
+}
+
 void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_State* state) {
     switch (expression->kind) {
         case Expression_Block: {
             Ast_Expression_Block* block = &expression->data.block;
+            frame_layout_enter_scope(&state->frame, &state->generic);
             for (size_t i = 0; i < block->statements.count; i++) {
                 output_statement_fasm_linux_x86_64(block->statements.elements[i], state);
             }
+            frame_layout_exit_scope(&state->frame, &state->generic);
             break;
         }
         case Expression_Multiple: {
@@ -417,6 +1274,40 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
         }
         case Expression_Invoke: {
             Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            if (invoke->kind == Invoke_Standard && state->options.register_calls) {
+                Ast_Item_Procedure* procedure = get_direct_callee(invoke, state);
+                if (procedure != NULL && uses_register_call(procedure, state)) {
+                    output_register_call_fasm_linux_x86_64(invoke, procedure, state);
+                    break;
+                }
+            }
+
+            if (invoke->kind == Invoke_Operator && state->options.registers && !state->in_register_expression) {
+                if (output_register_expression_fasm_linux_x86_64(expression, state)) {
+                    break;
+                }
+            }
+
+            // the padding of a call goes below its arguments, the callee leaves its returns right under it
+            size_t depth = state->stack_depth;
+            size_t padding = 0;
+            size_t returns_size = 0;
+            if (invoke->kind == Invoke_Standard && !is_intrinsic_call(invoke)) {
+                Ast_Type_Procedure* procedure_type = &invoke->data.procedure.computed_procedure_type.data.procedure;
+                size_t arguments_size = 0;
+                for (size_t i = 0; i < procedure_type->arguments.count; i++) {
+                    arguments_size += get_size(procedure_type->arguments.elements[i], &state->generic);
+                }
+                for (size_t i = 0; i < procedure_type->returns.count; i++) {
+                    returns_size += get_size(procedure_type->returns.elements[i], &state->generic);
+                }
+
+                padding = get_call_padding(arguments_size, state);
+                if (padding > 0) {
+                    emit_stack_adjust(state, Opcode_Sub, padding);
+                }
+            }
+
             for (size_t i = 0; i < invoke->arguments.count; i++) {
                 output_expression_fasm_linux_x86_64(invoke->arguments.elements[i], state);
             }
@@ -426,42 +1317,51 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                 bool handled = false;
 
                 if (procedure->kind == Expression_Retrieve) {
-                    char* name = procedure->data.retrieve.data.identifier.name;
+                    Word_Id id = procedure->data.retrieve.kind == Retrieve_Assign_Identifier ? procedure->data.retrieve.data.identifier.id : Word_None;
 
-                    if (strncmp(name, "@syscall", 8) == 0) {
+                    if (id >= Intrinsic_Syscall0 && id <= Intrinsic_Syscall6) {
                         handled = true;
 
-                        size_t arg_count = (size_t) atoi(name + 8);
+                        size_t arg_count = id - Intrinsic_Syscall0;
 
-                        if (arg_count >= 6) {
-                            stringbuffer_appendstring(&state->instructions, "  pop r9\n");
-                        }
-                        if (arg_count >= 5) {
-                            stringbuffer_appendstring(&state->instructions, "  pop r8\n");
-                        }
-                        if (arg_count >= 4) {
-                            stringbuffer_appendstring(&state->instructions, "  pop r10\n");
+                        for (size_t i = arg_count; i >= 1; i--) {
+                            emit1(state, Opcode_Pop, x86_64_register(syscall_registers[i], 8));
                         }
-                        if (arg_count >= 3) {
-                            stringbuffer_appendstring(&state->instructions, "  pop rdx\n");
-                        }
-                        if (arg_count >= 2) {
-                            stringbuffer_appendstring(&state->instructions, "  pop rsi\n");
-                        }
-                        if (arg_count >= 1) {
-                            stringbuffer_appendstring(&state->instructions, "  pop rdi\n");
-                        }
-                        stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                        stringbuffer_appendstring(&state->instructions, "  syscall\n");
-                        stringbuffer_appendstring(&state->instructions, "  push rax\n");
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
+                        emit0(state, Opcode_Syscall);
+                        emit1(state, Opcode_Push, x86_64_register(REGISTER_RAX, 8));
+                    }
+
+                    if (id == Intrinsic_Copy) {
+                        handled = true;
+
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RCX, 8));
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RDI, 8));
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RSI, 8));
+                        emit0(state, Opcode_Rep_Movsb);
+                    }
+
+                    if (id == Intrinsic_Set) {
+                        handled = true;
+
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RCX, 8));
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RDI, 8));
+                        emit0(state, Opcode_Rep_Stosb);
                     }
                 }
 
                 if (!handled) {
                     output_expression_fasm_linux_x86_64(procedure, state);
 
-                    stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                    stringbuffer_appendstring(&state->instructions, "  call rax\n");
+                    emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
+                    emit1(state, Opcode_Call, x86_64_register(REGISTER_RAX, 8));
+
+                    if (padding > 0) {
+                        output_copy_fasm_linux_x86_64(state, stack_top(0), stack_top(padding), returns_size, REGISTER_RAX);
+                        emit_stack_adjust(state, Opcode_Add, padding);
+                    }
+                    state->stack_depth = depth + returns_size;
                 }
             } else if (invoke->kind == Invoke_Operator) {
                 switch (invoke->data.operator_.operator_) {
@@ -471,382 +1371,105 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                     case Operator_Divide:
                     case Operator_Modulus: {
                         Ast_Type operator_type = invoke->data.operator_.computed_operand_type;
+                        Operator operator_ = invoke->data.operator_.operator_;
 
                         if (is_internal_type(Type_UInt64, &operator_type) || is_internal_type(Type_UInt, &operator_type)|| is_internal_type(Type_Ptr, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  pop rbx\n");
-                            stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Add:
-                                    stringbuffer_appendstring(&state->instructions, "  add rax, rbx\n");
-                                    break;
-                                case Operator_Subtract:
-                                    stringbuffer_appendstring(&state->instructions, "  sub rax, rbx\n");
-                                    break;
-                                case Operator_Multiply:
-                                    stringbuffer_appendstring(&state->instructions, "  mul rbx\n");
-                                    break;
-                                case Operator_Divide:
-                                    stringbuffer_appendstring(&state->instructions, "  xor rdx, rdx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div rbx\n");
-                                    break;
-                                case Operator_Modulus:
-                                    stringbuffer_appendstring(&state->instructions, "  xor rdx, rdx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div rbx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  mov rax, rdx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  push rax\n");
+                            output_arithmetic_fasm_linux_x86_64(operator_, 8, state);
                         } else if (is_internal_type(Type_UInt32, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  mov ebx, [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov eax, [rsp+4]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 8\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Add:
-                                    stringbuffer_appendstring(&state->instructions, "  add eax, ebx\n");
-                                    break;
-                                case Operator_Subtract:
-                                    stringbuffer_appendstring(&state->instructions, "  sub eax, ebx\n");
-                                    break;
-                                case Operator_Multiply:
-                                    stringbuffer_appendstring(&state->instructions, "  mul ebx\n");
-                                    break;
-                                case Operator_Divide:
-                                    stringbuffer_appendstring(&state->instructions, "  xor edx, edx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div ebx\n");
-                                    break;
-                                case Operator_Modulus:
-                                    stringbuffer_appendstring(&state->instructions, "  xor edx, edx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div ebx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  mov eax, edx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 4\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], eax\n");
+                            output_arithmetic_fasm_linux_x86_64(operator_, 4, state);
                         } else if (is_internal_type(Type_UInt16, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  mov bx, [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov ax, [rsp+2]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 4\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Add:
-                                    stringbuffer_appendstring(&state->instructions, "  add ax, bx\n");
-                                    break;
-                                case Operator_Subtract:
-                                    stringbuffer_appendstring(&state->instructions, "  sub ax, bx\n");
-                                    break;
-                                case Operator_Multiply:
-                                    stringbuffer_appendstring(&state->instructions, "  mul bx\n");
-                                    break;
-                                case Operator_Divide:
-                                    stringbuffer_appendstring(&state->instructions, "  xor dx, dx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div bx\n");
-                                    break;
-                                case Operator_Modulus:
-                                    stringbuffer_appendstring(&state->instructions, "  xor dx, dx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div bx\n");
-                                    stringbuffer_appendstring(&state->instructions, "  mov ax, dx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 2\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], ax\n");
+                            output_arithmetic_fasm_linux_x86_64(operator_, 2, state);
                         } else if (is_internal_type(Type_UInt8, &operator_type) || is_internal_type(Type_Byte, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  mov bl, [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov al, [rsp+1]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 2\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Add:
-                                    stringbuffer_appendstring(&state->instructions, "  add al, bl\n");
-                                    break;
-                                case Operator_Subtract:
-                                    stringbuffer_appendstring(&state->instructions, "  sub al, bl\n");
-                                    break;
-                                case Operator_Multiply:
-                                    stringbuffer_appendstring(&state->instructions, "  mul bl\n");
-                                    break;
-                                case Operator_Divide:
-                                    stringbuffer_appendstring(&state->instructions, "  xor dl, dl\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div bl\n");
-                                    break;
-                                case Operator_Modulus:
-                                    stringbuffer_appendstring(&state->instructions, "  xor dl, dl\n");
-                                    stringbuffer_appendstring(&state->instructions, "  div bl\n");
-                                    stringbuffer_appendstring(&state->instructions, "  mov al, dl\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], al\n");
-                        } else if (is_internal_type(Type_Float64, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  fld qword [rsp+8]\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Add:
-                                    stringbuffer_appendstring(&state->instructions, "  fadd qword [rsp]\n");
-                                    break;
-                                case Operator_Subtract:
-                                    stringbuffer_appendstring(&state->instructions, "  fsub qword [rsp]\n");
-                                    break;
-                                case Operator_Multiply:
-                                    stringbuffer_appendstring(&state->instructions, "  fmul qword [rsp]\n");
-                                    break;
-                                case Operator_Divide:
-                                    stringbuffer_appendstring(&state->instructions, "  fdiv qword [rsp]\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  fstp qword [rsp+8]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 8\n");
-                        } else {
-                            assert(false);
-                        }
-                        
-                        break;
-                    }
-                    case Operator_Equal:
-                    case Operator_NotEqual:
-                    case Operator_Greater:
-                    case Operator_GreaterEqual:
-                    case Operator_Less:
-                    case Operator_LessEqual: {
-                        Ast_Type operator_type = invoke->data.operator_.computed_operand_type;
-
-                        if (is_internal_type(Type_UInt64, &operator_type) || is_internal_type(Type_UInt, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  pop rbx\n");
-                            stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                            stringbuffer_appendstring(&state->instructions, "  cmp rax, rbx\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Equal:
-                                    stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                                    break;
-                                case Operator_NotEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovne rcx, rdx\n");
-                                    break;
-                                case Operator_Less:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovb rcx, rdx\n");
-                                    break;
-                                case Operator_LessEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovbe rcx, rdx\n");
-                                    break;
-                                case Operator_Greater:
-                                    stringbuffer_appendstring(&state->instructions, "  cmova rcx, rdx\n");
-                                    break;
-                                case Operator_GreaterEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovbe rcx, rdx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
-                        } else if (is_internal_type(Type_UInt32, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov ebx, [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov eax, [rsp+4]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 8\n");
-                            stringbuffer_appendstring(&state->instructions, "  cmp eax, ebx\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Equal:
-                                    stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                                    break;
-                                case Operator_NotEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovne rcx, rdx\n");
-                                    break;
-                                case Operator_Less:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovb rcx, rdx\n");
-                                    break;
-                                case Operator_LessEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovbe rcx, rdx\n");
-                                    break;
-                                case Operator_Greater:
-                                    stringbuffer_appendstring(&state->instructions, "  cmova rcx, rdx\n");
-                                    break;
-                                case Operator_GreaterEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovae rcx, rdx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
-                        } else if (is_internal_type(Type_UInt16, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov bx, [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov ax, [rsp+2]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 4\n");
-                            stringbuffer_appendstring(&state->instructions, "  cmp ax, bx\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Equal:
-                                    stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                                    break;
-                                case Operator_NotEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovne rcx, rdx\n");
-                                    break;
-                                case Operator_Less:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovb rcx, rdx\n");
-                                    break;
-                                case Operator_LessEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovbe rcx, rdx\n");
-                                    break;
-                                case Operator_Greater:
-                                    stringbuffer_appendstring(&state->instructions, "  cmova rcx, rdx\n");
-                                    break;
-                                case Operator_GreaterEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovae rcx, rdx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
-                        } else if (is_internal_type(Type_UInt8, &operator_type) || is_internal_type(Type_Byte, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov bl, [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov al, [rsp+1]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 2\n");
-                            stringbuffer_appendstring(&state->instructions, "  cmp al, bl\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Equal:
-                                    stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                                    break;
-                                case Operator_NotEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovne rcx, rdx\n");
-                                    break;
-                                case Operator_Less:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovb rcx, rdx\n");
-                                    break;
-                                case Operator_LessEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovbe rcx, rdx\n");
-                                    break;
-                                case Operator_Greater:
-                                    stringbuffer_appendstring(&state->instructions, "  cmova rcx, rdx\n");
-                                    break;
-                                case Operator_GreaterEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovae rcx, rdx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
+                            output_arithmetic_fasm_linux_x86_64(operator_, 1, state);
                         } else if (is_internal_type(Type_Float64, &operator_type)) {
-                            stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  fld qword [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  fld qword [rsp+8]\n");
-                            stringbuffer_appendstring(&state->instructions, "  fcomi st1\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Equal:
-                                    stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                                    break;
-                                case Operator_NotEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovne rcx, rdx\n");
-                                    break;
-                                case Operator_Less:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovb rcx, rdx\n");
-                                    break;
-                                case Operator_LessEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovbe rcx, rdx\n");
-                                    break;
-                                case Operator_Greater:
-                                    stringbuffer_appendstring(&state->instructions, "  cmova rcx, rdx\n");
-                                    break;
-                                case Operator_GreaterEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovae rcx, rdx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  fstp tword [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  fstp tword [rsp]\n");
-                            stringbuffer_appendstring(&state->instructions, "  add rsp, 16\n");
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
-                        } else if (is_enum_type(&operator_type, &state->generic)) {
-                            stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  pop rbx\n");
-                            stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                            stringbuffer_appendstring(&state->instructions, "  cmp rax, rbx\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Equal:
-                                    stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                                    break;
-                                case Operator_NotEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovne rcx, rdx\n");
-                                    break;
-                                default:
-                                    assert(false);
-                            }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
-                        } else if (is_internal_type(Type_Ptr, &operator_type) || operator_type.kind == Type_Pointer) {
-                            stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  pop rbx\n");
-                            stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                            stringbuffer_appendstring(&state->instructions, "  cmp rax, rbx\n");
-                            switch (invoke->data.operator_.operator_) {
-                                case Operator_Equal:
-                                    stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                                    break;
-                                case Operator_NotEqual:
-                                    stringbuffer_appendstring(&state->instructions, "  cmovne rcx, rdx\n");
-                                    break;
+                            X86_64_Opcode opcode;
+                            switch (operator_) {
+                                case Operator_Add: opcode = Opcode_Fadd; break;
+                                case Operator_Subtract: opcode = Opcode_Fsub; break;
+                                case Operator_Multiply: opcode = Opcode_Fmul; break;
+                                case Operator_Divide: opcode = Opcode_Fdiv; break;
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                            stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
+
+                            emit1(state, Opcode_Fld, x86_64_memory(REGISTER_RSP, 8, 8));
+                            emit1(state, opcode, x86_64_memory(REGISTER_RSP, 0, 8));
+                            emit1(state, Opcode_Fstp, x86_64_memory(REGISTER_RSP, 8, 8));
+                            emit_stack_adjust(state, Opcode_Add, 8);
                         } else {
                             assert(false);
                         }
                         
                         break;
                     }
-                    case Operator_And: {
-                        stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov bl, [rsp]\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov al, [rsp+1]\n");
-                        stringbuffer_appendstring(&state->instructions, "  add rsp, 2\n");
-                        stringbuffer_appendstring(&state->instructions, "  and al, bl\n");
-                        stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov [rsp], al\n");
+                    case Operator_Equal:
+                    case Operator_NotEqual:
+                    case Operator_Greater:
+                    case Operator_GreaterEqual:
+                    case Operator_Less:
+                    case Operator_LessEqual: {
+                        Ast_Type operator_type = invoke->data.operator_.computed_operand_type;
+                        Operator operator_ = invoke->data.operator_.operator_;
+                        bool equality = operator_ == Operator_Equal || operator_ == Operator_NotEqual;
+
+                        emit2(state, Opcode_Xor, x86_64_register(REGISTER_RCX, 8), x86_64_register(REGISTER_RCX, 8));
+                        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RDX, 8), x86_64_immediate(1));
+
+                        size_t size = 0;
+                        if (is_internal_type(Type_UInt64, &operator_type) || is_internal_type(Type_UInt, &operator_type)) {
+                            size = 8;
+                        } else if (is_internal_type(Type_UInt32, &operator_type)) {
+                            size = 4;
+                        } else if (is_internal_type(Type_UInt16, &operator_type)) {
+                            size = 2;
+                        } else if (is_internal_type(Type_UInt8, &operator_type) || is_internal_type(Type_Byte, &operator_type)) {
+                            size = 1;
+                        } else if (is_internal_type(Type_Float64, &operator_type)) {
+                            emit1(state, Opcode_Fld, x86_64_memory(REGISTER_RSP, 0, 8));
+                            emit1(state, Opcode_Fld, x86_64_memory(REGISTER_RSP, 8, 8));
+                            emit1(state, Opcode_Fcomi, x86_64_float(1));
+                        } else if (is_enum_type(&operator_type, &state->generic) || is_internal_type(Type_Ptr, &operator_type) || operator_type.kind == Type_Pointer) {
+                            assert(equality);
+                            size = 8;
+                        } else {
+                            assert(false);
+                        }
+
+                        if (size != 0) {
+                            output_pop_operands_fasm_linux_x86_64(size, state);
+                            emit2(state, Opcode_Cmp, x86_64_register(REGISTER_RAX, size), x86_64_register(REGISTER_RBX, size));
+                        }
+
+                        emit2(state, get_cmov_opcode(operator_), x86_64_register(REGISTER_RCX, 8), x86_64_register(REGISTER_RDX, 8));
+
+                        if (is_internal_type(Type_Float64, &operator_type)) {
+                            emit1(state, Opcode_Fstp, x86_64_memory(REGISTER_RSP, 0, 10));
+                            emit1(state, Opcode_Fstp, x86_64_memory(REGISTER_RSP, 0, 10));
+                            emit_stack_adjust(state, Opcode_Add, 16);
+                        }
+
+                        output_register_push_fasm_linux_x86_64(REGISTER_RCX, 1, state);
                         break;
                     }
+                    case Operator_And:
                     case Operator_Or: {
-                        stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov bl, [rsp]\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov al, [rsp+1]\n");
-                        stringbuffer_appendstring(&state->instructions, "  add rsp, 2\n");
-                        stringbuffer_appendstring(&state->instructions, "  or al, bl\n");
-                        stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov [rsp], al\n");
+                        emit2(state, Opcode_Xor, x86_64_register(REGISTER_RCX, 8), x86_64_register(REGISTER_RCX, 8));
+                        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RDX, 8), x86_64_immediate(1));
+                        output_pop_operands_fasm_linux_x86_64(1, state);
+                        emit2(state, invoke->data.operator_.operator_ == Operator_And ? Opcode_And : Opcode_Or, x86_64_register(REGISTER_RAX, 1), x86_64_register(REGISTER_RBX, 1));
+                        output_register_push_fasm_linux_x86_64(REGISTER_RAX, 1, state);
                         break;
                     }
                     case Operator_Not: {
-                        stringbuffer_appendstring(&state->instructions, "  xor rcx, rcx\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov rdx, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  xor rax, rax\n");
-                        stringbuffer_appendstring(&state->instructions, "  xor rbx, rbx\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov bl, [rsp]\n");
-                        stringbuffer_appendstring(&state->instructions, "  add rsp, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  cmp rax, rbx\n");
-                        stringbuffer_appendstring(&state->instructions, "  cmove rcx, rdx\n");
-                        stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov [rsp], cl\n");
+                        emit2(state, Opcode_Xor, x86_64_register(REGISTER_RCX, 8), x86_64_register(REGISTER_RCX, 8));
+                        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RDX, 8), x86_64_immediate(1));
+                        emit2(state, Opcode_Xor, x86_64_register(REGISTER_RAX, 8), x86_64_register(REGISTER_RAX, 8));
+                        emit2(state, Opcode_Xor, x86_64_register(REGISTER_RBX, 8), x86_64_register(REGISTER_RBX, 8));
+                        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RBX, 1), stack_top(0));
+                        emit_stack_adjust(state, Opcode_Add, 1);
+                        emit2(state, Opcode_Cmp, x86_64_register(REGISTER_RAX, 8), x86_64_register(REGISTER_RBX, 8));
+                        emit2(state, Opcode_Cmove, x86_64_register(REGISTER_RCX, 8), x86_64_register(REGISTER_RDX, 8));
+                        output_register_push_fasm_linux_x86_64(REGISTER_RCX, 1, state);
                         break;
                     }
                 }
@@ -863,10 +1486,10 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
             bool found = false;
 
             if (!found && retrieve->kind == Retrieve_Assign_Identifier) {
-                if (strcmp(retrieve->data.identifier.name, "@file") == 0) {
+                if (retrieve->data.identifier.id == Intrinsic_File) {
                     output_string_fasm_linux_x86_64(retrieve->location.file, state);
                     found = true;
-                } else if (strcmp(retrieve->data.identifier.name, "@line") == 0) {
+                } else if (retrieve->data.identifier.id == Intrinsic_Line) {
                     output_raw_value_fasm_linux_x86_64(Type_UInt, retrieve->location.row, state);
                     found = true;
                 }
@@ -892,24 +1515,20 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
 
                 size_t element_size = get_size(array_ast_type_raw->data.array.element_type, &state->generic);
 
-                stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                stringbuffer_appendstring(&state->instructions, "  pop rcx\n");
+                emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
+                emit1(state, Opcode_Pop, x86_64_register(REGISTER_RCX, 8));
 
-                char buffer[128] = {};
-                sprintf(buffer, "  mov rdx, %zu\n", element_size);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                emit2(state, Opcode_Mov, x86_64_register(REGISTER_RDX, 8), x86_64_immediate(element_size));
 
-                stringbuffer_appendstring(&state->instructions, "  mul rdx\n");
+                emit1(state, Opcode_Mul, x86_64_register(REGISTER_RDX, 8));
 
                 if (in_reference) {
-                    stringbuffer_appendstring(&state->instructions, "  add rax, rcx\n");
-                    stringbuffer_appendstring(&state->instructions, "  push rax\n");
+                    emit2(state, Opcode_Add, x86_64_register(REGISTER_RAX, 8), x86_64_register(REGISTER_RCX, 8));
+                    emit1(state, Opcode_Push, x86_64_register(REGISTER_RAX, 8));
                 } else {
-                    memset(buffer, 0, 128);
-                    sprintf(buffer, "  sub rsp, %zu\n", element_size);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    emit_stack_adjust(state, Opcode_Sub, element_size);
 
-                    output_copy_fasm_linux_x86_64(state, "rax+rcx", false, 0, "rsp", false, 0, element_size, "rbx", "bl");
+                    output_copy_fasm_linux_x86_64(state, x86_64_memory_index(REGISTER_RAX, REGISTER_RCX), stack_top(0), element_size, REGISTER_RBX);
                 }
             }
 
@@ -924,21 +1543,17 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                 }
 
                 output_expression_fasm_linux_x86_64(retrieve->data.parent.expression, state);
-                stringbuffer_appendstring(&state->instructions, "  pop rax\n");
+                emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
 
                 Location_Size_Data location_size = get_parent_item_location_size(&parent_type, retrieve->data.parent.name, &state->generic);
                 if (in_reference) {
-                    char buffer[128] = {};
-                    sprintf(buffer, "  add rax, %zu\n", location_size.location);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    emit2(state, Opcode_Add, x86_64_register(REGISTER_RAX, 8), x86_64_immediate(location_size.location));
 
-                    stringbuffer_appendstring(&state->instructions, "  push rax\n");
+                    emit1(state, Opcode_Push, x86_64_register(REGISTER_RAX, 8));
                 } else {
-                    char buffer[128] = {};
-                    sprintf(buffer, "  sub rsp, %zu\n", location_size.size);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    emit_stack_adjust(state, Opcode_Sub, location_size.size);
 
-                    output_copy_fasm_linux_x86_64(state, "rax", false, location_size.location, "rsp", false, 0, location_size.size, "rbx", "bl");
+                    output_copy_fasm_linux_x86_64(state, x86_64_memory(REGISTER_RAX, location_size.location, 0), stack_top(0), location_size.size, REGISTER_RBX);
                 }
             }
 
@@ -947,19 +1562,16 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                 if (has_local_variable(name, &state->generic)) {
                     found = true;
 
-                    Location_Size_Data location_size = get_local_variable_location_size(name, &state->generic);
+                    Location_Size_Data location_size = get_local_variable_location_size(name, &state->frame, &state->generic);
 
+                    X86_64_Operand local = x86_64_memory(REGISTER_RBP, -(long) (location_size.location + location_size.size), 0);
                     if (consume_in_reference(&state->generic)) {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  lea rax, [rbp-%zu]\n", location_size.location + location_size.size);
-                        stringbuffer_appendstring(&state->instructions, buffer);
-                        stringbuffer_appendstring(&state->instructions, "  push rax\n");
+                        emit2(state, Opcode_Lea, x86_64_register(REGISTER_RAX, 8), local);
+                        emit1(state, Opcode_Push, x86_64_register(REGISTER_RAX, 8));
                     } else {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  sub rsp, %zu\n", location_size.size);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        emit_stack_adjust(state, Opcode_Sub, location_size.size);
                         
-                        output_copy_fasm_linux_x86_64(state, "rbp", true, location_size.location + location_size.size, "rsp", false, 0, location_size.size, "rax", "al");
+                        output_copy_fasm_linux_x86_64(state, local, stack_top(0), location_size.size, REGISTER_RAX);
                     }
                 }
             }
@@ -969,18 +1581,15 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                 if (has_argument(name, &state->generic)) {
                     found = true;
 
-                    Location_Size_Data location_size = get_argument_location_size(name, &state->generic);
+                    size_t size;
+                    long offset = get_argument_offset_fasm_linux_x86_64(name, &size, state);
                     if (consume_in_reference(&state->generic)) {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  lea rax, [rbp+%zu]\n", location_size.location + 8);
-                        stringbuffer_appendstring(&state->instructions, buffer);
-                        stringbuffer_appendstring(&state->instructions, "  push rax\n");
+                        emit2(state, Opcode_Lea, x86_64_register(REGISTER_RAX, 8), x86_64_memory(REGISTER_RBP, offset, 0));
+                        emit1(state, Opcode_Push, x86_64_register(REGISTER_RAX, 8));
                     } else {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  sub rsp, %zu\n", location_size.size);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        emit_stack_adjust(state, Opcode_Sub, size);
 
-                        output_copy_fasm_linux_x86_64(state, "rbp", false, location_size.location + 8, "rsp", false, 0, location_size.size, "rax", "al");
+                        output_copy_fasm_linux_x86_64(state, x86_64_memory(REGISTER_RBP, offset, 0), stack_top(0), size, REGISTER_RAX);
                     }
                 }
             }
@@ -993,9 +1602,7 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                     index++;
                 }
 
-                char buffer[128] = {};
-                sprintf(buffer, "  push %zu\n", index);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                emit1(state, Opcode_Push, x86_64_immediate(index));
 
                 found = true;
             }
@@ -1008,27 +1615,21 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                         found = true;
                         switch (item->kind) {
                             case Item_Procedure: {
-                                char buffer[128] = {};
-                                sprintf(buffer, "  push %s\n", item->data.procedure.name);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                emit1(state, Opcode_Push, x86_64_label(item->data.procedure.name));
                                 break;
                             }
                             case Item_Global: {
                                 Ast_Item_Global* global = &item->data.global;
                                 if (consume_in_reference(&state->generic)) {
-                                    char buffer[128] = {};
-                                    sprintf(buffer + strlen(buffer), "  lea rax, [%s]\n", global->name);
+                                    emit2(state, Opcode_Lea, x86_64_register(REGISTER_RAX, 8), x86_64_memory_label(global->name));
 
-                                    stringbuffer_appendstring(&state->instructions, buffer);
-                                    stringbuffer_appendstring(&state->instructions, "  push rax\n");
+                                    emit1(state, Opcode_Push, x86_64_register(REGISTER_RAX, 8));
                                 } else {
                                     size_t size = get_size(&global->type, &state->generic);
 
-                                    char buffer[128] = {};
-                                    sprintf(buffer, "  sub rsp, %zu\n", size);
-                                    stringbuffer_appendstring(&state->instructions, buffer);
+                                    emit_stack_adjust(state, Opcode_Sub, size);
                                         
-                                    output_copy_fasm_linux_x86_64(state, global->name, false, 0, "rsp", false, 0, size, "rax", "al");
+                                    output_copy_fasm_linux_x86_64(state, x86_64_memory_label(global->name), stack_top(0), size, REGISTER_RAX);
                                 }
                                 break;
                             }
@@ -1063,32 +1664,20 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
 
             output_expression_fasm_linux_x86_64(node->condition, state);
 
-            stringbuffer_appendstring(&state->instructions, "  mov rbx, 1\n");
-            stringbuffer_appendstring(&state->instructions, "  xor rax, rax\n");
-            stringbuffer_appendstring(&state->instructions, "  mov al, [rsp]\n");
-            stringbuffer_appendstring(&state->instructions, "  add rsp, 1\n");
-            stringbuffer_appendstring(&state->instructions, "  cmp rax, rbx\n");
-            char buffer[128] = {};
-            sprintf(buffer, "  jne __%zu\n", else_);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            output_condition_fasm_linux_x86_64(state);
+            emit_jump(state, Opcode_Jne, else_);
 
             output_expression_fasm_linux_x86_64(node->if_expression, state);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  jmp __%zu\n", end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_jump(state, Opcode_Jmp, end);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  __%zu:\n", else_);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_flow_label(state, else_);
 
             if (node->else_expression != NULL) {
                 output_expression_fasm_linux_x86_64(node->else_expression, state);
             }
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  __%zu:\n", end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            emit_flow_label(state, end);
             break;
         }
         case Expression_Number: {
@@ -1132,7 +1721,7 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
             break;
         }
         case Expression_Null: {
-            stringbuffer_appendstring(&state->instructions, "  push 0\n");
+            emit1(state, Opcode_Push, x86_64_immediate(0));
             break;
         }
         case Expression_String: {
@@ -1168,37 +1757,17 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
                         (output_internal == Type_UInt || output_internal == Type_UInt64 || output_internal == Type_UInt32 || output_internal == Type_UInt16 || output_internal == Type_UInt8)) {
                     size_t input_size = get_size(&cast->computed_input_type, &state->generic);
                     if (input_size == 8) {
-                        stringbuffer_appendstring(&state->instructions, "  pop rax\n");
-                    } else if (input_size == 4) {
-                        stringbuffer_appendstring(&state->instructions, "  xor rax, rax\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov eax, [rsp]\n");
-                        stringbuffer_appendstring(&state->instructions, "  add rsp, 4\n");
-                    } else if (input_size == 2) {
-                        stringbuffer_appendstring(&state->instructions, "  xor rax, rax\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov ax, [rsp]\n");
-                        stringbuffer_appendstring(&state->instructions, "  add rsp, 2\n");
-                    } else if (input_size == 1) {
-                        stringbuffer_appendstring(&state->instructions, "  xor rax, rax\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov al, [rsp]\n");
-                        stringbuffer_appendstring(&state->instructions, "  add rsp, 1\n");
+                        emit1(state, Opcode_Pop, x86_64_register(REGISTER_RAX, 8));
+                    } else {
+                        emit2(state, Opcode_Xor, x86_64_register(REGISTER_RAX, 8), x86_64_register(REGISTER_RAX, 8));
+                        emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, input_size), stack_top(0));
+                        emit_stack_adjust(state, Opcode_Add, input_size);
                     }
 
-                    size_t output_size = get_size(&cast->type, &state->generic);
-                    if (output_size == 8) {
-                        stringbuffer_appendstring(&state->instructions, "  push rax\n");
-                    } else if (output_size == 4) {
-                        stringbuffer_appendstring(&state->instructions, "  sub rsp, 4\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov [rsp], eax\n");
-                    } else if (output_size == 2) {
-                        stringbuffer_appendstring(&state->instructions, "  sub rsp, 2\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov [rsp], ax\n");
-                    } else if (output_size == 1) {
-                        stringbuffer_appendstring(&state->instructions, "  sub rsp, 1\n");
-                        stringbuffer_appendstring(&state->instructions, "  mov [rsp], al\n");
-                    }
+                    output_register_push_fasm_linux_x86_64(REGISTER_RAX, get_size(&cast->type, &state->generic), state);
                 } else if (input_internal == Type_Float64 && output_internal == Type_UInt64) {
-                    stringbuffer_appendstring(&state->instructions, "  fld qword [rsp]\n");
-                    stringbuffer_appendstring(&state->instructions, "  fisttp qword [rsp]\n");
+                    emit1(state, Opcode_Fld, x86_64_memory(REGISTER_RSP, 0, 8));
+                    emit1(state, Opcode_Fisttp, x86_64_memory(REGISTER_RSP, 0, 8));
                 } else if (input.kind == Type_Internal && input.data.internal == Type_Byte && output.kind == Type_Internal && output.data.internal == Type_UInt8) {
                 } else if (input.kind == Type_Internal && input.data.internal == Type_UInt8 && output.kind == Type_Internal && output.data.internal == Type_Byte) {
                 } else {
@@ -1237,14 +1806,374 @@ void output_expression_fasm_linux_x86_64(Ast_Expression* expression, Output_Stat
     }
 }
 
-void output_item_fasm_linux_x86_64(Ast_Item* item, Output_State* state) {
-    if (has_directive(&item->directives, Directive_If)) {
-        Ast_Directive_If* if_node = &get_directive(&item->directives, Directive_If)->data.if_;
-        if (!if_node->result) {
-            return;
+// every ir value lives in its own 8 byte slot below rbp, the memory of allocas comes after all of them
+void output_ir_store_fasm_linux_x86_64(size_t source, Ir_Value value, Output_State* state) {
+    emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RBP, -(long) ((value + 1) * 8), 0), x86_64_register(source, 8));
+}
+
+void output_ir_load_fasm_linux_x86_64(size_t destination, Ir_Value value, Output_State* state) {
+    emit2(state, Opcode_Mov, x86_64_register(destination, 8), x86_64_memory(REGISTER_RBP, -(long) ((value + 1) * 8), 0));
+}
+
+// values are kept zero extended, so anything narrower than 64 bits is cut back after an operation
+void output_ir_truncate_fasm_linux_x86_64(Ir_Type type, Output_State* state) {
+    switch (type) {
+        case Ir_I32:
+            emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 4), x86_64_register(REGISTER_RAX, 4));
+            break;
+        case Ir_I16:
+            emit2(state, Opcode_Movzx, x86_64_register(REGISTER_RAX, 4), x86_64_register(REGISTER_RAX, 2));
+            break;
+        case Ir_I8:
+            emit2(state, Opcode_Movzx, x86_64_register(REGISTER_RAX, 4), x86_64_register(REGISTER_RAX, 1));
+            break;
+        default:
+            break;
+    }
+}
+
+void output_ir_push_fasm_linux_x86_64(Ir_Transfer* transfer, Output_State* state) {
+    emit_stack_adjust(state, Opcode_Sub, transfer->size);
+
+    if (transfer->aggregate) {
+        output_ir_load_fasm_linux_x86_64(REGISTER_RSI, transfer->value, state);
+        output_copy_fasm_linux_x86_64(state, x86_64_memory(REGISTER_RSI, 0, 0), stack_top(0), transfer->size, REGISTER_RAX);
+    } else {
+        output_ir_load_fasm_linux_x86_64(REGISTER_RAX, transfer->value, state);
+        emit2(state, Opcode_Mov, stack_top(0), x86_64_register(REGISTER_RAX, transfer->size));
+    }
+}
+
+// phis are written by their predecessors right before they jump
+void output_ir_jump_fasm_linux_x86_64(Ir_Procedure* procedure, size_t from, size_t to, size_t labels, Output_State* state) {
+    Ir_Block* target = &procedure->blocks.elements[to];
+    for (size_t i = 0; i < target->instructions.count; i++) {
+        Ir_Value value = target->instructions.elements[i];
+        Ir_Instruction* phi = &procedure->instructions.elements[value];
+        if (phi->kind != Ir_Phi) {
+            break;
+        }
+
+        for (size_t j = 0; j < phi->data.phi.count; j++) {
+            if (phi->data.phi.elements[j].block == from) {
+                output_ir_load_fasm_linux_x86_64(REGISTER_RAX, phi->data.phi.elements[j].value, state);
+                output_ir_store_fasm_linux_x86_64(REGISTER_RAX, value, state);
+            }
+        }
+    }
+
+    emit_jump(state, Opcode_Jmp, labels + to);
+}
+
+// arguments go straight from their slots into registers and the result comes back in rax
+void output_ir_register_call_fasm_linux_x86_64(Ir_Instruction* instruction, Output_State* state) {
+    Ast_Item_Procedure* procedure = instruction->data.call.direct;
+    size_t registers[ARGUMENT_REGISTER_COUNT];
+    assign_argument_registers(procedure, registers, state);
+
+    Array_Ir_Transfer* arguments = &instruction->data.call.arguments;
+    for (size_t i = 0; i < arguments->count; i++) {
+        Ir_Transfer* argument = &arguments->elements[i];
+        if (argument->aggregate) {
+            output_ir_load_fasm_linux_x86_64(REGISTER_RAX, argument->value, state);
+            output_argument_load_fasm_linux_x86_64(registers[i], REGISTER_RAX, 0, argument->size, state);
+        } else {
+            output_ir_load_fasm_linux_x86_64(argument_registers[registers[i]], argument->value, state);
+        }
+    }
+
+    emit_aligned_call(state, x86_64_label(procedure->name));
+
+    if (!instruction->data.call.has_value && instruction->data.call.destination != IR_NO_VALUE) {
+        output_ir_load_fasm_linux_x86_64(REGISTER_RDI, instruction->data.call.destination, state);
+        emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RDI, 0, 0), x86_64_register(REGISTER_RAX, instruction->data.call.returns_size));
+    }
+}
+
+// left in rax and right in rbx, the result ends up in rax
+void output_ir_binary_fasm_linux_x86_64(Ir_Binary_Operator operator_, Output_State* state) {
+    X86_64_Operand rax = x86_64_register(REGISTER_RAX, 8);
+    X86_64_Operand rbx = x86_64_register(REGISTER_RBX, 8);
+    X86_64_Operand edx = x86_64_register(REGISTER_RDX, 4);
+
+    switch (operator_) {
+        case Ir_Add:
+            emit2(state, Opcode_Add, rax, rbx);
+            break;
+        case Ir_Subtract:
+            emit2(state, Opcode_Sub, rax, rbx);
+            break;
+        case Ir_Multiply:
+            emit1(state, Opcode_Mul, rbx);
+            break;
+        case Ir_Divide:
+            emit2(state, Opcode_Xor, edx, edx);
+            emit1(state, Opcode_Div, rbx);
+            break;
+        case Ir_Modulus:
+            emit2(state, Opcode_Xor, edx, edx);
+            emit1(state, Opcode_Div, rbx);
+            emit2(state, Opcode_Mov, rax, x86_64_register(REGISTER_RDX, 8));
+            break;
+        case Ir_And:
+            emit2(state, Opcode_And, rax, rbx);
+            break;
+        case Ir_Or:
+            emit2(state, Opcode_Or, rax, rbx);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+X86_64_Opcode ir_float_instructions[] = { Opcode_Addsd, Opcode_Subsd, Opcode_Mulsd, Opcode_Divsd };
+// unsigned conditions, ucomisd sets the flags the same way for doubles
+X86_64_Opcode ir_set_instructions[] = { Opcode_Sete, Opcode_Setne, Opcode_Setb, Opcode_Setbe, Opcode_Seta, Opcode_Setae };
+
+void output_ir_instruction_fasm_linux_x86_64(Ir_Procedure* procedure, size_t block, Ir_Value value, size_t* alloca_offsets, size_t labels, Output_State* state) {
+    Ir_Instruction* instruction = &procedure->instructions.elements[value];
+    X86_64_Operand rax = x86_64_register(REGISTER_RAX, 8);
+
+    switch (instruction->kind) {
+        case Ir_Constant:
+            emit2(state, Opcode_Mov, rax, x86_64_immediate(instruction->data.constant));
+            break;
+        case Ir_Argument: {
+            size_t size;
+            long offset = get_argument_offset_fasm_linux_x86_64(procedure->source->arguments.elements[instruction->data.argument].name, &size, state);
+            emit2(state, Opcode_Lea, rax, x86_64_memory(REGISTER_RBP, offset, 0));
+            break;
+        }
+        case Ir_Alloca:
+            emit2(state, Opcode_Lea, rax, x86_64_memory(REGISTER_RBP, -(long) alloca_offsets[value], 0));
+            break;
+        case Ir_Global:
+            emit2(state, Opcode_Lea, rax, x86_64_memory_label(instruction->data.name));
+            break;
+        case Ir_Procedure_Address:
+            emit2(state, Opcode_Mov, rax, x86_64_label(instruction->data.name));
+            break;
+        case Ir_String:
+            output_string_fasm_linux_x86_64(instruction->data.string, state);
+            emit1(state, Opcode_Pop, rax);
+            break;
+        case Ir_Load:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RBX, instruction->data.memory.address, state);
+            output_register_load_fasm_linux_x86_64(REGISTER_RAX, REGISTER_RBX, 0, ir_type_size(instruction->type), state);
+            break;
+        case Ir_Store:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RBX, instruction->data.memory.address, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RAX, instruction->data.memory.value, state);
+            emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RBX, 0, 0), x86_64_register(REGISTER_RAX, ir_type_size(instruction->type)));
+            break;
+        case Ir_Copy:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RSI, instruction->data.copy.source, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RDI, instruction->data.copy.destination, state);
+            output_copy_fasm_linux_x86_64(state, x86_64_memory(REGISTER_RSI, 0, 0), x86_64_memory(REGISTER_RDI, 0, 0), instruction->data.copy.size, REGISTER_RAX);
+            break;
+        case Ir_Zero: {
+            output_ir_load_fasm_linux_x86_64(REGISTER_RDI, instruction->data.copy.destination, state);
+            emit2(state, Opcode_Xor, x86_64_register(REGISTER_RAX, 4), x86_64_register(REGISTER_RAX, 4));
+
+            size_t size = instruction->data.copy.size;
+            for (size_t i = 0; i < size;) {
+                if (size - i >= 8) {
+                    emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RDI, i, 0), rax);
+                    i += 8;
+                } else {
+                    emit2(state, Opcode_Mov, x86_64_memory(REGISTER_RDI, i, 0), x86_64_register(REGISTER_RAX, 1));
+                    i++;
+                }
+            }
+            break;
+        }
+        case Ir_Binary:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RAX, instruction->data.binary.left, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RBX, instruction->data.binary.right, state);
+            if (instruction->type == Ir_F64) {
+                assert(instruction->data.binary.operator_ <= Ir_Divide);
+                emit2(state, Opcode_Movq, x86_64_xmm(0), rax);
+                emit2(state, Opcode_Movq, x86_64_xmm(1), x86_64_register(REGISTER_RBX, 8));
+                emit2(state, ir_float_instructions[instruction->data.binary.operator_], x86_64_xmm(0), x86_64_xmm(1));
+                emit2(state, Opcode_Movq, rax, x86_64_xmm(0));
+            } else {
+                output_ir_binary_fasm_linux_x86_64(instruction->data.binary.operator_, state);
+            }
+            output_ir_truncate_fasm_linux_x86_64(instruction->type, state);
+            break;
+        case Ir_Compare:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RAX, instruction->data.compare.left, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RBX, instruction->data.compare.right, state);
+            if (instruction->data.compare.operand_type == Ir_F64) {
+                emit2(state, Opcode_Movq, x86_64_xmm(0), rax);
+                emit2(state, Opcode_Movq, x86_64_xmm(1), x86_64_register(REGISTER_RBX, 8));
+                emit2(state, Opcode_Xor, x86_64_register(REGISTER_RAX, 4), x86_64_register(REGISTER_RAX, 4));
+                emit2(state, Opcode_Ucomisd, x86_64_xmm(0), x86_64_xmm(1));
+            } else {
+                emit2(state, Opcode_Cmp, rax, x86_64_register(REGISTER_RBX, 8));
+                emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 4), x86_64_immediate(0));
+            }
+            emit1(state, ir_set_instructions[instruction->data.compare.condition], x86_64_register(REGISTER_RAX, 1));
+            break;
+        case Ir_Convert:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RAX, instruction->data.convert.value, state);
+            if (instruction->data.convert.from == Ir_F64) {
+                emit2(state, Opcode_Movq, x86_64_xmm(0), rax);
+                emit2(state, Opcode_Cvttsd2si, rax, x86_64_xmm(0));
+            }
+            output_ir_truncate_fasm_linux_x86_64(instruction->type, state);
+            break;
+        case Ir_Call: {
+            if (instruction->data.call.direct != NULL && uses_register_call(instruction->data.call.direct, state)) {
+                output_ir_register_call_fasm_linux_x86_64(instruction, state);
+                break;
+            }
+
+            Array_Ir_Transfer* arguments = &instruction->data.call.arguments;
+            size_t arguments_size = 0;
+            for (size_t i = 0; i < arguments->count; i++) {
+                arguments_size += arguments->elements[i].size;
+            }
+
+            size_t padding = get_call_padding(arguments_size, state);
+            if (padding > 0) {
+                emit_stack_adjust(state, Opcode_Sub, padding);
+            }
+            for (size_t i = 0; i < arguments->count; i++) {
+                output_ir_push_fasm_linux_x86_64(&arguments->elements[i], state);
+            }
+
+            if (instruction->data.call.direct != NULL) {
+                emit1(state, Opcode_Call, x86_64_label(instruction->data.call.direct->name));
+            } else {
+                output_ir_load_fasm_linux_x86_64(REGISTER_RAX, instruction->data.call.callee, state);
+                emit1(state, Opcode_Call, rax);
+            }
+
+            size_t returns_size = instruction->data.call.returns_size;
+            if (instruction->data.call.has_value) {
+                output_register_load_fasm_linux_x86_64(REGISTER_RAX, REGISTER_RSP, 0, returns_size, state);
+            } else if (instruction->data.call.destination != IR_NO_VALUE) {
+                output_ir_load_fasm_linux_x86_64(REGISTER_RDI, instruction->data.call.destination, state);
+                output_copy_fasm_linux_x86_64(state, stack_top(0), x86_64_memory(REGISTER_RDI, 0, 0), returns_size, REGISTER_RBX);
+            }
+
+            if (returns_size + padding > 0) {
+                emit_stack_adjust(state, Opcode_Add, returns_size + padding);
+            }
+            state->stack_depth -= arguments_size - returns_size;
+            break;
+        }
+        case Ir_Syscall: {
+            for (size_t i = 0; i < instruction->data.syscall.count; i++) {
+                output_ir_load_fasm_linux_x86_64(syscall_registers[i], instruction->data.syscall.elements[i].value, state);
+            }
+            emit0(state, Opcode_Syscall);
+            break;
+        }
+        case Ir_Copy_Bytes:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RSI, instruction->data.bytes.source, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RDI, instruction->data.bytes.destination, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RCX, instruction->data.bytes.length, state);
+            emit0(state, Opcode_Rep_Movsb);
+            break;
+        case Ir_Set_Bytes:
+            output_ir_load_fasm_linux_x86_64(REGISTER_RAX, instruction->data.bytes.source, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RDI, instruction->data.bytes.destination, state);
+            output_ir_load_fasm_linux_x86_64(REGISTER_RCX, instruction->data.bytes.length, state);
+            emit0(state, Opcode_Rep_Stosb);
+            break;
+        case Ir_Phi:
+            break;
+        case Ir_Jump:
+            output_ir_jump_fasm_linux_x86_64(procedure, block, instruction->data.jump, labels, state);
+            break;
+        case Ir_Branch:
+            assert(procedure->instructions.elements[procedure->blocks.elements[instruction->data.branch.if_true].instructions.elements[0]].kind != Ir_Phi);
+            assert(procedure->instructions.elements[procedure->blocks.elements[instruction->data.branch.if_false].instructions.elements[0]].kind != Ir_Phi);
+
+            output_ir_load_fasm_linux_x86_64(REGISTER_RAX, instruction->data.branch.condition, state);
+            emit2(state, Opcode_Test, x86_64_register(REGISTER_RAX, 1), x86_64_register(REGISTER_RAX, 1));
+            emit_jump(state, Opcode_Jne, labels + instruction->data.branch.if_true);
+            emit_jump(state, Opcode_Jmp, labels + instruction->data.branch.if_false);
+            break;
+        case Ir_Return:
+            for (size_t i = 0; i < instruction->data.return_.count; i++) {
+                output_ir_push_fasm_linux_x86_64(&instruction->data.return_.elements[i], state);
+            }
+            output_actual_return_fasm_linux_x86_64(state);
+            break;
+        case Ir_Unreachable:
+            break;
+        default:
+            assert(false);
+    }
+
+    if (ir_has_value(instruction) && instruction->kind != Ir_Phi) {
+        output_ir_store_fasm_linux_x86_64(REGISTER_RAX, value, state);
+    }
+}
+
+// the body of a procedure from its ir, the frame holds a slot for every value and then the allocas
+void output_ir_procedure_fasm_linux_x86_64(Ir_Procedure* procedure, Output_State* state) {
+    size_t* alloca_offsets = malloc(procedure->instructions.count * sizeof(size_t));
+    size_t size = procedure->instructions.count * 8;
+    for (size_t i = 0; i < procedure->instructions.count; i++) {
+        Ir_Instruction* instruction = &procedure->instructions.elements[i];
+        if (instruction->kind == Ir_Alloca) {
+            size += instruction->data.alloca.size;
+            size_t alignment = instruction->data.alloca.alignment;
+            size = (size + alignment - 1) / alignment * alignment;
+            alloca_offsets[i] = size;
+        }
+    }
+
+    state->frame.size = align_up(size, 16);
+
+    size_t arguments_home = state->register_call ? get_arguments_size(&state->generic) : 0;
+    emit_stack_adjust(state, Opcode_Sub, state->frame.size + arguments_home);
+    if (state->register_call) {
+        output_home_arguments_fasm_linux_x86_64(procedure->source, state);
+    }
+
+    size_t labels = state->flow_index;
+    state->flow_index += procedure->blocks.count;
+
+    for (size_t i = 0; i < procedure->blocks.count; i++) {
+        emit_flow_label(state, labels + i);
+
+        Ir_Block* block = &procedure->blocks.elements[i];
+        for (size_t j = 0; j < block->instructions.count; j++) {
+            output_ir_instruction_fasm_linux_x86_64(procedure, i, block->instructions.elements[j], alloca_offsets, labels, state);
+        }
+    }
+
+    free(alloca_offsets);
+}
+
+// optimizes the code since start once it is complete for the procedure, then encodes all of it for the elf backend or prints it for fasm
+void output_finish_procedure_fasm_linux_x86_64(size_t start, Output_State* state) {
+    if (state->options.peephole != NULL) {
+        peephole_optimize(&state->code, start, state->options.peephole);
+    }
+
+    for (size_t i = 0; i < state->code.count; i++) {
+        if (state->image != NULL) {
+            x86_64_encode_instruction(state->image, &state->code.elements[i]);
+        } else {
+            x86_64_append_instruction(&state->instructions, &state->code.elements[i]);
         }
     }
 
+    state->code.count = 0;
+    arena_reset(&state->code_arena);
+}
+
+void output_item_fasm_linux_x86_64(Ast_Item* item, Output_State* state) {
+    if (!is_item_output(item)) {
+        return;
+    }
+
     switch (item->kind) {
         case Item_Procedure: {
             // TODO: use some sort of annotation to specify entry procedure
@@ -1256,37 +2185,69 @@ void output_item_fasm_linux_x86_64(Ast_Item* item, Output_State* state) {
             state->generic.current_procedure = procedure;
 
             if (has_directive(&item->directives, Directive_Entry)) {
-                char buffer[128] = {};
-                sprintf(buffer, "_entry = %s\n", procedure->name);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                if (state->image != NULL) {
+                    array_x86_64_instruction_append(&state->code, x86_64_label_instruction("_entry"));
+                } else {
+                    state->label_name.count = 0;
+                    writer_format(&state->label_name, "_entry = %s", procedure->name);
+                    char* alias = arena_copy_string_length(&state->code_arena, state->label_name.elements, state->label_name.count);
+                    array_x86_64_instruction_append(&state->code, (X86_64_Instruction) { .kind = Instruction_Raw, .name = alias });
+                }
+            }
+
+            array_x86_64_instruction_append(&state->code, x86_64_label_instruction(procedure->name));
+
+            emit1(state, Opcode_Push, x86_64_register(REGISTER_RBP, 8));
+            emit2(state, Opcode_Mov, x86_64_register(REGISTER_RBP, 8), x86_64_register(REGISTER_RSP, 8));
+            state->stack_depth = 0;
+            state->stack_depth_known = true;
+
+            if (state->options.ir != NULL) {
+                Ir_Procedure* ir_procedure = &state->options.ir->elements[state->ir_index];
+                assert(ir_procedure->source == procedure);
+                state->ir_index++;
+
+                size_t start = state->code.count;
+                state->register_call = uses_register_call(procedure, state);
+                output_ir_procedure_fasm_linux_x86_64(ir_procedure, state);
+                output_finish_procedure_fasm_linux_x86_64(start, state);
+                break;
             }
 
-            char buffer[128] = {};
-            sprintf(buffer, "%s:\n", procedure->name);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            size_t start = state->code.count;
+
+            state->frame = frame_layout_new(procedure, &state->generic);
+            state->register_call = uses_register_call(procedure, state);
 
-            stringbuffer_appendstring(&state->instructions, "  push rbp\n");
-            stringbuffer_appendstring(&state->instructions, "  mov rbp, rsp\n");
+            size_t arguments_home = state->register_call ? get_arguments_size(&state->generic) : 0;
+            emit_stack_adjust(state, Opcode_Sub, state->frame.size + arguments_home);
 
-            size_t locals_size = get_locals_size(procedure, &state->generic);
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  sub rsp, %zu\n", locals_size);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            if (state->register_call) {
+                output_home_arguments_fasm_linux_x86_64(procedure, state);
+            }
 
             output_expression_fasm_linux_x86_64(procedure->body, state);
 
             if (procedure->has_implicit_return) {
                 output_actual_return_fasm_linux_x86_64(state);
             }
+            frame_layout_free(&state->frame);
+            output_finish_procedure_fasm_linux_x86_64(start, state);
             break;
         }
         case Item_Global: {
             Ast_Item_Global* global = &item->data.global;
             size_t size = get_size(&global->type, &state->generic);
+            size_t alignment = get_alignment(&global->type, &state->generic);
+
+            if (state->image != NULL) {
+                state->image->bss_size = align_up(state->image->bss_size, alignment);
+                x86_64_image_add_label(state->image, global->name, Section_Bss, state->image->bss_size);
+                state->image->bss_size += size;
+                break;
+            }
 
-            char buffer[128] = {};
-            sprintf(buffer, "%s: rb %zu\n", global->name, size);
-            stringbuffer_appendstring(&state->bss, buffer);
+            writer_format(&state->bss, "align %zu\n%s: rb %zu\n", alignment, global->name, size);
             break;
         }
         case Item_Constant:
@@ -1300,51 +2261,284 @@ void output_item_fasm_linux_x86_64(Ast_Item* item, Output_State* state) {
     }
 }
 
-void output_fasm_linux_x86_64(Program* program, char* output_file) {
-    Output_State state = (Output_State) {
+// calls the entry procedure with a pointer to the arguments, then every #exit procedure, and exits with 0
+// rsp starts out 16 byte aligned, so it is padded for the pushed pointer and kept in rbp, which every procedure restores
+void output_startup_fasm_linux_x86_64(Output_State* state) {
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RBP, 8), x86_64_register(REGISTER_RSP, 8));
+    emit2(state, Opcode_Lea, x86_64_register(REGISTER_RBX, 8), stack_top(8));
+    emit_stack_adjust(state, Opcode_Sub, 8);
+    emit1(state, Opcode_Push, x86_64_register(REGISTER_RBX, 8));
+    emit1(state, Opcode_Call, x86_64_label("_entry"));
+
+    for (size_t j = 0; j < state->generic.program->count; j++) {
+        Ast_File* file = &state->generic.program->elements[j];
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (item->kind == Item_Procedure && is_item_output(item) && has_directive(&item->directives, Directive_Exit)) {
+                emit2(state, Opcode_Mov, x86_64_register(REGISTER_RSP, 8), x86_64_register(REGISTER_RBP, 8));
+                emit1(state, Opcode_Call, x86_64_label(item->data.procedure.name));
+            }
+        }
+    }
+
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RAX, 8), x86_64_immediate(60));
+    emit2(state, Opcode_Mov, x86_64_register(REGISTER_RDI, 8), x86_64_immediate(0));
+    emit0(state, Opcode_Syscall);
+    output_finish_procedure_fasm_linux_x86_64(state->code.count, state);
+}
+
+Output_State output_state_new_fasm_linux_x86_64(Program* program, Symbol_Table* symbols, Fasm_Options options, FILE* file, X86_64_Image* image) {
+    return (Output_State) {
         .generic = (Generic_State) {
             .program = program,
+            .symbols = symbols,
             .current_file = NULL,
             .current_declares = {},
             .current_arguments = {},
             .in_reference = false,
         },
-        .instructions = stringbuffer_new(16384),
-        .data = stringbuffer_new(16384),
-        .bss = stringbuffer_new(16384),
+        .options = options,
+        .in_register_expression = false,
+        .register_instructions = array_register_instruction_new(16),
+        .code = array_x86_64_instruction_new(256),
+        .code_arena = arena_new("code"),
+        .label_name = writer_new(32, NULL),
+        .instructions = writer_new(4096, file),
+        .data = writer_new(1024, NULL),
+        .bss = writer_new(1024, NULL),
         .string_index = 0,
         .flow_index = 0,
         .while_index = array_size_new(4),
+        .stack_depth = 0,
+        .stack_depth_known = true,
+        .label_depths = array_size_new(16),
+        .ir_index = 0,
+        .image = image,
+    };
+}
+
+void output_state_free_fasm_linux_x86_64(Output_State* state) {
+    array_register_instruction_free(&state->register_instructions);
+    array_size_free(&state->while_index);
+    array_size_free(&state->label_depths);
+    writer_free(&state->instructions);
+    writer_free(&state->data);
+    writer_free(&state->bss);
+    array_x86_64_instruction_free(&state->code);
+    arena_free(&state->code_arena);
+    writer_free(&state->label_name);
+}
+
+// a procedure generated by itself on a worker thread, with its labels and strings numbered from zero
+typedef struct {
+    Output_State state;
+    Ast_Item* item;
+    Peephole_Stats peephole;
+    X86_64_Image image;
+} Procedure_Job;
+
+void run_procedure_job_fasm_linux_x86_64(void* data) {
+    Procedure_Job* job = data;
+    output_item_fasm_linux_x86_64(job->item, &job->state);
+}
+
+// puts a procedure encoded by itself after everything encoded so far
+void output_merge_image_fasm_linux_x86_64(X86_64_Image* image, X86_64_Image* other, Writer_Labels* labels, Writer* name) {
+    size_t bases[Section_Count] = { image->text.count, image->data.count, image->bss_size };
+
+    for (size_t i = 0; i < other->labels.count; i++) {
+        X86_64_Label* label = &other->labels.elements[i];
+        name->count = 0;
+        writer_append_labels(name, label->name, strlen(label->name) + 1, labels);
+        x86_64_image_add_label(image, name->elements, label->section, bases[label->section] + label->offset);
+    }
+
+    for (size_t i = 0; i < other->fixups.count; i++) {
+        X86_64_Fixup fixup = other->fixups.elements[i];
+        name->count = 0;
+        writer_append_labels(name, fixup.label, strlen(fixup.label), labels);
+        fixup.label = arena_copy_string_length(&image->names, name->elements, name->count);
+        fixup.offset += bases[Section_Text];
+        fixup.end += bases[Section_Text];
+        array_x86_64_fixup_append(&image->fixups, fixup);
+    }
+
+    stringbuffer_append_length(&image->text, other->text.elements, other->text.count);
+    stringbuffer_append_length(&image->data, other->data.elements, other->data.count);
+    image->bss_size += other->bss_size;
+}
+
+void output_program_fasm_linux_x86_64(Program* program, Output_State* state) {
+    compute_type_layouts(&state->generic);
+    if (state->options.register_calls) {
+        compute_address_taken(&state->generic);
+    }
+
+    size_t job_count = 0;
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file_node = &program->elements[j];
+        for (size_t i = 0; i < file_node->items.count; i++) {
+            Ast_Item* item = &file_node->items.elements[i];
+            if (item->kind == Item_Procedure && is_item_output(item)) {
+                job_count++;
+            }
+        }
+    }
+
+    // everything shared between procedures is only read from here on, so they are generated at the same time
+    Procedure_Job* jobs = malloc(sizeof(Procedure_Job) * (job_count > 0 ? job_count : 1));
+    Thread_Pool* pool = thread_pool_new(state->options.threads > 0 ? state->options.threads : 1);
+
+    size_t job_index = 0;
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file_node = &program->elements[j];
+        for (size_t i = 0; i < file_node->items.count; i++) {
+            Ast_Item* item = &file_node->items.elements[i];
+            if (item->kind != Item_Procedure || !is_item_output(item)) {
+                continue;
+            }
+
+            Procedure_Job* job = &jobs[job_index];
+            job->item = item;
+            job->peephole = (Peephole_Stats) {};
+
+            Fasm_Options options = state->options;
+            if (options.peephole != NULL) {
+                options.peephole = &job->peephole;
+            }
+
+            X86_64_Image* image = NULL;
+            if (state->image != NULL) {
+                job->image = x86_64_image_new();
+                image = &job->image;
+            }
+
+            job->state = output_state_new_fasm_linux_x86_64(program, state->generic.symbols, options, NULL, image);
+            job->state.generic.current_file = file_node;
+            // the ir has a procedure for every procedure that is output, in the same order
+            job->state.ir_index = job_index;
+
+            thread_pool_submit(pool, run_procedure_job_fasm_linux_x86_64, job);
+            job_index++;
+        }
+    }
+
+    thread_pool_wait(pool);
+    thread_pool_free(pool);
+
+    // put together in item order, the labels of every procedure continue from the ones before it
+    Writer_Labels labels = {
+        .flow_prefix = "__",
+        .flow_base = state->flow_index,
+        .string_prefix = "_",
+        .string_base = state->string_index,
     };
+    Writer name = writer_new(64, NULL);
 
+    job_index = 0;
     for (size_t j = 0; j < program->count; j++) {
         Ast_File* file_node = &program->elements[j];
-        state.generic.current_file = file_node;
+        state->generic.current_file = file_node;
 
         for (size_t i = 0; i < file_node->items.count; i++) {
             Ast_Item* item = &file_node->items.elements[i];
-            output_item_fasm_linux_x86_64(item, &state);
+            if (item->kind != Item_Procedure) {
+                output_item_fasm_linux_x86_64(item, state);
+                continue;
+            }
+            if (!is_item_output(item)) {
+                continue;
+            }
+
+            Procedure_Job* job = &jobs[job_index];
+            job_index++;
+
+            if (state->image != NULL) {
+                output_merge_image_fasm_linux_x86_64(state->image, &job->image, &labels, &name);
+                x86_64_image_free(&job->image);
+            } else {
+                writer_append_labels(&state->instructions, job->state.instructions.elements, job->state.instructions.count, &labels);
+                writer_append_labels(&state->data, job->state.data.elements, job->state.data.count, &labels);
+            }
+
+            labels.flow_base += job->state.flow_index;
+            labels.string_base += job->state.string_index;
+            if (state->options.peephole != NULL) {
+                peephole_add_stats(state->options.peephole, &job->peephole);
+            }
+
+            output_state_free_fasm_linux_x86_64(&job->state);
+            writer_commit(&state->instructions);
         }
     }
 
-    FILE* file = fopen(output_file, "w");
+    state->flow_index = labels.flow_base;
+    state->string_index = labels.string_base;
+    writer_free(&name);
+    free(jobs);
+}
 
-    fprintf(file, "format ELF64 executable\n");
-    fprintf(file, "segment readable executable\n");
-    fprintf(file, "  lea rbx, [rsp+8] \n");
-    fprintf(file, "  push rbx\n");
-    fprintf(file, "  call _entry\n");
-    fprintf(file, "  mov rax, 60\n");
-    fprintf(file, "  mov rdi, 0\n");
-    fprintf(file, "  syscall\n");
+void output_fasm_linux_x86_64(Program* program, Symbol_Table* symbols, Fasm_Options options, char* output_file) {
+    FILE* file = fopen(output_file, "w");
 
-    fwrite(state.instructions.elements, state.instructions.count, 1, file);
+    // procedures stream into the file as they are finished, data and bss follow them at the end
+    Output_State state = output_state_new_fasm_linux_x86_64(program, symbols, options, file, NULL);
+    writer_string(&state.instructions, "format ELF64 executable\n");
+    writer_string(&state.instructions, "segment readable executable\n");
+    output_startup_fasm_linux_x86_64(&state);
 
-    fprintf(file, "segment readable\n");
-    fwrite(state.data.elements, state.data.count, 1, file);
+    output_program_fasm_linux_x86_64(program, &state);
+    stats_add_section("text", ftell(file) + state.instructions.count);
+    stats_add_section("data", state.data.count);
+    stats_add_section("bss", state.bss.count);
 
-    fprintf(file, "segment readable writable\n");
-    fwrite(state.bss.elements, state.bss.count, 1, file);
+    writer_string(&state.instructions, "segment readable\n");
+    writer_append(&state.instructions, state.data.elements, state.data.count);
+    writer_string(&state.instructions, "segment readable writable\n");
+    writer_append(&state.instructions, state.bss.elements, state.bss.count);
+    writer_flush(&state.instructions);
 
     fclose(file);
+    output_state_free_fasm_linux_x86_64(&state);
+}
+
+void output_elf_linux_x86_64(Program* program, Symbol_Table* symbols, Fasm_Options options, char* output_file) {
+    X86_64_Image image = x86_64_image_new();
+    Output_State state = output_state_new_fasm_linux_x86_64(program, symbols, options, NULL, &image);
+
+    // the startup code goes first, the executable is entered at the start of the text
+    output_startup_fasm_linux_x86_64(&state);
+
+    output_program_fasm_linux_x86_64(program, &state);
+
+    // without an #entry procedure main is entered, like the self hosted elf backend does
+    X86_64_Label* entry = NULL;
+    X86_64_Label* main = NULL;
+    for (size_t i = 0; i < image.labels.count; i++) {
+        X86_64_Label* label = &image.labels.elements[i];
+        if (strcmp(label->name, "_entry") == 0) {
+            entry = label;
+        } else if (label->section == Section_Text && strcmp(label->name, "main") == 0) {
+            main = label;
+        }
+    }
+
+    if (entry == NULL) {
+        if (main == NULL) {
+            printf("Error: No procedure is marked with #entry and there is no main\n");
+            exit(1);
+        }
+        x86_64_image_add_label(&image, "_entry", Section_Text, main->offset);
+    }
+
+    stats_add_section("text", image.text.count);
+    stats_add_section("data", image.data.count);
+    stats_add_section("bss", image.bss_size);
+
+    long start = stats_now();
+    elf_write_executable(&image, output_file);
+    stats_add_phase(Phase_Write, start);
+
+    x86_64_image_free(&image);
+    output_state_free_fasm_linux_x86_64(&state);
 }
@@ -1,3 +1,20 @@
+#include "../ir.h"
 #include "../processor.h"
+#include "peephole.h"
 
-void output_fasm_linux_x86_64(Program* program, char* output_file);
+typedef struct {
+    // keep call free operator trees in registers instead of going through the stack
+    bool registers;
+    // pass arguments and the return value of directly called procedures in registers
+    bool register_calls;
+    // output procedures from their already built ir instead of walking their bodies
+    Ir_Program* ir;
+    // rewrite wasteful instruction sequences of every procedure and count them here, NULL leaves them as they are
+    Peephole_Stats* peephole;
+    // worker threads generating procedures at the same time
+    size_t threads;
+} Fasm_Options;
+
+void output_fasm_linux_x86_64(Program* program, Symbol_Table* symbols, Fasm_Options options, char* output_file);
+// same code generation, encoded straight into a static executable instead of fasm source
+void output_elf_linux_x86_64(Program* program, Symbol_Table* symbols, Fasm_Options options, char* output_file);
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "peephole.h"
+
+char* peephole_pattern_names[Peephole_Count] = {
+    "push pop",
+    "push pop move",
+    "stack adjust",
+    "store push",
+    "load push",
+    "immediate push",
+    "zero register",
+    "store load",
+    "move self",
+};
+
+// instructions that neither read nor write the flags
+bool flagless_opcodes[Opcode_Count] = {
+    [Opcode_Mov] = true, [Opcode_Movzx] = true, [Opcode_Lea] = true, [Opcode_Push] = true, [Opcode_Pop] = true, [Opcode_Movq] = true, [Opcode_Cvttsd2si] = true,
+    [Opcode_Addsd] = true, [Opcode_Subsd] = true, [Opcode_Mulsd] = true, [Opcode_Divsd] = true, [Opcode_Fld] = true, [Opcode_Fstp] = true, [Opcode_Fisttp] = true,
+};
+bool flag_writer_opcodes[Opcode_Count] = {
+    [Opcode_Add] = true, [Opcode_Sub] = true, [Opcode_And] = true, [Opcode_Or] = true, [Opcode_Xor] = true, [Opcode_Cmp] = true,
+    [Opcode_Test] = true, [Opcode_Mul] = true, [Opcode_Imul] = true, [Opcode_Div] = true, [Opcode_Ucomisd] = true, [Opcode_Fcomi] = true,
+};
+// instructions whose first operand is only written, so whatever it held before is dead
+bool move_opcodes[Opcode_Count] = { [Opcode_Mov] = true, [Opcode_Movzx] = true, [Opcode_Lea] = true, [Opcode_Movq] = true, [Opcode_Cvttsd2si] = true, [Opcode_Pop] = true };
+
+bool is_operation(X86_64_Instruction* instruction, X86_64_Opcode opcode, size_t operand_count) {
+    return instruction->kind == Instruction_Operation && instruction->operand_count == operand_count && instruction->opcode == opcode;
+}
+
+bool reads_flags(X86_64_Instruction* instruction) {
+    X86_64_Opcode opcode = instruction->opcode;
+    return x86_64_is_conditional(opcode, Opcode_Jo) || x86_64_is_conditional(opcode, Opcode_Seto) || x86_64_is_conditional(opcode, Opcode_Cmovo);
+}
+
+// whether the flags after index are always written before they are read, unknown instructions count as reads
+bool flags_dead_after(Array_X86_64_Instruction* instructions, size_t index) {
+    for (size_t i = index; i < instructions->count; i++) {
+        X86_64_Instruction* instruction = &instructions->elements[i];
+        if (instruction->kind != Instruction_Operation || reads_flags(instruction)) {
+            return false;
+        }
+
+        if (flag_writer_opcodes[instruction->opcode]) {
+            return true;
+        }
+        if (!flagless_opcodes[instruction->opcode]) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// whether the general register is overwritten before it is read after index, without leaving the straight line code
+bool register_dead_after(Array_X86_64_Instruction* instructions, size_t index, size_t number) {
+    for (size_t i = index; i < instructions->count; i++) {
+        X86_64_Instruction* instruction = &instructions->elements[i];
+        if (instruction->kind != Instruction_Operation) {
+            return false;
+        }
+
+        X86_64_Opcode opcode = instruction->opcode;
+        // string instructions use rcx, rsi and rdi without naming them
+        if (opcode == Opcode_Jmp || x86_64_is_conditional(opcode, Opcode_Jo) || opcode == Opcode_Call || opcode == Opcode_Ret || opcode == Opcode_Syscall || opcode == Opcode_Rep_Movsb || opcode == Opcode_Rep_Stosb) {
+            return false;
+        }
+
+        // one operand multiplies and divides use rax and rdx as well
+        if ((opcode == Opcode_Mul || opcode == Opcode_Div || opcode == Opcode_Imul) && instruction->operand_count == 1 && (number == 0 || number == 2)) {
+            return false;
+        }
+
+        bool moves = move_opcodes[opcode];
+        bool zeroes = opcode == Opcode_Xor && instruction->operand_count == 2 && x86_64_operand_equal(&instruction->operands[0], &instruction->operands[1]);
+
+        X86_64_Operand* first = &instruction->operands[0];
+        bool writes = (moves || zeroes) && instruction->operand_count >= 1 && first->kind == Operand_Register && first->data.register_.kind == Register_General && first->data.register_.number == number && first->data.register_.size >= 4;
+
+        for (size_t j = writes ? 1 : 0; j < instruction->operand_count; j++) {
+            if (!zeroes && x86_64_operand_uses_register(&instruction->operands[j], number)) {
+                return false;
+            }
+        }
+
+        if (writes) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_stack_adjust(X86_64_Instruction* instruction, long* amount) {
+    if (instruction->kind != Instruction_Operation || instruction->operand_count != 2) {
+        return false;
+    }
+
+    bool add = instruction->opcode == Opcode_Add;
+    if (!add && instruction->opcode != Opcode_Sub) {
+        return false;
+    }
+
+    if (!x86_64_is_general_register(&instruction->operands[0], 8) || instruction->operands[0].data.register_.number != REGISTER_RSP || instruction->operands[1].kind != Operand_Immediate) {
+        return false;
+    }
+
+    *amount = add ? (long) instruction->operands[1].data.immediate : -(long) instruction->operands[1].data.immediate;
+    return true;
+}
+
+bool is_stack_top(X86_64_Operand* operand) {
+    return operand->kind == Operand_Memory && (operand->size == 0 || operand->size == 8) &&
+        operand->data.memory.has_base && operand->data.memory.base.number == REGISTER_RSP && operand->data.memory.base.size == 8 &&
+        !operand->data.memory.has_index && operand->data.memory.label == NULL && operand->data.memory.displacement == 0;
+}
+
+bool fits_immediate(size_t value) {
+    return (long) value >= -2147483648l && (long) value <= 2147483647l;
+}
+
+// rewrites the window at index into output, returns how many instructions it consumed or 0 when nothing matched
+size_t apply_peephole(Array_X86_64_Instruction* input, size_t index, Array_X86_64_Instruction* output, Peephole_Stats* stats) {
+    X86_64_Instruction* first = &input->elements[index];
+    X86_64_Instruction* second = index + 1 < input->count ? &input->elements[index + 1] : NULL;
+    X86_64_Instruction* third = index + 2 < input->count ? &input->elements[index + 2] : NULL;
+    if (first->kind != Instruction_Operation) {
+        return 0;
+    }
+
+    if (is_operation(first, Opcode_Mov, 2) && x86_64_is_general_register(&first->operands[0], 8) && x86_64_operand_equal(&first->operands[0], &first->operands[1])) {
+        stats->hits[Peephole_Move_Self]++;
+        return 1;
+    }
+
+    if (second == NULL) {
+        return 0;
+    }
+
+    if (is_operation(first, Opcode_Push, 1) && is_operation(second, Opcode_Pop, 1) && x86_64_is_general_register(&second->operands[0], 8)) {
+        X86_64_Operand* source = &first->operands[0];
+        if (x86_64_operand_equal(source, &second->operands[0])) {
+            stats->hits[Peephole_Push_Pop]++;
+            return 2;
+        }
+
+        bool movable = x86_64_is_general_register(source, 8) || source->kind == Operand_Label || (source->kind == Operand_Immediate && fits_immediate(source->data.immediate));
+        if (movable) {
+            array_x86_64_instruction_append(output, x86_64_operation(Opcode_Mov, 2, second->operands[0], *source));
+            stats->hits[Peephole_Push_Pop_Move]++;
+            return 2;
+        }
+    }
+
+    long first_amount;
+    long second_amount;
+    if (is_stack_adjust(first, &first_amount)) {
+        if (is_stack_adjust(second, &second_amount) && flags_dead_after(input, index + 2)) {
+            long amount = first_amount + second_amount;
+            if (amount != 0) {
+                X86_64_Operand rsp = first->operands[0];
+                array_x86_64_instruction_append(output, x86_64_operation(amount > 0 ? Opcode_Add : Opcode_Sub, 2, rsp, x86_64_immediate(labs(amount))));
+            }
+            stats->hits[Peephole_Stack_Adjust]++;
+            return 2;
+        }
+
+        if (first_amount == 0 && flags_dead_after(input, index + 1)) {
+            stats->hits[Peephole_Stack_Adjust]++;
+            return 1;
+        }
+
+        if (first_amount == -8 && is_operation(second, Opcode_Mov, 2) && is_stack_top(&second->operands[0]) && x86_64_is_general_register(&second->operands[1], 8) &&
+                second->operands[1].data.register_.number != REGISTER_RSP && flags_dead_after(input, index + 2)) {
+            array_x86_64_instruction_append(output, x86_64_operation(Opcode_Push, 1, second->operands[1], (X86_64_Operand) {}));
+            stats->hits[Peephole_Store_Push]++;
+            return 2;
+        }
+
+        // the value is loaded without touching the stack, so the load can happen before the adjustment
+        if (first_amount == -8 && third != NULL && (is_operation(second, Opcode_Mov, 2) || is_operation(second, Opcode_Lea, 2)) && x86_64_is_general_register(&second->operands[0], 8) &&
+                second->operands[0].data.register_.number != REGISTER_RSP && !x86_64_operand_uses_register(&second->operands[1], REGISTER_RSP) &&
+                is_operation(third, Opcode_Mov, 2) && is_stack_top(&third->operands[0]) && x86_64_operand_equal(&third->operands[1], &second->operands[0]) &&
+                flags_dead_after(input, index + 3)) {
+            array_x86_64_instruction_append(output, *second);
+            array_x86_64_instruction_append(output, x86_64_operation(Opcode_Push, 1, second->operands[0], (X86_64_Operand) {}));
+            stats->hits[Peephole_Load_Push]++;
+            return 3;
+        }
+    }
+
+    if (is_operation(first, Opcode_Mov, 2) && x86_64_is_general_register(&first->operands[0], 8) && is_operation(second, Opcode_Push, 1) && x86_64_operand_equal(&first->operands[0], &second->operands[0])) {
+        X86_64_Operand* source = &first->operands[1];
+        bool pushable = (source->kind == Operand_Immediate && fits_immediate(source->data.immediate)) || source->kind == Operand_Label;
+        if (pushable && register_dead_after(input, index + 2, first->operands[0].data.register_.number)) {
+            array_x86_64_instruction_append(output, x86_64_operation(Opcode_Push, 1, *source, (X86_64_Operand) {}));
+            stats->hits[Peephole_Immediate_Push]++;
+            return 2;
+        }
+    }
+
+    if (is_operation(first, Opcode_Mov, 2) && first->operands[0].kind == Operand_Memory && first->operands[1].kind == Operand_Register &&
+            is_operation(second, Opcode_Mov, 2) && x86_64_operand_equal(&first->operands[0], &second->operands[1]) && x86_64_operand_equal(&first->operands[1], &second->operands[0]) &&
+            !x86_64_operand_uses_register(&first->operands[0], first->operands[1].data.register_.number)) {
+        array_x86_64_instruction_append(output, *first);
+        stats->hits[Peephole_Store_Load]++;
+        return 2;
+    }
+
+    if (is_operation(first, Opcode_Mov, 2) && (x86_64_is_general_register(&first->operands[0], 8) || x86_64_is_general_register(&first->operands[0], 4)) &&
+            first->operands[1].kind == Operand_Immediate && first->operands[1].data.immediate == 0 && flags_dead_after(input, index + 1)) {
+        X86_64_Operand destination = first->operands[0];
+        destination.data.register_.size = 4;
+        array_x86_64_instruction_append(output, x86_64_operation(Opcode_Xor, 2, destination, destination));
+        stats->hits[Peephole_Zero_Register]++;
+        return 1;
+    }
+
+    return 0;
+}
+
+// runs over the instructions from start until no pattern matches anymore, the ones before start are kept as they are
+void peephole_optimize(Array_X86_64_Instruction* instructions, size_t start, Peephole_Stats* stats) {
+    size_t original_count = instructions->count;
+    Array_X86_64_Instruction output = array_x86_64_instruction_new(instructions->count + 1);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        output.count = 0;
+        for (size_t i = 0; i < start; i++) {
+            array_x86_64_instruction_append(&output, instructions->elements[i]);
+        }
+
+        size_t i = start;
+        while (i < instructions->count) {
+            size_t consumed = apply_peephole(instructions, i, &output, stats);
+            if (consumed > 0) {
+                changed = true;
+                i += consumed;
+            } else {
+                array_x86_64_instruction_append(&output, instructions->elements[i]);
+                i++;
+            }
+        }
+
+        Array_X86_64_Instruction swap = *instructions;
+        *instructions = output;
+        output = swap;
+    }
+
+    array_x86_64_instruction_free(&output);
+    stats->removed += original_count - instructions->count;
+}
+
+void peephole_add_stats(Peephole_Stats* stats, Peephole_Stats* other) {
+    for (size_t i = 0; i < Peephole_Count; i++) {
+        stats->hits[i] += other->hits[i];
+    }
+    stats->removed += other->removed;
+}
+
+void peephole_print_stats(Peephole_Stats* stats) {
+    for (size_t i = 0; i < Peephole_Count; i++) {
+        printf("%s: %zu hits\n", peephole_pattern_names[i], stats->hits[i]);
+    }
+    printf("peephole: %zu instructions removed\n", stats->removed);
+}
@@ -0,0 +1,29 @@
+#ifndef PEEPHOLE__
+#define PEEPHOLE__
+
+#include "x86_64_instruction.h"
+
+typedef enum {
+    Peephole_Push_Pop,
+    Peephole_Push_Pop_Move,
+    Peephole_Stack_Adjust,
+    Peephole_Store_Push,
+    Peephole_Load_Push,
+    Peephole_Immediate_Push,
+    Peephole_Zero_Register,
+    Peephole_Store_Load,
+    Peephole_Move_Self,
+    Peephole_Count,
+} Peephole_Pattern;
+
+// how many times every pattern was rewritten, summed over everything optimized
+typedef struct {
+    size_t hits[Peephole_Count];
+    size_t removed;
+} Peephole_Stats;
+
+void peephole_optimize(Array_X86_64_Instruction* instructions, size_t start, Peephole_Stats* stats);
+void peephole_add_stats(Peephole_Stats* stats, Peephole_Stats* other);
+void peephole_print_stats(Peephole_Stats* stats);
+
+#endif
@@ -5,26 +5,60 @@
 #include <unistd.h>
 
 #include "qbe.h"
-#include "util.h"
+#include "writer.h"
 #include "x86_64_util.h"
 #include "../ast_walk.h"
+#include "../stats.h"
+#include "../thread_pool.h"
 
 typedef struct {
     Generic_State generic;
-    String_Buffer types;
-    String_Buffer instructions;
-    String_Buffer data;
-    String_Buffer bss;
+    Writer types;
+    Writer instructions;
+    Writer data;
+    Writer bss;
     size_t string_index;
     size_t flow_index;
     Array_Size while_index;
     size_t intermediate_index;
     Array_Size intermediate_stack;
+    // the alloc of every local in the procedure, made up front by collect_statement_locals_qbe
+    Array_Frame_Slot locals;
+    // alloc of each entry of current_declares, cut back with it at the end of every block
+    Array_Size local_locations;
+    Array_Size scopes;
     char* entry;
 } Output_State;
 
 void output_expression_qbe(Ast_Expression* expression, Output_State* state);
 
+size_t declare_local_qbe(Ast_Declaration* declaration, Output_State* state) {
+    size_t index = 0;
+    while (index < state->locals.count && state->locals.elements[index].declaration != declaration) {
+        index++;
+    }
+    assert(index < state->locals.count);
+
+    size_t location = state->locals.elements[index].location;
+    array_ast_declaration_append(&state->generic.current_declares, *declaration);
+    array_size_append(&state->local_locations, location);
+    return location;
+}
+
+Location_Size_Data get_local_location_size_qbe(char* name, Output_State* state) {
+    for (int i = state->generic.current_declares.count - 1; i >= 0; i--) {
+        Ast_Declaration* declaration = &state->generic.current_declares.elements[i];
+        if (strcmp(declaration->name, name) == 0) {
+            return (Location_Size_Data) {
+                .size = get_size(&declaration->type, &state->generic),
+                .location = state->local_locations.elements[i],
+            };
+        }
+    }
+
+    assert(false);
+}
+
 void output_actual_return_qbe(Output_State* state) {
     size_t size = 0;
     for (size_t i = 0; i < state->generic.current_returns.count; i++) {
@@ -33,54 +67,38 @@ void output_actual_return_qbe(Output_State* state) {
 
     if (size > 0) {
         size_t variable_pointer_intermediate = state->intermediate_index;
-        char buffer[128] = {};
-        sprintf(buffer, "  %%.%zu =l copy %%.r\n", state->intermediate_index);
-        stringbuffer_appendstring(&state->instructions, buffer);
+        writer_format(&state->instructions, "  %%.%zu =l copy %%.r\n", state->intermediate_index);
         state->intermediate_index++;
 
         size_t i = size;
         while (i > 0) {
             size_t temporary_pointer = state->intermediate_index;
 
-            char buffer[128] = {};
-            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
             state->intermediate_index++;
 
             if (i >= 8) {
-                char buffer[128] = {};
-                sprintf(buffer, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                 i -= 8;
             } else if (i >= 4) {
-                char buffer[128] = {};
-                sprintf(buffer, "  storew %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  storew %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                 i -= 4;
             } else if (i >= 2) {
-                char buffer[128] = {};
-                sprintf(buffer, "  storeh %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  storeh %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                 i -= 2;
             } else if (i >= 1) {
-                char buffer[128] = {};
-                sprintf(buffer, "  storeb %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  storeb %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                 i -= 1;
             }
         }
-        stringbuffer_appendstring(&state->instructions, "  ret %.r\n");
+        writer_string(&state->instructions, "  ret %.r\n");
 
-        memset(buffer, 0, 128);
-        sprintf(buffer, "  @__%zu\n", state->flow_index);
-        stringbuffer_appendstring(&state->instructions, buffer);
+        writer_format(&state->instructions, "  @.f%zu\n", state->flow_index);
         state->flow_index++;
     } else {
-        stringbuffer_appendstring(&state->instructions, "  ret\n");
+        writer_string(&state->instructions, "  ret\n");
 
-        char buffer[128] = {};
-        sprintf(buffer, "  @__%zu\n", state->flow_index);
-        stringbuffer_appendstring(&state->instructions, buffer);
+        writer_format(&state->instructions, "  @.f%zu\n", state->flow_index);
         state->flow_index++;
     }
 }
@@ -105,14 +123,12 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
                 output_expression_qbe(declare->expression, state);
 
                 for (int i = declare->declarations.count - 1; i >= 0; i--) {
-                    Ast_Declaration declaration = declare->declarations.elements[i];
-                    size_t location = state->generic.current_arguments.count + state->generic.current_declares.count;
-                    size_t size = get_size(&declaration.type, &state->generic);
+                    Ast_Declaration* declaration = &declare->declarations.elements[i];
+                    size_t location = declare_local_qbe(declaration, state);
+                    size_t size = get_size(&declaration->type, &state->generic);
 
                     size_t variable_pointer_intermediate = state->intermediate_index;
-                    char buffer[128] = {};
-                    sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location);
                     state->intermediate_index++;
 
                     Array_Size indexes = array_size_new(8);
@@ -140,40 +156,27 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
 
                         size_t temporary_pointer = state->intermediate_index;
 
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
                         state->intermediate_index++;
 
                         if (temp_size == 8) {
-                            char buffer[128] = {};
-                            sprintf(buffer, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (temp_size == 4) {
-                            char buffer[128] = {};
-                            sprintf(buffer, "  storew %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storew %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (temp_size == 2) {
-                            char buffer[128] = {};
-                            sprintf(buffer, "  storeh %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storeh %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (temp_size == 1) {
-                            char buffer[128] = {};
-                            sprintf(buffer, "  storeb %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storeb %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         }
                     }
-
-                    array_ast_declaration_append(&state->generic.current_declares, declaration);
                 }
             } else {
                 for (int i = declare->declarations.count - 1; i >= 0; i--) {
-                    Ast_Declaration declaration = declare->declarations.elements[i];
-                    array_ast_declaration_append(&state->generic.current_declares, declaration);
+                    declare_local_qbe(&declare->declarations.elements[i], state);
                 }
             }
             break;
@@ -208,15 +211,11 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
                     size_t variable_pointer_intermediate = array_size_pop(&state->intermediate_stack);
 
                     size_t index_offset_immediate = state->intermediate_index;
-                    char buffer[128] = {};
-                    sprintf(buffer, "  %%.%zu =l mul %%.%zu, %zu\n", index_offset_immediate, index_intermediate, size);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    writer_format(&state->instructions, "  %%.%zu =l mul %%.%zu, %zu\n", index_offset_immediate, index_intermediate, size);
                     state->intermediate_index++;
 
                     size_t index_offset_variable_immediate = state->intermediate_index;
-                    memset(buffer, 0, 128);
-                    sprintf(buffer, "  %%.%zu =l add %%.%zu, %%.%zu\n", index_offset_variable_immediate, variable_pointer_intermediate, index_offset_immediate);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %%.%zu\n", index_offset_variable_immediate, variable_pointer_intermediate, index_offset_immediate);
                     state->intermediate_index++;
 
                     size_t i = 0;
@@ -226,56 +225,40 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
 
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (i + 4 <= size) {
                             i += 4;
 
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =w add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =w add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (i + 2 <= size) {
                             i += 2;
 
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  storeh %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storeh %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (i + 1 <= size) {
                             i += 1;
 
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, size - i);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         }
                     }
@@ -303,42 +286,30 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
 
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (i + 4 <= location_size.size) {
                             i += 4;
 
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =w add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =w add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         } else if (i + 1 <= location_size.size) {
                             i += 1;
 
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                             state->intermediate_index++;
                         }
                     }
@@ -350,27 +321,10 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
                     if (has_local_variable(name, &state->generic)) {
                         found = true;
 
-                        Location_Size_Data location_size = { .location = state->generic.current_arguments.count };
-
-                        bool found = false;
-                        for (int i = state->generic.current_declares.count - 1; i >= 0; i--) {
-                            Ast_Declaration* declaration = &state->generic.current_declares.elements[i];
-                            size_t declaration_size = get_size(&declaration->type, &state->generic);
-
-                            if (found) {
-                                location_size.location += 1;
-                            }
-
-                            if (!found && strcmp(declaration->name, name) == 0) {
-                                location_size.size = declaration_size;
-                                found = true;
-                            }
-                        }
+                        Location_Size_Data location_size = get_local_location_size_qbe(name, state);
 
                         size_t variable_pointer_intermediate = state->intermediate_index;
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location_size.location);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location_size.location);
                         state->intermediate_index++;
 
                         Array_Size indexes = array_size_new(8);
@@ -398,50 +352,34 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
                             if (temp_size == 8) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                 state->intermediate_index++;
                             } else if (temp_size == 4) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                 state->intermediate_index++;
                             } else if (temp_size == 2) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  storeh %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  storeh %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                 state->intermediate_index++;
                             } else if (temp_size == 1) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - total);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                 state->intermediate_index++;
                             }
                         }
@@ -459,9 +397,7 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
                                     size_t size = get_size(&global->type, &state->generic);
 
                                     size_t variable_pointer_intermediate = state->intermediate_index;
-                                    char buffer[128] = {};
-                                    sprintf(buffer, "  %%.%zu =l copy $%s\n", state->intermediate_index, global->name);
-                                    stringbuffer_appendstring(&state->instructions, buffer);
+                                    writer_format(&state->instructions, "  %%.%zu =l copy $%s\n", state->intermediate_index, global->name);
                                     state->intermediate_index++;
 
                                     Array_Size indexes = array_size_new(8);
@@ -489,50 +425,34 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
                                         if (temp_size == 8) {
                                             size_t temporary_pointer = state->intermediate_index;
 
-                                            char buffer[128] = {};
-                                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
                                             state->intermediate_index++;
 
-                                            memset(buffer, 0, 128);
-                                            sprintf(buffer, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  storel %%.%zu, %%.%zu \n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                             state->intermediate_index++;
                                         } else if (temp_size == 4) {
                                             size_t temporary_pointer = state->intermediate_index;
 
-                                            char buffer[128] = {};
-                                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
                                             state->intermediate_index++;
 
-                                            memset(buffer, 0, 128);
-                                            sprintf(buffer, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  storew %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                             state->intermediate_index++;
                                         } else if (temp_size == 2) {
                                             size_t temporary_pointer = state->intermediate_index;
 
-                                            char buffer[128] = {};
-                                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
                                             state->intermediate_index++;
 
-                                            memset(buffer, 0, 128);
-                                            sprintf(buffer, "  storeh %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  storeh %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                             state->intermediate_index++;
                                         } else if (temp_size == 1) {
                                             size_t temporary_pointer = state->intermediate_index;
 
-                                            char buffer[128] = {};
-                                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - total);
                                             state->intermediate_index++;
 
-                                            memset(buffer, 0, 128);
-                                            sprintf(buffer, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  storeb %%.%zu, %%.%zu\n", array_size_pop(&state->intermediate_stack), temporary_pointer);
                                             state->intermediate_index++;
                                         }
                                     }
@@ -571,22 +491,16 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
             state->flow_index++;
 
             Ast_Statement_While* node = &statement->data.while_;
-            char buffer[128] = {};
-            sprintf(buffer, "  @__%zu\n", start);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  @.f%zu\n", start);
 
             output_expression_qbe(node->condition, state);
 
             size_t temp = state->flow_index;
             state->flow_index++;
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  jnz %%.%zu, @__%zu, @__%zu\n", array_size_pop(&state->intermediate_stack), temp, end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  jnz %%.%zu, @.f%zu, @.f%zu\n", array_size_pop(&state->intermediate_stack), temp, end);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  @__%zu\n", temp);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  @.f%zu\n", temp);
 
             array_size_append(&state->while_index, end);
 
@@ -594,19 +508,13 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
 
             state->while_index.count--;
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  jmp @__%zu\n", start);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  jmp @.f%zu\n", start);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  @__%zu\n", end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  @.f%zu\n", end);
             break;
         }
         case Statement_Break: {
-            char buffer[128] = {};
-            sprintf(buffer, "  jmp @__%zu\n", state->while_index.elements[state->while_index.count - 1]);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  jmp @.f%zu\n", state->while_index.elements[state->while_index.count - 1]);
             break;
         }
         default:
@@ -615,54 +523,42 @@ void output_statement_qbe(Ast_Statement* statement, Output_State* state) {
 }
 
 void output_raw_value_qbe(Ast_Type_Internal type, size_t value, Output_State* state) {
-    char buffer[128] = {};
     if (type == Type_UInt64 || type == Type_UInt) {
-        sprintf(buffer, "  %%.%zu =l copy %zu\n", state->intermediate_index, value);
+        writer_format(&state->instructions, "  %%.%zu =l copy %zu\n", state->intermediate_index, value);
     } else if (type == Type_Float64) {
-        sprintf(buffer, "  %%.%zu =l copy %zu\n", state->intermediate_index, value);
+        writer_format(&state->instructions, "  %%.%zu =l copy %zu\n", state->intermediate_index, value);
     } else if (type == Type_UInt32) {
-        sprintf(buffer, "  %%.%zu =w copy %zu\n", state->intermediate_index, value);
+        writer_format(&state->instructions, "  %%.%zu =w copy %zu\n", state->intermediate_index, value);
     } else if (type == Type_UInt16) {
-        sprintf(buffer, "  %%.%zu =w copy %zu\n", state->intermediate_index, value);
+        writer_format(&state->instructions, "  %%.%zu =w copy %zu\n", state->intermediate_index, value);
     } else if (type == Type_UInt8 || type == Type_Byte) {
-        sprintf(buffer, "  %%.%zu =w copy %zu\n", state->intermediate_index, value);
+        writer_format(&state->instructions, "  %%.%zu =w copy %zu\n", state->intermediate_index, value);
     } else {
         assert(false);
     }
-    stringbuffer_appendstring(&state->instructions, buffer);
     array_size_append(&state->intermediate_stack, state->intermediate_index);
     state->intermediate_index++;
 }
 
 void output_string_qbe(char* value, Output_State* state) {
-    char buffer[128] = {};
-    sprintf(buffer, "  %%.%zu =l copy $__%zu\n", state->intermediate_index,  state->string_index);
-    stringbuffer_appendstring(&state->instructions, buffer);
+    writer_format(&state->instructions, "  %%.%zu =l copy $.s%zu\n", state->intermediate_index,  state->string_index);
     array_size_append(&state->intermediate_stack, state->intermediate_index);
     state->intermediate_index++;
 
-    memset(buffer, 0, 128);
-    sprintf(buffer, "data $__%zu = {", state->string_index);
-    stringbuffer_appendstring(&state->data, buffer);
+    writer_format(&state->data, "data $.s%zu = {", state->string_index);
 
     size_t str_len = strlen(value);
     for (size_t i = 0; i < str_len; i++) {
-        char buffer[128] = {};
-        sprintf(buffer, "b %i,", (int) value[i]);
-        stringbuffer_appendstring(&state->data, buffer);
+        writer_format(&state->data, "b %i,", (int) value[i]);
     }
 
-    memset(buffer, 0, 128);
-    sprintf(buffer, "b 0 }\n");
-    stringbuffer_appendstring(&state->data, buffer);
+    writer_format(&state->data, "b 0 }\n");
 
     state->string_index++;
 }
 
 void output_boolean_qbe(bool value, Output_State* state) {
-    char buffer[128] = {};
-    sprintf(buffer, "  %%.%zu =w copy %i\n", state->intermediate_index, value);
-    stringbuffer_appendstring(&state->instructions, buffer);
+    writer_format(&state->instructions, "  %%.%zu =w copy %i\n", state->intermediate_index, value);
     array_size_append(&state->intermediate_stack, state->intermediate_index);
     state->intermediate_index++;
 }
@@ -671,16 +567,12 @@ void output_zeroes_qbe(size_t count, Output_State* state) {
     size_t i = 0;
     while (i < count) {
         if (i + 8 <= count) {
-            char buffer[128] = {};
-            sprintf(buffer, "  %%.%zu =l copy 0\n", state->intermediate_index);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  %%.%zu =l copy 0\n", state->intermediate_index);
             array_size_append(&state->intermediate_stack, state->intermediate_index);
             state->intermediate_index++;
             i += 8;
         } else {
-            char buffer[128] = {};
-            sprintf(buffer, "  %%.%zu =w copy 0\n", state->intermediate_index);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  %%.%zu =w copy 0\n", state->intermediate_index);
             array_size_append(&state->intermediate_stack, state->intermediate_index);
             state->intermediate_index++;
             i += 1;
@@ -694,9 +586,16 @@ void output_build_type_qbe(Ast_Expression_Build* build, Ast_Type* type_in, Outpu
         case Type_Struct: {
             Ast_Type_Struct* struct_ = &type.data.struct_;
             if (build->arguments.count == struct_->items.count) {
+                Type_Layout layout = get_layout(type_in, &state->generic);
+
                 for (size_t i = 0; i < struct_->items.count; i++) {
                     output_expression_qbe(build->arguments.elements[i], state);
+
+                    size_t end = i + 1 < struct_->items.count ? layout.offsets[i + 1] : layout.size;
+                    output_zeroes_qbe(end - (layout.offsets[i] + layout.sizes[i]), state);
                 }
+
+                layout_free_unnamed(&layout, type_in, &state->generic);
             }
             break;
         }
@@ -720,9 +619,14 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
     switch (expression->kind) {
         case Expression_Block: {
             Ast_Expression_Block* block = &expression->data.block;
+            array_size_append(&state->scopes, state->generic.current_declares.count);
             for (size_t i = 0; i < block->statements.count; i++) {
                 output_statement_qbe(block->statements.elements[i], state);
             }
+
+            size_t count = array_size_pop(&state->scopes);
+            state->generic.current_declares.count = count;
+            state->local_locations.count = count;
             break;
         }
         case Expression_Multiple: {
@@ -743,41 +647,52 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                 bool handled = false;
 
                 if (procedure->kind == Expression_Retrieve) {
-                    char* name = procedure->data.retrieve.data.identifier.name;
+                    Word_Id id = procedure->data.retrieve.kind == Retrieve_Assign_Identifier ? procedure->data.retrieve.data.identifier.id : Word_None;
 
-                    if (strncmp(name, "@syscall", 8) == 0) {
+                    if (id >= Intrinsic_Syscall0 && id <= Intrinsic_Syscall6) {
                         handled = true;
 
-                        size_t arg_count = (size_t) atoi(name + 8);
+                        size_t arg_count = id - Intrinsic_Syscall0;
 
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =l call $syscall(", state->intermediate_index);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =l call $syscall(", state->intermediate_index);
                         size_t syscall_result_intermediate = state->intermediate_index;
                         state->intermediate_index++;
 
                         for (size_t i = 0; i < arg_count + 1; i++) {
-                            char buffer[128] = {};
-                            sprintf(buffer, "l %%.%zu", array_size_get(&state->intermediate_stack, state->intermediate_stack.count - arg_count - 1 + i));
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "l %%.%zu", array_size_get(&state->intermediate_stack, state->intermediate_stack.count - arg_count - 1 + i));
 
                             if (i < arg_count) {
-                                stringbuffer_appendstring(&state->instructions, ",");
+                                writer_string(&state->instructions, ",");
                             }
                         }
 
                         state->intermediate_stack.count -= arg_count + 1;
 
-                        stringbuffer_appendstring(&state->instructions, ")\n");
+                        writer_string(&state->instructions, ")\n");
 
                         array_size_append(&state->intermediate_stack, syscall_result_intermediate);
                     }
+
+                    // the C library picks the best way to copy or set on the machine it runs on
+                    if (id == Intrinsic_Copy || id == Intrinsic_Set) {
+                        handled = true;
+
+                        size_t length = array_size_pop(&state->intermediate_stack);
+                        size_t second = array_size_pop(&state->intermediate_stack);
+                        size_t first = array_size_pop(&state->intermediate_stack);
+
+                        if (id == Intrinsic_Copy) {
+                            writer_format(&state->instructions, "  call $memcpy(l %%.%zu, l %%.%zu, l %%.%zu)\n", second, first, length);
+                        } else {
+                            writer_format(&state->instructions, "  call $memset(l %%.%zu, w %%.%zu, l %%.%zu)\n", first, second, length);
+                        }
+                    }
                 }
 
                 if (!handled) {
                     output_expression_qbe(procedure, state);
 
-                    stringbuffer_appendstring(&state->instructions, "  ");
+                    writer_string(&state->instructions, "  ");
 
                     Ast_Type_Procedure* procedure_type = &invoke->data.procedure.computed_procedure_type.data.procedure;
                     size_t returns_size = 0;
@@ -788,15 +703,11 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         }
 
                         return_intermediate = state->intermediate_index;
-                        char buffer[128] = {};
-                        sprintf(buffer, "%%.%zu =:.%zu ", return_intermediate, returns_size);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "%%.%zu =:.%zu ", return_intermediate, returns_size);
                         state->intermediate_index++;
                     }
 
-                    char buffer[128] = {};
-                    sprintf(buffer, "call %%.%zu(", array_size_pop(&state->intermediate_stack));
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    writer_format(&state->instructions, "call %%.%zu(", array_size_pop(&state->intermediate_stack));
 
                     Array_Size reversed = array_size_new(4);
                     for (size_t i = 0; i < procedure_type->arguments.count; i++) {
@@ -820,34 +731,28 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         size_t j = 0;
                         while (j < size) {
                             if (i > 0 || j > 0) {
-                                stringbuffer_appendstring(&state->instructions, ",");
+                                writer_string(&state->instructions, ",");
                             }
 
                             if (j + 8 <= size) {
                                 j += 8;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "l %%.%zu", array_size_pop(&reversed));
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "l %%.%zu", array_size_pop(&reversed));
                                 state->intermediate_index++;
                             } else if (j + 1 <= size) {
                                 j += 1;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "w %%.%zu", array_size_pop(&reversed));
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "w %%.%zu", array_size_pop(&reversed));
                                 state->intermediate_index++;
                             }
                         }
                     }
 
-                    stringbuffer_appendstring(&state->instructions, ")\n");
+                    writer_string(&state->instructions, ")\n");
 
                     if (procedure_type->returns.count > 0) {
                         size_t pointer_intermediate = state->intermediate_index;
-                        memset(buffer, 0, 128);
-                        sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, return_intermediate);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, return_intermediate);
                         state->intermediate_index++;
 
                         size_t size = returns_size;
@@ -857,28 +762,20 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                                 i -= 8;
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, pointer_intermediate, i);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, pointer_intermediate, i);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
                             } else if (i >= 1) {
                                 i -= 1;
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, pointer_intermediate, i);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, pointer_intermediate, i);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
                             }
@@ -896,164 +793,150 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
 
                         if (is_internal_type(Type_UInt64, &operator_type) || is_internal_type(Type_UInt, &operator_type)|| is_internal_type(Type_Ptr, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Add: {
-                                    sprintf(buffer, "  %%.%zu =l add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Subtract: {
-                                    sprintf(buffer, "  %%.%zu =l sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =l sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Multiply: {
-                                    sprintf(buffer, "  %%.%zu =l mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =l mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Divide: {
-                                    sprintf(buffer, "  %%.%zu =l udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =l udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Modulus: {
-                                    sprintf(buffer, "  %%.%zu =l urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =l urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_UInt32, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Add: {
-                                    sprintf(buffer, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Subtract: {
-                                    sprintf(buffer, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Multiply: {
-                                    sprintf(buffer, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Divide: {
-                                    sprintf(buffer, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Modulus: {
-                                    sprintf(buffer, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_UInt16, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Add: {
-                                    sprintf(buffer, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Subtract: {
-                                    sprintf(buffer, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Multiply: {
-                                    sprintf(buffer, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Divide: {
-                                    sprintf(buffer, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Modulus: {
-                                    sprintf(buffer, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_UInt8, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Add: {
-                                    sprintf(buffer, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Subtract: {
-                                    sprintf(buffer, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Multiply: {
-                                    sprintf(buffer, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Divide: {
-                                    sprintf(buffer, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Modulus: {
-                                    sprintf(buffer, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_Float64, &operator_type)) {
                             size_t input_intermediate1 = state->intermediate_index;
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =d cast %%.%zu\n", input_intermediate1, array_size_pop(&state->intermediate_stack));
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =d cast %%.%zu\n", input_intermediate1, array_size_pop(&state->intermediate_stack));
                             state->intermediate_index++;
 
                             size_t input_intermediate2 = state->intermediate_index;
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  %%.%zu =d cast %%.%zu\n", input_intermediate2, array_size_pop(&state->intermediate_stack));
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =d cast %%.%zu\n", input_intermediate2, array_size_pop(&state->intermediate_stack));
                             state->intermediate_index++;
 
                             size_t result_intermediate = state->intermediate_index;
-                            memset(buffer, 0, 128);
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Add: {
-                                    sprintf(buffer, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w add %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_Subtract: {
-                                    sprintf(buffer, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w sub %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_Multiply: {
-                                    sprintf(buffer, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w mul %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_Divide: {
-                                    sprintf(buffer, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w udiv %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_Modulus: {
-                                    sprintf(buffer, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w urem %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else {
@@ -1072,220 +955,202 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
 
                         if (is_internal_type(Type_UInt64, &operator_type) || is_internal_type(Type_UInt, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Equal: {
-                                    sprintf(buffer, "  %%.%zu =w ceql %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w ceql %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_NotEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cnel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cnel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Less: {
-                                    sprintf(buffer, "  %%.%zu =w cultl %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cultl %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_LessEqual: {
-                                    sprintf(buffer, "  %%.%zu =w culel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w culel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Greater: {
-                                    sprintf(buffer, "  %%.%zu =w cugtl %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugtl %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_GreaterEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cugel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_UInt32, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Equal: {
-                                    sprintf(buffer, "  %%.%zu =w ceqw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w ceqw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_NotEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cnew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cnew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Less: {
-                                    sprintf(buffer, "  %%.%zu =w cultw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cultw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_LessEqual: {
-                                    sprintf(buffer, "  %%.%zu =w culew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w culew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Greater: {
-                                    sprintf(buffer, "  %%.%zu =w cugtw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugtw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_GreaterEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cugew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_UInt16, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Equal: {
-                                    sprintf(buffer, "  %%.%zu =w ceqw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w ceqw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_NotEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cnew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cnew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Less: {
-                                    sprintf(buffer, "  %%.%zu =w cultw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cultw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_LessEqual: {
-                                    sprintf(buffer, "  %%.%zu =w culew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w culew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Greater: {
-                                    sprintf(buffer, "  %%.%zu =w cugtw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugtw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_GreaterEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cugew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_UInt8, &operator_type) || is_internal_type(Type_Byte, &operator_type)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Equal: {
-                                    sprintf(buffer, "  %%.%zu =w ceqw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w ceqw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_NotEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cnew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cnew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Less: {
-                                    sprintf(buffer, "  %%.%zu =w cultw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cultw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_LessEqual: {
-                                    sprintf(buffer, "  %%.%zu =w culew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w culew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_Greater: {
-                                    sprintf(buffer, "  %%.%zu =w cugtw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugtw %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_GreaterEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cugew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cugew %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_Float64, &operator_type)) {
                             size_t input_intermediate1 = state->intermediate_index;
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =d cast %%.%zu\n", input_intermediate1, array_size_pop(&state->intermediate_stack));
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =d cast %%.%zu\n", input_intermediate1, array_size_pop(&state->intermediate_stack));
                             state->intermediate_index++;
 
                             size_t input_intermediate2 = state->intermediate_index;
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  %%.%zu =d cast %%.%zu\n", input_intermediate2, array_size_pop(&state->intermediate_stack));
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =d cast %%.%zu\n", input_intermediate2, array_size_pop(&state->intermediate_stack));
                             state->intermediate_index++;
 
                             size_t result_intermediate = state->intermediate_index;
-                            memset(buffer, 0, 128);
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Equal: {
-                                    sprintf(buffer, "  %%.%zu =w ceqd %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w ceqd %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_NotEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cned %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w cned %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_Less: {
-                                    sprintf(buffer, "  %%.%zu =w cltd %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w cltd %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_LessEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cled %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w cled %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_Greater: {
-                                    sprintf(buffer, "  %%.%zu =w cgtd %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w cgtd %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 case Operator_GreaterEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cged %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
+                                    writer_format(&state->instructions, "  %%.%zu =w cged %%.%zu, %%.%zu\n", result_intermediate, input_intermediate2, input_intermediate1);
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_enum_type(&operator_type, &state->generic)) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Equal: {
-                                    sprintf(buffer, "  %%.%zu =w ceql %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w ceql %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_NotEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cnel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cnel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else if (is_internal_type(Type_Ptr, &operator_type) || operator_type.kind == Type_Pointer) {
                             size_t result_intermediate = state->intermediate_index;
-                            char buffer[128] = {};
                             switch (invoke->data.operator_.operator_) {
                                 case Operator_Equal: {
-                                    sprintf(buffer, "  %%.%zu =w ceql %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w ceql %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 case Operator_NotEqual: {
-                                    sprintf(buffer, "  %%.%zu =w cnel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
+                                    writer_format(&state->instructions, "  %%.%zu =w cnel %%.%zu, %%.%zu\n", result_intermediate, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                                     break;
                                 }
                                 default:
                                     assert(false);
                             }
-                            stringbuffer_appendstring(&state->instructions, buffer);
                             array_size_append(&state->intermediate_stack, result_intermediate);
                             state->intermediate_index++;
                         } else {
@@ -1295,25 +1160,19 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         break;
                     }
                     case Operator_And: {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =w and %%.%zu, %%.%zu\n", state->intermediate_index, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =w and %%.%zu, %%.%zu\n", state->intermediate_index, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                         array_size_append(&state->intermediate_stack, state->intermediate_index);
                         state->intermediate_index++;
                         break;
                     }
                     case Operator_Or: {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =w or %%.%zu, %%.%zu\n", state->intermediate_index, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =w or %%.%zu, %%.%zu\n", state->intermediate_index, array_size_pop(&state->intermediate_stack), array_size_pop(&state->intermediate_stack));
                         array_size_append(&state->intermediate_stack, state->intermediate_index);
                         state->intermediate_index++;
                         break;
                     }
                     case Operator_Not: {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =w ceqw 0, %%.%zu\n", state->intermediate_index, array_size_pop(&state->intermediate_stack));
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =w ceqw 0, %%.%zu\n", state->intermediate_index, array_size_pop(&state->intermediate_stack));
                         array_size_append(&state->intermediate_stack, state->intermediate_index);
                         state->intermediate_index++;
                         break;
@@ -1332,10 +1191,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
             bool found = false;
 
             if (!found && retrieve->kind == Retrieve_Assign_Identifier) {
-                if (strcmp(retrieve->data.identifier.name, "@file") == 0) {
+                if (retrieve->data.identifier.id == Intrinsic_File) {
                     output_string_qbe(retrieve->location.file, state);
                     found = true;
-                } else if (strcmp(retrieve->data.identifier.name, "@line") == 0) {
+                } else if (retrieve->data.identifier.id == Intrinsic_Line) {
                     output_raw_value_qbe(Type_UInt, retrieve->location.row, state);
                     found = true;
                 }
@@ -1365,15 +1224,11 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                 size_t variable_pointer_intermediate = array_size_pop(&state->intermediate_stack);
 
                 size_t index_offset_immediate = state->intermediate_index;
-                char buffer[128] = {};
-                sprintf(buffer, "  %%.%zu =l mul %%.%zu, %zu\n", index_offset_immediate, index_intermediate, element_size);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  %%.%zu =l mul %%.%zu, %zu\n", index_offset_immediate, index_intermediate, element_size);
                 state->intermediate_index++;
 
                 size_t index_offset_variable_immediate = state->intermediate_index;
-                memset(buffer, 0, 128);
-                sprintf(buffer, "  %%.%zu =l add %%.%zu, %%.%zu\n", index_offset_variable_immediate, variable_pointer_intermediate, index_offset_immediate);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %%.%zu\n", index_offset_variable_immediate, variable_pointer_intermediate, index_offset_immediate);
                 state->intermediate_index++;
 
                 if (in_reference) {
@@ -1384,14 +1239,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         if (i + 8 <= element_size) {
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, i);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, i);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  %%.%zu =l loadl %%.%zu\n", state->intermediate_index, temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l loadl %%.%zu\n", state->intermediate_index, temporary_pointer);
                             array_size_append(&state->intermediate_stack, state->intermediate_index);
                             state->intermediate_index++;
 
@@ -1399,14 +1250,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         } else if (i + 4 <= element_size) {
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =w add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, i);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =w add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, i);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  %%.%zu =w loadw %%.%zu\n", state->intermediate_index, temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =w loadw %%.%zu\n", state->intermediate_index, temporary_pointer);
                             array_size_append(&state->intermediate_stack, state->intermediate_index);
                             state->intermediate_index++;
 
@@ -1414,14 +1261,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         } else if (i + 1 <= element_size) {
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, i);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, index_offset_variable_immediate, i);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  %%.%zu =w loadub %%.%zu\n", state->intermediate_index, temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =w loadub %%.%zu\n", state->intermediate_index, temporary_pointer);
                             array_size_append(&state->intermediate_stack, state->intermediate_index);
                             state->intermediate_index++;
 
@@ -1448,9 +1291,7 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                 Location_Size_Data location_size = get_parent_item_location_size(&parent_type, retrieve->data.parent.name, &state->generic);
                 if (in_reference) {
                     size_t result_intermediate = state->intermediate_index;
-                    char buffer[128] = {};
-                    sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", result_intermediate, variable_pointer_intermediate, location_size.location);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", result_intermediate, variable_pointer_intermediate, location_size.location);
                     state->intermediate_index++;
 
                     array_size_append(&state->intermediate_stack, result_intermediate);
@@ -1460,14 +1301,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         if (i >= 8) {
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
                             array_size_append(&state->intermediate_stack, state->intermediate_index);
                             state->intermediate_index++;
 
@@ -1475,14 +1312,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         } else if (i >= 1) {
                             size_t temporary_pointer = state->intermediate_index;
 
-                            char buffer[128] = {};
-                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, location_size.size - i + location_size.location);
                             state->intermediate_index++;
 
-                            memset(buffer, 0, 128);
-                            sprintf(buffer, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
-                            stringbuffer_appendstring(&state->instructions, buffer);
+                            writer_format(&state->instructions, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
                             array_size_append(&state->intermediate_stack, state->intermediate_index);
                             state->intermediate_index++;
 
@@ -1497,27 +1330,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                 if (has_local_variable(name, &state->generic)) {
                     found = true;
 
-                    Location_Size_Data location_size = { .location = state->generic.current_arguments.count };
-
-                    bool found = false;
-                    for (int i = state->generic.current_declares.count - 1; i >= 0; i--) {
-                        Ast_Declaration* declaration = &state->generic.current_declares.elements[i];
-                        size_t declaration_size = get_size(&declaration->type, &state->generic);
-
-                        if (found) {
-                            location_size.location += 1;
-                        }
-
-                        if (!found && strcmp(declaration->name, name) == 0) {
-                            location_size.size = declaration_size;
-                            found = true;
-                        }
-                    }
+                    Location_Size_Data location_size = get_local_location_size_qbe(name, state);
 
                     size_t variable_pointer_intermediate = state->intermediate_index;
-                    char buffer[128] = {};
-                    sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", variable_pointer_intermediate, location_size.location);
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", variable_pointer_intermediate, location_size.location);
                     state->intermediate_index++;
 
                     if (consume_in_reference(&state->generic)) {
@@ -1542,27 +1358,19 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                             if (size_temp == 8) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
                             } else if (size_temp == 1) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
                             }
@@ -1595,16 +1403,12 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                     }
 
                     if (consume_in_reference(&state->generic)) {
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location_size.location);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location_size.location);
                         array_size_append(&state->intermediate_stack, state->intermediate_index);
                         state->intermediate_index++;
                     } else {
                         size_t variable_pointer_intermediate = state->intermediate_index;
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location_size.location);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", state->intermediate_index, location_size.location);
                         state->intermediate_index++;
 
                         size_t size = location_size.size;
@@ -1613,14 +1417,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                             if (i >= 8) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
 
@@ -1628,14 +1428,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                             } else if (i >= 4) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =w loadw %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =w loadw %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
 
@@ -1643,14 +1439,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                             } else if (i >= 2) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =w loadh %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =w loadh %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
 
@@ -1658,14 +1450,10 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                             } else if (i >= 1) {
                                 size_t temporary_pointer = state->intermediate_index;
 
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, size - i);
                                 state->intermediate_index++;
 
-                                memset(buffer, 0, 128);
-                                sprintf(buffer, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
 
@@ -1697,9 +1485,7 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                         found = true;
                         switch (item->kind) {
                             case Item_Procedure: {
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l copy $%s\n", state->intermediate_index, item->data.procedure.name);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l copy $%s\n", state->intermediate_index, item->data.procedure.name);
                                 array_size_append(&state->intermediate_stack, state->intermediate_index);
                                 state->intermediate_index++;
                                 break;
@@ -1707,9 +1493,7 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                             case Item_Global: {
                                 Ast_Item_Global* global = &item->data.global;
                                 size_t variable_pointer_intermediate = state->intermediate_index;
-                                char buffer[128] = {};
-                                sprintf(buffer, "  %%.%zu =l copy $%s\n", variable_pointer_intermediate, global->name);
-                                stringbuffer_appendstring(&state->instructions, buffer);
+                                writer_format(&state->instructions, "  %%.%zu =l copy $%s\n", variable_pointer_intermediate, global->name);
                                 state->intermediate_index++;
 
                                 if (consume_in_reference(&state->generic)) {
@@ -1735,27 +1519,19 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
                                         if (size_temp == 8) {
                                             size_t temporary_pointer = state->intermediate_index;
 
-                                            char buffer[128] = {};
-                                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
                                             state->intermediate_index++;
 
-                                            memset(buffer, 0, 128);
-                                            sprintf(buffer, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =l loadl %%.%zu \n", state->intermediate_index, temporary_pointer);
                                             array_size_append(&state->intermediate_stack, state->intermediate_index);
                                             state->intermediate_index++;
                                         } else if (size_temp == 1) {
                                             size_t temporary_pointer = state->intermediate_index;
 
-                                            char buffer[128] = {};
-                                            sprintf(buffer, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =l add %%.%zu, %zu\n", temporary_pointer, variable_pointer_intermediate, total);
                                             state->intermediate_index++;
 
-                                            memset(buffer, 0, 128);
-                                            sprintf(buffer, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
-                                            stringbuffer_appendstring(&state->instructions, buffer);
+                                            writer_format(&state->instructions, "  %%.%zu =w loadub %%.%zu \n", state->intermediate_index, temporary_pointer);
                                             array_size_append(&state->intermediate_stack, state->intermediate_index);
                                             state->intermediate_index++;
                                         }
@@ -1798,31 +1574,21 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
             size_t temp = state->flow_index;
             state->flow_index++;
 
-            char buffer[128] = {};
-            sprintf(buffer, "  jnz %%.%zu, @__%zu, @__%zu\n", array_size_pop(&state->intermediate_stack), temp, else_);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  jnz %%.%zu, @.f%zu, @.f%zu\n", array_size_pop(&state->intermediate_stack), temp, else_);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  @__%zu\n", temp);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  @.f%zu\n", temp);
 
             output_expression_qbe(node->if_expression, state);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  jmp @__%zu\n", end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  jmp @.f%zu\n", end);
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  @__%zu\n", else_);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  @.f%zu\n", else_);
 
             if (node->else_expression != NULL) {
                 output_expression_qbe(node->else_expression, state);
             }
 
-            memset(buffer, 0, 128);
-            sprintf(buffer, "  @__%zu\n", end);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "  @.f%zu\n", end);
             break;
         }
         case Expression_Number: {
@@ -1904,47 +1670,39 @@ void output_expression_qbe(Ast_Expression* expression, Output_State* state) {
 
                     size_t intermediate = state->intermediate_index;
                     state->intermediate_index++;
-                    char buffer[128] = {};
                     if (input_size == 8) {
-                        sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
+                        writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
                     } else if (input_size == 4) {
-                        sprintf(buffer, "  %%.%zu =l extuw %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
+                        writer_format(&state->instructions, "  %%.%zu =l extuw %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
                     } else if (input_size == 2) {
-                        sprintf(buffer, "  %%.%zu =l extuh %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
+                        writer_format(&state->instructions, "  %%.%zu =l extuh %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
                     } else if (input_size == 1) {
-                        sprintf(buffer, "  %%.%zu =l extub %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
+                        writer_format(&state->instructions, "  %%.%zu =l extub %%.%zu\n", intermediate, array_size_pop(&state->intermediate_stack));
                     }
-                    stringbuffer_appendstring(&state->instructions, buffer);
 
                     size_t output_size = get_size(&cast->type, &state->generic);
                     size_t output_intermediate = state->intermediate_index;
                     state->intermediate_index++;
 
-                    memset(buffer, 0, 128);
                     if (output_size == 8) {
-                        sprintf(buffer, "  %%.%zu =l copy %%.%zu\n", output_intermediate, intermediate);
+                        writer_format(&state->instructions, "  %%.%zu =l copy %%.%zu\n", output_intermediate, intermediate);
                     } else if (output_size == 4) {
-                        sprintf(buffer, "  %%.%zu =w copy %%.%zu\n", output_intermediate, intermediate);
+                        writer_format(&state->instructions, "  %%.%zu =w copy %%.%zu\n", output_intermediate, intermediate);
                     } else if (output_size == 2) {
-                        sprintf(buffer, "  %%.%zu =w copy %%.%zu\n", output_intermediate, intermediate);
+                        writer_format(&state->instructions, "  %%.%zu =w copy %%.%zu\n", output_intermediate, intermediate);
                     } else if (output_size == 1) {
-                        sprintf(buffer, "  %%.%zu =w copy %%.%zu\n", output_intermediate, intermediate);
+                        writer_format(&state->instructions, "  %%.%zu =w copy %%.%zu\n", output_intermediate, intermediate);
                     }
-                    stringbuffer_appendstring(&state->instructions, buffer);
                     array_size_append(&state->intermediate_stack, output_intermediate);
                 } else if (input_internal == Type_Float64 && output_internal == Type_UInt64) {
                     size_t input_intermediate = state->intermediate_index;
-                    char buffer[128] = {};
-                    sprintf(buffer, "  %%.%zu =d cast %%.%zu\n", input_intermediate, array_size_pop(&state->intermediate_stack));
-                    stringbuffer_appendstring(&state->instructions, buffer);
+                    writer_format(&state->instructions, "  %%.%zu =d cast %%.%zu\n", input_intermediate, array_size_pop(&state->intermediate_stack));
                     state->intermediate_index++;
 
                     size_t output_intermediate = state->intermediate_index;
-                    memset(buffer, 0, 128);
-                    sprintf(buffer, "  %%.%zu =l dtoui %%.%zu\n", output_intermediate, input_intermediate);
+                    writer_format(&state->instructions, "  %%.%zu =l dtoui %%.%zu\n", output_intermediate, input_intermediate);
                     array_size_append(&state->intermediate_stack, output_intermediate);
                     state->intermediate_index++;
-                    stringbuffer_appendstring(&state->instructions, buffer);
                 } else if (input.kind == Type_Internal && input.data.internal == Type_Byte && output.kind == Type_Internal && output.data.internal == Type_UInt8) {
                 } else if (input.kind == Type_Internal && input.data.internal == Type_UInt8 && output.kind == Type_Internal && output.data.internal == Type_Byte) {
                 } else {
@@ -1992,10 +1750,9 @@ void collect_statement_locals_qbe(Ast_Statement* statement, void* state_in) {
     switch (statement->kind) {
         case Statement_Declare: {
             for (size_t i = 0; i < statement->data.declare.declarations.count; i++) {
-                Ast_Type type = statement->data.declare.declarations.elements[i].type;
-                char buffer[128] = {};
-                sprintf(buffer, "  %%.%zu =l alloc8 %zu\n", state->state->intermediate_index, get_size(&type, &state->state->generic));
-                stringbuffer_appendstring(&state->state->instructions, buffer);
+                Ast_Declaration* declaration = &statement->data.declare.declarations.elements[i];
+                array_frame_slot_append(&state->state->locals, (Frame_Slot) { .declaration = declaration, .location = state->state->intermediate_index });
+                writer_format(&state->state->instructions, "  %%.%zu =l alloc8 %zu\n", state->state->intermediate_index, get_size(&declaration->type, &state->state->generic));
                 state->state->intermediate_index++;
             }
         }
@@ -2005,11 +1762,8 @@ void collect_statement_locals_qbe(Ast_Statement* statement, void* state_in) {
 }
 
 void output_item_qbe(Ast_Item* item, Output_State* state) {
-    if (has_directive(&item->directives, Directive_If)) {
-        Ast_Directive_If* if_node = &get_directive(&item->directives, Directive_If)->data.if_;
-        if (!if_node->result) {
-            return;
-        }
+    if (!is_item_output(item)) {
+        return;
     }
 
     switch (item->kind) {
@@ -2018,6 +1772,9 @@ void output_item_qbe(Ast_Item* item, Output_State* state) {
             Ast_Item_Procedure* procedure = &item->data.procedure;
 
             state->generic.current_declares = array_ast_declaration_new(4);
+            state->locals.count = 0;
+            state->local_locations.count = 0;
+            state->scopes.count = 0;
             state->generic.current_arguments = procedure->arguments;
             state->generic.current_returns = procedure->returns;
             state->generic.current_procedure = procedure;
@@ -2036,9 +1793,7 @@ void output_item_qbe(Ast_Item* item, Output_State* state) {
                     returns_size += get_size(procedure->returns.elements[i], &state->generic);
                 }
 
-                char buffer[128] = {};
-                sprintf(buffer, "type :.%zu = {", returns_size);
-                stringbuffer_appendstring(&state->types, buffer);
+                writer_format(&state->types, "type :.%zu = {", returns_size);
 
                 for (size_t i = 0; i < procedure->returns.count; i++) {
                     size_t return_size = get_size(procedure->returns.elements[i], &state->generic);
@@ -2046,33 +1801,29 @@ void output_item_qbe(Ast_Item* item, Output_State* state) {
                     size_t j = 0;
                     while (j < return_size) {
                         if (j != 0 || i != 0) {
-                            stringbuffer_appendstring(&state->types, ",");
+                            writer_string(&state->types, ",");
                         }
 
                         if (j + 8 <= return_size) {
-                            stringbuffer_appendstring(&state->types, "l");
+                            writer_string(&state->types, "l");
                             j += 8;
                         } else {
-                            stringbuffer_appendstring(&state->types, "b");
+                            writer_string(&state->types, "b");
                             j += 1;
                         }
                     }
                 }
 
-                stringbuffer_appendstring(&state->types, "}\n");
+                writer_string(&state->types, "}\n");
             }
 
 
-            stringbuffer_appendstring(&state->instructions, "export function ");
+            writer_string(&state->instructions, "export function ");
 
             if (has_returns) {
-                char buffer[128] = {};
-                sprintf(buffer, ":.%zu ", returns_size);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, ":.%zu ", returns_size);
             }
-            char buffer[128] = {};
-            sprintf(buffer, "$%s(", procedure->name);
-            stringbuffer_appendstring(&state->instructions, buffer);
+            writer_format(&state->instructions, "$%s(", procedure->name);
 
             size_t real_arg_index = 0;
             size_t temp_arg_index = 0;
@@ -2097,62 +1848,48 @@ void output_item_qbe(Ast_Item* item, Output_State* state) {
                 for (size_t j = 0; j < indexes.count; j++) {
                     size_t temp_size = indexes.elements[j];
                     if (j != 0 || i != 0) {
-                        stringbuffer_appendstring(&state->instructions, ", ");
+                        writer_string(&state->instructions, ", ");
                     }
 
                     if (temp_size == 8) {
-                        char buffer[128] = {};
-                        sprintf(buffer, "l %%.a%zu", temp_arg_index);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "l %%.a%zu", temp_arg_index);
                         temp_arg_index++;
                     } else {
-                        char buffer[128] = {};
-                        sprintf(buffer, "w %%.a%zu", temp_arg_index);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "w %%.a%zu", temp_arg_index);
                         temp_arg_index++;
                     }
                 }
             }
 
-            stringbuffer_appendstring(&state->instructions, ") {\n");
+            writer_string(&state->instructions, ") {\n");
 
-            stringbuffer_appendstring(&state->instructions, "@start\n");
+            writer_string(&state->instructions, "@start\n");
 
             real_arg_index = 0;
             for (size_t i = 0; i < procedure->arguments.count; i++) {
                 size_t arg_size = get_size(&procedure->arguments.elements[i].type, &state->generic);
 
                 size_t arg_local_intermediate = i;
-                char buffer[128] = {};
-                sprintf(buffer, "  %%.%zu =l alloc8 %zu\n", arg_local_intermediate, arg_size);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  %%.%zu =l alloc8 %zu\n", arg_local_intermediate, arg_size);
 
                 size_t temp_intermediate_index = 0;
                 size_t j = 0;
                 while (j < arg_size) {
                     if (j + 8 <= arg_size) {
                         size_t temporary_pointer = temp_intermediate_index;
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.i%zu =l add %%.%zu, %zu\n", temporary_pointer, arg_local_intermediate, j);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.i%zu =l add %%.%zu, %zu\n", temporary_pointer, arg_local_intermediate, j);
                         temp_intermediate_index++;
 
-                        memset(buffer, 0, 128);
-                        sprintf(buffer, "  storel %%.a%zu, %%.i%zu\n", real_arg_index, temporary_pointer);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  storel %%.a%zu, %%.i%zu\n", real_arg_index, temporary_pointer);
                         real_arg_index++;
 
                         j += 8;
                     } else {
                         size_t temporary_pointer = temp_intermediate_index;
-                        char buffer[128] = {};
-                        sprintf(buffer, "  %%.i%zu =l add %%.%zu, %zu\n", temporary_pointer, arg_local_intermediate, j);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  %%.i%zu =l add %%.%zu, %zu\n", temporary_pointer, arg_local_intermediate, j);
                         temp_intermediate_index++;
 
-                        memset(buffer, 0, 128);
-                        sprintf(buffer, "  storeb %%.a%zu, %%.i%zu\n", real_arg_index, temporary_pointer);
-                        stringbuffer_appendstring(&state->instructions, buffer);
+                        writer_format(&state->instructions, "  storeb %%.a%zu, %%.i%zu\n", real_arg_index, temporary_pointer);
                         real_arg_index++;
 
                         j += 1;
@@ -2168,9 +1905,7 @@ void output_item_qbe(Ast_Item* item, Output_State* state) {
                     returns_size += get_size(procedure->returns.elements[i], &state->generic);
                 }
 
-                char buffer[128] = {};
-                sprintf(buffer, "  %%.r =l alloc8 %zu\n", returns_size);
-                stringbuffer_appendstring(&state->instructions, buffer);
+                writer_format(&state->instructions, "  %%.r =l alloc8 %zu\n", returns_size);
             }
 
             Locals_Walk_State locals_state = {
@@ -2188,18 +1923,18 @@ void output_item_qbe(Ast_Item* item, Output_State* state) {
             if (procedure->has_implicit_return) {
                 output_actual_return_qbe(state);
             }
-            stringbuffer_appendstring(&state->instructions, "  ret\n");
+            writer_string(&state->instructions, "  ret\n");
 
-            stringbuffer_appendstring(&state->instructions, "}\n");
+            writer_string(&state->instructions, "}\n");
             break;
         }
         case Item_Global: {
             Ast_Item_Global* global = &item->data.global;
             size_t size = get_size(&global->type, &state->generic);
 
-            char buffer[128] = {};
-            sprintf(buffer, "data $%s = { z %zu }\n", global->name, size);
-            stringbuffer_appendstring(&state->bss, buffer);
+            size_t alignment = get_alignment(&global->type, &state->generic);
+
+            writer_format(&state->bss, "data $%s = align %zu { z %zu }\n", global->name, alignment, size);
             break;
         }
         case Item_Constant:
@@ -2213,49 +1948,168 @@ void output_item_qbe(Ast_Item* item, Output_State* state) {
     }
 }
 
-void output_qbe(Program* program, char* output_file) {
-    Output_State state = (Output_State) {
+Output_State output_state_new_qbe(Program* program, Symbol_Table* symbols) {
+    return (Output_State) {
         .generic = (Generic_State) {
             .program = program,
+            .symbols = symbols,
             .current_file = NULL,
             .current_declares = {},
             .current_arguments = {},
             .in_reference = false,
         },
-        .types = stringbuffer_new(16384),
-        .instructions = stringbuffer_new(16384),
-        .data = stringbuffer_new(16384),
-        .bss = stringbuffer_new(16384),
+        .types = writer_new(256, NULL),
+        .instructions = writer_new(4096, NULL),
+        .data = writer_new(1024, NULL),
+        .bss = writer_new(1024, NULL),
         .string_index = 0,
         .flow_index = 0,
         .intermediate_stack = array_size_new(16),
+        .locals = array_frame_slot_new(8),
+        .local_locations = array_size_new(8),
+        .scopes = array_size_new(4),
         .while_index = array_size_new(4),
     };
+}
+
+void output_state_free_qbe(Output_State* state) {
+    writer_free(&state->types);
+    writer_free(&state->instructions);
+    writer_free(&state->data);
+    writer_free(&state->bss);
+    array_size_free(&state->intermediate_stack);
+    array_frame_slot_free(&state->locals);
+    array_size_free(&state->local_locations);
+    array_size_free(&state->scopes);
+    array_size_free(&state->while_index);
+}
+
+// a procedure generated by itself on a worker thread, with its labels and strings numbered from zero
+typedef struct {
+    Output_State state;
+    Ast_Item* item;
+} Procedure_Job;
+
+void run_procedure_job_qbe(void* data) {
+    Procedure_Job* job = data;
+    output_item_qbe(job->item, &job->state);
+}
+
+void output_qbe(Program* program, Symbol_Table* symbols, size_t threads, char* output_file) {
+    Output_State state = output_state_new_qbe(program, symbols);
+
+    compute_type_layouts(&state.generic);
+
+    size_t job_count = 0;
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file_node = &program->elements[j];
+        for (size_t i = 0; i < file_node->items.count; i++) {
+            Ast_Item* item = &file_node->items.elements[i];
+            if (item->kind == Item_Procedure && is_item_output(item)) {
+                job_count++;
+            }
+        }
+    }
+
+    // everything shared between procedures is only read from here on, so they are generated at the same time
+    Procedure_Job* jobs = malloc(sizeof(Procedure_Job) * (job_count > 0 ? job_count : 1));
+    Thread_Pool* pool = thread_pool_new(threads > 0 ? threads : 1);
+
+    size_t job_index = 0;
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file_node = &program->elements[j];
+        for (size_t i = 0; i < file_node->items.count; i++) {
+            Ast_Item* item = &file_node->items.elements[i];
+            if (item->kind != Item_Procedure || !is_item_output(item)) {
+                continue;
+            }
+
+            Procedure_Job* job = &jobs[job_index];
+            job->item = item;
+            job->state = output_state_new_qbe(program, symbols);
+            job->state.generic.current_file = file_node;
+
+            thread_pool_submit(pool, run_procedure_job_qbe, job);
+            job_index++;
+        }
+    }
 
+    thread_pool_wait(pool);
+    thread_pool_free(pool);
+
+    // put together in item order, the labels of every procedure continue from the ones before it
+    Writer_Labels labels = {
+        .flow_prefix = "__",
+        .flow_base = 0,
+        .string_prefix = "__",
+        .string_base = 0,
+    };
+
+    job_index = 0;
     for (size_t j = 0; j < program->count; j++) {
         Ast_File* file_node = &program->elements[j];
         state.generic.current_file = file_node;
 
         for (size_t i = 0; i < file_node->items.count; i++) {
             Ast_Item* item = &file_node->items.elements[i];
-            output_item_qbe(item, &state);
+            if (item->kind != Item_Procedure) {
+                output_item_qbe(item, &state);
+                continue;
+            }
+            if (!is_item_output(item)) {
+                continue;
+            }
+
+            Procedure_Job* job = &jobs[job_index];
+            job_index++;
+
+            writer_append(&state.types, job->state.types.elements, job->state.types.count);
+            writer_append_labels(&state.instructions, job->state.instructions.elements, job->state.instructions.count, &labels);
+            writer_append_labels(&state.data, job->state.data.elements, job->state.data.count, &labels);
+            if (job->state.entry != NULL) {
+                state.entry = job->state.entry;
+            }
+
+            labels.flow_base += job->state.flow_index;
+            labels.string_base += job->state.string_index;
+            output_state_free_qbe(&job->state);
         }
     }
+    free(jobs);
 
-    FILE* file = fopen(output_file, "w");
+    stats_add_section("types", state.types.count);
+    stats_add_section("text", state.instructions.count);
+    stats_add_section("data", state.data.count);
+    stats_add_section("bss", state.bss.count);
 
-    fprintf(file, "export function $main(l %%.argc, l %%.argv) {\n");
-    fprintf(file, "@start\n");
-    fprintf(file, "  %%.argc2 =l copy %%.argc\n");
-    fprintf(file, "  call $%s(l %%.argc2, l %%.argv)\n", state.entry);
-    fprintf(file, "  ret\n");
-    fprintf(file, "}\n");
+    // the entry is only known once every item is output and types have to come before their uses, so the sections are kept until the end
+    FILE* file = fopen(output_file, "w");
+    Writer writer = writer_new(65536, file);
 
+    writer_string(&writer, "export function $main(l %.argc, l %.argv) {\n");
+    writer_string(&writer, "@start\n");
+    writer_string(&writer, "  %.argc2 =l copy %.argc\n");
+    writer_format(&writer, "  call $%s(l %%.argc2, l %%.argv)\n", state.entry);
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file = &program->elements[j];
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (item->kind == Item_Procedure && is_item_output(item) && has_directive(&item->directives, Directive_Exit)) {
+                writer_format(&writer, "  call $%s()\n", item->data.procedure.name);
+            }
+        }
+    }
+    writer_string(&writer, "  ret\n");
+    writer_string(&writer, "}\n");
 
-    fwrite(state.types.elements, state.types.count, 1, file);
-    fwrite(state.instructions.elements, state.instructions.count, 1, file);
-    fwrite(state.data.elements, state.data.count, 1, file);
-    fwrite(state.bss.elements, state.bss.count, 1, file);
+    Writer* sections[] = { &state.types, &state.instructions, &state.data, &state.bss };
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+        writer_append(&writer, sections[i]->elements, sections[i]->count);
+        writer_commit(&writer);
+    }
+    writer_flush(&writer);
 
     fclose(file);
+    writer_free(&writer);
+    output_state_free_qbe(&state);
 }
@@ -1,3 +1,4 @@
 #include "../processor.h"
 
-void output_qbe(Program* program, char* output_file);
+// procedures are generated on the given number of worker threads
+void output_qbe(Program* program, Symbol_Table* symbols, size_t threads, char* output_file);
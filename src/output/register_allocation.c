@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "register_allocation.h"
+
+Dynamic_Array_Impl(Live_Interval, Array_Live_Interval, array_live_interval_)
+
+size_t allocate_registers(Array_Live_Interval* intervals, size_t register_count) {
+    // owners[r] is the interval currently holding register r
+    size_t* owners = malloc(sizeof(size_t) * register_count);
+    for (size_t r = 0; r < register_count; r++) {
+        owners[r] = REGISTER_SPILLED;
+    }
+
+    size_t spill_count = 0;
+    for (size_t i = 0; i < intervals->count; i++) {
+        Live_Interval* current = &intervals->elements[i];
+
+        // an interval last read by this definition can hand its register over
+        for (size_t r = 0; r < register_count; r++) {
+            if (owners[r] != REGISTER_SPILLED && intervals->elements[owners[r]].end <= current->start) {
+                owners[r] = REGISTER_SPILLED;
+            }
+        }
+
+        size_t chosen = REGISTER_SPILLED;
+        if (current->hint != REGISTER_NO_HINT) {
+            size_t hinted = intervals->elements[current->hint].location;
+            if (hinted != REGISTER_SPILLED && owners[hinted] == REGISTER_SPILLED) {
+                chosen = hinted;
+            }
+        }
+        for (size_t r = 0; r < register_count && chosen == REGISTER_SPILLED; r++) {
+            if (owners[r] == REGISTER_SPILLED) {
+                chosen = r;
+            }
+        }
+
+        if (chosen == REGISTER_SPILLED) {
+            // evict whichever live interval is needed furthest in the future
+            size_t furthest = 0;
+            for (size_t r = 1; r < register_count; r++) {
+                if (intervals->elements[owners[r]].end > intervals->elements[owners[furthest]].end) {
+                    furthest = r;
+                }
+            }
+
+            Live_Interval* evicted = &intervals->elements[owners[furthest]];
+            if (evicted->end > current->end) {
+                evicted->location = REGISTER_SPILLED;
+                evicted->spill_slot = spill_count;
+                spill_count++;
+                chosen = furthest;
+            }
+        }
+
+        if (chosen == REGISTER_SPILLED) {
+            current->location = REGISTER_SPILLED;
+            current->spill_slot = spill_count;
+            spill_count++;
+        } else {
+            current->location = chosen;
+            owners[chosen] = i;
+        }
+    }
+
+    free(owners);
+    return spill_count;
+}
@@ -0,0 +1,27 @@
+#ifndef REGISTER_ALLOCATION__
+#define REGISTER_ALLOCATION__
+
+#include <stddef.h>
+
+#include "../dynamic_array.h"
+
+#define REGISTER_SPILLED ((size_t) -1)
+#define REGISTER_NO_HINT ((size_t) -1)
+
+// a virtual register is defined at start and last read at end
+typedef struct {
+    size_t start;
+    size_t end;
+    size_t hint;
+    size_t location;
+    size_t spill_slot;
+} Live_Interval;
+
+Dynamic_Array_Def(Live_Interval, Array_Live_Interval, array_live_interval_)
+
+// linear scan, intervals must be sorted by start
+// hint names another interval whose register is preferred when it is free
+// returns how many spill slots were handed out
+size_t allocate_registers(Array_Live_Interval* intervals, size_t register_count);
+
+#endif
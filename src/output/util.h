@@ -1,3 +0,0 @@
-#include "../ast.h"
-
-size_t get_length(Ast_Type* type);
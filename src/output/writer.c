@@ -0,0 +1,182 @@
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "writer.h"
+#include "../stats.h"
+
+#define WRITER_FLUSH_SIZE 65536
+
+Writer writer_new(size_t capacity, FILE* file) {
+    return (Writer) {
+        .elements = malloc(capacity),
+        .count = 0,
+        .capacity = capacity,
+        .file = file,
+    };
+}
+
+void writer_reserve(Writer* writer, size_t length) {
+    if (writer->count + length <= writer->capacity) {
+        return;
+    }
+
+    size_t capacity = writer->capacity * 2;
+    while (capacity < writer->count + length) {
+        capacity *= 2;
+    }
+    writer->elements = realloc(writer->elements, capacity);
+    writer->capacity = capacity;
+}
+
+void writer_append(Writer* writer, char* string, size_t length) {
+    writer_reserve(writer, length);
+    memcpy(writer->elements + writer->count, string, length);
+    writer->count += length;
+}
+
+void writer_string(Writer* writer, char* string) {
+    writer_append(writer, string, strlen(string));
+}
+
+void writer_character(Writer* writer, char character) {
+    writer_reserve(writer, 1);
+    writer->elements[writer->count] = character;
+    writer->count++;
+}
+
+void writer_unsigned(Writer* writer, size_t value) {
+    char digits[20];
+    size_t length = 0;
+    do {
+        length++;
+        digits[sizeof(digits) - length] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    writer_append(writer, digits + sizeof(digits) - length, length);
+}
+
+void writer_signed(Writer* writer, long value, bool explicit_sign) {
+    if (value < 0) {
+        writer_character(writer, '-');
+        writer_unsigned(writer, 0 - (size_t) value);
+        return;
+    }
+
+    if (explicit_sign) {
+        writer_character(writer, '+');
+    }
+    writer_unsigned(writer, value);
+}
+
+void writer_format(Writer* writer, char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+
+    char* start = format;
+    char* cursor = format;
+    while (*cursor != 0) {
+        if (*cursor != '%') {
+            cursor++;
+            continue;
+        }
+
+        writer_append(writer, start, cursor - start);
+        cursor++;
+
+        bool explicit_sign = *cursor == '+';
+        if (explicit_sign) {
+            cursor++;
+        }
+
+        switch (*cursor) {
+            case '%':
+                writer_character(writer, '%');
+                break;
+            case 's': {
+                // like printf, so output that used to go through it stays the same
+                char* string = va_arg(arguments, char*);
+                writer_string(writer, string != NULL ? string : "(null)");
+                break;
+            }
+            case 'c':
+                writer_character(writer, (char) va_arg(arguments, int));
+                break;
+            case 'i':
+                writer_signed(writer, va_arg(arguments, int), explicit_sign);
+                break;
+            case 'z':
+                cursor++;
+                assert(*cursor == 'u');
+                writer_unsigned(writer, va_arg(arguments, size_t));
+                break;
+            case 'l':
+                cursor++;
+                assert(*cursor == 'd');
+                writer_signed(writer, va_arg(arguments, long), explicit_sign);
+                break;
+            default:
+                assert(false);
+        }
+
+        cursor++;
+        start = cursor;
+    }
+    writer_append(writer, start, cursor - start);
+
+    va_end(arguments);
+}
+
+void writer_commit(Writer* writer) {
+    if (writer->file != NULL && writer->count >= WRITER_FLUSH_SIZE) {
+        writer_flush(writer);
+    }
+}
+
+void writer_flush(Writer* writer) {
+    if (writer->file == NULL) {
+        return;
+    }
+
+    long start = stats_now();
+    fwrite(writer->elements, 1, writer->count, writer->file);
+    writer->count = 0;
+    stats_add_phase(Phase_Write, start);
+}
+
+void writer_free(Writer* writer) {
+    free(writer->elements);
+}
+
+void writer_append_labels(Writer* writer, char* text, size_t length, Writer_Labels* labels) {
+    char* end = text + length;
+    char* start = text;
+    while (start < end) {
+        char* period = memchr(start, '.', end - start);
+        if (period == NULL) {
+            break;
+        }
+
+        char* cursor = period + 1;
+        if (cursor + 1 >= end || (*cursor != 'f' && *cursor != 's') || cursor[1] < '0' || cursor[1] > '9') {
+            writer_append(writer, start, cursor - start);
+            start = cursor;
+            continue;
+        }
+
+        bool flow = *cursor == 'f';
+        size_t number = 0;
+        cursor++;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            number = number * 10 + (*cursor - '0');
+            cursor++;
+        }
+
+        writer_append(writer, start, period - start);
+        writer_string(writer, flow ? labels->flow_prefix : labels->string_prefix);
+        writer_unsigned(writer, number + (flow ? labels->flow_base : labels->string_base));
+        start = cursor;
+    }
+    writer_append(writer, start, end - start);
+}
@@ -0,0 +1,42 @@
+#ifndef WRITER__
+#define WRITER__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// text output of the backends, appended in bulk and formatted without going through printf
+// committed text goes to the file once the buffer fills up, without a file everything stays in memory
+typedef struct {
+    char* elements;
+    size_t count;
+    size_t capacity;
+    FILE* file;
+} Writer;
+
+Writer writer_new(size_t capacity, FILE* file);
+void writer_append(Writer* writer, char* string, size_t length);
+void writer_string(Writer* writer, char* string);
+void writer_character(Writer* writer, char character);
+void writer_unsigned(Writer* writer, size_t value);
+void writer_signed(Writer* writer, long value, bool explicit_sign);
+// understands %s, %c, %i, %zu, %ld and %+ld, %% writes a single %
+void writer_format(Writer* writer, char* format, ...) __attribute__((format(printf, 2, 3)));
+// everything written so far is final and may be handed to the file
+void writer_commit(Writer* writer);
+void writer_flush(Writer* writer);
+void writer_free(Writer* writer);
+
+// procedures generated on their own number their flow labels .fN and their strings .sN from zero,
+// once they are put together in order the numbers continue from everything before them
+typedef struct {
+    char* flow_prefix;
+    size_t flow_base;
+    char* string_prefix;
+    size_t string_base;
+} Writer_Labels;
+
+// appends text with its private labels given their final names, nothing else output ever contains a period followed by f or s and digits
+void writer_append_labels(Writer* writer, char* text, size_t length, Writer_Labels* labels);
+
+#endif
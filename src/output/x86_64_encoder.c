@@ -0,0 +1,543 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "x86_64_encoder.h"
+
+Dynamic_Array_Impl(X86_64_Label, Array_X86_64_Label, array_x86_64_label_)
+Dynamic_Array_Impl(X86_64_Fixup, Array_X86_64_Fixup, array_x86_64_fixup_)
+
+// the opcode extension of two operand arithmetic, which also picks the register to register opcode
+size_t arithmetic_extensions[Opcode_Count] = { [Opcode_Add] = 0, [Opcode_Or] = 1, [Opcode_And] = 4, [Opcode_Sub] = 5, [Opcode_Xor] = 6, [Opcode_Cmp] = 7 };
+
+// one operand instructions sharing the f6 and f7 opcodes
+size_t unary_extensions[Opcode_Count] = { [Opcode_Not] = 2, [Opcode_Neg] = 3, [Opcode_Mul] = 4, [Opcode_Imul] = 5, [Opcode_Div] = 6, [Opcode_Idiv] = 7 };
+
+size_t scalar_double_opcodes[Opcode_Count] = { [Opcode_Addsd] = 0x58, [Opcode_Mulsd] = 0x59, [Opcode_Subsd] = 0x5c, [Opcode_Divsd] = 0x5e };
+
+// memory forms of the x87 arithmetic on a qword
+size_t float_extensions[Opcode_Count] = { [Opcode_Fadd] = 0, [Opcode_Fmul] = 1, [Opcode_Fsub] = 4, [Opcode_Fdiv] = 6 };
+
+X86_64_Image x86_64_image_new() {
+    return (X86_64_Image) {
+        .text = stringbuffer_new(4096),
+        .data = stringbuffer_new(256),
+        .bss_size = 0,
+        .labels = array_x86_64_label_new(16),
+        .fixups = array_x86_64_fixup_new(64),
+        .names = arena_new("image names"),
+    };
+}
+
+void x86_64_image_add_label(X86_64_Image* image, char* name, X86_64_Section section, size_t offset) {
+    char* copy = arena_copy_string_length(&image->names, name, strlen(name));
+    array_x86_64_label_append(&image->labels, (X86_64_Label) { .name = copy, .section = section, .offset = offset });
+}
+
+void x86_64_image_free(X86_64_Image* image) {
+    stringbuffer_free(&image->text);
+    stringbuffer_free(&image->data);
+    array_x86_64_label_free(&image->labels);
+    array_x86_64_fixup_free(&image->fixups);
+    arena_free(&image->names);
+}
+
+void emit_byte(X86_64_Image* image, size_t byte) {
+    stringbuffer_append(&image->text, (char) (byte & 0xff));
+}
+
+// little endian
+void emit_value(X86_64_Image* image, size_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        emit_byte(image, value >> (i * 8));
+    }
+}
+
+bool fits_byte(long value) {
+    return value >= -128 && value <= 127;
+}
+
+bool fits_dword(long value) {
+    return value >= -2147483648l && value <= 2147483647l;
+}
+
+void emit_fixup(X86_64_Image* image, char* label, long addend, bool relative) {
+    char* copy = arena_copy_string_length(&image->names, label, strlen(label));
+    array_x86_64_fixup_append(&image->fixups, (X86_64_Fixup) { .offset = image->text.count, .label = copy, .addend = addend, .relative = relative });
+    emit_value(image, 0, 4);
+}
+
+void encoding_error(X86_64_Instruction* instruction) {
+    printf("Error: Cannot encode instruction '%s'\n", instruction->kind == Instruction_Operation ? x86_64_opcode_names[instruction->opcode] : instruction->name);
+    exit(1);
+}
+
+bool is_general(X86_64_Operand* operand) {
+    return operand->kind == Operand_Register && operand->data.register_.kind == Register_General;
+}
+
+bool is_xmm(X86_64_Operand* operand) {
+    return operand->kind == Operand_Register && operand->data.register_.kind == Register_Xmm;
+}
+
+// spl, bpl, sil and dil can only be written with a rex prefix, without one they mean ah, ch, dh and bh
+bool needs_rex(X86_64_Operand* operand) {
+    return is_general(operand) && operand->data.register_.size == 1 && operand->data.register_.number >= 4 && operand->data.register_.number < 8;
+}
+
+size_t get_register_number(X86_64_Operand* operand) {
+    return operand->data.register_.number;
+}
+
+// size of the operation, taken from a general register or else from an explicitly sized operand
+size_t get_operation_size(X86_64_Instruction* instruction) {
+    for (size_t i = 0; i < instruction->operand_count; i++) {
+        if (is_general(&instruction->operands[i])) {
+            return instruction->operands[i].data.register_.size;
+        }
+    }
+    for (size_t i = 0; i < instruction->operand_count; i++) {
+        if (instruction->operands[i].size != 0) {
+            return instruction->operands[i].size;
+        }
+    }
+    encoding_error(instruction);
+    return 0;
+}
+
+// writes prefix, rex, opcode and the modrm with everything that follows it, reg is a register number or an opcode extension
+void emit_modrm(X86_64_Image* image, size_t prefix, bool wide, bool force_rex, size_t opcode, size_t opcode_length, size_t reg, X86_64_Operand* rm) {
+    size_t rex = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0);
+    if (rm->kind == Operand_Register) {
+        rex |= (get_register_number(rm) & 8) ? 0x01 : 0;
+    } else if (rm->kind == Operand_Memory) {
+        if (rm->data.memory.has_index) {
+            rex |= (rm->data.memory.index.number & 8) ? 0x02 : 0;
+        }
+        if (rm->data.memory.has_base) {
+            rex |= (rm->data.memory.base.number & 8) ? 0x01 : 0;
+        }
+    } else {
+        assert(false);
+    }
+
+    if (prefix != 0) {
+        emit_byte(image, prefix);
+    }
+    if (rex != 0x40 || force_rex) {
+        emit_byte(image, rex);
+    }
+    for (size_t i = opcode_length; i > 0; i--) {
+        emit_byte(image, opcode >> ((i - 1) * 8));
+    }
+
+    size_t reg_bits = (reg & 7) << 3;
+    if (rm->kind == Operand_Register) {
+        emit_byte(image, 0xc0 | reg_bits | (get_register_number(rm) & 7));
+        return;
+    }
+
+    char* label = rm->data.memory.label;
+    long displacement = rm->data.memory.displacement;
+    bool has_index = rm->data.memory.has_index;
+    size_t index = has_index ? rm->data.memory.index.number : 0;
+    assert(!has_index || index != REGISTER_RSP);
+
+    if (!rm->data.memory.has_base) {
+        if (label != NULL && !has_index) {
+            emit_byte(image, 0x05 | reg_bits);
+            emit_fixup(image, label, displacement, true);
+            return;
+        }
+
+        // absolute address through a sib without base
+        emit_byte(image, 0x04 | reg_bits);
+        emit_byte(image, (has_index ? (index & 7) << 3 : 0x20) | 0x05);
+        if (label != NULL) {
+            emit_fixup(image, label, displacement, false);
+        } else {
+            emit_value(image, displacement, 4);
+        }
+        return;
+    }
+
+    size_t base = rm->data.memory.base.number;
+    size_t mode;
+    if (label != NULL) {
+        mode = 0x80;
+    } else if (displacement == 0 && (base & 7) != 5) {
+        mode = 0x00;
+    } else if (fits_byte(displacement)) {
+        mode = 0x40;
+    } else {
+        mode = 0x80;
+    }
+
+    if (has_index || (base & 7) == REGISTER_RSP) {
+        emit_byte(image, mode | reg_bits | 0x04);
+        emit_byte(image, (has_index ? (index & 7) << 3 : 0x20) | (base & 7));
+    } else {
+        emit_byte(image, mode | reg_bits | (base & 7));
+    }
+
+    if (label != NULL) {
+        emit_fixup(image, label, displacement, false);
+    } else if (mode == 0x40) {
+        emit_value(image, displacement, 1);
+    } else if (mode == 0x80) {
+        emit_value(image, displacement, 4);
+    }
+}
+
+// the usual form of integer operations, with byte_opcode used for 8 bit operands
+void emit_sized(X86_64_Image* image, size_t size, bool force_rex, size_t byte_opcode, size_t opcode, size_t reg, X86_64_Operand* rm) {
+    emit_modrm(image, size == 2 ? 0x66 : 0, size == 8, force_rex, size == 1 ? byte_opcode : opcode, 1, reg, rm);
+}
+
+// immediates of qword operations are sign extended from a dword
+void emit_immediate(X86_64_Image* image, X86_64_Instruction* instruction, X86_64_Operand* operand, size_t size) {
+    if (operand->kind == Operand_Label) {
+        if (size < 4) {
+            encoding_error(instruction);
+        }
+        emit_fixup(image, operand->data.label, 0, false);
+        return;
+    }
+
+    assert(operand->kind == Operand_Immediate);
+    if (size == 8) {
+        if (!fits_dword((long) operand->data.immediate)) {
+            encoding_error(instruction);
+        }
+        size = 4;
+    }
+    emit_value(image, operand->data.immediate, size);
+}
+
+void encode_move(X86_64_Image* image, X86_64_Instruction* instruction, bool force_rex) {
+    X86_64_Operand* first = &instruction->operands[0];
+    X86_64_Operand* second = &instruction->operands[1];
+    size_t size = get_operation_size(instruction);
+
+    if (is_general(first) && (is_general(second) || second->kind == Operand_Memory)) {
+        emit_sized(image, size, force_rex, 0x8a, 0x8b, get_register_number(first), second);
+    } else if (first->kind == Operand_Memory && is_general(second)) {
+        emit_sized(image, size, force_rex, 0x88, 0x89, get_register_number(second), first);
+    } else if (is_general(first) && second->kind == Operand_Immediate) {
+        size_t number = get_register_number(first);
+        size_t value = second->data.immediate;
+
+        if (size == 8 && fits_dword((long) value) && (long) value < 0) {
+            emit_sized(image, size, force_rex, 0xc6, 0xc7, 0, first);
+            emit_value(image, value, 4);
+            return;
+        }
+
+        // writing the dword register clears the upper half, so unsigned dword values need no rex.w
+        bool wide = size == 8 && value > 0xffffffff;
+        if (size == 2) {
+            emit_byte(image, 0x66);
+        }
+        if (wide || (number & 8) || force_rex) {
+            emit_byte(image, 0x40 | (wide ? 0x08 : 0) | ((number & 8) ? 0x01 : 0));
+        }
+        emit_byte(image, (size == 1 ? 0xb0 : 0xb8) + (number & 7));
+        emit_value(image, value, wide ? 8 : size == 8 ? 4 : size);
+    } else if (second->kind == Operand_Immediate || second->kind == Operand_Label) {
+        emit_sized(image, size, force_rex, 0xc6, 0xc7, 0, first);
+        emit_immediate(image, instruction, second, size);
+    } else {
+        encoding_error(instruction);
+    }
+}
+
+void encode_arithmetic(X86_64_Image* image, X86_64_Instruction* instruction, size_t extension, bool force_rex) {
+    X86_64_Operand* first = &instruction->operands[0];
+    X86_64_Operand* second = &instruction->operands[1];
+    size_t size = get_operation_size(instruction);
+
+    if (second->kind == Operand_Immediate && size != 1 && fits_byte((long) second->data.immediate)) {
+        emit_sized(image, size, force_rex, 0x83, 0x83, extension, first);
+        emit_value(image, second->data.immediate, 1);
+    } else if (second->kind == Operand_Immediate || second->kind == Operand_Label) {
+        emit_sized(image, size, force_rex, 0x80, 0x81, extension, first);
+        emit_immediate(image, instruction, second, size);
+    } else if (is_general(second)) {
+        emit_sized(image, size, force_rex, extension * 8, extension * 8 + 1, get_register_number(second), first);
+    } else if (is_general(first)) {
+        emit_sized(image, size, force_rex, extension * 8 + 2, extension * 8 + 3, get_register_number(first), second);
+    } else {
+        encoding_error(instruction);
+    }
+}
+
+void encode_push_pop(X86_64_Image* image, X86_64_Instruction* instruction, bool push) {
+    X86_64_Operand* operand = &instruction->operands[0];
+    if (is_general(operand)) {
+        size_t number = get_register_number(operand);
+        if (number & 8) {
+            emit_byte(image, 0x41);
+        }
+        emit_byte(image, (push ? 0x50 : 0x58) + (number & 7));
+    } else if (operand->kind == Operand_Memory) {
+        emit_modrm(image, 0, false, false, push ? 0xff : 0x8f, 1, push ? 6 : 0, operand);
+    } else if (push && operand->kind == Operand_Immediate && fits_byte((long) operand->data.immediate)) {
+        emit_byte(image, 0x6a);
+        emit_value(image, operand->data.immediate, 1);
+    } else if (push && (operand->kind == Operand_Immediate || operand->kind == Operand_Label)) {
+        emit_byte(image, 0x68);
+        emit_immediate(image, instruction, operand, 8);
+    } else {
+        encoding_error(instruction);
+    }
+}
+
+// jumps and calls to labels always take a 32 bit displacement
+void encode_branch(X86_64_Image* image, X86_64_Instruction* instruction, size_t opcode, size_t opcode_length, size_t extension) {
+    X86_64_Operand* operand = &instruction->operands[0];
+    if (operand->kind == Operand_Label) {
+        emit_value(image, opcode >> 8, opcode_length - 1);
+        emit_byte(image, opcode);
+        emit_fixup(image, operand->data.label, 0, true);
+    } else if (extension != 0 && (is_general(operand) || operand->kind == Operand_Memory)) {
+        emit_modrm(image, 0, false, false, 0xff, 1, extension, operand);
+    } else {
+        encoding_error(instruction);
+    }
+}
+
+void encode_operation(X86_64_Image* image, X86_64_Instruction* instruction) {
+    X86_64_Opcode opcode = instruction->opcode;
+    size_t count = instruction->operand_count;
+    X86_64_Operand* first = &instruction->operands[0];
+    X86_64_Operand* second = &instruction->operands[1];
+    bool force_rex = (count >= 1 && needs_rex(first)) || (count >= 2 && needs_rex(second));
+
+    if (x86_64_is_conditional(opcode, Opcode_Jo) && count == 1) {
+        encode_branch(image, instruction, 0x0f80 + (opcode - Opcode_Jo), 2, 0);
+        return;
+    }
+    if (x86_64_is_conditional(opcode, Opcode_Seto) && count == 1) {
+        emit_modrm(image, 0, false, force_rex, 0x0f90 + (opcode - Opcode_Seto), 2, 0, first);
+        return;
+    }
+    if (x86_64_is_conditional(opcode, Opcode_Cmovo) && count == 2 && is_general(first)) {
+        size_t size = first->data.register_.size;
+        emit_modrm(image, size == 2 ? 0x66 : 0, size == 8, false, 0x0f40 + (opcode - Opcode_Cmovo), 2, get_register_number(first), second);
+        return;
+    }
+
+    switch (opcode) {
+        case Opcode_Ret:
+            if (count == 0) {
+                emit_byte(image, 0xc3);
+                return;
+            }
+            break;
+        case Opcode_Syscall:
+            if (count == 0) {
+                emit_byte(image, 0x0f);
+                emit_byte(image, 0x05);
+                return;
+            }
+            break;
+        case Opcode_Rep_Movsb:
+        case Opcode_Rep_Stosb:
+            if (count == 0) {
+                emit_byte(image, 0xf3);
+                emit_byte(image, opcode == Opcode_Rep_Movsb ? 0xa4 : 0xaa);
+                return;
+            }
+            break;
+        case Opcode_Push:
+        case Opcode_Pop:
+            if (count == 1) {
+                encode_push_pop(image, instruction, opcode == Opcode_Push);
+                return;
+            }
+            break;
+        case Opcode_Jmp:
+            if (count == 1) {
+                encode_branch(image, instruction, 0xe9, 1, 4);
+                return;
+            }
+            break;
+        case Opcode_Call:
+            if (count == 1) {
+                encode_branch(image, instruction, 0xe8, 1, 2);
+                return;
+            }
+            break;
+        case Opcode_Mov:
+            if (count == 2) {
+                encode_move(image, instruction, force_rex);
+                return;
+            }
+            break;
+        case Opcode_Add:
+        case Opcode_Or:
+        case Opcode_And:
+        case Opcode_Sub:
+        case Opcode_Xor:
+        case Opcode_Cmp:
+            if (count == 2) {
+                encode_arithmetic(image, instruction, arithmetic_extensions[opcode], force_rex);
+                return;
+            }
+            break;
+        case Opcode_Not:
+        case Opcode_Neg:
+        case Opcode_Mul:
+        case Opcode_Div:
+        case Opcode_Idiv:
+            if (count == 1) {
+                emit_sized(image, get_operation_size(instruction), force_rex, 0xf6, 0xf7, unary_extensions[opcode], first);
+                return;
+            }
+            break;
+        case Opcode_Imul:
+            if (count == 1) {
+                emit_sized(image, get_operation_size(instruction), force_rex, 0xf6, 0xf7, unary_extensions[opcode], first);
+                return;
+            }
+            // with an immediate it is the three operand form multiplying the register by itself
+            if (count == 2 && is_general(first) && second->kind == Operand_Immediate) {
+                size_t size = first->data.register_.size;
+                bool small = fits_byte((long) second->data.immediate);
+                emit_modrm(image, size == 2 ? 0x66 : 0, size == 8, false, small ? 0x6b : 0x69, 1, get_register_number(first), first);
+                emit_immediate(image, instruction, second, small ? 1 : size);
+                return;
+            }
+            if (count == 2 && is_general(first)) {
+                size_t size = first->data.register_.size;
+                emit_modrm(image, size == 2 ? 0x66 : 0, size == 8, false, 0x0faf, 2, get_register_number(first), second);
+                return;
+            }
+            break;
+        case Opcode_Lea:
+            if (count == 2 && is_general(first) && second->kind == Operand_Memory) {
+                emit_sized(image, first->data.register_.size, false, 0x8d, 0x8d, get_register_number(first), second);
+                return;
+            }
+            break;
+        case Opcode_Movzx:
+            if (count == 2 && is_general(first) && second->kind != Operand_Immediate) {
+                size_t source_size = is_general(second) ? second->data.register_.size : second->size;
+                size_t size = first->data.register_.size;
+                emit_modrm(image, size == 2 ? 0x66 : 0, size == 8, force_rex, source_size == 1 ? 0x0fb6 : 0x0fb7, 2, get_register_number(first), second);
+                return;
+            }
+            break;
+        case Opcode_Test:
+            if (count == 2 && is_general(second)) {
+                emit_sized(image, get_operation_size(instruction), force_rex, 0x84, 0x85, get_register_number(second), first);
+                return;
+            }
+            if (count == 2 && second->kind == Operand_Immediate) {
+                size_t size = get_operation_size(instruction);
+                emit_sized(image, size, force_rex, 0xf6, 0xf7, 0, first);
+                emit_immediate(image, instruction, second, size);
+                return;
+            }
+            break;
+        case Opcode_Fcomi:
+            if (count == 1 && first->kind == Operand_Register && first->data.register_.kind == Register_Float) {
+                emit_byte(image, 0xdb);
+                emit_byte(image, 0xf0 + first->data.register_.number);
+                return;
+            }
+            break;
+        case Opcode_Fld:
+            if (count == 1 && first->kind == Operand_Register && first->data.register_.kind == Register_Float) {
+                emit_byte(image, 0xd9);
+                emit_byte(image, 0xc0 + first->data.register_.number);
+                return;
+            }
+            if (count == 1 && first->kind == Operand_Memory) {
+                bool tword = first->size == 10;
+                emit_modrm(image, 0, false, false, tword ? 0xdb : 0xdd, 1, tword ? 5 : 0, first);
+                return;
+            }
+            break;
+        case Opcode_Fstp:
+            if (count == 1 && first->kind == Operand_Memory) {
+                bool tword = first->size == 10;
+                emit_modrm(image, 0, false, false, tword ? 0xdb : 0xdd, 1, tword ? 7 : 3, first);
+                return;
+            }
+            break;
+        case Opcode_Fisttp:
+            if (count == 1 && first->kind == Operand_Memory && first->size != 10) {
+                emit_modrm(image, 0, false, false, 0xdd, 1, 1, first);
+                return;
+            }
+            break;
+        case Opcode_Fadd:
+        case Opcode_Fsub:
+        case Opcode_Fmul:
+        case Opcode_Fdiv:
+            if (count == 1 && first->kind == Operand_Memory && first->size != 10) {
+                emit_modrm(image, 0, false, false, 0xdc, 1, float_extensions[opcode], first);
+                return;
+            }
+            break;
+        case Opcode_Movq:
+            if (count == 2 && is_xmm(first) && !is_xmm(second)) {
+                emit_modrm(image, 0x66, true, false, 0x0f6e, 2, get_register_number(first), second);
+                return;
+            }
+            if (count == 2 && is_xmm(second) && !is_xmm(first)) {
+                emit_modrm(image, 0x66, true, false, 0x0f7e, 2, get_register_number(second), first);
+                return;
+            }
+            break;
+        case Opcode_Addsd:
+        case Opcode_Subsd:
+        case Opcode_Mulsd:
+        case Opcode_Divsd:
+            if (count == 2 && is_xmm(first)) {
+                emit_modrm(image, 0xf2, false, false, 0x0f00 + scalar_double_opcodes[opcode], 2, get_register_number(first), second);
+                return;
+            }
+            break;
+        case Opcode_Ucomisd:
+            if (count == 2 && is_xmm(first)) {
+                emit_modrm(image, 0x66, false, false, 0x0f2e, 2, get_register_number(first), second);
+                return;
+            }
+            break;
+        case Opcode_Cvttsd2si:
+            if (count == 2 && is_general(first)) {
+                emit_modrm(image, 0xf2, first->data.register_.size == 8, false, 0x0f2c, 2, get_register_number(first), second);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    encoding_error(instruction);
+}
+
+void x86_64_encode_instruction(X86_64_Image* image, X86_64_Instruction* instruction) {
+    switch (instruction->kind) {
+        case Instruction_Label:
+            x86_64_image_add_label(image, instruction->name, Section_Text, image->text.count);
+            break;
+        case Instruction_Operation: {
+            size_t first_fixup = image->fixups.count;
+            encode_operation(image, instruction);
+
+            // immediates come after the displacement, so the end is only known now
+            for (size_t i = first_fixup; i < image->fixups.count; i++) {
+                image->fixups.elements[i].end = image->text.count;
+            }
+            break;
+        }
+        case Instruction_Raw:
+            encoding_error(instruction);
+            break;
+        default:
+            assert(false);
+    }
+}
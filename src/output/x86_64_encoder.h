@@ -0,0 +1,48 @@
+#ifndef X86_64_ENCODER__
+#define X86_64_ENCODER__
+
+#include "x86_64_instruction.h"
+
+typedef enum {
+    Section_Text,
+    Section_Data,
+    Section_Bss,
+    Section_Count,
+} X86_64_Section;
+
+typedef struct {
+    char* name;
+    X86_64_Section section;
+    size_t offset;
+} X86_64_Label;
+
+// a 4 byte field in the text waiting for the address of a label
+typedef struct {
+    size_t offset;
+    char* label;
+    long addend;
+    // relative fixups hold the distance from the end of their instruction, the others the absolute address
+    bool relative;
+    size_t end;
+} X86_64_Fixup;
+
+Dynamic_Array_Def(X86_64_Label, Array_X86_64_Label, array_x86_64_label_)
+Dynamic_Array_Def(X86_64_Fixup, Array_X86_64_Fixup, array_x86_64_fixup_)
+
+// machine code and data of a whole executable before labels are given addresses
+typedef struct {
+    String_Buffer text;
+    String_Buffer data;
+    size_t bss_size;
+    Array_X86_64_Label labels;
+    Array_X86_64_Fixup fixups;
+    // owns the names of labels and fixups
+    Arena names;
+} X86_64_Image;
+
+X86_64_Image x86_64_image_new();
+void x86_64_image_add_label(X86_64_Image* image, char* name, X86_64_Section section, size_t offset);
+void x86_64_encode_instruction(X86_64_Image* image, X86_64_Instruction* instruction);
+void x86_64_image_free(X86_64_Image* image);
+
+#endif
@@ -0,0 +1,248 @@
+#include <assert.h>
+
+#include "x86_64_instruction.h"
+
+Dynamic_Array_Impl(X86_64_Instruction, Array_X86_64_Instruction, array_x86_64_instruction_)
+
+char* x86_64_opcode_names[Opcode_Count] = {
+    [Opcode_Mov] = "mov", [Opcode_Movzx] = "movzx", [Opcode_Lea] = "lea", [Opcode_Push] = "push", [Opcode_Pop] = "pop", [Opcode_Add] = "add",
+    [Opcode_Or] = "or", [Opcode_And] = "and", [Opcode_Sub] = "sub", [Opcode_Xor] = "xor", [Opcode_Cmp] = "cmp", [Opcode_Test] = "test",
+    [Opcode_Not] = "not", [Opcode_Neg] = "neg", [Opcode_Mul] = "mul", [Opcode_Imul] = "imul", [Opcode_Div] = "div", [Opcode_Idiv] = "idiv",
+    [Opcode_Jmp] = "jmp", [Opcode_Call] = "call", [Opcode_Ret] = "ret", [Opcode_Syscall] = "syscall",
+    [Opcode_Rep_Movsb] = "rep movsb", [Opcode_Rep_Stosb] = "rep stosb",
+    [Opcode_Jo] = "jo", [Opcode_Jno] = "jno", [Opcode_Jb] = "jb", [Opcode_Jae] = "jae",
+    [Opcode_Je] = "je", [Opcode_Jne] = "jne", [Opcode_Jbe] = "jbe", [Opcode_Ja] = "ja",
+    [Opcode_Js] = "js", [Opcode_Jns] = "jns", [Opcode_Jp] = "jp", [Opcode_Jnp] = "jnp",
+    [Opcode_Jl] = "jl", [Opcode_Jge] = "jge", [Opcode_Jle] = "jle", [Opcode_Jg] = "jg",
+    [Opcode_Seto] = "seto", [Opcode_Setno] = "setno", [Opcode_Setb] = "setb", [Opcode_Setae] = "setae",
+    [Opcode_Sete] = "sete", [Opcode_Setne] = "setne", [Opcode_Setbe] = "setbe", [Opcode_Seta] = "seta",
+    [Opcode_Sets] = "sets", [Opcode_Setns] = "setns", [Opcode_Setp] = "setp", [Opcode_Setnp] = "setnp",
+    [Opcode_Setl] = "setl", [Opcode_Setge] = "setge", [Opcode_Setle] = "setle", [Opcode_Setg] = "setg",
+    [Opcode_Cmovo] = "cmovo", [Opcode_Cmovno] = "cmovno", [Opcode_Cmovb] = "cmovb", [Opcode_Cmovae] = "cmovae",
+    [Opcode_Cmove] = "cmove", [Opcode_Cmovne] = "cmovne", [Opcode_Cmovbe] = "cmovbe", [Opcode_Cmova] = "cmova",
+    [Opcode_Cmovs] = "cmovs", [Opcode_Cmovns] = "cmovns", [Opcode_Cmovp] = "cmovp", [Opcode_Cmovnp] = "cmovnp",
+    [Opcode_Cmovl] = "cmovl", [Opcode_Cmovge] = "cmovge", [Opcode_Cmovle] = "cmovle", [Opcode_Cmovg] = "cmovg",
+    [Opcode_Fld] = "fld", [Opcode_Fstp] = "fstp", [Opcode_Fisttp] = "fisttp", [Opcode_Fcomi] = "fcomi", [Opcode_Fadd] = "fadd", [Opcode_Fsub] = "fsub", [Opcode_Fmul] = "fmul", [Opcode_Fdiv] = "fdiv",
+    [Opcode_Movq] = "movq", [Opcode_Addsd] = "addsd", [Opcode_Subsd] = "subsd", [Opcode_Mulsd] = "mulsd", [Opcode_Divsd] = "divsd",
+    [Opcode_Ucomisd] = "ucomisd", [Opcode_Cvttsd2si] = "cvttsd2si",
+};
+
+char* general_register_names[16][4] = {
+    { "rax", "eax", "ax", "al" },
+    { "rcx", "ecx", "cx", "cl" },
+    { "rdx", "edx", "dx", "dl" },
+    { "rbx", "ebx", "bx", "bl" },
+    { "rsp", "esp", "sp", "spl" },
+    { "rbp", "ebp", "bp", "bpl" },
+    { "rsi", "esi", "si", "sil" },
+    { "rdi", "edi", "di", "dil" },
+    { "r8", "r8d", "r8w", "r8b" },
+    { "r9", "r9d", "r9w", "r9b" },
+    { "r10", "r10d", "r10w", "r10b" },
+    { "r11", "r11d", "r11w", "r11b" },
+    { "r12", "r12d", "r12w", "r12b" },
+    { "r13", "r13d", "r13w", "r13b" },
+    { "r14", "r14d", "r14w", "r14b" },
+    { "r15", "r15d", "r15w", "r15b" },
+};
+
+char* size_names[] = { NULL, "byte", "word", NULL, "dword", NULL, NULL, NULL, "qword", NULL, "tword" };
+
+void append_register(Writer* writer, X86_64_Register* register_) {
+    switch (register_->kind) {
+        case Register_General: {
+            size_t index = register_->size == 8 ? 0 : register_->size == 4 ? 1 : register_->size == 2 ? 2 : 3;
+            writer_string(writer, general_register_names[register_->number][index]);
+            break;
+        }
+        case Register_Xmm:
+            writer_string(writer, "xmm");
+            writer_unsigned(writer, register_->number);
+            break;
+        case Register_Float:
+            writer_string(writer, "st");
+            writer_unsigned(writer, register_->number);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void append_operand(Writer* writer, X86_64_Operand* operand) {
+    if (operand->size != 0) {
+        writer_string(writer, size_names[operand->size]);
+        writer_character(writer, ' ');
+    }
+
+    switch (operand->kind) {
+        case Operand_Register:
+            append_register(writer, &operand->data.register_);
+            break;
+        case Operand_Immediate:
+            // negative immediates are written signed, the way fasm expects them
+            if ((long) operand->data.immediate < 0) {
+                writer_signed(writer, (long) operand->data.immediate, false);
+            } else {
+                writer_unsigned(writer, operand->data.immediate);
+            }
+            break;
+        case Operand_Label:
+            writer_string(writer, operand->data.label);
+            break;
+        case Operand_Memory: {
+            writer_character(writer, '[');
+            bool first = true;
+            if (operand->data.memory.label != NULL) {
+                writer_string(writer, operand->data.memory.label);
+                first = false;
+            }
+            if (operand->data.memory.has_base) {
+                append_register(writer, &operand->data.memory.base);
+                first = false;
+            }
+            if (operand->data.memory.has_index) {
+                writer_character(writer, '+');
+                append_register(writer, &operand->data.memory.index);
+            }
+            if (operand->data.memory.displacement != 0 || first) {
+                writer_signed(writer, operand->data.memory.displacement, !first);
+            }
+            writer_character(writer, ']');
+            break;
+        }
+        default:
+            assert(false);
+    }
+}
+
+void x86_64_append_instruction(Writer* writer, X86_64_Instruction* instruction) {
+    switch (instruction->kind) {
+        case Instruction_Operation:
+            writer_string(writer, "  ");
+            writer_string(writer, x86_64_opcode_names[instruction->opcode]);
+            for (size_t i = 0; i < instruction->operand_count; i++) {
+                writer_string(writer, i == 0 ? " " : ", ");
+                append_operand(writer, &instruction->operands[i]);
+            }
+            break;
+        case Instruction_Label:
+            writer_string(writer, "  ");
+            writer_string(writer, instruction->name);
+            writer_character(writer, ':');
+            break;
+        case Instruction_Raw:
+            writer_string(writer, instruction->name);
+            break;
+        default:
+            assert(false);
+    }
+    writer_character(writer, '\n');
+}
+
+bool x86_64_is_conditional(X86_64_Opcode opcode, X86_64_Opcode family) {
+    return opcode >= family && opcode < family + X86_64_CONDITION_COUNT;
+}
+
+X86_64_Instruction x86_64_operation(X86_64_Opcode opcode, size_t operand_count, X86_64_Operand first, X86_64_Operand second) {
+    return (X86_64_Instruction) { .kind = Instruction_Operation, .opcode = opcode, .operand_count = operand_count, .operands = { first, second } };
+}
+
+X86_64_Instruction x86_64_label_instruction(char* name) {
+    return (X86_64_Instruction) { .kind = Instruction_Label, .name = name };
+}
+
+X86_64_Operand x86_64_register(size_t number, size_t size) {
+    return (X86_64_Operand) { .kind = Operand_Register, .data = { .register_ = { .kind = Register_General, .number = number, .size = size } } };
+}
+
+X86_64_Operand x86_64_xmm(size_t number) {
+    return (X86_64_Operand) { .kind = Operand_Register, .data = { .register_ = { .kind = Register_Xmm, .number = number, .size = 16 } } };
+}
+
+X86_64_Operand x86_64_float(size_t number) {
+    return (X86_64_Operand) { .kind = Operand_Register, .data = { .register_ = { .kind = Register_Float, .number = number, .size = 10 } } };
+}
+
+X86_64_Operand x86_64_immediate(size_t value) {
+    return (X86_64_Operand) { .kind = Operand_Immediate, .data = { .immediate = value } };
+}
+
+X86_64_Operand x86_64_label(char* label) {
+    return (X86_64_Operand) { .kind = Operand_Label, .data = { .label = label } };
+}
+
+X86_64_Operand x86_64_memory(size_t base, long displacement, size_t size) {
+    X86_64_Operand operand = { .kind = Operand_Memory, .size = size };
+    operand.data.memory.has_base = true;
+    operand.data.memory.base = (X86_64_Register) { .kind = Register_General, .number = base, .size = 8 };
+    operand.data.memory.displacement = displacement;
+    return operand;
+}
+
+X86_64_Operand x86_64_memory_index(size_t base, size_t index) {
+    X86_64_Operand operand = x86_64_memory(base, 0, 0);
+    operand.data.memory.has_index = true;
+    operand.data.memory.index = (X86_64_Register) { .kind = Register_General, .number = index, .size = 8 };
+    return operand;
+}
+
+X86_64_Operand x86_64_memory_label(char* label) {
+    X86_64_Operand operand = { .kind = Operand_Memory };
+    operand.data.memory.label = label;
+    return operand;
+}
+
+bool register_equal(X86_64_Register* a, X86_64_Register* b) {
+    return a->kind == b->kind && a->number == b->number && a->size == b->size;
+}
+
+bool x86_64_operand_equal(X86_64_Operand* a, X86_64_Operand* b) {
+    if (a->kind != b->kind || a->size != b->size) {
+        return false;
+    }
+
+    switch (a->kind) {
+        case Operand_Register:
+            return register_equal(&a->data.register_, &b->data.register_);
+        case Operand_Immediate:
+            return a->data.immediate == b->data.immediate;
+        case Operand_Label:
+            return strcmp(a->data.label, b->data.label) == 0;
+        case Operand_Memory:
+            if (a->data.memory.has_base != b->data.memory.has_base || a->data.memory.has_index != b->data.memory.has_index) {
+                return false;
+            }
+            if (a->data.memory.has_base && !register_equal(&a->data.memory.base, &b->data.memory.base)) {
+                return false;
+            }
+            if (a->data.memory.has_index && !register_equal(&a->data.memory.index, &b->data.memory.index)) {
+                return false;
+            }
+            if ((a->data.memory.label == NULL) != (b->data.memory.label == NULL)) {
+                return false;
+            }
+            if (a->data.memory.label != NULL && strcmp(a->data.memory.label, b->data.memory.label) != 0) {
+                return false;
+            }
+            return a->data.memory.displacement == b->data.memory.displacement;
+        default:
+            assert(false);
+    }
+}
+
+// true when the operand reads or writes any part of the general register
+bool x86_64_operand_uses_register(X86_64_Operand* operand, size_t number) {
+    switch (operand->kind) {
+        case Operand_Register:
+            return operand->data.register_.kind == Register_General && operand->data.register_.number == number;
+        case Operand_Memory:
+            return (operand->data.memory.has_base && operand->data.memory.base.kind == Register_General && operand->data.memory.base.number == number) ||
+                (operand->data.memory.has_index && operand->data.memory.index.kind == Register_General && operand->data.memory.index.number == number);
+        default:
+            return false;
+    }
+}
+
+bool x86_64_is_general_register(X86_64_Operand* operand, size_t size) {
+    return operand->kind == Operand_Register && operand->data.register_.kind == Register_General && operand->data.register_.size == size;
+}
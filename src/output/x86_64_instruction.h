@@ -0,0 +1,159 @@
+#ifndef X86_64_INSTRUCTION__
+#define X86_64_INSTRUCTION__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../arena.h"
+#include "../ast.h"
+#include "writer.h"
+
+typedef enum {
+    Register_General,
+    Register_Xmm,
+    Register_Float,
+} X86_64_Register_Kind;
+
+// general registers are numbered the way they are encoded, so rax is 0 and r15 is 15
+typedef struct {
+    X86_64_Register_Kind kind;
+    size_t number;
+    size_t size;
+} X86_64_Register;
+
+typedef enum {
+    Operand_Register,
+    Operand_Immediate,
+    Operand_Label,
+    Operand_Memory,
+} X86_64_Operand_Kind;
+
+typedef struct {
+    X86_64_Operand_Kind kind;
+    // bytes accessed when written out explicitly, like the dword in mov dword [rsp], 5
+    size_t size;
+    union {
+        X86_64_Register register_;
+        size_t immediate;
+        char* label;
+        struct {
+            bool has_base;
+            X86_64_Register base;
+            bool has_index;
+            X86_64_Register index;
+            char* label;
+            long displacement;
+        } memory;
+    } data;
+} X86_64_Operand;
+
+// every operation the backend emits, the conditional ones come in families of sixteen in the order of their condition codes
+typedef enum {
+    Opcode_Mov,
+    Opcode_Movzx,
+    Opcode_Lea,
+    Opcode_Push,
+    Opcode_Pop,
+    Opcode_Add,
+    Opcode_Or,
+    Opcode_And,
+    Opcode_Sub,
+    Opcode_Xor,
+    Opcode_Cmp,
+    Opcode_Test,
+    Opcode_Not,
+    Opcode_Neg,
+    Opcode_Mul,
+    Opcode_Imul,
+    Opcode_Div,
+    Opcode_Idiv,
+    Opcode_Jmp,
+    Opcode_Call,
+    Opcode_Ret,
+    Opcode_Syscall,
+    Opcode_Rep_Movsb,
+    Opcode_Rep_Stosb,
+    Opcode_Jo, Opcode_Jno, Opcode_Jb, Opcode_Jae, Opcode_Je, Opcode_Jne, Opcode_Jbe, Opcode_Ja,
+    Opcode_Js, Opcode_Jns, Opcode_Jp, Opcode_Jnp, Opcode_Jl, Opcode_Jge, Opcode_Jle, Opcode_Jg,
+    Opcode_Seto, Opcode_Setno, Opcode_Setb, Opcode_Setae, Opcode_Sete, Opcode_Setne, Opcode_Setbe, Opcode_Seta,
+    Opcode_Sets, Opcode_Setns, Opcode_Setp, Opcode_Setnp, Opcode_Setl, Opcode_Setge, Opcode_Setle, Opcode_Setg,
+    Opcode_Cmovo, Opcode_Cmovno, Opcode_Cmovb, Opcode_Cmovae, Opcode_Cmove, Opcode_Cmovne, Opcode_Cmovbe, Opcode_Cmova,
+    Opcode_Cmovs, Opcode_Cmovns, Opcode_Cmovp, Opcode_Cmovnp, Opcode_Cmovl, Opcode_Cmovge, Opcode_Cmovle, Opcode_Cmovg,
+    Opcode_Fld,
+    Opcode_Fstp,
+    Opcode_Fisttp,
+    Opcode_Fcomi,
+    Opcode_Fadd,
+    Opcode_Fsub,
+    Opcode_Fmul,
+    Opcode_Fdiv,
+    Opcode_Movq,
+    Opcode_Addsd,
+    Opcode_Subsd,
+    Opcode_Mulsd,
+    Opcode_Divsd,
+    Opcode_Ucomisd,
+    Opcode_Cvttsd2si,
+    Opcode_Count,
+} X86_64_Opcode;
+
+#define X86_64_CONDITION_COUNT 16
+
+typedef enum {
+    Instruction_Operation,
+    Instruction_Label,
+    // fasm source printed as it is, like the _entry alias, it is never encoded
+    Instruction_Raw,
+} X86_64_Instruction_Kind;
+
+typedef struct {
+    X86_64_Instruction_Kind kind;
+    X86_64_Opcode opcode;
+    // name of labels, the whole line for raw instructions
+    char* name;
+    size_t operand_count;
+    X86_64_Operand operands[2];
+} X86_64_Instruction;
+
+Dynamic_Array_Def(X86_64_Instruction, Array_X86_64_Instruction, array_x86_64_instruction_)
+
+extern char* x86_64_opcode_names[Opcode_Count];
+
+void x86_64_append_instruction(Writer* writer, X86_64_Instruction* instruction);
+// whether the opcode is one of the sixteen conditional forms starting at family, like Opcode_Jo
+bool x86_64_is_conditional(X86_64_Opcode opcode, X86_64_Opcode family);
+
+X86_64_Instruction x86_64_operation(X86_64_Opcode opcode, size_t operand_count, X86_64_Operand first, X86_64_Operand second);
+X86_64_Instruction x86_64_label_instruction(char* name);
+X86_64_Operand x86_64_register(size_t number, size_t size);
+X86_64_Operand x86_64_xmm(size_t number);
+X86_64_Operand x86_64_float(size_t number);
+X86_64_Operand x86_64_immediate(size_t value);
+X86_64_Operand x86_64_label(char* label);
+// [base+displacement], the size is only given where it has to be written out
+X86_64_Operand x86_64_memory(size_t base, long displacement, size_t size);
+X86_64_Operand x86_64_memory_index(size_t base, size_t index);
+X86_64_Operand x86_64_memory_label(char* label);
+
+bool x86_64_operand_equal(X86_64_Operand* a, X86_64_Operand* b);
+bool x86_64_operand_uses_register(X86_64_Operand* operand, size_t number);
+bool x86_64_is_general_register(X86_64_Operand* operand, size_t size);
+
+#define REGISTER_RAX 0
+#define REGISTER_RCX 1
+#define REGISTER_RDX 2
+#define REGISTER_RBX 3
+#define REGISTER_RSP 4
+#define REGISTER_RBP 5
+#define REGISTER_RSI 6
+#define REGISTER_RDI 7
+#define REGISTER_R8 8
+#define REGISTER_R9 9
+#define REGISTER_R10 10
+#define REGISTER_R11 11
+#define REGISTER_R12 12
+#define REGISTER_R13 13
+#define REGISTER_R14 14
+#define REGISTER_R15 15
+
+#endif
@@ -1,127 +1,64 @@
 #include <assert.h>
 
 #include "x86_64_util.h"
+#include "../ast_walk.h"
 #include "../processor.h"
 
-#include "../ast_walk.h"
+Dynamic_Array_Impl(Frame_Slot, Array_Frame_Slot, array_frame_slot_)
 
-size_t get_size(Ast_Type* type_in, Generic_State* state) {
-    Ast_Type type = evaluate_type_complete(type_in, state);
-    switch (type.kind) {
-        case Type_Array: {
-            Ast_Type_Array* array = &type.data.array;
+typedef struct {
+    Generic_State* state;
+    Array_Ast_Expression direct_callees;
+} Address_Taken_State;
 
-            if (array->has_size) {
-                assert(array->size_type->kind == Type_Number);
-                size_t size = array->size_type->data.number.value;
-                return size * get_size(array->element_type, state);
-            }
-            break;
-        }
-        case Type_Internal: {
-            Ast_Type_Internal* internal = &type.data.internal;
-
-            switch (*internal) {
-                case Type_UInt:
-                case Type_UInt64:
-                case Type_Float64:
-                case Type_Ptr:
-                    return 8;
-                case Type_UInt32:
-                    return 4;
-                case Type_UInt16:
-                    return 2;
-                case Type_UInt8:
-                case Type_Byte:
-                    return 1;
-                case Type_Bool:
-                    return 1;
-            }
-            break;
-        }
-        case Type_Pointer: {
-            return 8;
-        }
-        case Type_Struct: {
-            size_t size = 0;
-            Ast_Type_Struct* struct_ = &type.data.struct_;
-            for (size_t i = 0; i < struct_->items.count; i++) {
-                size += get_size(&struct_->items.elements[i]->type, state);
-            }
-            return size;
-        }
-        case Type_Union: {
-            size_t size = 0;
-            Ast_Type_Union* union_ = &type.data.union_;
-            for (size_t i = 0; i < union_->items.count; i++) {
-                size_t size_temp = get_size(&union_->items.elements[i]->type, state);
-                if (size_temp > size) {
-                    size = size_temp;
-                }
-            }
-            return size;
-        }
-        case Type_Enum: {
-            return 8;
-        }
-        default:
-            assert(false);
+void mark_address_taken(Ast_Expression* expression, void* internal_state) {
+    Address_Taken_State* state = internal_state;
+
+    // callees are walked right after their arguments, so the innermost pending one is on top
+    bool direct_callee = state->direct_callees.count > 0 && state->direct_callees.elements[state->direct_callees.count - 1] == expression;
+    if (direct_callee) {
+        state->direct_callees.count--;
     }
-    assert(false);
-}
 
-Location_Size_Data get_parent_item_location_size(Ast_Type* parent_type, char* item_name, Generic_State* state) {
-    Location_Size_Data result = {};
+    if (expression->kind == Expression_Invoke && expression->data.invoke.kind == Invoke_Standard) {
+        array_ast_expression_append(&state->direct_callees, expression->data.invoke.data.procedure.procedure);
+    }
 
-    if (strcmp(item_name, "*") == 0) {
-        result.size = get_size(parent_type, state);
-    } else {
-        switch (parent_type->kind) {
-            case Type_Basic: {
-                Ast_Identifier identifier = parent_type->data.basic.identifier;
-                Resolved resolved = resolve(state, identifier);
+    if (!direct_callee && expression->kind == Expression_Retrieve && expression->data.retrieve.kind == Retrieve_Assign_Identifier) {
+        Resolved resolved = resolve(state->state, expression->data.retrieve.data.identifier);
+        if (resolved.kind == Resolved_Item && resolved.data.item->kind == Item_Procedure) {
+            resolved.data.item->data.procedure.computed_address_taken = true;
+        }
+    }
+}
 
-                assert(resolved.kind == Resolved_Item);
+// procedures used as values or called from the start code need the stack calling convention
+void compute_address_taken(Generic_State* state) {
+    Address_Taken_State address_taken_state = {
+        .state = state,
+        .direct_callees = array_ast_expression_new(16),
+    };
+    Ast_Walk_State walk_state = {
+        .expression_func = mark_address_taken,
+        .internal_state = &address_taken_state,
+    };
 
-                Ast_Item* item = resolved.data.item;
-                assert(item->kind == Item_Type);
-                Ast_Type type = item->data.type.type;
-                return get_parent_item_location_size(&type, item_name, state);
+    for (size_t j = 0; j < state->program->count; j++) {
+        Ast_File* file = &state->program->elements[j];
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (!is_item_output(item)) {
+                continue;
             }
-            case Type_Struct: {
-                Ast_Type_Struct* struct_type = &parent_type->data.struct_;
-                for (size_t i = 0; i < struct_type->items.count; i++) {
-                    Ast_Declaration* declaration = struct_type->items.elements[i];
-                    size_t item_size = get_size(&declaration->type, state);
-                    if (strcmp(declaration->name, item_name) == 0) {
-                        result.size = item_size;
-                        break;
-                    }
-                    result.location += item_size;
-                }
-                break;
-            }
-            case Type_Union: {
-                Ast_Type_Union* union_type = &parent_type->data.union_;
-                for (size_t i = 0; i < union_type->items.count; i++) {
-                    Ast_Declaration* declaration = union_type->items.elements[i];
-                    size_t item_size = get_size(&declaration->type, state);
-                    if (strcmp(declaration->name, item_name) == 0) {
-                        result.size = item_size;
-                        break;
-                    }
-                }
-                break;
-            }
-            case Type_RunMacro: {
-                return get_parent_item_location_size(parent_type->data.run_macro.result.data.type, item_name, state);
+
+            if (item->kind == Item_Procedure && (has_directive(&item->directives, Directive_Entry) || has_directive(&item->directives, Directive_Exit))) {
+                item->data.procedure.computed_address_taken = true;
             }
-            default:
-                assert(false);
+            walk_item(item, &walk_state);
         }
     }
 
-    return result;
+    array_ast_expression_free(&address_taken_state.direct_callees);
 }
 
 bool has_local_variable(char* name, Generic_State* state) {
@@ -135,26 +72,18 @@ bool has_local_variable(char* name, Generic_State* state) {
     return false;
 }
 
-Location_Size_Data get_local_variable_location_size(char* name, Generic_State* state) {
-    Location_Size_Data result = { .location = 8 };
-
-    bool found = false;
-
+Location_Size_Data get_local_variable_location_size(char* name, Frame_Layout* frame, Generic_State* state) {
     for (int i = state->current_declares.count - 1; i >= 0; i--) {
         Ast_Declaration* declaration = &state->current_declares.elements[i];
-        size_t declaration_size = get_size(&declaration->type, state);
-
-        if (found) {
-            result.location += declaration_size;
-        }
-
-        if (!found && strcmp(declaration->name, name) == 0) {
-            result.size = declaration_size;
-            found = true;
+        if (strcmp(declaration->name, name) == 0) {
+            return (Location_Size_Data) {
+                .size = get_size(&declaration->type, state),
+                .location = frame->locations.elements[i],
+            };
         }
     }
 
-    return result;
+    assert(false);
 }
 
 bool has_argument(char* name, Generic_State* state) {
@@ -184,38 +113,204 @@ Location_Size_Data get_argument_location_size(char* name, Generic_State* state)
 }
 
 typedef struct {
-    size_t total;
+    Frame_Layout* frame;
     Generic_State* state;
-} Locals_Walk_State;
+    size_t top;
+} Frame_Layout_State;
+
+void layout_expression(Ast_Expression* expression, Frame_Layout_State* state);
+
+void layout_retrieve(Retrieve_Assign_Node* retrieve, Frame_Layout_State* state) {
+    switch (retrieve->kind) {
+        case Retrieve_Assign_Parent:
+            layout_expression(retrieve->data.parent.expression, state);
+            break;
+        case Retrieve_Assign_Array:
+            layout_expression(retrieve->data.array.expression_outer, state);
+            layout_expression(retrieve->data.array.expression_inner, state);
+            break;
+        default:
+            break;
+    }
+}
+
+void layout_statement(Ast_Statement* statement, Frame_Layout_State* state) {
+    if (has_directive(&statement->directives, Directive_If)) {
+        Ast_Directive_If* if_node = &get_directive(&statement->directives, Directive_If)->data.if_;
+        if (!if_node->result) {
+            return;
+        }
+    }
 
-void collect_statement_locals_size(Ast_Statement* statement, void* state_in) {
-    Locals_Walk_State* state = state_in;
     switch (statement->kind) {
+        case Statement_Expression:
+            layout_expression(statement->data.expression.expression, state);
+            break;
         case Statement_Declare: {
-            size_t size = 0;
-            for (size_t i = 0; i < statement->data.declare.declarations.count; i++) {
-                Ast_Type type = statement->data.declare.declarations.elements[i].type;
-                size += get_size(&type, state->state);
+            Ast_Statement_Declare* declare = &statement->data.declare;
+            if (declare->expression != NULL) {
+                layout_expression(declare->expression, state);
             }
-            state->total += size;
+
+            // declared last to first, the same order the backend pushes them in
+            for (int i = declare->declarations.count - 1; i >= 0; i--) {
+                Ast_Declaration* declaration = &declare->declarations.elements[i];
+                size_t size = get_size(&declaration->type, state->state);
+
+                // a local starts location + size bytes below rbp, which is kept 16 byte aligned
+                size_t end = align_up(state->top + size, get_alignment(&declaration->type, state->state));
+                array_frame_slot_append(&state->frame->slots, (Frame_Slot) { .declaration = declaration, .location = end - size });
+
+                state->top = end;
+                if (state->top > state->frame->size) {
+                    state->frame->size = state->top;
+                }
+            }
+            break;
+        }
+        case Statement_Assign: {
+            Ast_Statement_Assign* assign = &statement->data.assign;
+            layout_expression(assign->expression, state);
+            for (size_t i = 0; i < assign->parts.count; i++) {
+                layout_retrieve(&assign->parts.elements[i], state);
+            }
+            break;
+        }
+        case Statement_Return:
+            if (statement->data.return_.expression != NULL) {
+                layout_expression(statement->data.return_.expression, state);
+            }
+            break;
+        case Statement_While:
+            layout_expression(statement->data.while_.condition, state);
+            layout_expression(statement->data.while_.inside, state);
+            break;
+        case Statement_Break:
+            break;
+        default:
+            assert(false);
+    }
+}
+
+void layout_expression(Ast_Expression* expression, Frame_Layout_State* state) {
+    switch (expression->kind) {
+        case Expression_Block: {
+            Ast_Expression_Block* block = &expression->data.block;
+            size_t top = state->top;
+            for (size_t i = 0; i < block->statements.count; i++) {
+                layout_statement(block->statements.elements[i], state);
+            }
+            state->top = top;
+            break;
+        }
+        case Expression_Multiple: {
+            Ast_Expression_Multiple* multiple = &expression->data.multiple;
+            for (size_t i = 0; i < multiple->expressions.count; i++) {
+                layout_expression(multiple->expressions.elements[i], state);
+            }
+            break;
+        }
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            for (size_t i = 0; i < invoke->arguments.count; i++) {
+                layout_expression(invoke->arguments.elements[i], state);
+            }
+            if (invoke->kind == Invoke_Standard) {
+                layout_expression(invoke->data.procedure.procedure, state);
+            }
+            break;
+        }
+        case Expression_RunMacro: {
+            Ast_RunMacro* run_macro = &expression->data.run_macro;
+            if (run_macro->result.kind == Macro_Expression) {
+                layout_expression(run_macro->result.data.expression, state);
+            }
+            break;
+        }
+        case Expression_Retrieve:
+            layout_retrieve(&expression->data.retrieve, state);
+            break;
+        case Expression_If: {
+            Ast_Expression_If* if_ = &expression->data.if_;
+            layout_expression(if_->condition, state);
+            layout_expression(if_->if_expression, state);
+            if (if_->else_expression != NULL) {
+                layout_expression(if_->else_expression, state);
+            }
+            break;
+        }
+        case Expression_Reference:
+            layout_expression(expression->data.reference.inner, state);
+            break;
+        case Expression_Cast:
+            layout_expression(expression->data.cast.expression, state);
+            break;
+        case Expression_Build: {
+            Ast_Expression_Build* build = &expression->data.build;
+            for (size_t i = 0; i < build->arguments.count; i++) {
+                layout_expression(build->arguments.elements[i], state);
+            }
+            break;
         }
         default:
             break;
     }
 }
 
-size_t get_locals_size(Ast_Item_Procedure* procedure, Generic_State* state) {
-    Locals_Walk_State locals_state = {
-        .total = 8,
-        .state = state,
+Frame_Layout frame_layout_new(Ast_Item_Procedure* procedure, Generic_State* state) {
+    Frame_Layout frame = {
+        .slots = array_frame_slot_new(8),
+        .size = 8,
+        .next = 0,
+        .locations = array_size_new(8),
+        .scopes = array_size_new(4),
     };
-    Ast_Walk_State walk_state = {
-        .expression_func = NULL,
-        .statement_func = collect_statement_locals_size,
-        .internal_state = &locals_state,
+
+    Frame_Layout_State layout_state = {
+        .frame = &frame,
+        .state = state,
+        .top = 8,
     };
-    walk_expression(procedure->body, &walk_state);
-    return locals_state.total;
+    layout_expression(procedure->body, &layout_state);
+    frame.size = align_up(frame.size, 16);
+
+    return frame;
+}
+
+// declarations are almost always reached in layout order, so the next slot is checked before searching
+size_t frame_layout_declare(Frame_Layout* frame, Ast_Declaration* declaration, Generic_State* state) {
+    size_t index = frame->next;
+    if (index >= frame->slots.count || frame->slots.elements[index].declaration != declaration) {
+        index = 0;
+        while (index < frame->slots.count && frame->slots.elements[index].declaration != declaration) {
+            index++;
+        }
+        assert(index < frame->slots.count);
+    }
+    frame->next = index + 1;
+
+    size_t location = frame->slots.elements[index].location;
+    array_ast_declaration_append(&state->current_declares, *declaration);
+    array_size_append(&frame->locations, location);
+    return location;
+}
+
+void frame_layout_enter_scope(Frame_Layout* frame, Generic_State* state) {
+    array_size_append(&frame->scopes, state->current_declares.count);
+}
+
+void frame_layout_exit_scope(Frame_Layout* frame, Generic_State* state) {
+    size_t count = frame->scopes.elements[frame->scopes.count - 1];
+    frame->scopes.count--;
+
+    state->current_declares.count = count;
+    frame->locations.count = count;
+}
+
+void frame_layout_free(Frame_Layout* frame) {
+    array_frame_slot_free(&frame->slots);
+    array_size_free(&frame->locations);
+    array_size_free(&frame->scopes);
 }
 
 size_t get_arguments_size(Generic_State* state) {
@@ -1,18 +1,34 @@
 #include <stdlib.h>
 
+#include "../layout.h"
 #include "../processor.h"
 
 typedef struct {
-    size_t size;
+    Ast_Declaration* declaration;
     size_t location;
-} Location_Size_Data;
+} Frame_Slot;
+
+Dynamic_Array_Def(Frame_Slot, Array_Frame_Slot, array_frame_slot_)
+
+// offsets of every local in a procedure, computed once before its body is output
+// locals of sibling scopes are never alive together, so they share slots
+typedef struct {
+    Array_Frame_Slot slots;
+    size_t size;
+    size_t next;
+    Array_Size locations;
+    Array_Size scopes;
+} Frame_Layout;
 
-size_t get_size(Ast_Type* type_in, Generic_State* state);
-Location_Size_Data get_parent_item_location_size(Ast_Type* parent_type, char* item_name, Generic_State* state);
+void compute_address_taken(Generic_State* state);
 bool has_argument(char* name, Generic_State* state);
-Location_Size_Data get_local_variable_location_size(char* name, Generic_State* state);
+Location_Size_Data get_local_variable_location_size(char* name, Frame_Layout* frame, Generic_State* state);
 bool has_local_variable(char* name, Generic_State* state);
 Location_Size_Data get_argument_location_size(char* name, Generic_State* state);
-size_t get_locals_size(Ast_Item_Procedure* procedure, Generic_State* state);
+Frame_Layout frame_layout_new(Ast_Item_Procedure* procedure, Generic_State* state);
+size_t frame_layout_declare(Frame_Layout* frame, Ast_Declaration* declaration, Generic_State* state);
+void frame_layout_enter_scope(Frame_Layout* frame, Generic_State* state);
+void frame_layout_exit_scope(Frame_Layout* frame, Generic_State* state);
+void frame_layout_free(Frame_Layout* frame);
 size_t get_arguments_size(Generic_State* state);
 size_t get_returns_size(Generic_State* state);
@@ -15,6 +15,11 @@ Token_Kind peek(Parser_State* state) {
     return current->kind;
 }
 
+Word_Id peek_word(Parser_State* state) {
+    Token* current = &state->tokens->elements[state->index];
+    return current->id;
+}
+
 Token_Kind consume(Parser_State* state) {
     Token* current = &state->tokens->elements[state->index];
     state->index++;
@@ -27,6 +32,8 @@ void consume_check(Parser_State* state, Token_Kind wanted_kind) {
         Token temp = (Token) {
             wanted_kind,
             NULL,
+            0,
+            Word_None,
             (Location) {
                 NULL,
                 0,
@@ -54,7 +61,7 @@ char* consume_string(Parser_State* state) {
         exit(1);
     }
     state->index++;
-    return current->data;
+    return interner_intern(state->interner, current->data, current->length);
 }
 
 char* consume_char(Parser_State* state) {
@@ -66,10 +73,10 @@ char* consume_char(Parser_State* state) {
         exit(1);
     }
     state->index++;
-    return current->data;
+    return interner_intern(state->interner, current->data, current->length);
 }
 
-char* consume_boolean(Parser_State* state) {
+bool consume_boolean(Parser_State* state) {
     Token* current = &state->tokens->elements[state->index];
     if (current->kind != Token_Boolean) {
         printf("Error: Expected Boolean, got ");
@@ -78,7 +85,7 @@ char* consume_boolean(Parser_State* state) {
         exit(1);
     }
     state->index++;
-    return current->data;
+    return current->id == Literal_True;
 }
 
 char* consume_number(Parser_State* state) {
@@ -90,10 +97,10 @@ char* consume_number(Parser_State* state) {
         exit(1);
     }
     state->index++;
-    return current->data;
+    return interner_intern(state->interner, current->data, current->length);
 }
 
-char* consume_keyword(Parser_State* state) {
+Word_Id consume_keyword(Parser_State* state) {
     Token* current = &state->tokens->elements[state->index];
     if (current->kind != Token_Keyword) {
         print_token_error_stub(current);
@@ -103,7 +110,7 @@ char* consume_keyword(Parser_State* state) {
         exit(1);
     }
     state->index++;
-    return current->data;
+    return current->id;
 }
 
 char* consume_identifier(Parser_State* state) {
@@ -116,7 +123,7 @@ char* consume_identifier(Parser_State* state) {
         exit(1);
     }
     state->index++;
-    return current->data;
+    return interner_intern(state->interner, current->data, current->length);
 }
 
 Ast_Type parse_type(Parser_State* state);
@@ -132,7 +139,7 @@ void parse_directives(Parser_State* state) {
             Ast_Directive_If if_node;
             consume_check(state, Token_LeftParenthesis);
 
-            Ast_Expression* expression = malloc(sizeof(*expression));
+            Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
             *expression = parse_expression(state);
             if_node.expression = expression;
 
@@ -142,6 +149,14 @@ void parse_directives(Parser_State* state) {
             directive.data.if_ = if_node;
         } else if (strcmp(directive_string, "#entry") == 0) {
             directive.kind = Directive_Entry;
+        } else if (strcmp(directive_string, "#exit") == 0) {
+            directive.kind = Directive_Exit;
+        } else if (strcmp(directive_string, "#packed") == 0) {
+            directive.kind = Directive_Packed;
+        } else if (strcmp(directive_string, "#inline") == 0) {
+            directive.kind = Directive_Inline;
+        } else if (strcmp(directive_string, "#noinline") == 0) {
+            directive.kind = Directive_NoInline;
         }
 
         array_ast_directive_append(&state->directives, directive);
@@ -168,11 +183,11 @@ void filter_add_directive(Parser_State* state, Array_Ast_Directive* directives,
 Ast_Macro_Syntax_Kind parse_macro_kind(Parser_State* state, Ast_Macro_Syntax_Kind default_kind) {
     Ast_Macro_Syntax_Kind result = default_kind;
     if (peek(state) == Token_Identifier) {
-        char* name = state->tokens->elements[state->index].data;
-        if (strcmp(name, "$expr") == 0) {
+        Token* name = &state->tokens->elements[state->index];
+        if (token_equals(name, "$expr")) {
             result = Macro_Expression;
             consume(state);
-        } else if (strcmp(name, "$type") == 0) {
+        } else if (token_equals(name, "$type")) {
             result = Macro_Type;
             consume(state);
         }
@@ -197,7 +212,7 @@ Ast_Macro_Syntax_Data parse_macro_syntax_data_inner(Parser_State* state, Ast_Mac
 
     switch (kind) {
         case Macro_Expression: {
-            Ast_Expression* expression = malloc(sizeof(*expression));
+            Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
             *expression = parse_expression(state);
 
             result.kind = Macro_Expression;
@@ -205,7 +220,7 @@ Ast_Macro_Syntax_Data parse_macro_syntax_data_inner(Parser_State* state, Ast_Mac
             break;
         }
         case Macro_Type: {
-            Ast_Type* type = malloc(sizeof(*type));
+            Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
             *type = parse_type(state);
 
             result.kind = Macro_Type;
@@ -238,7 +253,7 @@ Ast_RunMacro parse_run_macro(Parser_State* state, Ast_Identifier identifier, Ast
             continue;
         }
 
-        Ast_Macro_Syntax_Data* data = malloc(sizeof(*data));;
+        Ast_Macro_Syntax_Data* data = arena_allocate(state->arena, sizeof(*data));
         *data = parse_macro_syntax_data(state, default_kind);
 
         array_ast_macro_syntax_data_append(&run_macro.arguments, data);
@@ -253,13 +268,14 @@ Ast_Type parse_type(Parser_State* state) {
     Ast_Type result = { .directives = array_ast_directive_new(1) };
 
     parse_directives(state);
+    filter_add_directive(state, &result.directives, Directive_Packed);
 
     if (peek(state) == Token_Asterisk) {
         Ast_Type_Pointer pointer;
 
         consume(state);
 
-        Ast_Type* child = malloc(sizeof(*child));
+        Ast_Type* child = arena_allocate(state->arena, sizeof(*child));
         *child = parse_type(state);
         pointer.child = child;
 
@@ -272,23 +288,23 @@ Ast_Type parse_type(Parser_State* state) {
 
         if (peek(state) != Token_RightBracket) {
             array.has_size = true;
-            Ast_Type* size_type = malloc(sizeof(*size_type));
+            Ast_Type* size_type = arena_allocate(state->arena, sizeof(*size_type));
             *size_type = parse_type(state);
             array.size_type = size_type;
         }
 
         consume_check(state, Token_RightBracket);
 
-        Ast_Type* child = malloc(sizeof(*child));
+        Ast_Type* child = arena_allocate(state->arena, sizeof(*child));
         *child = parse_type(state);
         array.element_type = child;
 
         result.kind = Type_Array;
         result.data.array = array;
     } else if (peek(state) == Token_Keyword) {
-        char* keyword = consume_keyword(state);
+        Word_Id keyword = consume_keyword(state);
 
-        if (strcmp(keyword, "proc") == 0) {
+        if (keyword == Keyword_Proc) {
             consume(state);
 
             Ast_Type_Procedure procedure = {
@@ -302,30 +318,26 @@ Ast_Type parse_type(Parser_State* state) {
                     continue;
                 }
 
-                Ast_Type* type = malloc(sizeof(*type));
+                Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
                 *type = parse_type(state);
                 array_ast_type_append(&procedure.arguments, type);
             }
 
             consume(state);
 
+            // a single return, so a comma after it ends the type as it does for every other type
             if (peek(state) == Token_Colon) {
                 consume(state);
 
-                bool looking_at_returns = true;
-                while (looking_at_returns) {
-                    Ast_Type* type = malloc(sizeof(*type));
-                    *type = parse_type(state);
-                    array_ast_type_append(&procedure.returns, type);
-
-                    looking_at_returns = peek(state) == Token_Comma;
-                }
+                Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
+                *type = parse_type(state);
+                array_ast_type_append(&procedure.returns, type);
             }
 
             result.kind = Type_Procedure;
             result.data.procedure = procedure;
-        } else if (strcmp(keyword, "struct") == 0 || strcmp(keyword, "union") == 0) {
-            bool is_struct = strcmp(keyword, "struct") == 0;
+        } else if (keyword == Keyword_Struct || keyword == Keyword_Union) {
+            bool is_struct = keyword == Keyword_Struct;
             consume(state);
 
             Array_Ast_Declaration_Pointer items = array_ast_declaration_pointer_new(4);
@@ -340,7 +352,7 @@ Ast_Type parse_type(Parser_State* state) {
                 consume_check(state, Token_Colon);
                 Ast_Type type = parse_type(state);
 
-                Ast_Declaration* declaration = malloc(sizeof(*declaration));
+                Ast_Declaration* declaration = arena_allocate(state->arena, sizeof(*declaration));
                 declaration->name = name;
                 declaration->type = type;
                 declaration->location = location;
@@ -359,7 +371,7 @@ Ast_Type parse_type(Parser_State* state) {
                 result.kind = Type_Union;
                 result.data.union_ = union_type;
             }
-        } else if (strcmp(keyword, "enum") == 0) {
+        } else if (keyword == Keyword_Enum) {
             Ast_Type_Enum enum_type;
             consume(state);
 
@@ -389,17 +401,18 @@ Ast_Type parse_type(Parser_State* state) {
         result.kind = Type_Number;
         result.data.number = number_type;
     } else {
+        Word_Id id = peek_word(state);
         char* name = consume_identifier(state);
         Ast_Type_Internal internal;
         bool found = false;
 
         if (!found) {
-            if (strcmp(name, "@typeof") == 0) {
+            if (id == Intrinsic_TypeOf) {
                 Ast_Type_TypeOf type_of;
 
                 consume_check(state, Token_LeftParenthesis);
 
-                Ast_Expression* expression = malloc(sizeof(*expression));
+                Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
                 *expression = parse_expression(state);
                 type_of.expression = expression;
 
@@ -412,33 +425,45 @@ Ast_Type parse_type(Parser_State* state) {
         }
 
         if (!found) {
-            if (strcmp(name, "uint") == 0) {
-                internal = Type_UInt;
-                found = true;
-            } else if (strcmp(name, "uint64") == 0) {
-                internal = Type_UInt64;
-                found = true;
-            } else if (strcmp(name, "uint32") == 0) {
-                internal = Type_UInt32;
-                found = true;
-            } else if (strcmp(name, "uint16") == 0) {
-                internal = Type_UInt16;
-                found = true;
-            } else if (strcmp(name, "uint8") == 0) {
-                internal = Type_UInt8;
-                found = true;
-            } else if (strcmp(name, "float64") == 0) {
-                internal = Type_Float64;
-                found = true;
-            } else if (strcmp(name, "byte") == 0) {
-                internal = Type_Byte;
-                found = true;
-            } else if (strcmp(name, "ptr") == 0) {
-                internal = Type_Ptr;
-                found = true;
-            } else if (strcmp(name, "bool") == 0) {
-                internal = Type_Bool;
-                found = true;
+            switch (id) {
+                case Builtin_UInt:
+                    internal = Type_UInt;
+                    found = true;
+                    break;
+                case Builtin_UInt64:
+                    internal = Type_UInt64;
+                    found = true;
+                    break;
+                case Builtin_UInt32:
+                    internal = Type_UInt32;
+                    found = true;
+                    break;
+                case Builtin_UInt16:
+                    internal = Type_UInt16;
+                    found = true;
+                    break;
+                case Builtin_UInt8:
+                    internal = Type_UInt8;
+                    found = true;
+                    break;
+                case Builtin_Float64:
+                    internal = Type_Float64;
+                    found = true;
+                    break;
+                case Builtin_Byte:
+                    internal = Type_Byte;
+                    found = true;
+                    break;
+                case Builtin_Ptr:
+                    internal = Type_Ptr;
+                    found = true;
+                    break;
+                case Builtin_Bool:
+                    internal = Type_Bool;
+                    found = true;
+                    break;
+                default:
+                    break;
             }
 
             if (found) {
@@ -469,14 +494,14 @@ Ast_Type parse_type(Parser_State* state) {
 }
 
 Ast_Expression parse_multiple_expression(Parser_State* state) {
-    Ast_Expression result;
+    Ast_Expression result = { .directives = array_ast_directive_new(1) };
     Ast_Expression_Multiple node = { .expressions = array_ast_expression_new(2) };
     do {
         if (peek(state) == Token_Comma) {
             consume(state);
         }
 
-        Ast_Expression* expression = malloc(sizeof(*expression));
+        Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
         *expression = parse_expression(state);
         array_ast_expression_append(&node.expressions, expression);
     } while (peek(state) == Token_Comma);
@@ -493,7 +518,7 @@ Ast_Statement parse_statement(Parser_State* state) {
     filter_add_directive(state, &result.directives, Directive_If);
 
     Token_Kind token = peek(state);
-    if (token == Token_Keyword && strcmp(state->tokens->elements[state->index].data, "var") == 0) {
+    if (token == Token_Keyword && state->tokens->elements[state->index].id == Keyword_Var) {
         Ast_Statement_Declare node = {};
 
         consume(state);
@@ -517,7 +542,7 @@ Ast_Statement parse_statement(Parser_State* state) {
         if (next == Token_Equals) {
             consume(state);
 
-            Ast_Expression* expression = malloc(sizeof(*expression));
+            Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
             *expression = parse_multiple_expression(state);
             node.expression = expression;
 
@@ -528,14 +553,14 @@ Ast_Statement parse_statement(Parser_State* state) {
 
         result.kind = Statement_Declare;
         result.data.declare = node;
-    } else if (token == Token_Keyword && strcmp(state->tokens->elements[state->index].data, "return") == 0) {
+    } else if (token == Token_Keyword && state->tokens->elements[state->index].id == Keyword_Return) {
         Ast_Statement_Return node = {};
         node.location = state->tokens->elements[state->index].location;
 
         consume(state);
 
         if (peek(state) != Token_Semicolon) {
-            Ast_Expression* expression = malloc(sizeof(*expression));
+            Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
             *expression = parse_multiple_expression(state);
             node.expression = expression;
         }
@@ -544,16 +569,16 @@ Ast_Statement parse_statement(Parser_State* state) {
 
         result.kind = Statement_Return;
         result.data.return_ = node;
-    } else if (token == Token_Keyword && strcmp(state->tokens->elements[state->index].data, "while") == 0) {
+    } else if (token == Token_Keyword && state->tokens->elements[state->index].id == Keyword_While) {
         consume(state);
 
         Ast_Statement_While node;
 
-        Ast_Expression* condition = malloc(sizeof(*condition));
+        Ast_Expression* condition = arena_allocate(state->arena, sizeof(*condition));
         *condition = parse_expression(state);
         node.condition = condition;
 
-        Ast_Expression* inside = malloc(sizeof(*inside));
+        Ast_Expression* inside = arena_allocate(state->arena, sizeof(*inside));
         *inside = parse_expression(state);
         node.inside = inside;
 
@@ -561,7 +586,7 @@ Ast_Statement parse_statement(Parser_State* state) {
 
         result.kind = Statement_While;
         result.data.while_ = node;
-    } else if (token == Token_Keyword && strcmp(state->tokens->elements[state->index].data, "break") == 0) {
+    } else if (token == Token_Keyword && state->tokens->elements[state->index].id == Keyword_Break) {
         consume(state);
 
         Ast_Statement_Break node;
@@ -572,7 +597,7 @@ Ast_Statement parse_statement(Parser_State* state) {
     } else {
         Ast_Statement_Expression node = {};
 
-        Ast_Expression* expression = malloc(sizeof(*expression));
+        Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
         *expression = parse_multiple_expression(state);
         node.expression = expression;
 
@@ -597,7 +622,7 @@ Ast_Statement parse_statement(Parser_State* state) {
                 }
             }
 
-            Ast_Expression* expression = malloc(sizeof(*expression));
+            Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
             *expression = parse_multiple_expression(state);
             assign.expression = expression;
 
@@ -666,7 +691,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
             Array_Ast_Statement statements = array_ast_statement_new(32);
 
             while (peek(state) != Token_RightCurlyBrace) {
-                Ast_Statement* statement = malloc(sizeof(*statement));
+                Ast_Statement* statement = arena_allocate(state->arena, sizeof(*statement));
                 *statement = parse_statement(state);
                 array_ast_statement_append(&statements, statement);
             }
@@ -717,7 +742,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
         case Token_Boolean: {
             Ast_Expression_Boolean node;
 
-            node.value = strcmp(consume_boolean(state), "true") == 0;
+            node.value = consume_boolean(state);
 
             result.kind = Expression_Boolean;
             result.data.boolean = node;
@@ -730,8 +755,9 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
         }
         case Token_Identifier: {
             Location location = state->tokens->elements[state->index].location;
+            Word_Id id = peek_word(state);
             char* name = consume_identifier(state);
-            if (strcmp(name, "@sizeof") == 0) {
+            if (id == Intrinsic_SizeOf) {
                 Ast_Expression_SizeOf node = {};
 
                 consume_check(state, Token_LeftParenthesis);
@@ -743,7 +769,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
 
                 result.kind = Expression_SizeOf;
                 result.data.size_of = node;
-            } else if (strcmp(name, "@lengthof") == 0) {
+            } else if (id == Intrinsic_LengthOf) {
                 Ast_Expression_LengthOf node = {};
 
                 consume_check(state, Token_LeftParenthesis);
@@ -755,7 +781,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
 
                 result.kind = Expression_LengthOf;
                 result.data.length_of = node;
-            } else if (strcmp(name, "@istype") == 0) {
+            } else if (id == Intrinsic_IsType) {
                 Ast_Expression_IsType node = {};
 
                 consume_check(state, Token_LeftParenthesis);
@@ -770,7 +796,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
 
                 result.kind = Expression_IsType;
                 result.data.is_type = node;
-            } else if (strcmp(name, "@cast") == 0) {
+            } else if (id == Intrinsic_Cast) {
                 Ast_Expression_Cast node = {};
                 node.location = location;
 
@@ -781,7 +807,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
 
                 consume_check(state, Token_Comma);
 
-                Ast_Expression* inner = malloc(sizeof(*inner));
+                Ast_Expression* inner = arena_allocate(state->arena, sizeof(*inner));
                 *inner = parse_expression(state);
                 node.expression = inner;
 
@@ -790,7 +816,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
                 result.kind = Expression_Cast;
                 result.data.cast = node;
                 break;
-            } else if (strcmp(name, "@init") == 0) {
+            } else if (id == Intrinsic_Init) {
                 Ast_Expression_Init node = {};
                 node.location = location;
 
@@ -804,7 +830,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
                 result.kind = Expression_Init;
                 result.data.init = node;
                 break;
-            } else if (strcmp(name, "@build") == 0) {
+            } else if (id == Intrinsic_Build) {
                 Ast_Expression_Build node;
                 node.location = location;
 
@@ -821,7 +847,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
                         continue;
                     }
 
-                    Ast_Expression* expression = malloc(sizeof(*expression));
+                    Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
                     *expression = parse_expression(state);
 
                     array_ast_expression_append(&arguments, expression);
@@ -840,6 +866,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
                 node.kind = Retrieve_Assign_Identifier;
                 Ast_Identifier identifier = {};
                 identifier.name = name;
+                identifier.id = id;
 
                 node.kind = Retrieve_Assign_Identifier;
                 node.data.identifier = identifier;
@@ -857,7 +884,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
 
             consume(state);
 
-            Ast_Expression* expression = malloc(sizeof(*expression));
+            Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
             *expression = parse_expression_without_operators(state);
             array_ast_expression_append(&node.arguments, expression);
 
@@ -866,23 +893,23 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
             break;
         }
         case Token_Keyword: {
-            char* name = consume_keyword(state);
+            Word_Id keyword = consume_keyword(state);
 
-            if (strcmp(name, "if") == 0) {
+            if (keyword == Keyword_If) {
                 Ast_Expression_If node = {};
                 node.location = state->tokens->elements[state->index].location;
 
-                Ast_Expression* condition = malloc(sizeof(*condition));
+                Ast_Expression* condition = arena_allocate(state->arena, sizeof(*condition));
                 *condition = parse_expression(state);
                 node.condition = condition;
 
-                Ast_Expression* expression = malloc(sizeof(*expression));
+                Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
                 *expression = parse_expression(state);
                 node.if_expression = expression;
 
-                if (state->tokens->elements[state->index].kind == Token_Keyword && strcmp(state->tokens->elements[state->index].data, "else") == 0) {
+                if (state->tokens->elements[state->index].kind == Token_Keyword && state->tokens->elements[state->index].id == Keyword_Else) {
                     consume(state);
-                    Ast_Expression* expression = malloc(sizeof(*expression));
+                    Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
                     *expression = parse_expression(state);
                     node.else_expression = expression;
                 }
@@ -903,7 +930,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
 
             consume(state);
             
-            Ast_Expression* inner = malloc(sizeof(*inner));
+            Ast_Expression* inner = arena_allocate(state->arena, sizeof(*inner));
             *inner = parse_expression(state);
             node.inner = inner;
 
@@ -939,7 +966,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
 
             consume(state);
 
-            Ast_Expression* previous_result = malloc(sizeof(*previous_result));
+            Ast_Expression* previous_result = arena_allocate(state->arena, sizeof(*previous_result));
             *previous_result = result;
             node.data.parent.expression = previous_result;
 
@@ -961,13 +988,13 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
             node.kind = Retrieve_Assign_Array;
             node.location = state->tokens->elements[state->index].location;
 
-            Ast_Expression* previous_result = malloc(sizeof(*previous_result));
+            Ast_Expression* previous_result = arena_allocate(state->arena, sizeof(*previous_result));
             *previous_result = result;
             node.data.array.expression_outer = previous_result;
 
             consume(state);
 
-            Ast_Expression* inner = malloc(sizeof(*inner));
+            Ast_Expression* inner = arena_allocate(state->arena, sizeof(*inner));
             *inner = parse_expression(state);
             node.data.array.expression_inner = inner;
 
@@ -984,7 +1011,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
             node.location = state->tokens->elements[state->index].location;
             node.kind = Invoke_Standard;
 
-            Ast_Expression* previous_result = malloc(sizeof(*previous_result));
+            Ast_Expression* previous_result = arena_allocate(state->arena, sizeof(*previous_result));
             *previous_result = result;
             node.data.procedure.procedure = previous_result;
             consume(state);
@@ -997,7 +1024,7 @@ Ast_Expression parse_expression_without_operators(Parser_State* state) {
                     continue;
                 }
 
-                Ast_Expression* expression = malloc(sizeof(*expression));
+                Ast_Expression* expression = arena_allocate(state->arena, sizeof(*expression));
                 *expression = parse_expression(state);
 
                 array_ast_expression_append(&arguments, expression);
@@ -1085,11 +1112,11 @@ Ast_Expression parse_expression(Parser_State* state) {
             }
             node.data.operator_.operator_ = operator;
 
-            Ast_Expression* parsed = malloc(sizeof(*parsed));
+            Ast_Expression* parsed = arena_allocate(state->arena, sizeof(*parsed));
             *parsed = parse_expression_without_operators(state);
 
             if (current_precedence > previous_precedence) {
-                Ast_Expression* result_inner = malloc(sizeof(*result_inner));
+                Ast_Expression* result_inner = arena_allocate(state->arena, sizeof(*result_inner));
 
                 Array_Ast_Expression arguments = array_ast_expression_new(32);
                 array_ast_expression_append(&arguments, array_ast_expression_get(&result.data.invoke.arguments, 1));
@@ -1101,7 +1128,7 @@ Ast_Expression parse_expression(Parser_State* state) {
 
                 array_ast_expression_set(&result.data.invoke.arguments, 1, result_inner);
             } else {
-                Ast_Expression* result_allocated = malloc(sizeof(*result_allocated));
+                Ast_Expression* result_allocated = arena_allocate(state->arena, sizeof(*result_allocated));
                 *result_allocated = result;
 
                 Array_Ast_Expression arguments = array_ast_expression_new(32);
@@ -1149,7 +1176,7 @@ Ast_Item_Procedure parse_procedure(Parser_State* state) {
 
         bool running = true;
         while (running) {
-            Ast_Type* type = malloc(sizeof(*type));
+            Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
             *type = parse_type(state);
 
             array_ast_type_append(&node.returns, type);
@@ -1161,7 +1188,7 @@ Ast_Item_Procedure parse_procedure(Parser_State* state) {
         }
     }
 
-    Ast_Expression* body = malloc(sizeof(*body));
+    Ast_Expression* body = arena_allocate(state->arena, sizeof(*body));
     *body = parse_expression(state);
     node.body = body;
 
@@ -1176,15 +1203,20 @@ Ast_Item parse_item(Parser_State* state) {
     parse_directives(state);
     filter_add_directive(state, &result.directives, Directive_If);
     filter_add_directive(state, &result.directives, Directive_Entry);
+    filter_add_directive(state, &result.directives, Directive_Exit);
+    filter_add_directive(state, &result.directives, Directive_Inline);
+    filter_add_directive(state, &result.directives, Directive_NoInline);
+
+    result.location = state->tokens->elements[state->index].location;
 
     switch (peek(state)) {
         case Token_Keyword: {
-            char* keyword = consume_keyword(state);
-            if (strcmp(keyword, "proc") == 0) {
+            Word_Id keyword = consume_keyword(state);
+            if (keyword == Keyword_Proc) {
                 Ast_Item_Procedure node = parse_procedure(state);
                 result.kind = Item_Procedure;
                 result.data.procedure = node;
-            } else if (strcmp(keyword, "macro") == 0) {
+            } else if (keyword == Keyword_Macro) {
                 Ast_Item_Macro node = { .arguments = array_ast_macro_syntax_kind_new(2), .variants = array_ast_macro_variant_new(2) };
 
                 node.name = consume_identifier(state);
@@ -1233,12 +1265,12 @@ Ast_Item parse_item(Parser_State* state) {
                     consume(state);
 
                     if (node.return_.kind == Macro_Expression) {
-                        Ast_Expression* node = malloc(sizeof(*node));
+                        Ast_Expression* node = arena_allocate(state->arena, sizeof(*node));
                         *node = parse_expression(state);
                         variant.data.kind = Macro_Expression;
                         variant.data.data.expression = node;
                     } else if (node.return_.kind == Macro_Type) {
-                        Ast_Type* type = malloc(sizeof(*type));
+                        Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
                         *type = parse_type(state);
                         variant.data.kind = Macro_Type;
                         variant.data.data.type = type;
@@ -1253,7 +1285,7 @@ Ast_Item parse_item(Parser_State* state) {
 
                 result.kind = Item_Macro;
                 result.data.macro = node;
-            } else if (strcmp(keyword, "type") == 0) {
+            } else if (keyword == Keyword_Type) {
                 Ast_Item_Type node = {};
 
                 node.name = consume_identifier(state);
@@ -1264,7 +1296,7 @@ Ast_Item parse_item(Parser_State* state) {
 
                 result.kind = Item_Type;
                 result.data.type = node;
-            } else if (strcmp(keyword, "global") == 0) {
+            } else if (keyword == Keyword_Global) {
                 Ast_Item_Global node = {};
 
                 node.name = consume_identifier(state);
@@ -1274,7 +1306,7 @@ Ast_Item parse_item(Parser_State* state) {
 
                 result.kind = Item_Global;
                 result.data.global = node;
-            } else if (strcmp(keyword, "const") == 0) {
+            } else if (keyword == Keyword_Const) {
                 Ast_Item_Constant node = {};
 
                 node.name = consume_identifier(state);
@@ -1307,10 +1339,10 @@ Ast_Item parse_item(Parser_State* state) {
     return result;
 }
 
-Ast_File parse(Tokens* tokens) {
+Ast_File parse(Tokens* tokens, Arena* arena, Interner* interner) {
     Ast_File result;
 
-    Parser_State state = { .tokens = tokens, .directives = array_ast_directive_new(4), .index = 0 };
+    Parser_State state = { .tokens = tokens, .directives = array_ast_directive_new(4), .index = 0, .arena = arena, .interner = interner };
 
     Array_Ast_Item array = array_ast_item_new(32);
     while (state.index < tokens->count) {
@@ -1,10 +1,14 @@
+#include "arena.h"
 #include "ast.h"
+#include "interner.h"
 #include "tokenizer.h"
 
 typedef struct {
     Tokens* tokens;
     size_t index;
     Array_Ast_Directive directives;
+    Arena* arena;
+    Interner* interner;
 } Parser_State;
 
-Ast_File parse(Tokens* tokens);
+Ast_File parse(Tokens* tokens, Arena* arena, Interner* interner);
@@ -4,7 +4,9 @@
 #include "ast_clone.h"
 #include "ast_walk.h"
 #include "file_util.h"
+#include "layout.h"
 #include "processor.h"
+#include "stats.h"
 
 Dynamic_Array_Impl(Ast_Type, Stack_Ast_Type, stack_type_)
 Dynamic_Array_Impl(size_t, Array_Size, array_size_)
@@ -46,28 +48,16 @@ char* get_item_name(Ast_Item* item) {
 }
 
 Resolved resolve(Generic_State* state, Ast_Identifier data) {
-    Ast_Identifier initial_search = {};
-    initial_search = data;
-
-    Resolved result = { NULL, Unresolved, {} };
-    for (size_t j = 0; j < state->program->count; j++) {
-        Ast_File* file_node = &state->program->elements[j];
-        bool stop = false;
-        for (size_t i = 0; i < file_node->items.count; i++) {
-            Ast_Item* item = &file_node->items.elements[i];
-            if (strcmp(get_item_name(item), initial_search.name) == 0) {
-                result = (Resolved) { file_node, Resolved_Item, { .item = item } };
-                stop = true;
-                break;
-            }
-        }
+    if (compiler_stats.enabled) {
+        atomic_fetch_add_explicit(&compiler_stats.resolves, 1, memory_order_relaxed);
+    }
 
-        if (stop) {
-            break;
-        }
+    Symbol* symbol = symbol_table_get(state->symbols, data.name);
+    if (symbol == NULL) {
+        return (Resolved) { NULL, Unresolved, {} };
     }
 
-    return result;
+    return (Resolved) { symbol->file, Resolved_Item, { .item = symbol->item } };
 }
 
 Ast_Type create_basic_single_type(char* name) {
@@ -89,11 +79,11 @@ Ast_Type create_internal_type(Ast_Type_Internal internal_type) {
     return type;
 }
 
-Ast_Type create_array_type(Ast_Type child) {
+Ast_Type create_array_type(Ast_Type child, Arena* arena) {
     Ast_Type type = { .directives = array_ast_directive_new(1) };
     Ast_Type_Array array = {};
 
-    Ast_Type* child_allocated = malloc(sizeof(*child_allocated));
+    Ast_Type* child_allocated = arena_allocate(arena, sizeof(*child_allocated));
     *child_allocated = child;
     array.element_type = child_allocated;
 
@@ -103,11 +93,11 @@ Ast_Type create_array_type(Ast_Type child) {
     return type;
 }
 
-Ast_Type create_pointer_type(Ast_Type child) {
+Ast_Type create_pointer_type(Ast_Type child, Arena* arena) {
     Ast_Type type = { .directives = array_ast_directive_new(1) };
     Ast_Type_Pointer pointer;
 
-    Ast_Type* child_allocated = malloc(sizeof(*child_allocated));
+    Ast_Type* child_allocated = arena_allocate(arena, sizeof(*child_allocated));
     *child_allocated = child;
     pointer.child = child_allocated;
 
@@ -579,6 +569,7 @@ void process_run_macro(Ast_RunMacro* run_macro, Ast_Macro_Syntax_Kind kind, Proc
 
     assert(matched);
     assert(variant.data.kind == kind);
+    compiler_stats.macro_expansions++;
 
     Apply_Macro_Walk_State locals_state = {
         .bindings = variant.bindings,
@@ -593,22 +584,22 @@ void process_run_macro(Ast_RunMacro* run_macro, Ast_Macro_Syntax_Kind kind, Proc
 
     switch (kind) {
         case Macro_Expression: {
-            Ast_Expression cloned = clone_expression(*variant.data.data.expression);
+            Ast_Expression cloned = clone_expression(*variant.data.data.expression, state->arena);
             walk_expression(&cloned, &walk_state);
 
             run_macro->result.kind = Macro_Expression;
-            run_macro->result.data.expression = malloc(sizeof(*run_macro->result.data.expression));
+            run_macro->result.data.expression = arena_allocate(state->arena, sizeof(*run_macro->result.data.expression));
             *run_macro->result.data.expression = cloned;
 
             process_expression(run_macro->result.data.expression, state);
             break;
         }
         case Macro_Type: {
-            Ast_Type cloned = clone_type(*variant.data.data.type);
+            Ast_Type cloned = clone_type(*variant.data.data.type, state->arena);
             walk_type(&cloned, &walk_state);
 
             run_macro->result.kind = Macro_Type;
-            run_macro->result.data.type = malloc(sizeof(*run_macro->result.data.type));
+            run_macro->result.data.type = arena_allocate(state->arena, sizeof(*run_macro->result.data.type));
             *run_macro->result.data.type = cloned;
 
             process_type(run_macro->result.data.type, state);
@@ -644,7 +635,7 @@ void process_type(Ast_Type* type, Process_State* state) {
             size_t stack_initial = state->stack.count;
             process_expression(expression, state);
 
-            Ast_Type* type = malloc(sizeof(*type));
+            Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
             *type = stack_type_pop(&state->stack);
             type_of->computed_result_type = type;
 
@@ -707,67 +698,48 @@ typedef enum {
     Operating_System_Windows,
 } Operating_System;
 
-typedef struct {
-    enum {
-        Evaluation_Boolean,
-        Evaluation_Operating_System,
-    } kind;
-    union {
-        bool boolean;
-        Operating_System operating_system;
-    } data;
-} Evaluation_Value;
-
-Evaluation_Value evaluate_if_directive_expression(Ast_Expression* expression, Process_State* state) {
+bool evaluate_constant_expression(Ast_Expression* expression, size_t* value, Generic_State* state);
+
+// #if expressions are never processed, so their operators are typed and @istype is decided here
+// before they go through the same evaluation as every other constant
+Ast_Type type_if_directive_expression(Ast_Expression* expression, Process_State* state) {
     switch (expression->kind) {
         case Expression_Retrieve: {
             if (expression->data.retrieve.kind == Retrieve_Assign_Identifier) {
-                char* identifier = expression->data.retrieve.data.identifier.name;
-
-                if (strcmp(identifier, "@os")) {
-                    return (Evaluation_Value) { .kind = Evaluation_Operating_System, .data = { .operating_system = Operating_System_Linux } };
-                } else if (strcmp(identifier, "@linux")) {
-                    return (Evaluation_Value) { .kind = Evaluation_Operating_System, .data = { .operating_system = Operating_System_Linux } };
+                switch (expression->data.retrieve.data.identifier.id) {
+                    case Intrinsic_Os:
+                    case Intrinsic_Linux:
+                        return create_internal_type(Type_UInt);
+                    default:
+                        break;
                 }
             }
             break;
         }
         case Expression_Invoke: {
             Ast_Expression_Invoke* invoke = &expression->data.invoke;
-            if (invoke->kind == Invoke_Operator) {
-                Operator* operator = &invoke->data.operator_.operator_;
-                Evaluation_Value left = evaluate_if_directive_expression(invoke->arguments.elements[0], state);
-                Evaluation_Value right = evaluate_if_directive_expression(invoke->arguments.elements[1], state);
-
-                switch (*operator) {
-                    case Operator_Equal: {
-                        if (left.kind == Evaluation_Operating_System && right.kind == Evaluation_Operating_System) {
-                            bool result = left.data.operating_system == right.data.operating_system;
-                            return (Evaluation_Value) { .kind = Evaluation_Boolean, .data = { .boolean = result } };
-                        }
-                        break;
-                    }
-                    case Operator_NotEqual: {
-                        if (left.kind == Evaluation_Operating_System && right.kind == Evaluation_Operating_System) {
-                            bool result = left.data.operating_system != right.data.operating_system;
-                            return (Evaluation_Value) { .kind = Evaluation_Boolean, .data = { .boolean = result } };
-                        }
-                        break;
-                    }
-                    default:
-                        assert(false);
-                }
+            if (invoke->kind != Invoke_Operator) {
+                break;
             }
-            break;
-        }
-        case Expression_Boolean: {
-            return (Evaluation_Value) { .kind = Evaluation_Boolean, .data = { .boolean = expression->data.boolean.value } };
+
+            Ast_Type operand_type = type_if_directive_expression(invoke->arguments.elements[0], state);
+            for (size_t i = 1; i < invoke->arguments.count; i++) {
+                type_if_directive_expression(invoke->arguments.elements[i], state);
+            }
+            invoke->data.operator_.computed_operand_type = operand_type;
+            return create_internal_type(Type_Bool);
         }
+        case Expression_Boolean:
+            return create_internal_type(Type_Bool);
         case Expression_IsType: {
             Ast_Expression_IsType* is_type_node = &expression->data.is_type;
             process_type(&is_type_node->given, state);
             process_type(&is_type_node->wanted, state);
-            return (Evaluation_Value) { .kind = Evaluation_Boolean, .data = { .boolean = is_type(&is_type_node->given, &is_type_node->wanted, state) } };
+            bool result = is_type(&is_type_node->given, &is_type_node->wanted, state);
+
+            expression->kind = Expression_Boolean;
+            expression->data.boolean = (Ast_Expression_Boolean) { .value = result };
+            return create_internal_type(Type_Bool);
         }
         default:
             break;
@@ -776,16 +748,20 @@ Evaluation_Value evaluate_if_directive_expression(Ast_Expression* expression, Pr
 }
 
 bool evaluate_if_directive(Ast_Directive_If* if_node, Process_State* state) {
-    Evaluation_Value value = evaluate_if_directive_expression(if_node->expression, state);
-    assert(value.kind == Evaluation_Boolean);
-    return value.data.boolean;
+    Ast_Type type = type_if_directive_expression(if_node->expression, state);
+    assert(is_internal_type(Type_Bool, &type));
+
+    size_t value;
+    bool constant = evaluate_constant_expression(if_node->expression, &value, &state->generic);
+    assert(constant);
+    return value;
 }
 
 void process_assign(Ast_Statement_Assign* assign, Process_State* state) {
     Array_Ast_Type wanted_types = array_ast_type_new(1);
     for (size_t i = 0; i < assign->parts.count; i++) {
         Statement_Assign_Part* assign_part = &assign->parts.elements[i];
-        Ast_Type* wanted_type = malloc(sizeof(*wanted_type));
+        Ast_Type* wanted_type = arena_allocate(state->arena, sizeof(*wanted_type));
         bool found = false;
 
         if (assign_part->kind == Retrieve_Assign_Array) {
@@ -814,7 +790,7 @@ void process_assign(Ast_Statement_Assign* assign, Process_State* state) {
         if (assign_part->kind == Retrieve_Assign_Identifier) {
             char* name = assign_part->data.identifier.name;
 
-            Ast_Type* type = malloc(sizeof(*type));
+            Ast_Type* type = arena_allocate(state->arena, sizeof(*type));
             for (size_t j = 0; j < state->generic.current_declares.count; j++) {
                 if (strcmp(state->generic.current_declares.elements[j].name, name) == 0) {
                     *type = state->generic.current_declares.elements[j].type;
@@ -1294,10 +1270,20 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                 if (procedure->kind == Expression_Retrieve) {
                     bool is_internal = false;
                     if (procedure->data.retrieve.kind == Retrieve_Assign_Identifier) {
-                        char* name = procedure->data.retrieve.data.identifier.name;
-
-                        if (strcmp(name, "@syscall6") == 0 || strcmp(name, "@syscall5") == 0 || strcmp(name, "@syscall4") == 0 || strcmp(name, "@syscall3") == 0 || strcmp(name, "@syscall2") == 0 || strcmp(name, "@syscall1") == 0 || strcmp(name, "@syscall0") == 0) {
-                            is_internal = true;
+                        switch (procedure->data.retrieve.data.identifier.id) {
+                            case Intrinsic_Syscall0:
+                            case Intrinsic_Syscall1:
+                            case Intrinsic_Syscall2:
+                            case Intrinsic_Syscall3:
+                            case Intrinsic_Syscall4:
+                            case Intrinsic_Syscall5:
+                            case Intrinsic_Syscall6:
+                            case Intrinsic_Copy:
+                            case Intrinsic_Set:
+                                is_internal = true;
+                                break;
+                            default:
+                                break;
                         }
                     }
 
@@ -1309,8 +1295,9 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                             process_expression(invoke->arguments.elements[i], state);
                         }
 
-                        if (strncmp(name, "@syscall", 8) == 0) {
-                            size_t count = strtoul(name + 8, NULL, 0) + 1;
+                        Word_Id id = procedure->data.retrieve.data.identifier.id;
+                        if (id >= Intrinsic_Syscall0 && id <= Intrinsic_Syscall6) {
+                            size_t count = id - Intrinsic_Syscall0 + 1;
 
                             if (state->stack.count < count) {
                                 print_error_stub(&invoke->location);
@@ -1332,6 +1319,31 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                             stack_type_push(&state->stack, (Ast_Type) { .kind = Type_RegisterSize, .data = {} });
                         }
 
+                        // @copy(source, destination, length) and @set(destination, value, length), only the lowest byte of the value is used
+                        if (id == Intrinsic_Copy || id == Intrinsic_Set) {
+                            Ast_Type ptr = create_internal_type(Type_Ptr);
+                            Ast_Type* wanted[3] = { &ptr, id == Intrinsic_Copy ? &ptr : usize_type(), usize_type() };
+
+                            if (state->stack.count < 3) {
+                                print_error_stub(&invoke->location);
+                                printf("Ran out of values for %s, needed 3\n", name);
+                                exit(1);
+                            }
+
+                            for (int i = 2; i >= 0; i--) {
+                                Ast_Type given = stack_type_pop(&state->stack);
+                                if (!is_type(wanted[i], &given, state)) {
+                                    print_error_stub(&invoke->location);
+                                    printf("Type '");
+                                    print_type_inline(&given);
+                                    printf("' is not assignable to argument of type '");
+                                    print_type_inline(wanted[i]);
+                                    printf("'\n");
+                                    exit(1);
+                                }
+                            }
+                        }
+
                         handled = true;
                     }
                 }
@@ -1398,7 +1410,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
 
                     process_expression(invoke->arguments.elements[reversed ? 1 : 0], state);
 
-                    Ast_Type* wanted = malloc(sizeof(*wanted));
+                    Ast_Type* wanted = arena_allocate(state->arena, sizeof(*wanted));
                     *wanted = state->stack.elements[state->stack.count - 1];
                     state->wanted_type = wanted;
 
@@ -1502,10 +1514,10 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
             bool found = false;
 
             if (!found && retrieve->kind == Retrieve_Assign_Identifier) {
-                if (strcmp(retrieve->data.identifier.name, "@file") == 0) {
-                    stack_type_push(&state->stack, create_pointer_type(create_array_type(create_internal_type(Type_Byte))));
+                if (retrieve->data.identifier.id == Intrinsic_File) {
+                    stack_type_push(&state->stack, create_pointer_type(create_array_type(create_internal_type(Type_Byte), state->arena), state->arena));
                     found = true;
-                } else if (strcmp(retrieve->data.identifier.name, "@line") == 0) {
+                } else if (retrieve->data.identifier.id == Intrinsic_Line) {
                     stack_type_push(&state->stack, create_internal_type(Type_UInt));
                     found = true;
                 }
@@ -1538,7 +1550,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
 
                 Ast_Type resulting_type = *array_ast_type_raw->data.array.element_type;
                 if (in_reference) {
-                    resulting_type = create_pointer_type(resulting_type);
+                    resulting_type = create_pointer_type(resulting_type, state->arena);
                 }
                 stack_type_push(&state->stack, resulting_type);
                 found = true;
@@ -1550,7 +1562,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                 if (variable_type != NULL) {
                     found = true;
                     if (consume_in_reference(&state->generic)) {
-                        stack_type_push(&state->stack, create_pointer_type(*variable_type));
+                        stack_type_push(&state->stack, create_pointer_type(*variable_type, state->arena));
                     } else {
                         stack_type_push(&state->stack, *variable_type);
                     }
@@ -1570,7 +1582,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
 
                 if (found) {
                     if (consume_in_reference(&state->generic)) {
-                        type = create_pointer_type(type);
+                        type = create_pointer_type(type, state->arena);
                     }
 
                     stack_type_push(&state->stack, type);
@@ -1600,7 +1612,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                 }
 
                 if (in_reference) {
-                    item_type = create_pointer_type(item_type);
+                    item_type = create_pointer_type(item_type, state->arena);
                 }
 
                 stack_type_push(&state->stack, item_type);
@@ -1614,7 +1626,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                     Ast_Type_Enum* enum_type = &evaluated_wanted_type.data.enum_;
                     for (size_t i = 0; i < enum_type->items.count; i++) {
                         if (strcmp(enum_variant, enum_type->items.elements[i]) == 0) {
-                            Ast_Type* evaluated_wanted_type_allocated = malloc(sizeof(*evaluated_wanted_type_allocated));
+                            Ast_Type* evaluated_wanted_type_allocated = arena_allocate(state->arena, sizeof(*evaluated_wanted_type_allocated));
                             *evaluated_wanted_type_allocated = evaluated_wanted_type;
                             retrieve->computed_result_type = evaluated_wanted_type_allocated;
                             stack_type_push(&state->stack, *state->wanted_type);
@@ -1652,14 +1664,14 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                                 type.kind = Type_Procedure;
                                 type.data.procedure = procedure_type;
 
-                                stack_type_push(&state->stack, create_pointer_type(type));
+                                stack_type_push(&state->stack, create_pointer_type(type, state->arena));
                                 break;
                             }
                             case Item_Global: {
                                 Ast_Item_Global* global = &item->data.global;
 
                                 if (consume_in_reference(&state->generic)) {
-                                    stack_type_push(&state->stack, create_pointer_type(global->type));
+                                    stack_type_push(&state->stack, create_pointer_type(global->type, state->arena));
                                 } else {
                                     stack_type_push(&state->stack, global->type);
                                 }
@@ -1674,6 +1686,12 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                                 retrieve->computed_result_type = wanted_type;
 
                                 stack_type_push(&state->stack, *wanted_type);
+
+                                // the backends only ever see the value
+                                Ast_Expression_Number number = item->data.constant.expression;
+                                number.type = wanted_type;
+                                expression->kind = Expression_Number;
+                                expression->data.number = number;
                                 break;
                             }
                             default:
@@ -1755,7 +1773,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                 stack_type_push(&state->stack, *wanted);
                 number->type = wanted;
             } else {
-                Ast_Type* usize = malloc(sizeof(*usize));
+                Ast_Type* usize = arena_allocate(state->arena, sizeof(*usize));
                 *usize = create_internal_type(Type_UInt);
                 stack_type_push(&state->stack, *usize);
                 number->type = usize;
@@ -1770,7 +1788,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
                 stack_type_push(&state->stack, *wanted);
                 null->type = wanted;
             } else {
-                Ast_Type* usize = malloc(sizeof(*usize));
+                Ast_Type* usize = arena_allocate(state->arena, sizeof(*usize));
                 *usize = create_internal_type(Type_UInt);
                 stack_type_push(&state->stack, *usize);
                 null->type = usize;
@@ -1782,7 +1800,7 @@ void process_expression(Ast_Expression* expression, Process_State* state) {
             break;
         }
         case Expression_String: {
-            stack_type_push(&state->stack, create_pointer_type(create_array_type(create_internal_type(Type_Byte))));
+            stack_type_push(&state->stack, create_pointer_type(create_array_type(create_internal_type(Type_Byte), state->arena), state->arena));
             break;
         }
         case Expression_Char: {
@@ -1912,6 +1930,13 @@ Ast_Directive* get_directive(Array_Ast_Directive* directives, Directive_Kind kin
     return false;
 }
 
+bool is_item_output(Ast_Item* item) {
+    if (has_directive(&item->directives, Directive_If) && !get_directive(&item->directives, Directive_If)->data.if_.result) {
+        return false;
+    }
+    return !item->computed_unreachable;
+}
+
 void process_item_reference(Ast_Item* item, Process_State* state) {
     switch (item->kind) {
         case Item_Procedure: {
@@ -1964,6 +1989,12 @@ void process_item(Ast_Item* item, Process_State* state) {
                 process_type(&procedure->arguments.elements[i].type, state);
             }
 
+            if (has_directive(&item->directives, Directive_Exit) && (procedure->arguments.count > 0 || procedure->returns.count > 0)) {
+                print_error_stub(&item->location);
+                printf("Exit procedure '%s' cannot take arguments or return values\n", procedure->name);
+                exit(1);
+            }
+
             process_expression(procedure->body, state);
 
             procedure->has_implicit_return = has_implicit_return(procedure->body);
@@ -2001,10 +2032,251 @@ bool is_enum_type(Ast_Type* type, Generic_State* generic_state) {
     return false;
 }
 
-void process(Program* program) {
+// width in bytes of the integer types constants can be computed in, 0 for everything else
+size_t get_constant_width(Ast_Type* type) {
+    if (type == NULL || type->kind != Type_Internal) {
+        return 0;
+    }
+
+    switch (type->data.internal) {
+        case Type_UInt:
+        case Type_UInt64:
+            return 8;
+        case Type_UInt32:
+            return 4;
+        case Type_UInt16:
+            return 2;
+        case Type_UInt8:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+size_t truncate_constant(size_t value, size_t width) {
+    if (width == 8) {
+        return value;
+    }
+    return value & ((1ul << (width * 8)) - 1);
+}
+
+// integers wrap at the width of their type like they do at runtime, booleans are 0 or 1
+bool evaluate_constant_expression(Ast_Expression* expression, size_t* value, Generic_State* state) {
+    switch (expression->kind) {
+        case Expression_Number: {
+            Ast_Expression_Number* number = &expression->data.number;
+            size_t width = get_constant_width(number->type);
+            if (width == 0 || number->kind != Number_Integer) {
+                return false;
+            }
+
+            *value = truncate_constant(number->value.integer, width);
+            return true;
+        }
+        case Expression_Boolean:
+            *value = expression->data.boolean.value;
+            return true;
+        case Expression_Retrieve: {
+            // only reached from #if, everything else that retrieves is left alone by get_folded_type
+            if (expression->data.retrieve.kind != Retrieve_Assign_Identifier) {
+                return false;
+            }
+
+            switch (expression->data.retrieve.data.identifier.id) {
+                case Intrinsic_Os:
+                case Intrinsic_Linux:
+                    *value = Operating_System_Linux;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+        case Expression_SizeOf: {
+            Ast_Expression_SizeOf* size_of = &expression->data.size_of;
+            size_t width = get_constant_width(&size_of->computed_result_type);
+            if (width == 0) {
+                return false;
+            }
+
+            *value = truncate_constant(get_size(&size_of->type, state), width);
+            return true;
+        }
+        case Expression_LengthOf: {
+            Ast_Expression_LengthOf* length_of = &expression->data.length_of;
+            size_t width = get_constant_width(&length_of->computed_result_type);
+            if (width == 0) {
+                return false;
+            }
+
+            *value = truncate_constant(get_length(&length_of->type), width);
+            return true;
+        }
+        case Expression_Cast: {
+            Ast_Expression_Cast* cast = &expression->data.cast;
+            size_t width = get_constant_width(&cast->type);
+            if (width == 0 || get_constant_width(&cast->computed_input_type) == 0) {
+                return false;
+            }
+
+            size_t input;
+            if (!evaluate_constant_expression(cast->expression, &input, state)) {
+                return false;
+            }
+
+            *value = truncate_constant(input, width);
+            return true;
+        }
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            if (invoke->kind != Invoke_Operator) {
+                return false;
+            }
+
+            Operator operator_ = invoke->data.operator_.operator_;
+            size_t width = 0;
+            if (operator_ == Operator_Not) {
+                width = 1;
+            } else if (operator_ == Operator_And || operator_ == Operator_Or || is_internal_type(Type_Bool, &invoke->data.operator_.computed_operand_type)) {
+                width = 1;
+            } else {
+                width = get_constant_width(&invoke->data.operator_.computed_operand_type);
+            }
+            if (width == 0) {
+                return false;
+            }
+
+            size_t arguments[2] = { 0, 0 };
+            for (size_t i = 0; i < invoke->arguments.count; i++) {
+                if (!evaluate_constant_expression(invoke->arguments.elements[i], &arguments[i], state)) {
+                    return false;
+                }
+            }
+
+            size_t left = arguments[0];
+            size_t right = arguments[1];
+            switch (operator_) {
+                case Operator_Add: *value = truncate_constant(left + right, width); return true;
+                case Operator_Subtract: *value = truncate_constant(left - right, width); return true;
+                case Operator_Multiply: *value = truncate_constant(left * right, width); return true;
+                // division by zero is left for the program to fault on
+                case Operator_Divide:
+                    if (right == 0) {
+                        return false;
+                    }
+                    *value = left / right;
+                    return true;
+                case Operator_Modulus:
+                    if (right == 0) {
+                        return false;
+                    }
+                    *value = left % right;
+                    return true;
+                case Operator_Equal: *value = left == right; return true;
+                case Operator_NotEqual: *value = left != right; return true;
+                case Operator_Less: *value = left < right; return true;
+                case Operator_LessEqual: *value = left <= right; return true;
+                case Operator_Greater: *value = left > right; return true;
+                case Operator_GreaterEqual: *value = left >= right; return true;
+                case Operator_And: *value = left && right; return true;
+                case Operator_Or: *value = left || right; return true;
+                case Operator_Not: *value = !left; return true;
+                default:
+                    return false;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+// type an expression folds to, false for expressions that are never folded
+bool get_folded_type(Ast_Expression* expression, Ast_Type* type) {
+    switch (expression->kind) {
+        case Expression_SizeOf:
+            *type = expression->data.size_of.computed_result_type;
+            return true;
+        case Expression_LengthOf:
+            *type = expression->data.length_of.computed_result_type;
+            return true;
+        case Expression_Cast:
+            *type = expression->data.cast.type;
+            return true;
+        case Expression_Invoke: {
+            Ast_Expression_Invoke* invoke = &expression->data.invoke;
+            if (invoke->kind != Invoke_Operator) {
+                return false;
+            }
+
+            switch (invoke->data.operator_.operator_) {
+                case Operator_Add:
+                case Operator_Subtract:
+                case Operator_Multiply:
+                case Operator_Divide:
+                case Operator_Modulus:
+                    *type = invoke->data.operator_.computed_operand_type;
+                    return true;
+                default:
+                    *type = create_internal_type(Type_Bool);
+                    return true;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+void fold_constant_expression(Ast_Expression* expression, void* state_in) {
+    Process_State* state = state_in;
+
+    Ast_Type type;
+    size_t value;
+    if (!get_folded_type(expression, &type) || !evaluate_constant_expression(expression, &value, &state->generic)) {
+        return;
+    }
+
+    if (is_internal_type(Type_Bool, &type)) {
+        expression->kind = Expression_Boolean;
+        expression->data.boolean = (Ast_Expression_Boolean) { .value = value };
+    } else {
+        Ast_Type* number_type = arena_allocate(state->arena, sizeof(*number_type));
+        *number_type = type;
+
+        expression->kind = Expression_Number;
+        expression->data.number = (Ast_Expression_Number) { .kind = Number_Integer, .value = { .integer = value }, .type = number_type };
+    }
+}
+
+// replaces every operator, cast, @sizeof and @lengthof that only depends on constants with its result
+void fold_constants(Process_State* state) {
+    Ast_Walk_State walk_state = {
+        .expression_func = fold_constant_expression,
+        .internal_state = state,
+    };
+
+    for (size_t j = 0; j < state->generic.program->count; j++) {
+        Ast_File* file = &state->generic.program->elements[j];
+        state->generic.current_file = file;
+
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (item->kind != Item_Procedure) {
+                continue;
+            }
+
+            if (has_directive(&item->directives, Directive_If) && !get_directive(&item->directives, Directive_If)->data.if_.result) {
+                continue;
+            }
+
+            walk_item(item, &walk_state);
+        }
+    }
+}
+
+void process(Program* program, Symbol_Table* symbols, Arena* arena) {
     Process_State state = (Process_State) {
         .generic = (Generic_State) {
             .program = program,
+            .symbols = symbols,
             // should items just be able to store their file?
             .current_file = NULL,
             .current_arguments = {},
@@ -2015,6 +2287,7 @@ void process(Program* program) {
         .stack = stack_type_new(8),
         .wanted_type = NULL,
         .scoped_declares = array_size_new(8),
+        .arena = arena,
     };
 
     for (size_t j = 0; j < program->count; j++) {
@@ -2026,4 +2299,6 @@ void process(Program* program) {
             process_item(item, &state);
         }
     }
+
+    fold_constants(&state);
 }
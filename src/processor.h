@@ -1,13 +1,16 @@
 #ifndef PROCESSOR__
 #define PROCESSOR__
 
+#include "arena.h"
 #include "ast.h"
+#include "symbol_table.h"
 
 Dynamic_Array_Def(Ast_Type, Stack_Ast_Type, stack_type_)
 Dynamic_Array_Def(size_t, Array_Size, array_size_)
 
 typedef struct {
     Program* program;
+    Symbol_Table* symbols;
     Ast_File* current_file;
     Ast_Item_Procedure* current_procedure;
     Array_Ast_Declaration current_arguments;
@@ -21,6 +24,7 @@ typedef struct {
     Stack_Ast_Type stack;
     Ast_Type* wanted_type;
     Array_Size scoped_declares;
+    Arena* arena;
 } Process_State;
 
 typedef struct {
@@ -39,16 +43,21 @@ bool is_type(Ast_Type* wanted, Ast_Type* given, Process_State* state);
 bool is_internal_type(Ast_Type_Internal wanted, Ast_Type* given);
 Ast_Type create_internal_type(Ast_Type_Internal type);
 Ast_Type create_basic_single_type(char* name);
-void process(Program* program);
+void process(Program* program, Symbol_Table* symbols, Arena* arena);
+
+char* get_item_name(Ast_Item* item);
 
 bool consume_in_reference(Generic_State* state);
 
 bool has_directive(Array_Ast_Directive* directives, Directive_Kind kind);
 Ast_Directive* get_directive(Array_Ast_Directive* directives, Directive_Kind kind);
+// false for items left out by #if and items nothing reaches
+bool is_item_output(Ast_Item* item);
 
 bool is_enum_type(Ast_Type* type, Generic_State* generic_state);
 
 Ast_Type evaluate_type(Ast_Type* type);
 Ast_Type evaluate_type_complete(Ast_Type* type, Generic_State* state);
+Ast_Type get_parent_item_type(Ast_Type* parent_type, char* item_name, Generic_State* state);
 
 #endif
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "ast_walk.h"
+#include "processor.h"
+#include "reachability.h"
+
+Dynamic_Array_Def(Ast_Item*, Array_Ast_Item_Pointer, array_ast_item_pointer_)
+Dynamic_Array_Impl(Ast_Item*, Array_Ast_Item_Pointer, array_ast_item_pointer_)
+
+typedef struct {
+    Generic_State generic;
+    // reached items whose own references are not followed yet
+    Array_Ast_Item_Pointer pending;
+} Reachability_State;
+
+char* item_kind_names[] = { "procedure", "macro", "type", "global", "constant" };
+
+void reach_item(Ast_Item* item, Reachability_State* state) {
+    if (item->computed_unreachable) {
+        item->computed_unreachable = false;
+        array_ast_item_pointer_append(&state->pending, item);
+    }
+}
+
+void reach_identifier(Ast_Identifier identifier, Reachability_State* state) {
+    // locals resolve to nothing, a local shadowing an item only keeps that item around
+    Resolved resolved = resolve(&state->generic, identifier);
+    if (resolved.kind == Resolved_Item) {
+        reach_item(resolved.data.item, state);
+    }
+}
+
+void reach_expression(Ast_Expression* expression, void* internal_state) {
+    Reachability_State* state = internal_state;
+
+    switch (expression->kind) {
+        case Expression_Retrieve:
+            if (expression->data.retrieve.kind == Retrieve_Assign_Identifier) {
+                reach_identifier(expression->data.retrieve.data.identifier, state);
+            }
+            break;
+        case Expression_RunMacro:
+            reach_identifier(expression->data.run_macro.identifier, state);
+            break;
+        default:
+            break;
+    }
+}
+
+void reach_statement(Ast_Statement* statement, void* internal_state) {
+    Reachability_State* state = internal_state;
+
+    if (statement->kind == Statement_Assign) {
+        Ast_Statement_Assign* assign = &statement->data.assign;
+        for (size_t i = 0; i < assign->parts.count; i++) {
+            if (assign->parts.elements[i].kind == Retrieve_Assign_Identifier) {
+                reach_identifier(assign->parts.elements[i].data.identifier, state);
+            }
+        }
+    }
+}
+
+void reach_type(Ast_Type* type, void* internal_state);
+
+Ast_Walk_State reach_walk_state(Reachability_State* state) {
+    return (Ast_Walk_State) {
+        .expression_func = reach_expression,
+        .statement_func = reach_statement,
+        .type_func = reach_type,
+        .internal_state = state,
+    };
+}
+
+void reach_type(Ast_Type* type, void* internal_state) {
+    Reachability_State* state = internal_state;
+    Ast_Walk_State walk_state = reach_walk_state(state);
+
+    // the walk does not go into these by itself
+    switch (type->kind) {
+        case Type_Basic:
+            reach_identifier(type->data.basic.identifier, state);
+            break;
+        case Type_RunMacro:
+            reach_identifier(type->data.run_macro.identifier, state);
+            break;
+        case Type_Union:
+            for (size_t i = 0; i < type->data.union_.items.count; i++) {
+                walk_type(&type->data.union_.items.elements[i]->type, &walk_state);
+            }
+            break;
+        case Type_Procedure:
+            for (size_t i = 0; i < type->data.procedure.arguments.count; i++) {
+                walk_type(type->data.procedure.arguments.elements[i], &walk_state);
+            }
+            for (size_t i = 0; i < type->data.procedure.returns.count; i++) {
+                walk_type(type->data.procedure.returns.elements[i], &walk_state);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void mark_unreachable_items(Program* program, Symbol_Table* symbols, bool print_dropped) {
+    Reachability_State state = {
+        .generic = (Generic_State) {
+            .program = program,
+            .symbols = symbols,
+        },
+        .pending = array_ast_item_pointer_new(64),
+    };
+
+    Ast_Item* entry = NULL;
+    Ast_Item* main = NULL;
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file = &program->elements[j];
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (has_directive(&item->directives, Directive_If) && !get_directive(&item->directives, Directive_If)->data.if_.result) {
+                continue;
+            }
+
+            item->computed_unreachable = true;
+            if (item->kind == Item_Procedure && has_directive(&item->directives, Directive_Entry)) {
+                entry = item;
+            } else if (item->kind == Item_Procedure && strcmp(item->data.procedure.name, "main") == 0) {
+                main = item;
+            }
+        }
+    }
+
+    if (entry == NULL) {
+        entry = main;
+    }
+
+    if (entry == NULL) {
+        for (size_t j = 0; j < program->count; j++) {
+            Ast_File* file = &program->elements[j];
+            for (size_t i = 0; i < file->items.count; i++) {
+                file->items.elements[i].computed_unreachable = false;
+            }
+        }
+        array_ast_item_pointer_free(&state.pending);
+        return;
+    }
+
+    Ast_Walk_State walk_state = reach_walk_state(&state);
+    reach_item(entry, &state);
+    // the startup code calls these after the entry procedure
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file = &program->elements[j];
+        for (size_t i = 0; i < file->items.count; i++) {
+            Ast_Item* item = &file->items.elements[i];
+            if (item->kind == Item_Procedure && has_directive(&item->directives, Directive_Exit)) {
+                reach_item(item, &state);
+            }
+        }
+    }
+    while (state.pending.count > 0) {
+        Ast_Item* item = array_ast_item_pointer_pop(&state.pending);
+        switch (item->kind) {
+            case Item_Global:
+                walk_type(&item->data.global.type, &walk_state);
+                break;
+            case Item_Macro:
+                // expanded macros are part of the code using them and are walked there
+                break;
+            default:
+                walk_item(item, &walk_state);
+                break;
+        }
+    }
+
+    if (print_dropped) {
+        size_t dropped = 0;
+        size_t total = 0;
+        for (size_t j = 0; j < program->count; j++) {
+            Ast_File* file = &program->elements[j];
+            for (size_t i = 0; i < file->items.count; i++) {
+                Ast_Item* item = &file->items.elements[i];
+                if (has_directive(&item->directives, Directive_If) && !get_directive(&item->directives, Directive_If)->data.if_.result) {
+                    continue;
+                }
+
+                total++;
+                if (item->computed_unreachable) {
+                    dropped++;
+                    printf("%s:%zu:%zu: dropped %s %s\n", item->location.file, item->location.row, item->location.col, item_kind_names[item->kind], get_item_name(item));
+                }
+            }
+        }
+        printf("dropped %zu of %zu items\n", dropped, total);
+    }
+
+    array_ast_item_pointer_free(&state.pending);
+}
@@ -0,0 +1,11 @@
+#ifndef REACHABILITY__
+#define REACHABILITY__
+
+#include "ast.h"
+#include "symbol_table.h"
+
+// marks every item the entry procedure cannot reach as unreachable so the backends leave it out, runs on the processed program
+// the entry is the #entry procedure or otherwise main, without either everything is kept
+void mark_unreachable_items(Program* program, Symbol_Table* symbols, bool print_dropped);
+
+#endif
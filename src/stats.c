@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "stats.h"
+
+Dynamic_Array_Impl(Stats_File, Array_Stats_File, array_stats_file_)
+Dynamic_Array_Impl(Stats_Section, Array_Stats_Section, array_stats_section_)
+
+Compiler_Stats compiler_stats = {};
+
+char* phase_names[] = { "read", "tokenize", "parse", "process", "inline", "reachability", "ir", "codegen", "write" };
+
+void stats_enable() {
+    compiler_stats.enabled = true;
+    compiler_stats.files = array_stats_file_new(32);
+    compiler_stats.sections = array_stats_section_new(4);
+}
+
+long stats_now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000l + time.tv_nsec;
+}
+
+void stats_add_phase(Stats_Phase phase, long start) {
+    compiler_stats.phase_nanoseconds[phase] += stats_now() - start;
+}
+
+void stats_add_section(char* name, size_t bytes) {
+    if (compiler_stats.enabled) {
+        array_stats_section_append(&compiler_stats.sections, (Stats_Section) { name, bytes });
+    }
+}
+
+void print_json_string(char* string) {
+    putchar('"');
+    for (char* cursor = string; *cursor != 0; cursor++) {
+        if (*cursor == '"' || *cursor == '\\') {
+            putchar('\\');
+        }
+        putchar(*cursor);
+    }
+    putchar('"');
+}
+
+void stats_print(bool json) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // kilobytes on linux
+    size_t peak_memory = usage.ru_maxrss;
+
+    if (!json) {
+        for (size_t i = 0; i < Phase_Count; i++) {
+            printf("%s: %.3f ms\n", phase_names[i], compiler_stats.phase_nanoseconds[i] / 1e6);
+        }
+        printf("total: %.3f ms\n", compiler_stats.total_nanoseconds / 1e6);
+        printf("files wall clock: %.3f ms\n", compiler_stats.files_nanoseconds / 1e6);
+
+        for (size_t i = 0; i < compiler_stats.files.count; i++) {
+            Stats_File* file = &compiler_stats.files.elements[i];
+            if (file->cached) {
+                printf("%s: cached, %zu nodes\n", file->path, file->nodes);
+            } else {
+                printf("%s: %zu tokens, %zu nodes\n", file->path, file->tokens, file->nodes);
+            }
+        }
+
+        printf("resolves: %zu\n", (size_t) compiler_stats.resolves);
+        printf("macro expansions: %zu\n", compiler_stats.macro_expansions);
+        for (size_t i = 0; i < compiler_stats.sections.count; i++) {
+            printf("%s section: %zu bytes\n", compiler_stats.sections.elements[i].name, compiler_stats.sections.elements[i].bytes);
+        }
+        printf("peak memory: %zu KiB\n", peak_memory);
+        return;
+    }
+
+    printf("{\"phases_ms\": {");
+    for (size_t i = 0; i < Phase_Count; i++) {
+        printf("%s\"%s\": %.3f", i > 0 ? ", " : "", phase_names[i], compiler_stats.phase_nanoseconds[i] / 1e6);
+    }
+    printf("}, \"total_ms\": %.3f, \"files_wall_ms\": %.3f, \"files\": [", compiler_stats.total_nanoseconds / 1e6, compiler_stats.files_nanoseconds / 1e6);
+
+    for (size_t i = 0; i < compiler_stats.files.count; i++) {
+        Stats_File* file = &compiler_stats.files.elements[i];
+        printf("%s{\"path\": ", i > 0 ? ", " : "");
+        print_json_string(file->path);
+        printf(", \"cached\": %s, \"tokens\": %zu, \"nodes\": %zu}", file->cached ? "true" : "false", file->tokens, file->nodes);
+    }
+
+    printf("], \"resolves\": %zu, \"macro_expansions\": %zu, \"sections\": {", (size_t) compiler_stats.resolves, compiler_stats.macro_expansions);
+    for (size_t i = 0; i < compiler_stats.sections.count; i++) {
+        printf("%s\"%s\": %zu", i > 0 ? ", " : "", compiler_stats.sections.elements[i].name, compiler_stats.sections.elements[i].bytes);
+    }
+    printf("}, \"peak_memory_kib\": %zu}\n", peak_memory);
+}
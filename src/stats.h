@@ -0,0 +1,65 @@
+#ifndef STATS__
+#define STATS__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dynamic_array.h"
+
+typedef enum {
+    Phase_Read,
+    Phase_Tokenize,
+    Phase_Parse,
+    Phase_Process,
+    Phase_Inline,
+    Phase_Reachability,
+    Phase_Ir,
+    Phase_Codegen,
+    Phase_Write,
+    Phase_Count,
+} Stats_Phase;
+
+typedef struct {
+    char* path;
+    size_t tokens;
+    size_t nodes;
+    // tokens are not counted for files loaded from the module cache
+    bool cached;
+} Stats_File;
+
+Dynamic_Array_Def(Stats_File, Array_Stats_File, array_stats_file_)
+
+typedef struct {
+    char* name;
+    size_t bytes;
+} Stats_Section;
+
+Dynamic_Array_Def(Stats_Section, Array_Stats_Section, array_stats_section_)
+
+// what a compilation spent its time on and how much it did, only collected when enabled by -stats
+typedef struct {
+    bool enabled;
+    // files are read, tokenized and parsed on several threads at once, their phases add up the time of every file
+    long phase_nanoseconds[Phase_Count];
+    // wall clock time of reading, tokenizing and parsing all files, the three phases overlap across threads
+    long files_nanoseconds;
+    long total_nanoseconds;
+    Array_Stats_File files;
+    // resolving happens during parallel code generation too
+    atomic_size_t resolves;
+    size_t macro_expansions;
+    // bytes of the sections the backend emitted, for the text backends those of the source it wrote
+    Array_Stats_Section sections;
+} Compiler_Stats;
+
+extern Compiler_Stats compiler_stats;
+
+void stats_enable();
+// monotonic time in nanoseconds
+long stats_now();
+void stats_add_phase(Stats_Phase phase, long start);
+void stats_add_section(char* name, size_t bytes);
+void stats_print(bool json);
+
+#endif
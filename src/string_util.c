@@ -44,9 +44,40 @@ char* string_substring(char* string, size_t start, size_t end) {
     return result;
 }
 
+size_t string_hash(char* string) {
+    return string_hash_length(string, strlen(string));
+}
+
+size_t string_hash_length(char* string, size_t length) {
+    // FNV-1a
+    size_t hash = 14695981039346656037UL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) string[i];
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
 void stringbuffer_appendstring(String_Buffer* buffer, char* string) {
-    // seems quite inefficient, adding one at a time
-    for (size_t i = 0; i < strlen(string); i++) {
-        stringbuffer_append(buffer, string[i]);
+    stringbuffer_append_length(buffer, string, strlen(string));
+}
+
+void stringbuffer_append_length(String_Buffer* buffer, char* string, size_t length) {
+    if (buffer->count + length > buffer->capacity) {
+        // grows like the dynamic array does, unused capacity stays zeroed
+        size_t new_capacity = buffer->capacity * 2;
+        while (new_capacity < buffer->count + length) {
+            new_capacity *= 2;
+        }
+
+        char* elements_new = malloc(new_capacity);
+        memset(elements_new, 0, new_capacity);
+        memcpy(elements_new, buffer->elements, buffer->count);
+        free(buffer->elements);
+        buffer->elements = elements_new;
+        buffer->capacity = new_capacity;
     }
+
+    memcpy(buffer->elements + buffer->count, string, length);
+    buffer->count += length;
 }
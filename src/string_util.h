@@ -12,3 +12,6 @@ char* string_substring(char* string, size_t start, size_t end);
 char* copy_string(char* string);
 char* copy_string_length(char* string, size_t length);
 void stringbuffer_appendstring(String_Buffer* buffer, char* string);
+void stringbuffer_append_length(String_Buffer* buffer, char* string, size_t length);
+size_t string_hash(char* string);
+size_t string_hash_length(char* string, size_t length);
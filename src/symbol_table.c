@@ -0,0 +1,78 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "processor.h"
+#include "symbol_table.h"
+
+// names come from the interner, so equal names are the same pointer
+static Symbol* symbol_table_find_slot(Symbol_Table* table, char* name, size_t hash) {
+    size_t mask = table->capacity - 1;
+    size_t index = hash & mask;
+    while (table->symbols[index].name != NULL) {
+        Symbol* symbol = &table->symbols[index];
+        if (symbol->hash == hash && symbol->name == name) {
+            return symbol;
+        }
+        index = (index + 1) & mask;
+    }
+    return &table->symbols[index];
+}
+
+Symbol_Table symbol_table_build(Program* program) {
+    size_t item_count = 0;
+    for (size_t i = 0; i < program->count; i++) {
+        item_count += program->elements[i].items.count;
+    }
+
+    // keep the load factor at or below one half
+    size_t capacity = 16;
+    while (capacity < item_count * 2) {
+        capacity *= 2;
+    }
+
+    Symbol_Table table = {
+        .symbols = calloc(capacity, sizeof(Symbol)),
+        .count = 0,
+        .capacity = capacity,
+    };
+
+    for (size_t j = 0; j < program->count; j++) {
+        Ast_File* file_node = &program->elements[j];
+        for (size_t i = 0; i < file_node->items.count; i++) {
+            Ast_Item* item = &file_node->items.elements[i];
+            char* name = get_item_name(item);
+            size_t hash = string_hash(name);
+
+            Symbol* symbol = symbol_table_find_slot(&table, name, hash);
+            if (symbol->name != NULL) {
+                // items behind an #if may legitimately share a name, the first one wins like before
+                if (has_directive(&item->directives, Directive_If) || has_directive(&symbol->item->directives, Directive_If)) {
+                    continue;
+                }
+
+                Location* location = &item->location;
+                Location* previous = &symbol->item->location;
+                printf("%s:%zu:%zu: Item '%s' is already defined at %s:%zu:%zu\n", location->file, location->row, location->col, name, previous->file, previous->row, previous->col);
+                exit(1);
+            }
+
+            *symbol = (Symbol) { name, hash, file_node, item };
+            table.count++;
+        }
+    }
+
+    return table;
+}
+
+Symbol* symbol_table_get(Symbol_Table* table, char* name) {
+    Symbol* symbol = symbol_table_find_slot(table, name, string_hash(name));
+    if (symbol->name == NULL) {
+        return NULL;
+    }
+    return symbol;
+}
+
+void symbol_table_free(Symbol_Table* table) {
+    free(table->symbols);
+}
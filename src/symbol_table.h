@@ -0,0 +1,24 @@
+#ifndef SYMBOL_TABLE__
+#define SYMBOL_TABLE__
+
+#include "ast.h"
+
+typedef struct {
+    char* name;
+    size_t hash;
+    Ast_File* file;
+    Ast_Item* item;
+} Symbol;
+
+// open addressing table of every item in the program, keyed by interned item name
+typedef struct {
+    Symbol* symbols;
+    size_t count;
+    size_t capacity;
+} Symbol_Table;
+
+Symbol_Table symbol_table_build(Program* program);
+Symbol* symbol_table_get(Symbol_Table* table, char* name);
+void symbol_table_free(Symbol_Table* table);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+size_t thread_pool_default_size() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) {
+        return 1;
+    }
+    return count;
+}
+
+static void* thread_pool_worker(void* data) {
+    Thread_Pool* pool = data;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (pool->next_job == pool->job_count && !pool->stopping) {
+            pthread_cond_wait(&pool->job_available, &pool->mutex);
+        }
+
+        if (pool->next_job == pool->job_count && pool->stopping) {
+            break;
+        }
+
+        Job job = pool->jobs[pool->next_job];
+        pool->next_job++;
+
+        pthread_mutex_unlock(&pool->mutex);
+        job.procedure(job.data);
+        pthread_mutex_lock(&pool->mutex);
+
+        pool->finished_jobs++;
+        if (pool->finished_jobs == pool->job_count) {
+            pthread_cond_broadcast(&pool->jobs_finished);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+Thread_Pool* thread_pool_new(size_t thread_count) {
+    Thread_Pool* pool = malloc(sizeof(Thread_Pool));
+    *pool = (Thread_Pool) {
+        .threads = malloc(sizeof(pthread_t) * thread_count),
+        .thread_count = thread_count,
+        .jobs = malloc(sizeof(Job) * 16),
+        .job_count = 0,
+        .job_capacity = 16,
+        .next_job = 0,
+        .finished_jobs = 0,
+        .stopping = false,
+    };
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->job_available, NULL);
+    pthread_cond_init(&pool->jobs_finished, NULL);
+
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool) != 0) {
+            printf("Error: Failed to start worker thread\n");
+            exit(1);
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_submit(Thread_Pool* pool, Job_Procedure procedure, void* data) {
+    pthread_mutex_lock(&pool->mutex);
+
+    if (pool->job_count == pool->job_capacity) {
+        pool->job_capacity *= 2;
+        pool->jobs = realloc(pool->jobs, sizeof(Job) * pool->job_capacity);
+    }
+
+    pool->jobs[pool->job_count] = (Job) { procedure, data };
+    pool->job_count++;
+
+    pthread_cond_signal(&pool->job_available);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void thread_pool_wait(Thread_Pool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->finished_jobs < pool->job_count) {
+        pthread_cond_wait(&pool->jobs_finished, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void thread_pool_free(Thread_Pool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->job_available);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->job_available);
+    pthread_cond_destroy(&pool->jobs_finished);
+    free(pool->threads);
+    free(pool->jobs);
+    free(pool);
+}
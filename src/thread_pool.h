@@ -0,0 +1,38 @@
+#ifndef THREAD_POOL__
+#define THREAD_POOL__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void (*Job_Procedure)(void* data);
+
+typedef struct {
+    Job_Procedure procedure;
+    void* data;
+} Job;
+
+// fixed set of worker threads taking jobs from a shared queue in submission order
+typedef struct {
+    pthread_t* threads;
+    size_t thread_count;
+
+    Job* jobs;
+    size_t job_count;
+    size_t job_capacity;
+    size_t next_job;
+    size_t finished_jobs;
+    bool stopping;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t job_available;
+    pthread_cond_t jobs_finished;
+} Thread_Pool;
+
+size_t thread_pool_default_size();
+Thread_Pool* thread_pool_new(size_t thread_count);
+void thread_pool_submit(Thread_Pool* pool, Job_Procedure procedure, void* data);
+void thread_pool_wait(Thread_Pool* pool);
+void thread_pool_free(Thread_Pool* pool);
+
+#endif
@@ -9,24 +9,8 @@
 
 Dynamic_Array_Impl(Token, Tokens, tokens_)
 
-bool is_keyword(char* buffer) {
-    if (strcmp(buffer, "proc") == 0)        return true;
-    else if (strcmp(buffer, "macro") == 0)  return true;
-    else if (strcmp(buffer, "type") == 0)   return true;
-    else if (strcmp(buffer, "struct") == 0) return true;
-    else if (strcmp(buffer, "union") == 0)  return true;
-    else if (strcmp(buffer, "enum") == 0)   return true;
-    else if (strcmp(buffer, "mod") == 0)    return true;
-    else if (strcmp(buffer, "global") == 0) return true;
-    else if (strcmp(buffer, "const") == 0)  return true;
-    else if (strcmp(buffer, "var") == 0)    return true;
-    else if (strcmp(buffer, "if") == 0)     return true;
-    else if (strcmp(buffer, "else") == 0)   return true;
-    else if (strcmp(buffer, "while") == 0)  return true;
-    else if (strcmp(buffer, "break") == 0)  return true;
-    else if (strcmp(buffer, "return") == 0) return true;
-
-    return false;
+bool token_equals(Token* token, char* string) {
+    return strlen(string) == token->length && memcmp(token->data, string, token->length) == 0;
 }
 
 void print_token(Token* token, bool newline) {
@@ -86,19 +70,19 @@ void print_token(Token* token, bool newline) {
             printf("!");
             break;
         case Token_Identifier:
-            printf("Identifier { \"%s\" }", token->data);
+            printf("Identifier { \"%.*s\" }", (int) token->length, token->data);
             break;
         case Token_Keyword:
-            printf("Keyword { \"%s\" }", token->data);
+            printf("Keyword { \"%.*s\" }", (int) token->length, token->data);
             break;
         case Token_Number:
-            printf("Number { \"%s\" }", token->data);
+            printf("Number { \"%.*s\" }", (int) token->length, token->data);
             break;
         case Token_Null:
             printf("Null");
             break;
         case Token_String:
-            printf("String { \"%s\" }", token->data);
+            printf("String { \"%.*s\" }", (int) token->length, token->data);
             break;
         default:
             printf("Unknown");
@@ -110,43 +94,89 @@ void print_token(Token* token, bool newline) {
     }
 }
 
-void check_append_string_token(Tokens* tokens, String_Buffer* buffer, char* file, size_t* row, size_t* col) {
-    char* buffer_contents = buffer->elements;
-    if (strlen(buffer_contents) == 0) {
+void check_append_string_token(Tokens* tokens, char* contents, size_t word_start, size_t* word_length, char* file, size_t* row, size_t* col) {
+    if (*word_length == 0) {
         return;
     }
 
+    char* word = contents + word_start;
+    Word_Id id = lookup_word(word, *word_length);
+
     Token_Kind kind;
-    if (is_keyword(buffer_contents)) {
+    if (id >= Keyword_Proc && id <= Keyword_Return) {
         kind = Token_Keyword;
-    } else if (buffer_contents[0] >= '0' && buffer_contents[0] <= '9') {
+    } else if (word[0] >= '0' && word[0] <= '9') {
         kind = Token_Number;
-    } else if (strcmp(buffer_contents, "true") == 0 || strcmp(buffer_contents, "false") == 0) {
+    } else if (id == Literal_True || id == Literal_False) {
         kind = Token_Boolean;
-    } else if (strcmp(buffer_contents, "null") == 0) {
+    } else if (id == Literal_Null) {
         kind = Token_Null;
     } else {
         kind = Token_Identifier;
     }
 
-    tokens_append(tokens, (Token) { kind, copy_string_length(buffer_contents, buffer->count), (Location) { file, *row, *col } });
-    *col += buffer->count;
-    stringbuffer_clear(buffer);
+    tokens_append(tokens, (Token) { kind, word, *word_length, id, (Location) { file, *row, *col } });
+    *col += *word_length;
+    *word_length = 0;
 }
 
+// copies a string literal containing escapes, literals without escapes are referenced in place
+char* unescape_string(char* string, size_t length, size_t* result_length, Arena* arena) {
+    char* result = arena_allocate(arena, length + 1);
 
-#define INITIAL_CAPACITY 512
+    size_t j = 0;
+    size_t i = 0;
+    while (i < length) {
+        if (string[i] == '\\') {
+            switch (string[i + 1]) {
+                case 'n':
+                    result[j] = '\n';
+                    break;
+                case '0':
+                    result[j] = '\0';
+                    break;
+                case '"':
+                    result[j] = '"';
+                    break;
+                case '\'':
+                    result[j] = '\'';
+                    break;
+                default:
+                    assert(false);
+            }
+            i += 2;
+        } else {
+            result[j] = string[i];
+            i++;
+        }
+        j++;
+    }
 
-Tokens tokenize(char* file, char* contents) {
-    size_t length = strlen(contents);
+    result[j] = 0;
+    // the string ends at the first \0, as it did when literals were stored as C strings
+    *result_length = strlen(result);
+    return result;
+}
+
+// contents is not NUL-terminated, lookahead past the end reads as 0
+char peek_character(char* contents, size_t length, size_t index) {
+    if (index >= length) {
+        return 0;
+    }
+    return contents[index];
+}
+
+Tokens tokenize(char* file, char* contents, size_t length, Arena* arena) {
+    size_t initial_capacity = length / 3 > 16 ? length / 3 : 16;
     Tokens tokens = {
-        (Token*) malloc(sizeof(Token) * (length / 3)),
+        (Token*) malloc(sizeof(Token) * initial_capacity),
         0,
-        length / 3,
+        initial_capacity,
     };
 
-    String_Buffer buffer = stringbuffer_new(32);
-    stringbuffer_clear(&buffer);
+    // the word being built is always contiguous in contents
+    size_t word_start = 0;
+    size_t word_length = 0;
 
     size_t row = 1;
     size_t col = 1;
@@ -155,6 +185,7 @@ Tokens tokenize(char* file, char* contents) {
 
     bool in_string = false;
     bool in_char = false;
+    bool has_escape = false;
 
     bool in_comment = false;
     size_t i = 0;
@@ -169,184 +200,166 @@ Tokens tokenize(char* file, char* contents) {
             }
             i++;
         } else if (in_string || in_char) {
-            if (in_string && character == '"') {
-                tokens_append(&tokens, (Token) { Token_String, copy_string(buffer.elements), (Location) { file, row, col } });
-                stringbuffer_clear(&buffer);
+            if ((in_string && character == '"') || (in_char && character == '\'')) {
+                char* data = contents + cached_i + 1;
+                size_t data_length = i - cached_i - 1;
+                if (has_escape) {
+                    data = unescape_string(data, data_length, &data_length, arena);
+                }
+
+                tokens_append(&tokens, (Token) { in_string ? Token_String : Token_Char, data, data_length, Word_None, (Location) { file, row, col } });
                 in_string = false;
-                i++;
-                col += (i - cached_i);
-            } else if (in_char && character == '\'') {
-                tokens_append(&tokens, (Token) { Token_Char, copy_string(buffer.elements), (Location) { file, row, col } });
-                stringbuffer_clear(&buffer);
                 in_char = false;
                 i++;
                 col += (i - cached_i);
+            } else if (character == '\\') {
+                has_escape = true;
+                i += 2;
             } else {
-                if (character == '\\') {
-                    switch (contents[i + 1]) {
-                        case 'n':
-                            stringbuffer_append(&buffer, '\n');
-                            break;
-                        case '0':
-                            stringbuffer_append(&buffer, '\0');
-                            break;
-                        case '"':
-                            stringbuffer_append(&buffer, '"');
-                            break;
-                        case '\'':
-                            stringbuffer_append(&buffer, '\'');
-                            break;
-                        default:
-                            assert(false);
-                    }
-                    i += 2;
-                } else {
-                    stringbuffer_append(&buffer, character);
-                    i++;
-                }
+                i++;
             }
         } else {
             switch (character) {
                 case '(':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_LeftParenthesis, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_LeftParenthesis, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case ')':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_RightParenthesis, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_RightParenthesis, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case ':':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_Colon, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_Colon, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case ';':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_Semicolon, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_Semicolon, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case ',':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_Comma, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_Comma, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '.':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '.') {
-                        tokens_append(&tokens, (Token) { Token_DoublePeriod, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '.') {
+                        tokens_append(&tokens, (Token) { Token_DoublePeriod, 0, 0, Word_None, (Location) { file, row, col } });
                         col += 2;
                         i += 2;
                     } else {
-                        tokens_append(&tokens, (Token) { Token_Period, 0, (Location) { file, row, col } });
+                        tokens_append(&tokens, (Token) { Token_Period, 0, 0, Word_None, (Location) { file, row, col } });
                         col++;
                         i++;
                     }
                     break;
                 case '=':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '=') {
-                        tokens_append(&tokens, (Token) { Token_DoubleEquals, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '=') {
+                        tokens_append(&tokens, (Token) { Token_DoubleEquals, 0, 0, Word_None, (Location) { file, row, col } });
                         col += 2;
                         i += 2;
                     } else {
-                        tokens_append(&tokens, (Token) { Token_Equals, 0, (Location) { file, row, col } });
+                        tokens_append(&tokens, (Token) { Token_Equals, 0, 0, Word_None, (Location) { file, row, col } });
                         col++;
                         i++;
                     }
                     break;
                 case '>':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '=') {
-                        tokens_append(&tokens, (Token) { Token_GreaterThanEqual, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '=') {
+                        tokens_append(&tokens, (Token) { Token_GreaterThanEqual, 0, 0, Word_None, (Location) { file, row, col } });
                         col += 2;
                         i += 2;
                     } else {
-                        tokens_append(&tokens, (Token) { Token_GreaterThan, 0, (Location) { file, row, col } });
+                        tokens_append(&tokens, (Token) { Token_GreaterThan, 0, 0, Word_None, (Location) { file, row, col } });
                         col++;
                         i++;
                     }
                     break;
                 case '<':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '=') {
-                        tokens_append(&tokens, (Token) { Token_LessThanEqual, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '=') {
+                        tokens_append(&tokens, (Token) { Token_LessThanEqual, 0, 0, Word_None, (Location) { file, row, col } });
                         i += 2;
                     } else {
-                        tokens_append(&tokens, (Token) { Token_LessThan, 0, (Location) { file, row, col } });
+                        tokens_append(&tokens, (Token) { Token_LessThan, 0, 0, Word_None, (Location) { file, row, col } });
                         i++;
                     }
                     break;
                 case '!':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '=') {
-                        tokens_append(&tokens, (Token) { Token_ExclamationEquals, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '=') {
+                        tokens_append(&tokens, (Token) { Token_ExclamationEquals, 0, 0, Word_None, (Location) { file, row, col } });
                         col += 2;
                         i += 2;
                     } else {
-                        tokens_append(&tokens, (Token) { Token_Exclamation, 0, (Location) { file, row, col } });
+                        tokens_append(&tokens, (Token) { Token_Exclamation, 0, 0, Word_None, (Location) { file, row, col } });
                         col++;
                         i++;
                     }
                     break;
                 case '+':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_Plus, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_Plus, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '-':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_Minus, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_Minus, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '*':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_Asterisk, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_Asterisk, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '/':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '/') {
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '/') {
                         in_comment = true;
                         col += 2;
                         i += 2;
                     } else {
-                        tokens_append(&tokens, (Token) { Token_Slash, 0, (Location) { file, row, col } });
+                        tokens_append(&tokens, (Token) { Token_Slash, 0, 0, Word_None, (Location) { file, row, col } });
                         col++;
                         i++;
                     }
                     break;
                 case '%':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_Percent, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_Percent, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '&':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '&') {
-                        tokens_append(&tokens, (Token) { Token_DoubleAmpersand, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '&') {
+                        tokens_append(&tokens, (Token) { Token_DoubleAmpersand, 0, 0, Word_None, (Location) { file, row, col } });
                         col += 2;
                         i += 2;
                     } else {
-                        tokens_append(&tokens, (Token) { Token_Ampersand, 0, (Location) { file, row, col } });
+                        tokens_append(&tokens, (Token) { Token_Ampersand, 0, 0, Word_None, (Location) { file, row, col } });
                         col++;
                         i++;
                     }
                     break;
                 case '|':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    if (contents[i + 1] == '|') {
-                        tokens_append(&tokens, (Token) { Token_DoubleBar, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    if (peek_character(contents, length, i + 1) == '|') {
+                        tokens_append(&tokens, (Token) { Token_DoubleBar, 0, 0, Word_None, (Location) { file, row, col } });
                         col += 2;
                         i += 2;
                     } else {
@@ -354,60 +367,65 @@ Tokens tokenize(char* file, char* contents) {
                     }
                     break;
                 case '{':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_LeftCurlyBrace, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_LeftCurlyBrace, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '}':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_RightCurlyBrace, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_RightCurlyBrace, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '[':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_LeftBracket, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_LeftBracket, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case ']':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
-                    tokens_append(&tokens, (Token) { Token_RightBracket, 0, (Location) { file, row, col } });
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
+                    tokens_append(&tokens, (Token) { Token_RightBracket, 0, 0, Word_None, (Location) { file, row, col } });
                     col++;
                     i++;
                     break;
                 case '"':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
                     in_string = true;
+                    has_escape = false;
                     cached_i = i;
                     i++;
                     break;
                 case '\'':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
                     in_char = true;
+                    has_escape = false;
                     cached_i = i;
                     i++;
                     break;
                 case ' ':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
                     col++;
                     i++;
                     break;
                 case '\n':
-                    check_append_string_token(&tokens, &buffer, file, &row, &col);
+                    check_append_string_token(&tokens, contents, word_start, &word_length, file, &row, &col);
                     col = 1;
                     row++;
                     i++;
                     break;
                 default:
-                    stringbuffer_append(&buffer, character);
+                    if (word_length == 0) {
+                        word_start = i;
+                    }
+                    word_length++;
                     i++;
 
-                    if (character >= '0' && character <= '9' && contents[i] == '.') {
-                        bool is_number_buffer = buffer.elements[0] >= '0' && buffer.elements[0] <= '9';
-                        if (is_number_buffer) {
-                            stringbuffer_append(&buffer, contents[i]);
+                    if (character >= '0' && character <= '9' && peek_character(contents, length, i) == '.') {
+                        bool is_number_word = contents[word_start] >= '0' && contents[word_start] <= '9';
+                        if (is_number_word) {
+                            word_length++;
                             i++;
                         }
                     }
@@ -417,6 +435,9 @@ Tokens tokenize(char* file, char* contents) {
         }
     }
 
-    stringbuffer_free(&buffer);
+    // the parser peeks one token past the end, make sure it sees Token_Unknown rather than leftover memory
+    tokens_append(&tokens, (Token) { Token_Unknown, 0, 0, Word_None, (Location) { file, row, col } });
+    tokens.count--;
+
     return tokens;
 }
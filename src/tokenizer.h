@@ -5,7 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "dynamic_array.h"
+#include "keywords.h"
 
 typedef enum {
     Token_Unknown, // 0 case is invalid
@@ -53,13 +55,18 @@ typedef struct {
 
 typedef struct {
     Token_Kind kind;
+    // points into the source, not NUL-terminated
     char* data;
+    size_t length;
+    // set for keywords, literals, intrinsics and builtin type names
+    Word_Id id;
     Location location;
 } Token;
 
 Dynamic_Array_Def(Token, Tokens, tokens_)
 
-Tokens tokenize(char* file, char* contents);
+Tokens tokenize(char* file, char* contents, size_t length, Arena* arena);
+bool token_equals(Token* token, char* string);
 void print_token(Token* token, bool newline);
 
 #endif
@@ -2,7 +2,17 @@ import os
 import subprocess
 import sys
 
-def run(compiler, directory):
+# code generation modes the suite is run under by the modes command, each one a list of compiler flags
+modes = [
+    [],
+    ["-registers"],
+    ["-register-calls"],
+    ["-registers", "-register-calls"],
+    ["-ir"],
+    ["-ir", "-register-calls"],
+]
+
+def run(compiler, directory, flags):
     tests_count = 0
     tests_passed = 0
 
@@ -10,7 +20,12 @@ def run(compiler, directory):
         file = open(directory + "/" + file_name)
         contents = file.readlines()
 
+        # other files the test is compiled together with, relative to where the tests are run from
+        includes = []
         for line in contents:
+            if line.startswith("//@include: "):
+                includes += line[12:].split()
+
             if line.startswith("//@out: "):
                 wanted_output = ""
                 output_line = line[8:-1]
@@ -31,7 +46,7 @@ def run(compiler, directory):
 
         passed = True
 
-        output = subprocess.run([compiler, directory + "/" + file_name], capture_output = True, text = True)
+        output = subprocess.run([compiler] + flags + [directory + "/" + file_name] + includes, capture_output = True, text = True)
         if output.returncode != 0:
             print("FAILED: " + file_name + " (compile)")
             print(output.stdout, end='')
@@ -50,16 +65,30 @@ def run(compiler, directory):
             tests_passed += 1
 
     print(" - " + str(tests_passed) + "/" + str(tests_count) + " tests passed")
+    return tests_passed == tests_count
 
 args = sys.argv
 if len(args) < 4:
-    print("Usage: test.py [compiler] [test_directory] [command]")
+    print("Usage: test.py [compiler] [test_directory] [command] [compiler flags...]")
+    print("Commands: run, modes")
     exit(1)
 
 compiler = args[1]
 directory = args[2]
 command = args[3]
+flags = args[4:]
 
 match command:
     case "run":
-        run(compiler, directory)
+        if not run(compiler, directory, flags):
+            exit(1)
+    case "modes":
+        failed = []
+        for mode in modes:
+            name = " ".join(mode) if len(mode) > 0 else "default"
+            print("== " + name)
+            if not run(compiler, directory, flags + mode):
+                failed.append(name)
+        if len(failed) > 0:
+            print("FAILED modes: " + ", ".join(failed))
+            exit(1)